@@ -0,0 +1,89 @@
+/**
+ * @file bench.h
+ * @brief Minimal host-side benchmark harness shared by the benchmark executables.
+ *
+ * Results are written to stdout as CSV (one header line, then one line per measurement) so they
+ * can be diffed or loaded into a spreadsheet to track regressions between commits.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Stop the compiler optimising away a value that is otherwise unused.
+ */
+template <typename T>
+inline void do_not_optimize(T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    volatile T sink = value;
+    (void)sink;
+#endif
+}
+
+/**
+ * @brief Time `iterations` calls of `fn`, after a short warm-up.
+ *
+ * @return average nanoseconds per call
+ */
+template <typename Fn>
+double time_ns(Fn&& fn, uint32_t iterations) {
+    const uint32_t warmup = iterations / 10 + 1;
+    for (uint32_t i = 0; i < warmup; i++) {
+        fn();
+    }
+
+    auto start = Clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = Clock::now();
+
+    auto total_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return static_cast<double>(total_ns) / iterations;
+}
+
+/**
+ * @brief Number of iterations so that each measurement processes roughly the same number of
+ * items (e.g. pixels) regardless of problem size.
+ */
+inline uint32_t iterations_for(uint32_t items, uint32_t total_items = 4'000'000, uint32_t min_iterations = 100) {
+    uint32_t n = items == 0 ? total_items : total_items / items;
+    return n < min_iterations ? min_iterations : n;
+}
+
+/**
+ * @brief Print the CSV header. Call once before any `print_row`.
+ */
+inline void print_header() {
+    std::printf("benchmark,case,variant,items,iterations,ns_per_call,ns_per_item\n");
+}
+
+/**
+ * @brief Print one CSV row.
+ *
+ * @param benchmark name of the benchmark executable/suite
+ * @param name what was measured (e.g. effect name)
+ * @param variant how it was measured (e.g. "direct" or "factory")
+ * @param items number of items (e.g. LEDs) processed per call
+ * @param iterations number of calls timed
+ * @param ns_per_call average nanoseconds per call
+ */
+inline void print_row(const char* benchmark, const char* name, const char* variant, uint32_t items,
+                      uint32_t iterations, double ns_per_call) {
+    double ns_per_item = items == 0 ? 0.0 : ns_per_call / items;
+    std::printf("%s,%s,%s,%u,%u,%.2f,%.4f\n", benchmark, name, variant, static_cast<unsigned>(items),
+                static_cast<unsigned>(iterations), ns_per_call, ns_per_item);
+}
+
+} // namespace bench
+
+#endif // BENCH_H
@@ -0,0 +1,144 @@
+/**
+ * @file bench_dmx.cpp
+ * @brief Host benchmark of `DmxReceiver` (net/dmx_receiver.h).
+ *
+ * One call is one complete frame (all universes for the LED count), so `ns_per_item` is the time
+ * per packet and 1e9 / ns_per_item is packets/s. The "parse" rows feed packets from memory; the
+ * "udp_loopback" rows send each packet through a loopback UDP socket first, so `ns_per_call` is
+ * the latency from sending a frame's first packet to that frame being presented.
+ */
+#include <cstdint>
+#include <cstdio>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "etl/array.h"
+
+#include "bench.h"
+#include "../src/net/dmx_receiver.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "dmx";
+
+constexpr size_t PACKET_BYTES = dmx::E131_DATA + dmx::MAX_CHANNELS;
+using Packet = etl::array<uint8_t, PACKET_BYTES>;
+
+struct Frames {
+    Packet packets[dmx::MAX_UNIVERSES];
+    size_t sizes[dmx::MAX_UNIVERSES];
+    uint16_t count;
+};
+
+// one frame's packets, for `universes` universes starting at `first`
+void build(Frames& frames, bool artnet, uint16_t first, uint16_t universes) {
+    etl::array<uint8_t, 510> channels;
+    for (size_t i = 0; i < channels.size(); i++) {
+        channels[i] = static_cast<uint8_t>(i);
+    }
+    frames.count = universes;
+    for (uint16_t u = 0; u < universes; u++) {
+        frames.sizes[u] = artnet ? dmx::build_artnet_dmx(frames.packets[u], first + u, 0, channels)
+                                 : dmx::build_e131_data(frames.packets[u], first + u, 0, channels);
+    }
+}
+
+// E1.31 would discard repeated sequence numbers, so bump them each frame
+void next_sequence(Frames& frames, bool artnet) {
+    if (!artnet) {
+        for (uint16_t u = 0; u < frames.count; u++) {
+            frames.packets[u][dmx::E131_SEQUENCE]++;
+        }
+    }
+}
+
+// one static chain per LED count: too big for the stack
+template <int N>
+FrameSwapChain& chain_for() {
+    static FrameSwapChain chain(N);
+    return chain;
+}
+
+template <int N>
+double bench_parse(bool artnet, uint32_t iterations) {
+    FrameSwapChain& chain = chain_for<N>();
+    static Frames frames;
+    uint16_t first = artnet ? 0 : 1;
+    uint16_t universes = DmxReceiver::universes_for(chain.num_leds());
+    DmxReceiver rx(chain, first, universes);
+    build(frames, artnet, first, universes);
+
+    return bench::time_ns([&]() {
+        next_sequence(frames, artnet);
+        for (uint16_t u = 0; u < frames.count; u++) {
+            rx.on_packet(etl::span<const uint8_t>(frames.packets[u].data(), frames.sizes[u]));
+        }
+        uint32_t presented = chain.presented();
+        bench::do_not_optimize(presented);
+    }, iterations);
+}
+
+template <int N>
+double bench_loopback(bool artnet, uint32_t iterations) {
+    FrameSwapChain& chain = chain_for<N>();
+    static Frames frames;
+    uint16_t first = artnet ? 0 : 1;
+    uint16_t universes = DmxReceiver::universes_for(chain.num_leds());
+    DmxReceiver rx(chain, first, universes);
+    build(frames, artnet, first, universes);
+
+    int rx_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int tx_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (rx_sock < 0 || tx_sock < 0 || bind(rx_sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        getsockname(rx_sock, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0) {
+        std::fprintf(stderr, "dmx: no loopback socket, skipping\n");
+        return 0.0;
+    }
+
+    Packet buffer;
+    double ns = bench::time_ns([&]() {
+        next_sequence(frames, artnet);
+        for (uint16_t u = 0; u < frames.count; u++) {
+            sendto(tx_sock, frames.packets[u].data(), frames.sizes[u], 0, reinterpret_cast<sockaddr*>(&addr),
+                   sizeof(addr));
+            ssize_t n = recv(rx_sock, buffer.data(), buffer.size(), 0);
+            if (n > 0) {
+                rx.on_packet(etl::span<const uint8_t>(buffer.data(), static_cast<size_t>(n)));
+            }
+        }
+    }, iterations);
+
+    close(tx_sock);
+    close(rx_sock);
+    return ns;
+}
+
+template <int N>
+void run(bool artnet) {
+    const char* name = artnet ? "artnet" : "e131";
+    uint16_t universes = DmxReceiver::universes_for(N);
+    uint32_t iterations = bench::iterations_for(universes, 2'000'000);
+    bench::print_row(BENCH_NAME, name, "parse", universes, iterations, bench_parse<N>(artnet, iterations));
+    iterations = bench::iterations_for(universes, 200'000);
+    bench::print_row(BENCH_NAME, name, "udp_loopback", universes, iterations, bench_loopback<N>(artnet, iterations));
+}
+
+} // namespace
+
+
+int main() {
+    bench::print_header();
+    for (bool artnet : {false, true}) {
+        run<170>(artnet);
+        run<1000>(artnet);
+        run<MAX_LEDS>(artnet);
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * @file bench_effects.cpp
+ * @brief Host benchmark of every effect in effects_lib.h, called directly and through
+ * `EffectFactory`, over a range of LED counts up to MAX_LEDS.
+ *
+ * Output is CSV (see bench.h). "direct" rows call the effect class itself, "factory" rows go
+ * through the `etl::visit` dispatch in `EffectFactory::draw_frame`; each is the fastest of `RUNS`
+ * runs, the two interleaved so both see the same machine. The "dispatch" row is the cost of the
+ * dispatch alone: `BeatBlinkEffect` draws nothing, so it's the factory's time for it less the
+ * direct call's. The "ZoneSet" row draws three effects on thirds of the strip in one call
+ * (effects/zones.h).
+ *
+ * Host timings are only useful relative to each other (or to earlier runs); they are not the
+ * cost on the RP2040.
+ */
+#include <algorithm>
+#include <cstdint>
+
+#include "etl/array.h"
+
+#include "bench.h"
+#include "../src/draw.h"
+#include "../src/effects/effects_lib.h"
+#include "../src/effects/effect_factory.h"
+#include "../src/effects/zones.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "effects";
+constexpr uint32_t FRAME_PERIOD_US = 16'667; // simulate 60 fps so time-based effects animate
+
+constexpr int led_counts[] = {60, 150, 300, 760, 1000, 1900, MAX_LEDS};
+constexpr int RUNS = 5;
+
+using Mags = etl::array<uint16_t, 129>;
+
+
+/**
+ * @brief Time `draw_frame` of `Effect` called directly.
+ */
+template <typename Effect>
+double bench_direct(int num_leds, uint32_t iterations, Mags& mags) {
+    Frame frame(num_leds);
+    std::fill(frame.data.begin(), frame.data.end(), BLACK);
+    DrawInfo<uint16_t, 129> info {FRAME_PERIOD_US, mags};
+    Effect effect;
+
+    return bench::time_ns([&]() {
+        effect.draw_frame(frame, info);
+        bench::do_not_optimize(frame.data[0]);
+    }, iterations);
+}
+
+
+/**
+ * @brief Time `draw_frame` of effect `type` called through `EffectFactory`.
+ */
+double bench_factory(EffectFactory::EffectType type, int num_leds, uint32_t iterations, Mags& mags) {
+    Frame frame(num_leds);
+    std::fill(frame.data.begin(), frame.data.end(), BLACK);
+    DrawInfo<uint16_t, 129> info {FRAME_PERIOD_US, mags};
+    EffectFactory factory;
+    factory.set_effect(type);
+
+    return bench::time_ns([&]() {
+        factory.draw_frame(frame, info);
+        bench::do_not_optimize(frame.data[0]);
+    }, iterations);
+}
+
+
+template <typename Effect>
+void bench_effect(const char* name, EffectFactory::EffectType type, Mags& mags) {
+    for (int num_leds : led_counts) {
+        Frame probe(num_leds);
+        uint32_t leds = probe.num_leds;
+        uint32_t iterations = bench::iterations_for(leds);
+
+        double direct_ns = 0;
+        double factory_ns = 0;
+        for (int run = 0; run < RUNS; run++) {
+            double direct = bench_direct<Effect>(num_leds, iterations, mags);
+            double factory = bench_factory(type, num_leds, iterations, mags);
+            direct_ns = run == 0 ? direct : std::min(direct_ns, direct);
+            factory_ns = run == 0 ? factory : std::min(factory_ns, factory);
+        }
+
+        bench::print_row(BENCH_NAME, name, "direct", leds, iterations, direct_ns);
+        bench::print_row(BENCH_NAME, name, "factory", leds, iterations, factory_ns);
+    }
+}
+
+
+/**
+ * @brief Time the `EffectFactory` dispatch by itself, with an effect that draws nothing: the
+ * difference between two effects' separate runs is mostly noise, and often negative.
+ */
+void bench_dispatch(Mags& mags) {
+    constexpr int num_leds = 300;
+    const uint32_t iterations = 10'000'000;
+    double direct_ns = 0;
+    double factory_ns = 0;
+    for (int run = 0; run < RUNS; run++) {
+        double direct = bench_direct<BeatBlinkEffect>(num_leds, iterations, mags);
+        double factory = bench_factory(EffectFactory::BEATBLINK, num_leds, iterations, mags);
+        direct_ns = run == 0 ? direct : std::min(direct_ns, direct);
+        factory_ns = run == 0 ? factory : std::min(factory_ns, factory);
+    }
+    bench::print_row(BENCH_NAME, "EffectFactory", "dispatch", 1, iterations, std::max(factory_ns - direct_ns, 0.0));
+}
+
+
+uint64_t no_clock() {
+    return 0;
+}
+
+
+/**
+ * @brief Time a `ZoneSet` splitting MAX_LEDS into three zones (laser, spectrum, fire), drawn
+ * as one call. Compare with the three effects' direct rows at a third of the LEDs each.
+ */
+void bench_zones(Mags& mags) {
+    constexpr unsigned int third = static_cast<unsigned int>(MAX_LEDS) / 3;
+    static ZoneSet zones(no_clock,
+                         Zone<LaserEffect, 0, third>{},
+                         Zone<SpectrumEffect, third, third>{},
+                         Zone<FireEffect, 2 * third, third>{});
+    Frame frame(MAX_LEDS);
+    std::fill(frame.data.begin(), frame.data.end(), BLACK);
+    DrawInfo<uint16_t, 129> info {FRAME_PERIOD_US, mags};
+    uint32_t iterations = bench::iterations_for(frame.num_leds);
+    double ns = bench::time_ns([&]() {
+        zones.draw_frame(frame, info);
+        bench::do_not_optimize(frame.data[0]);
+    }, iterations);
+    bench::print_row(BENCH_NAME, "ZoneSet", "3 zones", frame.num_leds, iterations, ns);
+}
+
+} // namespace
+
+
+int main() {
+    Mags mags {};
+    for (size_t i = 0; i < mags.size(); i++) {
+        mags[i] = static_cast<uint16_t>((i * 509) & 0xFFFF);
+    }
+
+    bench::print_header();
+
+    // Keep in step with `EffectFactory::EffectType` and effects_lib.h
+    bench_effect<LaserEffect>("LaserEffect", EffectFactory::LASER, mags);
+    bench_effect<BlinkEffect>("BlinkEffect", EffectFactory::BLINK, mags);
+    bench_effect<BeatBlinkEffect>("BeatBlinkEffect", EffectFactory::BEATBLINK, mags);
+    bench_effect<SpectrumEffect>("SpectrumEffect", EffectFactory::SPECTRUM, mags);
+    bench_effect<WaterfallEffect>("WaterfallEffect", EffectFactory::WATERFALL, mags);
+    bench_effect<TwinkleEffect>("TwinkleEffect", EffectFactory::TWINKLE, mags);
+    bench_effect<FireEffect>("FireEffect", EffectFactory::FIRE, mags);
+    bench_dispatch(mags);
+    bench_zones(mags);
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file bench_fixed.cpp
+ * @brief Host benchmark of the fixed-point types (fixed_point.h) against the hand-written shifts
+ * and clamps they replaced.
+ *
+ * Each pair of rows should take the same time: the types are meant to compile to the same code.
+ * The butterfly is the inner loop of FixedPointFFT, the 16.16 scale is LaserEffect's position. The
+ * host has an FPU, so its `float` row is a lower bound: the RP2040 emulates float in software.
+ */
+#include <cstdint>
+
+#include "etl/array.h"
+
+#include "bench.h"
+#include "../src/fixed_point.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "fixed";
+constexpr uint32_t N = 1024;
+
+etl::array<int16_t, N> a_raw;
+etl::array<int16_t, N> b_raw;
+etl::array<int16_t, N> out_raw;
+etl::array<Q15, N> a_q;
+etl::array<Q15, N> b_q;
+etl::array<Q15, N> out_q;
+
+int16_t mul_q15(int16_t a, int16_t b) {
+    int32_t result = ((int32_t)a * (int32_t)b) >> 15;
+    if (result > 32767) return 32767;
+    if (result < -32768) return -32768;
+    return (int16_t)result;
+}
+
+int16_t add_sat(int16_t a, int16_t b) {
+    int32_t result = (int32_t)a + (int32_t)b;
+    if (result > 32767) return 32767;
+    if (result < -32768) return -32768;
+    return (int16_t)result;
+}
+
+int16_t sub_sat(int16_t a, int16_t b) {
+    int32_t result = (int32_t)a - (int32_t)b;
+    if (result > 32767) return 32767;
+    if (result < -32768) return -32768;
+    return (int16_t)result;
+}
+
+template <typename Fn>
+void run(const char* name, const char* variant, Fn&& fn) {
+    uint32_t iterations = bench::iterations_for(N, 50'000'000);
+    double ns = bench::time_ns(fn, iterations);
+    bench::print_row(BENCH_NAME, name, variant, N, iterations, ns);
+}
+
+} // namespace
+
+
+int main() {
+    uint32_t lcg = 1;
+    for (uint32_t i = 0; i < N; i++) {
+        lcg = lcg * 1664525 + 1013904223;
+        a_raw[i] = static_cast<int16_t>(lcg >> 16);
+        lcg = lcg * 1664525 + 1013904223;
+        b_raw[i] = static_cast<int16_t>(lcg >> 16);
+        a_q[i] = Q15::from_raw(a_raw[i]);
+        b_q[i] = Q15::from_raw(b_raw[i]);
+    }
+
+    bench::print_header();
+
+    run("q15_mul_sat", "hand", []() {
+        for (uint32_t i = 0; i < N; i++) {
+            out_raw[i] = mul_q15(a_raw[i], b_raw[i]);
+        }
+        bench::do_not_optimize(out_raw);
+    });
+    run("q15_mul_sat", "fixed", []() {
+        for (uint32_t i = 0; i < N; i++) {
+            out_q[i] = mul_sat(a_q[i], b_q[i]);
+        }
+        bench::do_not_optimize(out_q);
+    });
+
+    // N/2 butterflies with the twiddle in b, as in FixedPointFFT::process
+    run("butterfly", "hand", []() {
+        for (uint32_t i = 0; i < N / 2; i += 2) {
+            int16_t wr = b_raw[i], wi = b_raw[i + 1];
+            uint32_t i1 = i, i2 = i + N / 2;
+            int16_t tr = sub_sat(mul_q15(a_raw[i2], wr), mul_q15(a_raw[i2 + 1], wi));
+            int16_t ti = add_sat(mul_q15(a_raw[i2], wi), mul_q15(a_raw[i2 + 1], wr));
+            out_raw[i2] = sub_sat(a_raw[i1], tr);
+            out_raw[i2 + 1] = sub_sat(a_raw[i1 + 1], ti);
+            out_raw[i1] = add_sat(a_raw[i1], tr);
+            out_raw[i1 + 1] = add_sat(a_raw[i1 + 1], ti);
+        }
+        bench::do_not_optimize(out_raw);
+    });
+    run("butterfly", "fixed", []() {
+        const ComplexQ15* a = reinterpret_cast<const ComplexQ15*>(a_q.data());
+        const ComplexQ15* w = reinterpret_cast<const ComplexQ15*>(b_q.data());
+        ComplexQ15* out = reinterpret_cast<ComplexQ15*>(out_q.data());
+        for (uint32_t i = 0; i < N / 4; i++) {
+            uint32_t i1 = i, i2 = i + N / 4;
+            ComplexQ15 t = mul_sat(a[i2], w[i]);
+            out[i2] = sub_sat(a[i1], t);
+            out[i1] = add_sat(a[i1], t);
+        }
+        bench::do_not_optimize(out_q);
+    });
+
+    // LaserEffect's position: elapsed / 50ms * length
+    static etl::array<uint32_t, N> positions;
+    run("q16_16_ratio", "float", []() {
+        for (uint32_t i = 0; i < N; i++) {
+            positions[i] = static_cast<uint32_t>((i * 97u / 50'000.0f) * 380);
+        }
+        bench::do_not_optimize(positions);
+    });
+    run("q16_16_ratio", "fixed", []() {
+        for (uint32_t i = 0; i < N; i++) {
+            positions[i] = static_cast<uint32_t>(mul_sat(Q16_16::ratio(i * 97u, 50'000), 380).to_int());
+        }
+        bench::do_not_optimize(positions);
+    });
+    return 0;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file bench_history.cpp
+ * @brief Host benchmark of the frame history ring (frame_history.h) in each storage format.
+ *
+ * "push" encodes a frame into the ring, "add_to" blends a past frame into a new one in one pass,
+ * and "two pass" does the same by decoding the past frame into a scratch `Frame` first and then
+ * blending, for comparison with the fused pass. Each format's RAM per slot is printed to stderr.
+ */
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.h"
+#include "../src/frame_history.h"
+
+using namespace fixed_literals;
+
+namespace {
+
+constexpr const char* BENCH_NAME = "history";
+constexpr unsigned int SLOTS = 4;
+
+Frame frame(MAX_LEDS);
+Frame scratch(MAX_LEDS);
+
+template <typename Format>
+void run() {
+    static FrameHistory<Format, SLOTS> history;
+    const uint32_t leds = frame.num_leds;
+    uint32_t iterations = bench::iterations_for(leds, 20'000'000);
+
+    double push_ns = bench::time_ns([&]() {
+        history.push(frame);
+        bench::do_not_optimize(frame.data[0]);
+    }, iterations);
+    bench::print_row(BENCH_NAME, Format::name, "push", leds, iterations, push_ns);
+
+    double fused_ns = bench::time_ns([&]() {
+        history.add_to(frame, 2, 0.5_q15, 3);
+        bench::do_not_optimize(frame.data[0]);
+    }, iterations);
+    bench::print_row(BENCH_NAME, Format::name, "add_to", leds, iterations, fused_ns);
+
+    double two_pass_ns = bench::time_ns([&]() {
+        for (unsigned int i = 0; i < leds; i++) {
+            scratch.data[i] = history.pixel(2, i);
+        }
+        const int32_t g = (0.5_q15).raw();
+        for (unsigned int i = 3; i < leds; i++) {
+            const RGBValue& h = scratch.data[i - 3];
+            RGBValue& p = frame.data[i];
+            p.r = static_cast<uint8_t>(std::min(255, p.r + ((h.r * g) >> 15)));
+            p.g = static_cast<uint8_t>(std::min(255, p.g + ((h.g * g) >> 15)));
+            p.b = static_cast<uint8_t>(std::min(255, p.b + ((h.b * g) >> 15)));
+        }
+        bench::do_not_optimize(frame.data[0]);
+    }, iterations);
+    bench::print_row(BENCH_NAME, Format::name, "two pass", leds, iterations, two_pass_ns);
+
+    std::fprintf(stderr, "%-8s %6zu bytes per slot of %u LEDs\n", Format::name,
+                 FrameHistory<Format, SLOTS>::slot_bytes, static_cast<unsigned>(leds));
+}
+
+} // namespace
+
+
+int main() {
+    uint32_t lcg = 1;
+    for (RGBValue& p : frame.data) {
+        lcg = lcg * 1664525 + 1013904223;
+        p = RGBValue{static_cast<uint8_t>(lcg >> 24), static_cast<uint8_t>(lcg >> 16), static_cast<uint8_t>(lcg >> 8)};
+    }
+
+    bench::print_header();
+    run<history_format::Rgb888>();
+    run<history_format::Yuv422>();
+    run<history_format::Rgb332>();
+    return 0;
+}
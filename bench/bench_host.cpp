@@ -0,0 +1,149 @@
+/**
+ * @file bench_host.cpp
+ * @brief Host benchmark of the Linux host runtime (host/host_pipeline.h): how many strips and LEDs
+ * one x86 (or AArch64) core draws at 60 fps, and the FFT's SIMD kernel against its scalar one.
+ *
+ * "fft" rows are one `FixedPointFFT::magnitudes` per call. Effect rows are one frame per call
+ * (the hops of audio due in 16.7 ms, FFT, draw and pack every strip; items = LEDs in all strips),
+ * with no sink, for 1 and 8 strips. For each effect and strip length, the most strips one core
+ * draws in 16.7 ms (up to 2048) are searched for and printed to stderr.
+ *
+ * The SIMD pipeline is then checked against the scalar one, as on the Pico: every frame's
+ * magnitudes and wire words must be the same. Exits with 1 if they aren't.
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "bench.h"
+#include "../host/host_pipeline.h"
+#include "../src/wavegen.h"
+
+namespace {
+
+using namespace fixed_literals;
+using Config = LightDancerConfig;
+using Gen = WaveGen<Config::audio_rate_hz>;
+
+constexpr const char* BENCH_NAME = "host";
+constexpr uint32_t FRAME_US = 16'667;
+constexpr int led_counts[] = {300, 1000, MAX_LEDS};
+constexpr size_t MAX_STRIPS = 2048;    // ~45 KB each at MAX_LEDS
+
+void music(Gen& gen) {
+    gen.add_tone(110, 0.25_q15);
+    gen.add_tone(880, 0.1_q15);
+    gen.set_clicks(128, 0.5_q15);
+    gen.set_noise(NoiseColor::Pink, 0.05_q15);
+}
+
+template <FftKernel Kernel>
+void bench_fft(const char* variant) {
+    static PipelineFFT<Config, Kernel> fft;
+    Gen gen;
+    music(gen);
+    etl::array<int16_t, Config::fft_n> samples;
+    gen.read(samples);
+    etl::array<uint16_t, Config::fft_bins> mags;
+    uint32_t iterations = bench::iterations_for(Config::fft_n, 100'000'000);
+    double ns = bench::time_ns([&]() {
+        fft.magnitudes(samples, mags);
+        bench::do_not_optimize(mags);
+    }, iterations);
+    bench::print_row(BENCH_NAME, "fft", variant, Config::fft_n, iterations, ns);
+}
+
+template <FftKernel Kernel>
+double frame_ns(size_t effect, size_t strips, int leds, uint32_t iterations) {
+    Gen gen;
+    music(gen);
+    HostPipeline<Gen, Kernel> pipeline(gen, strips, leds, effect);
+    return bench::time_ns([&]() {
+        pipeline.step(FRAME_US);
+    }, iterations);
+}
+
+// most strips of `leds` one core draws in a frame time, to within 1/16, searched up to `MAX_STRIPS`
+template <FftKernel Kernel>
+size_t strips_at_60fps(size_t effect, int leds) {
+    auto fits = [&](size_t strips) {
+        return frame_ns<Kernel>(effect, strips, leds, 5) < FRAME_US * 1e3;
+    };
+    size_t lo = 0;
+    size_t hi = 1;
+    while (hi <= MAX_STRIPS && fits(hi)) {
+        lo = hi;
+        hi *= 2;
+    }
+    if (hi > MAX_STRIPS) {
+        return lo;
+    }
+    while (hi - lo > 1 && hi - lo > lo / 16) {
+        size_t mid = (lo + hi) / 2;
+        (fits(mid) ? lo : hi) = mid;
+    }
+    return lo;
+}
+
+template <FftKernel Kernel>
+void bench_effect(const char* name, const char* variant, size_t effect) {
+    for (int leds : led_counts) {
+        for (size_t strips : {1, 8}) {
+            const uint32_t items = static_cast<uint32_t>(strips * leds);
+            uint32_t iterations = bench::iterations_for(items, 20'000'000, 20);
+            bench::print_row(BENCH_NAME, name, variant, items, iterations,
+                             frame_ns<Kernel>(effect, strips, leds, iterations));
+        }
+        size_t strips = strips_at_60fps<Kernel>(effect, leds);
+        std::fprintf(stderr, "%s %s: %s%u strips of %d LEDs (%u LEDs) at 60 fps\n", name, variant,
+                     strips == MAX_STRIPS ? ">= " : "", static_cast<unsigned>(strips), leds,
+                     static_cast<unsigned>(strips * leds));
+    }
+}
+
+// the SIMD pipeline draws the same frames as the scalar one
+bool bit_exact(size_t effect, int leds) {
+    Gen scalar_gen;
+    Gen simd_gen;
+    music(scalar_gen);
+    music(simd_gen);
+    HostPipeline<Gen, FftKernel::Scalar> scalar(scalar_gen, 2, leds, effect);
+    HostPipeline<Gen, FftKernel::Simd> simd(simd_gen, 2, leds, effect);
+    for (int f = 0; f < 600; f++) {
+        scalar.step(FRAME_US);
+        simd.step(FRAME_US);
+        if (scalar.magnitudes() != simd.magnitudes()) {
+            return false;
+        }
+        for (size_t s = 0; s < scalar.strips(); s++) {
+            auto a = scalar.words(s);
+            auto b = simd.words(s);
+            if (a.size() != b.size() || std::memcmp(a.data(), b.data(), a.size_bytes()) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+
+int main() {
+    bench::print_header();
+
+    bench_fft<FftKernel::Scalar>("scalar");
+    bench_fft<FftKernel::Simd>(fft_simd::name);
+
+    bench_effect<FftKernel::Scalar>("SpectrumEffect", "scalar", EffectFactory::SPECTRUM);
+    bench_effect<FftKernel::Simd>("SpectrumEffect", fft_simd::name, EffectFactory::SPECTRUM);
+    bench_effect<FftKernel::Simd>("FireEffect", fft_simd::name, EffectFactory::FIRE);
+    bench_effect<FftKernel::Simd>("LaserEffect", fft_simd::name, EffectFactory::LASER);
+
+    bool exact = true;
+    for (size_t effect : {EffectFactory::SPECTRUM, EffectFactory::WATERFALL, EffectFactory::FIRE}) {
+        exact = exact && bit_exact(effect, 1000);
+    }
+    std::fprintf(stderr, "%s kernel against scalar: %s\n", fft_simd::name, exact ? "bit-exact" : "MISMATCH");
+    return exact ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file bench_leds.cpp
+ * @brief Host benchmark of the LED protocol encoders (leds/led_protocol.h).
+ *
+ * One call packs one frame into the words the drivers DMA to the PIO. The time on the wire for
+ * the same frame, i.e. the fastest refresh of each protocol, is printed to stderr for comparison:
+ * the encoder has to be well inside it to keep the line busy. The "encode panel" rows go through
+ * a `PanelMap` (a scrolled serpentine panel) for the cost of the logical-to-physical mapping.
+ */
+#include <cstdint>
+#include <cstdio>
+
+#include "etl/array.h"
+
+#include "bench.h"
+#include "../src/leds/led_protocol.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "leds";
+
+etl::array<RGBValue, MAX_LEDS> pixels;
+etl::array<uint32_t, APA102Protocol::frame_words(MAX_LEDS) + 1> words;
+
+template <typename Protocol>
+void run(size_t num_leds) {
+    etl::span<const RGBValue> frame(pixels.data(), num_leds);
+    uint32_t iterations = bench::iterations_for(static_cast<uint32_t>(num_leds), 20'000'000);
+    double ns = bench::time_ns([&]() {
+        size_t n = encode_frame<Protocol>(frame, words);
+        bench::do_not_optimize(n);
+    }, iterations);
+    bench::print_row(BENCH_NAME, Protocol::name, "encode", static_cast<uint32_t>(num_leds), iterations, ns);
+
+    // a scrolled serpentine panel, 16 pixels wide: the mapping should cost next to nothing
+    PanelMap panel {16, true, 5};
+    double panel_ns = bench::time_ns([&]() {
+        size_t n = encode_frame<Protocol>(frame, words, panel);
+        bench::do_not_optimize(n);
+    }, iterations);
+    bench::print_row(BENCH_NAME, Protocol::name, "encode panel", static_cast<uint32_t>(num_leds), iterations, panel_ns);
+
+    uint32_t wire_us = Protocol::wire_time_us(num_leds);
+    std::fprintf(stderr, "%-12s %4u LEDs: %7u us on the wire (%5.1f fps), encode %.1f us on this host\n",
+                 Protocol::name, static_cast<unsigned>(num_leds), static_cast<unsigned>(wire_us),
+                 1e6 / wire_us, ns / 1000);
+}
+
+} // namespace
+
+
+int main() {
+    uint32_t lcg = 1;
+    for (RGBValue& p : pixels) {
+        lcg = lcg * 1664525 + 1013904223;
+        p = RGBValue{static_cast<uint8_t>(lcg >> 24), static_cast<uint8_t>(lcg >> 16), static_cast<uint8_t>(lcg >> 8)};
+    }
+
+    bench::print_header();
+    for (size_t num_leds : {size_t(100), size_t(MAX_LEDS)}) {
+        run<WS2811Protocol>(num_leds);
+        run<WS2812BProtocol>(num_leds);
+        run<SK6812RgbwProtocol>(num_leds);
+        run<APA102Protocol>(num_leds);
+        run<SK9822Protocol>(num_leds);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file bench_params.cpp
+ * @brief Host benchmark of runtime parameter blocks (params.h, serial/param_command.h): the
+ * per-frame `ParamStore::apply()` with nothing pending and with a block committed, and a write
+ * request parsed a byte at a time.
+ *
+ * Items are parameter blocks for `apply()` and request bytes for the parser.
+ */
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.h"
+#include "../src/params.h"
+#include "../src/serial/param_command.h"
+#include "../src/effects/effects_lib.h"
+#include "../src/frame_scheduler.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "params";
+
+ParamBlock<LaserEffect::Params> laser_params;
+ParamBlock<BlinkEffect::Params> blink_params;
+ParamBlock<SpectrumEffect::Params> spectrum_params;
+ParamBlock<WaterfallEffect::Params> waterfall_params;
+ParamBlock<TwinkleEffect::Params> twinkle_params;
+ParamBlock<FireEffect::Params> fire_params;
+ParamBlock<LodParams> lod_params;
+ParamStore store;
+
+} // namespace
+
+
+int main() {
+    // the blocks main.cpp registers
+    store.add(0, laser_params);
+    store.add(1, blink_params);
+    store.add(4, spectrum_params);
+    store.add(5, waterfall_params);
+    store.add(6, twinkle_params);
+    store.add(7, fire_params);
+    store.add(0x40, lod_params);
+    const uint32_t blocks = 7;
+
+    bench::print_header();
+
+    uint32_t iterations = bench::iterations_for(blocks, 100'000'000);
+    double ns = bench::time_ns([&]() {
+        bool changed = store.apply();
+        bench::do_not_optimize(changed);
+    }, iterations);
+    bench::print_row(BENCH_NAME, "apply", "nothing pending", blocks, iterations, ns);
+
+    ns = bench::time_ns([&]() {
+        store.commit(0);
+        bool changed = store.apply();
+        bench::do_not_optimize(changed);
+    }, iterations);
+    bench::print_row(BENCH_NAME, "apply", "one committed", blocks, iterations, ns);
+
+    uint8_t request[param_command::MAX_REQUEST_BYTES];
+    LaserEffect::Params p;
+    size_t len = param_command::encode_request(param_command::Type::Write, 0, 0,
+                                               etl::span<const uint8_t>(reinterpret_cast<const uint8_t*>(&p), sizeof(p)),
+                                               0, etl::span<uint8_t>(request, sizeof(request)));
+    ParamCommandParser parser(store);
+    iterations = bench::iterations_for(static_cast<uint32_t>(len), 20'000'000);
+    ns = bench::time_ns([&]() {
+        etl::span<const uint8_t> reply;
+        for (size_t i = 0; i < len; i++) {
+            reply = parser.feed(request[i]);
+        }
+        bench::do_not_optimize(reply);
+    }, iterations);
+    bench::print_row(BENCH_NAME, "parser", "write request", static_cast<uint32_t>(len), iterations, ns);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file bench_refresh.cpp
+ * @brief Host benchmark of change-driven refresh (leds/refresh_gate.h): each effect drawn and
+ * encoded as its `FrameChange` says, against encoding every frame whole.
+ *
+ * The audio alternates between 1s of music and 1s of silence at 60 fps. "gated" draws, asks the
+ * `RefreshGate` and packs what changed; "every frame" draws and packs the whole frame. The share
+ * of frames unchanged and of encoding and sends skipped is printed to stderr per effect.
+ */
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.h"
+#include "../src/effects/effect_factory.h"
+#include "../src/leds/led_protocol.h"
+#include "../src/leds/refresh_gate.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "refresh";
+constexpr uint32_t FRAME_US = 16'667;
+
+using Mags = etl::array<uint16_t, 129>;
+
+Frame frame(MAX_LEDS);
+uint32_t wire_words[LedProtocol::frame_words(MAX_LEDS)];
+
+void bench_effect(const char* name, size_t effect_type, const Mags& music) {
+    static EffectFactory factory;
+    static Mags mags {};
+    const uint32_t leds = frame.num_leds;
+    uint32_t iterations = bench::iterations_for(leds, 20'000'000);
+    uint32_t n = 0;
+    auto next_mags = [&]() {
+        mags = (n++ / 60) % 2 == 0 ? music : Mags{};
+    };
+    DrawInfo<uint16_t, 129> info {FRAME_US, mags};
+    etl::span<const RGBValue> pixels = frame.data.first(leds);
+    // the waterfall scrolls a 16 wide panel
+    const uint16_t width = effect_type == EffectFactory::WATERFALL ? 16 : 0;
+
+    factory.set_effect(effect_type);
+    double ns = bench::time_ns([&]() {
+        next_mags();
+        factory.draw_frame(frame, info);
+        encode_frame<LedProtocol>(pixels, wire_words, PanelMap{width, false, factory.row_offset()});
+        bench::do_not_optimize(wire_words[0]);
+    }, iterations);
+    bench::print_row(BENCH_NAME, name, "every frame", leds, iterations, ns);
+
+    factory.set_effect(effect_type);
+    RefreshGate gate(1'000'000);
+    uint64_t now_us = 0;
+    n = 0;
+    ns = bench::time_ns([&]() {
+        next_mags();
+        FrameChange change = factory.draw_frame(frame, info);
+        PanelMap panel {width, false, factory.row_offset()};
+        Refresh refresh = gate.update(change, leds, now_us += FRAME_US, panel);
+        if (refresh.encode.kind == FrameChange::Kind::Full) {
+            encode_frame<LedProtocol>(pixels, wire_words, panel);
+        } else if (refresh.encode.kind == FrameChange::Kind::Range) {
+            encode_pixels<LedProtocol>(pixels, wire_words, refresh.encode.begin, refresh.encode.end, panel);
+        }
+        bench::do_not_optimize(wire_words[0]);
+    }, iterations);
+    bench::print_row(BENCH_NAME, name, "gated", leds, iterations, ns);
+
+    const RefreshStats& stats = gate.stats();
+    std::fprintf(stderr, "%-16s %3u%% frames unchanged, %3u%% encoding skipped, %3u%% sends skipped\n", name,
+                 static_cast<unsigned>(static_cast<uint64_t>(stats.unchanged) * 100 / stats.frames),
+                 static_cast<unsigned>(stats.encode_skipped_percent()),
+                 static_cast<unsigned>(stats.send_skipped_percent()));
+}
+
+} // namespace
+
+
+int main() {
+    Mags music {};
+    for (size_t i = 0; i < music.size(); i++) {
+        music[i] = static_cast<uint16_t>((i * 509) & 0xFFFF);
+    }
+
+    bench::print_header();
+
+    // Keep in step with `EffectFactory::EffectType`
+    bench_effect("LaserEffect", EffectFactory::LASER, music);
+    bench_effect("BlinkEffect", EffectFactory::BLINK, music);
+    bench_effect("BeatBlinkEffect", EffectFactory::BEATBLINK, music);
+    bench_effect("SpectrumEffect", EffectFactory::SPECTRUM, music);
+    bench_effect("WaterfallEffect", EffectFactory::WATERFALL, music);
+    bench_effect("TwinkleEffect", EffectFactory::TWINKLE, music);
+    bench_effect("FireEffect", EffectFactory::FIRE, music);
+    return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file bench_serial.cpp
+ * @brief Host benchmark of the serial frame stream (serial/frame_stream.h).
+ *
+ * With no arguments, a sender thread streams frames through a pty pair into a
+ * `FrameStreamReceiver` and the sustained rate is reported (one call = one frame, items = LEDs;
+ * fps = 1e9 / ns_per_call). The "encode" and "receive" rows are the protocol cost alone, from
+ * memory.
+ *
+ * With a device argument (e.g. /dev/ttyACM0) it is the host PC sender instead: frames are written
+ * to the device for a tethered LightDancer built with the frame stream receiver and the achieved
+ * rate is reported.
+ */
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "etl/array.h"
+
+#include "bench.h"
+#include "../src/serial/frame_stream.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "serial";
+constexpr int led_counts[] = {300, 1000, MAX_LEDS};
+
+etl::array<uint8_t, frame_stream::packet_bytes(MAX_LEDS)> packet;
+RGBValue pixels[MAX_LEDS];
+
+size_t encode_frame(int num_leds, uint32_t f) {
+    for (int i = 0; i < num_leds; i++) {
+        pixels[i] = RGBValue{static_cast<uint8_t>(f + i), static_cast<uint8_t>(f), static_cast<uint8_t>(i)};
+    }
+    return frame_stream::encode(etl::span<const RGBValue>(pixels, num_leds), packet);
+}
+
+bool write_all(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void bench_protocol(FrameSwapChain& chain, int num_leds) {
+    FrameStreamReceiver rx(chain);
+    size_t len = encode_frame(num_leds, 0);
+    uint32_t iterations = bench::iterations_for(num_leds, 20'000'000);
+
+    uint32_t f = 0;
+    bench::print_row(BENCH_NAME, "encode", "memory", num_leds, iterations, bench::time_ns([&]() {
+        len = frame_stream::encode(etl::span<const RGBValue>(pixels, num_leds), packet);
+        bench::do_not_optimize(len);
+    }, iterations));
+    bench::print_row(BENCH_NAME, "receive", "memory", num_leds, iterations, bench::time_ns([&]() {
+        rx.feed(etl::span<const uint8_t>(packet.data(), len));
+        f++;
+    }, iterations));
+    if (rx.stats().frames != f) {
+        std::fprintf(stderr, "serial: %u of %u frames received\n", static_cast<unsigned>(rx.stats().frames),
+                     static_cast<unsigned>(f));
+    }
+}
+
+void bench_pty(FrameSwapChain& chain, int num_leds) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        std::fprintf(stderr, "serial: no pty, skipping\n");
+        return;
+    }
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    FrameStreamReceiver rx(chain);
+    const uint32_t frames = bench::iterations_for(num_leds, 2'000'000, 20);
+
+    auto start = bench::Clock::now();
+    std::thread sender([&]() {
+        static etl::array<uint8_t, frame_stream::packet_bytes(MAX_LEDS)> out;
+        static RGBValue frame[MAX_LEDS];
+        for (uint32_t f = 0; f < frames; f++) {
+            frame[0].r = static_cast<uint8_t>(f);
+            size_t len = frame_stream::encode(etl::span<const RGBValue>(frame, num_leds), out);
+            if (!write_all(master, out.data(), len)) {
+                return;
+            }
+        }
+    });
+    uint8_t buffer[4096];
+    while (rx.stats().frames + rx.stats().crc_errors < frames) {
+        ssize_t n = read(slave, buffer, sizeof(buffer));
+        if (n <= 0) {
+            break;
+        }
+        rx.feed(etl::span<const uint8_t>(buffer, static_cast<size_t>(n)));
+    }
+    auto end = bench::Clock::now();
+    sender.join();
+    close(slave);
+    close(master);
+
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    bench::print_row(BENCH_NAME, "stream", "pty", num_leds, frames, ns / frames);
+}
+
+int send_to_device(const char* device, int num_leds, uint32_t frames) {
+    int fd = open(device, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        std::perror(device);
+        return 1;
+    }
+    termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    auto start = bench::Clock::now();
+    for (uint32_t f = 0; f < frames; f++) {
+        size_t len = encode_frame(num_leds, f);
+        if (!write_all(fd, packet.data(), len)) {
+            std::perror(device);
+            return 1;
+        }
+    }
+    tcdrain(fd);
+    auto end = bench::Clock::now();
+    close(fd);
+
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    bench::print_header();
+    bench::print_row(BENCH_NAME, "stream", device, num_leds, frames, ns / frames);
+    std::fprintf(stderr, "%.1f fps\n", 1e9 * frames / ns);
+    return 0;
+}
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        int num_leds = argc > 2 ? std::atoi(argv[2]) : MAX_LEDS;
+        uint32_t frames = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : 300;
+        if (num_leds <= 0 || num_leds > MAX_LEDS) {
+            std::fprintf(stderr, "usage: %s [device [num_leds <= %d] [frames]]\n", argv[0], MAX_LEDS);
+            return 1;
+        }
+        return send_to_device(argv[1], num_leds, frames);
+    }
+
+    bench::print_header();
+    static FrameSwapChain chain(MAX_LEDS);
+    for (int num_leds : led_counts) {
+        bench_protocol(chain, num_leds);
+        bench_pty(chain, num_leds);
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file bench_state.cpp
+ * @brief Host benchmark of per-pixel effect state (effects/pixel_state.h): bit-packed fields
+ * against a byte per LED.
+ *
+ * "sub_sat" and "sub_sat_random" are the bulk kernels alone; "twinkle" and "fire" are whole frames
+ * of the reference effects with each storage. Each storage's RAM at MAX_LEDS is printed to stderr.
+ */
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.h"
+#include "../src/effects/effects_lib.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "state";
+
+Frame frame(MAX_LEDS);
+etl::array<uint16_t, 129> mags {};
+
+template <typename State>
+void bench_kernels(const char* name) {
+    static State state;
+    state.fill(State::max_value);
+    const uint32_t leds = MAX_LEDS;
+    uint32_t iterations = bench::iterations_for(leds, 50'000'000);
+    uint32_t rng = 1;
+
+    double ns = bench::time_ns([&]() {
+        state.sub_sat(leds, 1);
+        bench::do_not_optimize(state);
+    }, iterations);
+    bench::print_row(BENCH_NAME, name, "sub_sat", leds, iterations, ns);
+
+    ns = bench::time_ns([&]() {
+        state.sub_sat_random(leds, [&rng]() { return xorshift32(rng); }, 3);
+        bench::do_not_optimize(state);
+    }, iterations);
+    bench::print_row(BENCH_NAME, name, "sub_sat_random", leds, iterations, ns);
+
+    std::fprintf(stderr, "%-12s %6zu bytes for %u LEDs\n", name, State::bytes, static_cast<unsigned>(leds));
+}
+
+template <typename Effect>
+void bench_effect(const char* name, const char* variant) {
+    static Effect effect;
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    const uint32_t leds = frame.num_leds;
+    uint32_t iterations = bench::iterations_for(leds, 20'000'000);
+    double ns = bench::time_ns([&]() {
+        effect.draw_frame(frame, info);
+        bench::do_not_optimize(frame.data[0]);
+    }, iterations);
+    bench::print_row(BENCH_NAME, name, variant, leds, iterations, ns);
+}
+
+} // namespace
+
+
+int main() {
+    bench::print_header();
+    bench_kernels<PackedState<4, MAX_LEDS>>("packed 4 bit");
+    bench_kernels<ByteState<4, MAX_LEDS>>("byte 4 bit");
+    bench_kernels<PackedState<6, MAX_LEDS>>("packed 6 bit");
+    bench_kernels<ByteState<6, MAX_LEDS>>("byte 6 bit");
+    bench_effect<BasicTwinkleEffect<PackedState<4, MAX_LEDS>>>("twinkle", "packed");
+    bench_effect<BasicTwinkleEffect<ByteState<4, MAX_LEDS>>>("twinkle", "byte");
+    bench_effect<BasicFireEffect<PackedState<6, MAX_LEDS>>>("fire", "packed");
+    bench_effect<BasicFireEffect<ByteState<6, MAX_LEDS>>>("fire", "byte");
+    return 0;
+}
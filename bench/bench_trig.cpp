@@ -0,0 +1,148 @@
+/**
+ * @file bench_trig.cpp
+ * @brief Host benchmark of the trig library (trig.h) against what it replaced: the FFT's Taylor
+ * series `sin_q15`, the VM's 64-step table and `std::sin`/`std::atan2` in double.
+ *
+ * Each call covers `ANGLES` angles spread over the whole turn. The maximum error of each
+ * implementation (in Q15 LSBs, or 16-bit angle steps for atan2) is printed to stderr.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include "etl/array.h"
+
+#include "bench.h"
+#include "../src/trig.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "trig";
+constexpr uint32_t ANGLES = 1024;
+constexpr uint32_t ANGLE_STEP = 0x10000 / ANGLES + 1;     // odd, so every table position is hit
+
+etl::array<int32_t, ANGLES> out;
+
+// FixedPointFFT's sine before trig.h: angle in Q15 where 32767 = π
+int16_t taylor_sin_q15(int32_t angle_q15) {
+    const int32_t Q15_ONE = 32767;
+    while (angle_q15 > Q15_ONE) angle_q15 -= 2 * Q15_ONE;
+    while (angle_q15 < -Q15_ONE) angle_q15 += 2 * Q15_ONE;
+    bool negate = false;
+    if (angle_q15 < 0) {
+        negate = true;
+        angle_q15 = -angle_q15;
+    }
+    if (angle_q15 > (Q15_ONE >> 1)) {
+        angle_q15 = Q15_ONE - angle_q15;
+    }
+    int32_t x = angle_q15;
+    int32_t x2 = (x * x) >> 15;
+    int32_t x3 = (x2 * x) >> 15;
+    int32_t x5 = (x3 * x2) >> 15;
+    int32_t result = x - (x3 / 6) + (x5 / 120);
+    if (result > Q15_ONE) result = Q15_ONE;
+    if (result < -Q15_ONE) result = -Q15_ONE;
+    return negate ? -result : result;
+}
+
+// the 16-bit angle as the Taylor version's Q15 angle, -π to π
+int32_t to_taylor_angle(uint32_t angle) {
+    return static_cast<int32_t>(static_cast<int16_t>(angle)) * 32767 / 32768;
+}
+
+// the VM's sine before trig.h: 64 steps per quarter turn
+constexpr int16_t vm_quarter_sin[65] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393, 7179, 7962, 8739, 9512, 10278, 11039,
+    11793, 12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868, 19519, 20159,
+    20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790, 27245,
+    27683, 28105, 28510, 28898, 29268, 29621, 29956, 30273, 30571, 30852, 31113, 31356, 31580,
+    31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757, 32767
+};
+
+int32_t vm_sin16(uint32_t angle) {
+    angle &= 0xFFFF;
+    uint32_t quadrant = angle >> 14;
+    uint32_t idx = angle & 0x3FFF;
+    if (quadrant & 1) {
+        idx = 0x4000 - idx;
+    }
+    uint32_t i = idx >> 8;
+    uint32_t frac = idx & 0xFF;
+    int32_t v = vm_quarter_sin[i];
+    if (i < 64) {
+        v += ((vm_quarter_sin[i + 1] - v) * static_cast<int32_t>(frac)) >> 8;
+    }
+    return (quadrant & 2) ? -v : v;
+}
+
+double std_sin16(uint32_t angle) {
+    return 32767 * std::sin(2 * M_PI * (angle & 0xFFFF) / 65536);
+}
+
+template <typename Fn>
+void run(const char* name, const char* variant, Fn&& sin_fn) {
+    uint32_t iterations = bench::iterations_for(ANGLES, 50'000'000);
+    double ns = bench::time_ns([&]() {
+        uint32_t angle = 0;
+        for (uint32_t i = 0; i < ANGLES; i++) {
+            out[i] = static_cast<int32_t>(sin_fn(angle));
+            angle += ANGLE_STEP;
+        }
+        bench::do_not_optimize(out);
+    }, iterations);
+    bench::print_row(BENCH_NAME, name, variant, ANGLES, iterations, ns);
+
+    double max_error = 0;
+    for (uint32_t a = 0; a < 0x10000; a++) {
+        max_error = std::max(max_error, std::fabs(sin_fn(a) - std_sin16(a)));
+    }
+    std::fprintf(stderr, "%-6s %-8s max error %8.2f LSB\n", name, variant, max_error);
+}
+
+} // namespace
+
+
+int main() {
+    bench::print_header();
+
+    run("sin", "trig", [](uint32_t a) { return trig::sin16(a); });
+    run("sin", "taylor", [](uint32_t a) { return taylor_sin_q15(to_taylor_angle(a)); });
+    run("sin", "vm_64", [](uint32_t a) { return vm_sin16(a); });
+    run("sin", "std", [](uint32_t a) { return std::lround(std_sin16(a)); });
+
+    // atan2 over points on a circle, error in 16-bit angle steps
+    etl::array<int16_t, ANGLES> xs;
+    etl::array<int16_t, ANGLES> ys;
+    for (uint32_t i = 0; i < ANGLES; i++) {
+        xs[i] = static_cast<int16_t>(std::lround(30000 * std::cos(2 * M_PI * i / ANGLES)));
+        ys[i] = static_cast<int16_t>(std::lround(30000 * std::sin(2 * M_PI * i / ANGLES)));
+    }
+    auto std_atan2 = [](int32_t y, int32_t x) {
+        return std::atan2(static_cast<double>(y), static_cast<double>(x)) * 65536 / (2 * M_PI);
+    };
+    uint32_t iterations = bench::iterations_for(ANGLES, 50'000'000);
+    double ns = bench::time_ns([&]() {
+        for (uint32_t i = 0; i < ANGLES; i++) {
+            out[i] = trig::atan2(ys[i], xs[i]);
+        }
+        bench::do_not_optimize(out);
+    }, iterations);
+    bench::print_row(BENCH_NAME, "atan2", "trig", ANGLES, iterations, ns);
+    ns = bench::time_ns([&]() {
+        for (uint32_t i = 0; i < ANGLES; i++) {
+            out[i] = static_cast<int32_t>(std_atan2(ys[i], xs[i]));
+        }
+        bench::do_not_optimize(out);
+    }, iterations);
+    bench::print_row(BENCH_NAME, "atan2", "std", ANGLES, iterations, ns);
+
+    double max_error = 0;
+    for (uint32_t i = 0; i < ANGLES; i++) {
+        double d = std::fmod(trig::atan2(ys[i], xs[i]) - std_atan2(ys[i], xs[i]) + 2 * 65536, 65536);
+        max_error = std::max(max_error, std::fabs(d > 32768 ? d - 65536 : d));
+    }
+    std::fprintf(stderr, "%-6s %-8s max error %8.2f steps\n", "atan2", "trig", max_error);
+    return 0;
+}
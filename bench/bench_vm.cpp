@@ -0,0 +1,165 @@
+/**
+ * @file bench_vm.cpp
+ * @brief Host benchmark of `VmEffect` (effect_vm.h) against equivalent native effects.
+ *
+ * Each look is implemented natively and as a VM program. The ratio of the "vm" and "native" rows
+ * is the interpreter's overhead; the RP2040 budget for 30 fps at 1000 LEDs is ~4400 cycles per
+ * pixel at 133 MHz.
+ */
+#include <algorithm>
+#include <cstdint>
+
+#include "etl/array.h"
+
+#include "bench.h"
+#include "../src/draw.h"
+#include "../src/effects/effects_lib.h"
+#include "../src/effects/effect_vm.h"
+
+namespace {
+
+constexpr const char* BENCH_NAME = "vm";
+constexpr uint32_t FRAME_PERIOD_US = 16'667;
+constexpr int led_counts[] = {60, 300, 1000, MAX_LEDS};
+
+using Mags = etl::array<uint16_t, 129>;
+
+
+/**
+ * @brief Native plasma: two sine waves moving in opposite directions mapped through a palette.
+ */
+class NativePlasma : public EffectBase<NativePlasma> {
+    uint64_t cum_elapsed_us_ = 0;
+    static constexpr RGBValue palette_[3] = {{0, 0, 255}, {255, 0, 128}, {255, 255, 0}};
+
+    public:
+    template <typename FreqT, unsigned int FreqN>
+    void draw_frame(Frame& frame, DrawInfo<FreqT, FreqN>& info) {
+        cum_elapsed_us_ += info.elapsed_time_us;
+        int32_t t = static_cast<int32_t>(cum_elapsed_us_ / 1000) << 4;
+        for (unsigned int i = 0; i < frame.num_leds; i++) {
+            int32_t s = trig::sin16((i << 9) + t) + trig::sin16((i << 7) - t);
+            uint32_t idx = static_cast<uint32_t>(s + 65534) >> 9;
+            uint32_t pos = idx * 2;
+            uint32_t j = pos >> 8;
+            int32_t f = pos & 0xFF;
+            f += f >> 7;
+            const RGBValue& c0 = palette_[j];
+            const RGBValue& c1 = palette_[std::min(j + 1, 2u)];
+            frame.data[i] = RGBValue{static_cast<uint8_t>(c0.r + (((c1.r - c0.r) * f) >> 8)),
+                                     static_cast<uint8_t>(c0.g + (((c1.g - c0.g) * f) >> 8)),
+                                     static_cast<uint8_t>(c0.b + (((c1.b - c0.b) * f) >> 8))};
+        }
+    }
+};
+
+
+VmAssembler<512> plasma_program() {
+    VmAssembler<512> a;
+    a.palette({{0, 0, 255}, {255, 0, 128}, {255, 255, 0}});
+    a.frame(VmOp::SHLI, 8, 2, 4);       // r8 = t = ms << 4
+    a.pixel(VmOp::SHLI, 4, 0, 9);       // r4 = i << 9
+    a.pixel(VmOp::ADD, 4, 4, 8);
+    a.pixel(VmOp::SIN, 4, 4);
+    a.pixel(VmOp::SHLI, 5, 0, 7);       // r5 = i << 7
+    a.pixel(VmOp::SUB, 5, 5, 8);
+    a.pixel(VmOp::SIN, 5, 5);
+    a.pixel(VmOp::ADD, 4, 4, 5);
+    a.pixel_const(5, 65534);
+    a.pixel(VmOp::ADD, 4, 4, 5);
+    a.pixel(VmOp::SHRI, 4, 4, 9);       // 0..255
+    a.pixel(VmOp::PAL, 4, 4);
+    a.pixel(VmOp::OUT, 0, 4);
+    return a;
+}
+
+
+/**
+ * @brief `LaserEffect` as a VM program (same look, integer approximations of its float maths).
+ */
+VmAssembler<512> laser_program() {
+    VmAssembler<512> a;
+    a.frame(VmOp::ADD, 9, 9, 3);        // r9 = cumulative µs
+    a.frame(VmOp::SHRI, 12, 9, 10);     // r12 ≈ ms
+    a.frame_const(4, 6554);
+    a.frame(VmOp::MUL, 10, 1, 4);
+    a.frame(VmOp::SHRI, 10, 10, 16);    // r10 = laser length = leds / 10
+    a.frame(VmOp::MUL, 11, 12, 10);
+    a.frame_const(4, 1342);
+    a.frame(VmOp::MUL, 11, 11, 4);
+    a.frame(VmOp::SHRI, 11, 11, 16);    // r11 = position = ms * length / 50
+    a.frame(VmOp::LT, 5, 11, 1);        // on strip?
+    a.frame(VmOp::MOV, 7, 5);
+    a.frame_const(6, 0);
+    a.frame(VmOp::SEL, 5, 9, 6);        // restart at the end of the strip
+    a.frame(VmOp::MOV, 9, 5);
+    a.frame(VmOp::SEL, 7, 11, 6);
+    a.frame(VmOp::MOV, 11, 7);
+    a.frame_const(4, 1);
+    a.frame(VmOp::ADD, 13, 11, 10);
+    a.frame(VmOp::ADD, 13, 13, 4);      // r13 = end of laser
+
+    a.pixel(VmOp::LT, 4, 0, 11);        // before laser
+    a.pixel(VmOp::LT, 5, 0, 13);        // before end of laser
+    a.pixel_const(6, 1);
+    a.pixel(VmOp::XOR, 4, 4, 6);
+    a.pixel(VmOp::AND, 4, 4, 5);        // in laser
+    a.pixel_const(5, 255);
+    a.pixel(VmOp::MUL, 7, 4, 5);
+    a.pixel_const(6, 0);
+    a.pixel(VmOp::RGB, 7, 6, 6);
+    return a;
+}
+
+
+template <typename Effect>
+double bench_native(int num_leds, uint32_t iterations, Mags& mags) {
+    Frame frame(num_leds);
+    DrawInfo<uint16_t, 129> info {FRAME_PERIOD_US, mags};
+    Effect effect;
+    return bench::time_ns([&]() {
+        effect.draw_frame(frame, info);
+        bench::do_not_optimize(frame.data[0]);
+    }, iterations);
+}
+
+
+double bench_vm(etl::span<const uint8_t> program, int num_leds, uint32_t iterations, Mags& mags) {
+    Frame frame(num_leds);
+    DrawInfo<uint16_t, 129> info {FRAME_PERIOD_US, mags};
+    VmEffect effect;
+    if (effect.load(program) != VmEffect::LoadResult::Ok) {
+        return 0.0;
+    }
+    return bench::time_ns([&]() {
+        effect.draw_frame(frame, info);
+        bench::do_not_optimize(frame.data[0]);
+    }, iterations);
+}
+
+
+template <typename Native>
+void bench_look(const char* name, etl::span<const uint8_t> program, Mags& mags) {
+    for (int num_leds : led_counts) {
+        Frame probe(num_leds);
+        uint32_t leds = probe.num_leds;
+        uint32_t iterations = bench::iterations_for(leds, 2'000'000);
+        bench::print_row(BENCH_NAME, name, "native", leds, iterations, bench_native<Native>(num_leds, iterations, mags));
+        bench::print_row(BENCH_NAME, name, "vm", leds, iterations, bench_vm(program, num_leds, iterations, mags));
+    }
+}
+
+} // namespace
+
+
+int main() {
+    Mags mags {};
+    bench::print_header();
+
+    VmAssembler<512> laser = laser_program();
+    bench_look<LaserEffect>("laser", laser.build(), mags);
+
+    VmAssembler<512> plasma = plasma_program();
+    bench_look<NativePlasma>("plasma", plasma.build(), mags);
+    return 0;
+}
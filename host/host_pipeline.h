@@ -0,0 +1,159 @@
+/**
+ * @file host_pipeline.h
+ * @brief The whole LightDancer pipeline on a Linux host: audio source → `FixedPointFFT` → effects
+ * → `encode_frame`, for as many strips as one core keeps up with.
+ *
+ * It's the same code the Pico runs, with the FFT's SIMD kernel (`FftKernel::Simd`) if asked for
+ * and one `EffectFactory` and `Frame` per strip. `step()` draws one frame: the audio due since the
+ * last frame is read a hop at a time and each hop is transformed, as core 1 does, then every
+ * strip is drawn with the latest magnitudes and packed for `Protocol`. Sending is up to the caller
+ * (see led_sink.h), so benchmarks and tests time and check the pipeline alone.
+ *
+ * ```cpp
+ * WaveGen<44'100> gen;
+ * HostPipeline<WaveGen<44'100>, FftKernel::Simd> pipeline(gen, 4, 1000, EffectFactory::SPECTRUM);
+ * pipeline.step(16'667);
+ * sink.send(0, pipeline.words(0), pipeline.pixels(0));
+ * ```
+ */
+#ifndef HOST_PIPELINE_H
+#define HOST_PIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "etl/array.h"
+#include "etl/span.h"
+#include "../src/audio_source.h"
+#include "../src/config.h"
+#include "../src/draw.h"
+#include "../src/effects/effect_factory.h"
+#include "../src/leds/led_protocol.h"
+
+
+/**
+ * @param Source audio source (audio_source.h), e.g. `SpanAudioSource` over a recording
+ * @param Kernel FFT butterflies, `Scalar` as on the Pico or `Simd`
+ */
+template <typename Source, FftKernel Kernel = FftKernel::Scalar, typename Config = LightDancerConfig,
+          typename Protocol = LedProtocol>
+class HostPipeline {
+
+    static_assert(is_audio_source<Source>::value, "Source must be an audio source (audio_source.h)");
+
+    public:
+
+    using FFT = PipelineFFT<Config, Kernel>;
+    using Magnitudes = etl::array<uint16_t, Config::fft_bins>;
+
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t ffts = 0;
+        uint64_t short_reads = 0;   /// hops the source couldn't fill (end of a recording), padded with silence
+    };
+
+
+    private:
+
+    // big (a `Frame` is MAX_LEDS pixels), so each strip is allocated once, up front
+    struct Strip {
+        EffectFactory effects;
+        Frame frame;
+        std::vector<uint32_t> words;
+
+        explicit Strip(int num_leds) : frame(num_leds), words(Protocol::frame_words(frame.num_leds)) {
+        }
+    };
+
+    Source& source_;
+    FFT fft_;
+    etl::array<int16_t, Config::fft_n> window_ {};     // the last fft_n samples
+    Magnitudes magnitudes_ {};
+    uint64_t audio_due_ = 0;                            // samples due * 1e6, not read yet
+    std::vector<std::unique_ptr<Strip>> strips_;
+    Stats stats_;
+
+    // slide the window on by a hop from the source and transform it
+    void analyse_hop() {
+        constexpr size_t keep = Config::fft_n - Config::fft_hop;
+        std::memmove(window_.data(), window_.data() + Config::fft_hop, keep * sizeof(int16_t));
+        etl::span<int16_t> hop(window_.data() + keep, Config::fft_hop);
+        size_t n = source_.read(hop);
+        if (n < hop.size()) {
+            std::memset(hop.data() + n, 0, (hop.size() - n) * sizeof(int16_t));
+            stats_.short_reads++;
+        }
+        fft_.magnitudes(window_, magnitudes_);
+        stats_.ffts++;
+    }
+
+
+    public:
+
+    /**
+     * @param strips number of strips, each with its own effect
+     * @param leds_per_strip LEDs on each strip, up to `MAX_LEDS`
+     * @param effect `EffectFactory::EffectType` every strip starts with
+     */
+    HostPipeline(Source& source, size_t strips, int leds_per_strip, size_t effect) : source_(source) {
+        strips_.reserve(strips);
+        for (size_t i = 0; i < strips; i++) {
+            strips_.push_back(std::make_unique<Strip>(leds_per_strip));
+            strips_.back()->effects.set_effect(effect);
+        }
+    }
+
+    HostPipeline(const HostPipeline&) = delete;
+
+    void set_effect(size_t strip, size_t effect) {
+        strips_[strip]->effects.set_effect(effect);
+    }
+
+    /**
+     * @brief Draw and pack one frame on every strip, `elapsed_us` after the last one.
+     */
+    void step(uint32_t elapsed_us) {
+        constexpr uint64_t hop_due = static_cast<uint64_t>(Config::fft_hop) * 1'000'000;
+        audio_due_ += static_cast<uint64_t>(elapsed_us) * source_.sample_rate();
+        while (audio_due_ >= hop_due) {
+            audio_due_ -= hop_due;
+            analyse_hop();
+        }
+
+        DrawInfo<uint16_t, Config::fft_bins> info {elapsed_us, magnitudes_};
+        for (auto& strip : strips_) {
+            strip->effects.draw_frame(strip->frame, info);
+            encode_frame<Protocol>(strip->frame.data, etl::span<uint32_t>(strip->words.data(), strip->words.size()));
+        }
+        stats_.frames++;
+    }
+
+    size_t strips() const {
+        return strips_.size();
+    }
+
+    /**
+     * @brief Strip `strip`'s last frame, packed for `Protocol`.
+     */
+    etl::span<const uint32_t> words(size_t strip) const {
+        return etl::span<const uint32_t>(strips_[strip]->words.data(), strips_[strip]->words.size());
+    }
+
+    etl::span<const RGBValue> pixels(size_t strip) const {
+        return strips_[strip]->frame.data;
+    }
+
+    const Magnitudes& magnitudes() const {
+        return magnitudes_;
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+};
+
+
+#endif // HOST_PIPELINE_H
@@ -0,0 +1,223 @@
+/**
+ * @file led_sink.h
+ * @brief Where the Linux host runtime sends its frames: a file, a Unix socket or a serial bridge to
+ * a tethered LightDancer.
+ *
+ * Sinks are chosen on the command line by a spec:
+ *
+ * - `file:PATH` writes each strip's wire words (as `encode_frame` packs them) to a file
+ * - `unix:PATH` writes the same to a Unix stream socket another program listens on, e.g. a
+ *   visualiser or an SPI/USB bridge
+ * - `serial:DEV[@BAUD]` sends the first strip's pixels as frame_stream.h packets to a LightDancer
+ *   built with `LIGHTDANCER_SERIAL_STREAM`, which packs them for its own LEDs (default 3 Mbaud)
+ *
+ * File and socket records are two 32-bit words, the strip and the number of words, then the words,
+ * all in host byte order:
+ *
+ *     | strip u32 | count u32 | count words u32 |
+ *
+ * POSIX only, like bench_serial.cpp.
+ */
+#ifndef LED_SINK_H
+#define LED_SINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "etl/span.h"
+#include "../src/serial/frame_stream.h"
+
+
+class LedSink {
+
+    public:
+
+    enum class Kind : uint8_t {
+        None,
+        File,
+        Unix,
+        Serial
+    };
+
+    struct Stats {
+        uint64_t records = 0;   /// strips' frames written
+        uint64_t bytes = 0;
+        uint32_t errors = 0;    /// failed writes: the reader went away or the device is gone
+    };
+
+
+    private:
+
+    Kind kind_ = Kind::None;
+    int fd_ = -1;
+    std::vector<uint8_t> packet_;   // frame_stream packet for the serial bridge
+    Stats stats_;
+
+    static bool baud_constant(uint32_t baud, speed_t& speed) {
+        switch (baud) {
+            case 115'200: speed = B115200; return true;
+            case 230'400: speed = B230400; return true;
+            case 460'800: speed = B460800; return true;
+            case 921'600: speed = B921600; return true;
+#ifdef B3000000
+            case 1'000'000: speed = B1000000; return true;
+            case 2'000'000: speed = B2000000; return true;
+            case 3'000'000: speed = B3000000; return true;
+#endif
+            default: return false;
+        }
+    }
+
+    bool open_file(const char* path) {
+        fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        return fd_ >= 0;
+    }
+
+    bool open_unix(const char* path) {
+        sockaddr_un addr {};
+        if (std::strlen(path) >= sizeof(addr.sun_path)) {
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, path);
+        fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd_ < 0) {
+            return false;
+        }
+        return ::connect(fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    }
+
+    bool open_serial(const char* device_baud) {
+        const char* at = std::strchr(device_baud, '@');
+        uint32_t baud = at != nullptr ? static_cast<uint32_t>(std::strtoul(at + 1, nullptr, 10)) : 3'000'000;
+        speed_t speed;
+        if (!baud_constant(baud, speed)) {
+            return false;
+        }
+        std::vector<char> device(device_baud, at != nullptr ? at : device_baud + std::strlen(device_baud));
+        device.push_back('\0');
+        fd_ = ::open(device.data(), O_RDWR | O_NOCTTY);
+        if (fd_ < 0) {
+            return false;
+        }
+        termios tio;
+        if (tcgetattr(fd_, &tio) == 0) {
+            cfmakeraw(&tio);
+            cfsetspeed(&tio, speed);
+            tcsetattr(fd_, TCSANOW, &tio);
+        }
+        return true;
+    }
+
+    bool write_all(const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        while (len > 0) {
+            // no SIGPIPE if the socket's reader has gone
+            ssize_t n = kind_ == Kind::Unix ? ::send(fd_, p, len, MSG_NOSIGNAL) : ::write(fd_, p, len);
+            if (n <= 0) {
+                stats_.errors++;
+                return false;
+            }
+            p += n;
+            len -= static_cast<size_t>(n);
+            stats_.bytes += static_cast<uint64_t>(n);
+        }
+        return true;
+    }
+
+
+    public:
+
+    LedSink() = default;
+    LedSink(const LedSink&) = delete;
+
+    ~LedSink() {
+        close();
+    }
+
+    /**
+     * @brief Open the sink `spec` (see above), closing any open one.
+     *
+     * @return false if the spec is unknown or the file, socket or device can't be opened
+     */
+    bool open(const char* spec) {
+        close();
+        bool ok = false;
+        if (std::strncmp(spec, "file:", 5) == 0) {
+            kind_ = Kind::File;
+            ok = open_file(spec + 5);
+        } else if (std::strncmp(spec, "unix:", 5) == 0) {
+            kind_ = Kind::Unix;
+            ok = open_unix(spec + 5);
+        } else if (std::strncmp(spec, "serial:", 7) == 0) {
+            kind_ = Kind::Serial;
+            ok = open_serial(spec + 7);
+        }
+        if (!ok) {
+            close();
+        }
+        return ok;
+    }
+
+    void close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = -1;
+        kind_ = Kind::None;
+    }
+
+    Kind kind() const {
+        return kind_;
+    }
+
+    /**
+     * @brief Send one strip's frame: its wire words to a file or socket, its pixels over the
+     * serial bridge (strip 0 only: a tethered controller shows one strip).
+     *
+     * @return false if the write failed (counted in `stats().errors`) or nothing is open
+     */
+    bool send(uint32_t strip, etl::span<const uint32_t> words, etl::span<const RGBValue> pixels) {
+        switch (kind_) {
+            case Kind::File:
+            case Kind::Unix: {
+                const uint32_t header[2] = {strip, static_cast<uint32_t>(words.size())};
+                if (!write_all(header, sizeof(header)) || !write_all(words.data(), words.size_bytes())) {
+                    return false;
+                }
+                break;
+            }
+            case Kind::Serial: {
+                if (strip != 0) {
+                    return true;
+                }
+                packet_.resize(frame_stream::packet_bytes(static_cast<unsigned int>(pixels.size())));
+                size_t len = frame_stream::encode(pixels, etl::span<uint8_t>(packet_.data(), packet_.size()));
+                if (len == 0 || !write_all(packet_.data(), len)) {
+                    return false;
+                }
+                break;
+            }
+            case Kind::None:
+                return false;
+        }
+        stats_.records++;
+        return true;
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+};
+
+
+#endif // LED_SINK_H
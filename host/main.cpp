@@ -0,0 +1,169 @@
+/**
+ * @file main.cpp
+ * @brief LightDancer on Linux: the whole pipeline (host_pipeline.h) at 60 fps, into a file, a Unix
+ * socket or a serial bridge (led_sink.h).
+ *
+ * Usage: lightdancer_host [options]
+ *
+ *     --wav FILE      audio from a 16-bit PCM recording, looped (default: a generated beat)
+ *     --effect N      `EffectFactory::EffectType` (default 4, SPECTRUM)
+ *     --strips N      strips, each drawn and packed separately (default 1)
+ *     --leds N        LEDs per strip, up to MAX_LEDS (default 300)
+ *     --sink SPEC     file:PATH, unix:PATH or serial:DEV[@BAUD] (default: none, frames are dropped)
+ *     --frames N      stop after N frames (default: run until killed)
+ *     --fast          don't wait for the next frame time: as fast as one core goes
+ *     --scalar        the FFT's scalar kernel, as on the Pico, instead of SIMD
+ *
+ * Prints the frame rate and time per frame every second to stderr.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "host_pipeline.h"
+#include "led_sink.h"
+#include "wav_file.h"
+#include "../src/wavegen.h"
+
+namespace {
+
+using Config = LightDancerConfig;
+constexpr uint32_t frame_us = 16'667;   // 60 fps, as `FrameScheduler` on the Pico
+
+struct Options {
+    const char* wav = nullptr;
+    size_t effect = EffectFactory::SPECTRUM;
+    size_t strips = 1;
+    int leds = 300;
+    const char* sink = nullptr;
+    uint64_t frames = 0;
+    bool fast = false;
+    bool scalar = false;
+};
+
+bool parse(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(arg, "--fast") == 0) {
+            options.fast = true;
+        } else if (std::strcmp(arg, "--scalar") == 0) {
+            options.scalar = true;
+        } else if (!has_value) {
+            return false;
+        } else if (std::strcmp(arg, "--wav") == 0) {
+            options.wav = argv[++i];
+        } else if (std::strcmp(arg, "--effect") == 0) {
+            options.effect = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(arg, "--strips") == 0) {
+            options.strips = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(arg, "--leds") == 0) {
+            options.leds = std::atoi(argv[++i]);
+        } else if (std::strcmp(arg, "--sink") == 0) {
+            options.sink = argv[++i];
+        } else if (std::strcmp(arg, "--frames") == 0) {
+            options.frames = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return options.strips > 0 && options.leds > 0 && options.leds <= MAX_LEDS;
+}
+
+uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+void sleep_until_ns(uint64_t ns) {
+    timespec ts {static_cast<time_t>(ns / 1'000'000'000), static_cast<long>(ns % 1'000'000'000)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) != 0) {
+    }
+}
+
+template <FftKernel Kernel, typename Source>
+int run(Source& source, const Options& options, LedSink& sink) {
+    HostPipeline<Source, Kernel> pipeline(source, options.strips, options.leds, options.effect);
+
+    uint64_t next_frame = now_ns();
+    uint64_t next_report = next_frame + 1'000'000'000;
+    uint64_t report_frames = 0;
+    uint64_t busy_ns = 0;
+    uint64_t max_ns = 0;
+    for (uint64_t f = 0; options.frames == 0 || f < options.frames; f++) {
+        const uint64_t start = now_ns();
+        pipeline.step(frame_us);
+        for (size_t s = 0; s < pipeline.strips(); s++) {
+            if (sink.kind() != LedSink::Kind::None) {
+                sink.send(static_cast<uint32_t>(s), pipeline.words(s), pipeline.pixels(s));
+            }
+        }
+        const uint64_t end = now_ns();
+        busy_ns += end - start;
+        max_ns = end - start > max_ns ? end - start : max_ns;
+        report_frames++;
+
+        if (end >= next_report) {
+            std::fprintf(stderr, "%u fps, %.2f ms/frame (max %.2f), %u strips x %d LEDs, %s FFT, %u sink errors\n",
+                         static_cast<unsigned>(report_frames), busy_ns / 1e6 / report_frames, max_ns / 1e6,
+                         static_cast<unsigned>(options.strips), options.leds,
+                         Kernel == FftKernel::Simd ? fft_simd::name : "scalar",
+                         static_cast<unsigned>(sink.stats().errors));
+            report_frames = 0;
+            busy_ns = 0;
+            max_ns = 0;
+            next_report = end + 1'000'000'000;
+        }
+
+        next_frame += frame_us * 1'000ull;
+        if (!options.fast) {
+            sleep_until_ns(next_frame);
+        }
+    }
+    return 0;
+}
+
+template <typename Source>
+int run(Source& source, const Options& options, LedSink& sink) {
+    return options.scalar ? run<FftKernel::Scalar>(source, options, sink) : run<FftKernel::Simd>(source, options, sink);
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse(argc, argv, options)) {
+        std::fprintf(stderr, "usage: lightdancer_host [--wav FILE] [--effect N] [--strips N] [--leds N (<= %d)] "
+                             "[--sink file:PATH|unix:PATH|serial:DEV[@BAUD]] [--frames N] [--fast] [--scalar]\n",
+                     MAX_LEDS);
+        return 1;
+    }
+
+    LedSink sink;
+    if (options.sink != nullptr && !sink.open(options.sink)) {
+        std::perror(options.sink);
+        return 1;
+    }
+
+    if (options.wav != nullptr) {
+        std::vector<int16_t> samples;
+        uint32_t rate = 0;
+        if (!wav_file::read(options.wav, samples, rate)) {
+            std::fprintf(stderr, "%s: not a 16-bit PCM WAV file\n", options.wav);
+            return 1;
+        }
+        SpanAudioSource source(etl::span<const int16_t>(samples.data(), samples.size()), rate, true);
+        return run(source, options, sink);
+    }
+
+    using namespace fixed_literals;
+    WaveGen<Config::audio_rate_hz> source;
+    source.add_tone(110, 0.25_q15);
+    source.add_tone(880, 0.1_q15);
+    source.set_clicks(128, 0.5_q15);
+    return run(source, options, sink);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file wav_file.h
+ * @brief Read a recording for the host tools: the Linux host runtime and power_replay.
+ */
+#ifndef WAV_FILE_H
+#define WAV_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+namespace wav_file {
+
+    inline uint32_t le(const uint8_t* p, int bytes) {
+        uint32_t v = 0;
+        for (int i = bytes - 1; i >= 0; i--) {
+            v = (v << 8) | p[i];
+        }
+        return v;
+    }
+
+    /**
+     * @brief Read the first channel of a 16-bit PCM WAV file. Returns false if it isn't one.
+     */
+    inline bool read(const char* path, std::vector<int16_t>& samples, uint32_t& rate) {
+        FILE* f = std::fopen(path, "rb");
+        if (f == nullptr) {
+            return false;
+        }
+        std::vector<uint8_t> bytes;
+        uint8_t buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            bytes.insert(bytes.end(), buffer, buffer + n);
+        }
+        std::fclose(f);
+
+        if (bytes.size() < 12 || std::memcmp(bytes.data(), "RIFF", 4) != 0 || std::memcmp(bytes.data() + 8, "WAVE", 4) != 0) {
+            return false;
+        }
+        uint16_t channels = 0;
+        uint16_t bits = 0;
+        for (size_t pos = 12; pos + 8 <= bytes.size();) {
+            uint32_t size = le(&bytes[pos + 4], 4);
+            const uint8_t* chunk = &bytes[pos + 8];
+            if (pos + 8 + size > bytes.size()) {
+                size = static_cast<uint32_t>(bytes.size() - pos - 8);
+            }
+            if (std::memcmp(&bytes[pos], "fmt ", 4) == 0 && size >= 16) {
+                channels = static_cast<uint16_t>(le(chunk + 2, 2));
+                rate = le(chunk + 4, 4);
+                bits = static_cast<uint16_t>(le(chunk + 14, 2));
+            } else if (std::memcmp(&bytes[pos], "data", 4) == 0 && channels > 0 && bits == 16) {
+                size_t frames = size / (2u * channels);
+                samples.resize(frames);
+                for (size_t i = 0; i < frames; i++) {
+                    samples[i] = static_cast<int16_t>(le(chunk + i * 2 * channels, 2));
+                }
+                return true;
+            }
+            pos += 8 + size + (size & 1);
+        }
+        return false;
+    }
+}
+
+
+#endif // WAV_FILE_H
@@ -0,0 +1,210 @@
+/**
+ * @file arena.h
+ * @brief Static (.bss) bump allocator for short-lived scratch memory, e.g. per-frame temporaries.
+ *
+ * This is the "static pool" option described in README.md under "No Heap": memory is reserved at
+ * compile-time, so it's accounted for in `RamBudget`, and large temporaries stay off the 4K core
+ * stacks. Allocation is O(1) (bump a pointer) and memory is released in LIFO order by
+ * `ArenaScope`, typically once per frame:
+ *
+ * ```cpp
+ * Arena& arena = CoreArenas<LightDancerConfig>::get(get_core_num());
+ * while (true) {
+ *     ArenaScope frame_scope(arena);              // everything allocated below is freed at '}'
+ *     etl::span<int16_t> tmp = arena.allocate_span<int16_t>(512);
+ *     ...
+ * }
+ * ```
+ *
+ * An arena is not thread-safe: each core uses its own (see `CoreArenas`) and IRQ handlers must not
+ * allocate.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <new>
+#include <type_traits>
+#include "etl/span.h"
+
+
+/**
+ * @brief Bump allocator over a fixed buffer.
+ *
+ * Use `StaticArena` to allocate the buffer too.
+ */
+class Arena {
+
+    private:
+
+    uint8_t* buffer_;
+    size_t capacity_;
+    size_t top_ = 0;            // offset of next free byte
+    size_t high_water_ = 0;     // max value `top_` has reached
+    uint32_t failures_ = 0;     // number of allocations that didn't fit
+
+
+    public:
+
+    /**
+     * @brief Construct an arena over `capacity` bytes at `buffer`.
+     */
+    constexpr Arena(uint8_t* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief Allocate `bytes` bytes aligned to `align` (a power of 2).
+     *
+     * @return pointer to uninitialised memory, or nullptr if there is not enough space left
+     */
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(buffer_);
+        uintptr_t aligned = (base + top_ + (align - 1)) & ~static_cast<uintptr_t>(align - 1);
+        size_t start = aligned - base;
+
+        if (start > capacity_ || bytes > capacity_ - start) {
+            failures_++;
+            return nullptr;
+        }
+
+        top_ = start + bytes;
+        if (top_ > high_water_) {
+            high_water_ = top_;
+        }
+        return buffer_ + start;
+    }
+
+    /**
+     * @brief Allocate an array of `n` default-initialised `T`.
+     *
+     * `T` must be trivially destructible since destructors aren't run when memory is released.
+     *
+     * @return pointer to the first element or nullptr if there is not enough space left
+     */
+    template <typename T>
+    T* allocate(size_t n) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena never runs destructors, T must be trivially destructible");
+        if (n > SIZE_MAX / sizeof(T)) {     // n * sizeof(T) would wrap
+            failures_++;
+            return nullptr;
+        }
+        void* p = allocate(n * sizeof(T), alignof(T));
+        if (p == nullptr) {
+            return nullptr;
+        }
+        return new (p) T[n];
+    }
+
+    /**
+     * @brief Allocate `n` default-initialised `T` as a span.
+     *
+     * @return span of `n` elements, or an empty span if there is not enough space left
+     */
+    template <typename T>
+    etl::span<T> allocate_span(size_t n) {
+        T* p = allocate<T>(n);
+        return p == nullptr ? etl::span<T>() : etl::span<T>(p, n);
+    }
+
+    /**
+     * @brief Current allocation position, to pass to `release(size_t)` later.
+     */
+    size_t marker() const {
+        return top_;
+    }
+
+    /**
+     * @brief Free everything allocated since `marker()` returned `marker`.
+     */
+    void release(size_t marker) {
+        if (marker < top_) {
+            top_ = marker;
+        }
+    }
+
+    /** @brief Bytes currently allocated (including alignment padding). */
+    size_t used() const { return top_; }
+
+    /** @brief Total bytes in the arena. */
+    size_t capacity() const { return capacity_; }
+
+    /** @brief Most bytes ever allocated at once. Use this to size the arena. */
+    size_t high_water() const { return high_water_; }
+
+    /** @brief Number of allocations that returned nullptr because the arena was full. */
+    uint32_t failures() const { return failures_; }
+
+    /** @brief Reset `high_water()` and `failures()`, e.g. after start-up. */
+    void reset_stats() {
+        high_water_ = top_;
+        failures_ = 0;
+    }
+};
+
+
+/**
+ * @brief `Arena` with its own `Bytes` sized buffer. Declare it static (or global) so the buffer
+ * is in .bss.
+ */
+template <size_t Bytes>
+class StaticArena : public Arena {
+
+    private:
+    alignas(std::max_align_t) uint8_t storage_[Bytes];
+
+    public:
+    StaticArena() : Arena(storage_, Bytes) {
+    }
+};
+
+
+/**
+ * @brief RAII scope marker. Everything allocated from `arena` during the lifetime of this object
+ * is released when it is destroyed. Scopes may be nested.
+ */
+class ArenaScope {
+
+    private:
+    Arena& arena_;
+    size_t marker_;
+
+    public:
+    explicit ArenaScope(Arena& arena) : arena_(arena), marker_(arena.marker()) {
+    }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    ~ArenaScope() {
+        arena_.release(marker_);
+    }
+};
+
+
+/**
+ * @brief One scratch arena per core, sized by a `PipelineConfig`.
+ *
+ * Core 0 (effects and LED output) and Core 1 (audio analysis) each get their own region so no
+ * locking is needed.
+ */
+template <typename Config>
+struct CoreArenas {
+
+    static inline StaticArena<Config::core0_arena_bytes> core0;
+    static inline StaticArena<Config::core1_arena_bytes> core1;
+
+    /**
+     * @brief Arena for `core` (0 or 1), e.g. `CoreArenas<Config>::get(get_core_num())`
+     */
+    static Arena& get(unsigned int core) {
+        return core == 0 ? static_cast<Arena&>(core0) : static_cast<Arena&>(core1);
+    }
+};
+
+
+#endif // ARENA_H
@@ -0,0 +1,111 @@
+/**
+ * @file audio_level.h
+ * @brief Cheap per-block audio level measures: an envelope follower and an adaptive noise floor.
+ *
+ * Both work on the mean absolute sample value of a block (0..32767 for int16_t audio) with
+ * integer one-pole filters, so they can run on every audio block on the M0+ even when the FFT is
+ * throttled.
+ */
+#ifndef AUDIO_LEVEL_H
+#define AUDIO_LEVEL_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "etl/span.h"
+
+
+/**
+ * @brief Mean absolute value of a block of samples.
+ */
+inline uint16_t block_level(etl::span<const int16_t> samples) {
+    if (samples.empty()) {
+        return 0;
+    }
+    uint32_t sum = 0;
+    for (int16_t s : samples) {
+        sum += static_cast<uint32_t>(s < 0 ? -static_cast<int32_t>(s) : s);
+    }
+    uint32_t mean = sum / samples.size();
+    return static_cast<uint16_t>(mean > 32767 ? 32767 : mean);
+}
+
+
+/**
+ * @brief Envelope follower: rises quickly with the level and decays slowly.
+ *
+ * Each block moves the envelope 1/2^AttackShift of the way up to a louder level, or
+ * 1/2^ReleaseShift of the way down to a quieter one.
+ */
+template <unsigned int AttackShift = 1, unsigned int ReleaseShift = 5>
+class EnvelopeFollower {
+
+    uint32_t envelope_ = 0; // 16.8 fixed point so slow releases still move
+
+    public:
+
+    /**
+     * @brief Update with the level of the next block (see `block_level`).
+     *
+     * @return the envelope, same scale as `level`
+     */
+    uint16_t update(uint16_t level) {
+        uint32_t target = static_cast<uint32_t>(level) << 8;
+        if (target > envelope_) {
+            envelope_ += (target - envelope_ + (1u << AttackShift) - 1) >> AttackShift;
+        } else {
+            envelope_ -= (envelope_ - target) >> ReleaseShift;
+        }
+        return value();
+    }
+
+    uint16_t value() const {
+        return static_cast<uint16_t>(envelope_ >> 8);
+    }
+
+    void reset() {
+        envelope_ = 0;
+    }
+};
+
+
+/**
+ * @brief Noise floor estimate: follows the level straight down, creeps up very slowly.
+ *
+ * So during music it stays near the quietest recent passage, and in silence it settles on the
+ * background (room, amplifier hiss, ADC noise). Rising takes roughly 2^RiseShift blocks.
+ */
+template <unsigned int RiseShift = 12>
+class NoiseFloor {
+
+    uint32_t floor_;   // 16.16 fixed point
+
+    public:
+
+    /**
+     * @param initial starting estimate, e.g. the loudest expected background
+     */
+    explicit NoiseFloor(uint16_t initial = 32767) : floor_(static_cast<uint32_t>(initial) << 16) {
+    }
+
+    /**
+     * @brief Update with the level of the next block.
+     *
+     * @return the floor, same scale as `level`
+     */
+    uint16_t update(uint16_t level) {
+        uint32_t target = static_cast<uint32_t>(level) << 16;
+        if (target < floor_) {
+            floor_ = target;
+        } else {
+            floor_ += ((target - floor_) >> RiseShift) + 1;
+        }
+        return value();
+    }
+
+    uint16_t value() const {
+        return static_cast<uint16_t>(floor_ >> 16);
+    }
+};
+
+
+#endif // AUDIO_LEVEL_H
@@ -0,0 +1,85 @@
+/**
+ * @file audio_source.h
+ * @brief The interface audio comes into the pipeline through, so capture, recordings and
+ * generated signals are interchangeable.
+ *
+ * An audio source is any class with:
+ *
+ * ```cpp
+ * struct Source {
+ *     uint32_t sample_rate() const;                // samples per second
+ *     size_t read(etl::span<int16_t> samples);     // the next samples, returns how many were written
+ * };
+ * ```
+ *
+ * `read` never blocks: a capture driver returns what it has, a generator always fills the span.
+ * Consumers are templated on the source (see `is_audio_source`), like the LED drivers' `Hal`.
+ * `WaveGen` in wavegen.h generates test signals; `SpanAudioSource` replays samples from memory.
+ */
+#ifndef AUDIO_SOURCE_H
+#define AUDIO_SOURCE_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include "etl/span.h"
+
+
+/**
+ * @brief true if `T` has the audio source interface above.
+ */
+template <typename T, typename = void>
+struct is_audio_source : std::false_type {
+};
+
+template <typename T>
+struct is_audio_source<T, std::void_t<
+    decltype(static_cast<uint32_t>(std::declval<const T&>().sample_rate())),
+    decltype(static_cast<size_t>(std::declval<T&>().read(std::declval<etl::span<int16_t>>())))>>
+    : std::true_type {
+};
+
+
+/**
+ * @brief Audio source over samples in memory, e.g. a recording, optionally looped.
+ */
+class SpanAudioSource {
+
+    private:
+
+    etl::span<const int16_t> samples_;
+    uint32_t sample_rate_;
+    bool loop_;
+    size_t pos_ = 0;
+
+
+    public:
+
+    SpanAudioSource(etl::span<const int16_t> samples, uint32_t sample_rate, bool loop = false)
+        : samples_(samples), sample_rate_(sample_rate), loop_(loop) {
+    }
+
+    uint32_t sample_rate() const {
+        return sample_rate_;
+    }
+
+    size_t read(etl::span<int16_t> out) {
+        size_t n = 0;
+        while (n < out.size() && !samples_.empty()) {
+            if (pos_ == samples_.size()) {
+                if (!loop_) {
+                    break;
+                }
+                pos_ = 0;
+            }
+            out[n++] = samples_[pos_++];
+        }
+        return n;
+    }
+};
+
+static_assert(is_audio_source<SpanAudioSource>::value, "SpanAudioSource is an audio source");
+
+
+#endif // AUDIO_SOURCE_H
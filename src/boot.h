@@ -0,0 +1,137 @@
+/**
+ * @file boot.h
+ * @brief Fast boot to first light: a "boot look" packed for the LEDs at compile time and sent
+ * from flash by DMA as soon as the LED driver is up, and the boot milestones timed for the report.
+ *
+ * Without it the strip stays dark from reset until the first effect frame, while everything else
+ * is set up. With it the LEDs show the boot look within a frame's wire time of the driver starting,
+ * and audio analysis is brought up on core 1 while core 0 starts the effects. Pack the look for as
+ * many LEDs as the frames that follow it: LEDs beyond the frames would keep the look, and a longer
+ * look only takes longer on the wire (3800 WS2811 LEDs take 114ms, 100 take 3ms).
+ *
+ * There's no milestone for the first audio-reactive frame: nothing captures audio yet, so it would
+ * only time the FFT being constructed. Add one with the capture driver.
+ *
+ * ```cpp
+ * static constexpr auto look = boot::encode_look<LedProtocol, 100>(boot::ember);  // in flash
+ * leds.send_words(look.span());
+ * leds.wait_until_latched();
+ * boot_times.mark(BootTimes::Stage::FirstLatch, time_us_64());
+ * ```
+ *
+ * No hardware access, like refresh_gate.h.
+ */
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "etl/span.h"
+#include "draw.h"
+
+
+namespace boot {
+
+    /**
+     * @brief A frame already packed for a protocol, header and trailer included.
+     */
+    template <size_t NumWords>
+    struct Look {
+        uint32_t words[NumWords];
+
+        constexpr etl::span<const uint32_t> span() const {
+            return etl::span<const uint32_t>(words, NumWords);
+        }
+    };
+
+    /**
+     * @brief Pack `NumLeds` pixels for `Protocol` at compile time.
+     *
+     * @param pixel constexpr `RGBValue pixel(size_t i, size_t num_leds)` giving LED i's colour
+     */
+    template <typename Protocol, size_t NumLeds, typename Pixel>
+    constexpr Look<Protocol::frame_words(NumLeds)> encode_look(Pixel pixel) {
+        Look<Protocol::frame_words(NumLeds)> look {};
+        size_t w = Protocol::header_words();    // header and trailer words are zero
+        for (size_t i = 0; i < NumLeds; i++) {
+            look.words[w++] = Protocol::pack(pixel(i, NumLeds));
+        }
+        return look;
+    }
+
+    /**
+     * @brief A dim, warm glow, brightest in the middle of the strip: a few mA per LED, so it's
+     * safe on any power supply before the power policy is running.
+     */
+    constexpr RGBValue ember(size_t i, size_t num_leds) {
+        const size_t half = num_leds / 2;
+        const size_t from_middle = i < half ? half - i : i - half;
+        const uint32_t level = half == 0 ? 32 : static_cast<uint32_t>(32 - from_middle * 24 / half);  // 8..32
+        return RGBValue{static_cast<uint8_t>(level), static_cast<uint8_t>(level * 3 / 8), static_cast<uint8_t>(level / 16)};
+    }
+}
+
+
+/**
+ * @brief When each boot milestone was reached, in µs since reset (the RP2040 timer starts at 0).
+ */
+class BootTimes {
+
+    public:
+
+    enum class Stage : uint8_t {
+        FirstLatch = 0,     /// the boot look is latched by the LEDs
+        Effects = 1,        /// the first effect frame is drawn
+    };
+    static constexpr size_t STAGES = 2;
+
+
+    private:
+
+    uint64_t us_[STAGES] = {};
+    uint8_t reached_ = 0;       // bit per `Stage`
+    bool reported_ = false;
+
+
+    public:
+
+    /**
+     * @brief Stage reached at `now_us`. Only the first time counts.
+     */
+    void mark(Stage stage, uint64_t now_us) {
+        const uint8_t bit = static_cast<uint8_t>(1u << static_cast<uint8_t>(stage));
+        if ((reached_ & bit) == 0) {
+            us_[static_cast<size_t>(stage)] = now_us;
+            reached_ |= bit;
+        }
+    }
+
+    bool reached(Stage stage) const {
+        return (reached_ & (1u << static_cast<uint8_t>(stage))) != 0;
+    }
+
+    /**
+     * @return µs since reset that `stage` was reached, or 0 if it hasn't been
+     */
+    uint64_t us(Stage stage) const {
+        return us_[static_cast<size_t>(stage)];
+    }
+
+    bool complete() const {
+        return reached_ == (1u << STAGES) - 1;
+    }
+
+    /**
+     * @brief True once, when every stage has been reached: time to print the report.
+     */
+    bool take_report() {
+        if (reported_ || !complete()) {
+            return false;
+        }
+        reported_ = true;
+        return true;
+    }
+};
+
+
+#endif // BOOT_H
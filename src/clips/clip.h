@@ -0,0 +1,723 @@
+/**
+ * @file clip.h
+ * @brief Compressed pre-rendered animation clips, e.g. choreographed sequences stored in flash.
+ *
+ * Raw frames are far too big for flash (3800 LEDs * 3 bytes * 30 fps is 342KB per second), so a
+ * clip stores each frame either as a **key** frame (run-length coded pixels) or a **delta** frame
+ * (run-length coded XOR against its key frame, which is mostly zero runs for animations where
+ * little changes).
+ *
+ * Deltas are against the key frame rather than the previous frame so a frame can be decoded by
+ * streaming its record and its key frame's record side by side, directly from XIP flash, into
+ * the LED wire buffer or a small chunk buffer. No decompressed frame is needed in RAM and any
+ * frame can be decoded without decoding the ones before it. Pixels decoded into wire words are
+ * packed for the LED protocol (`LedProtocol::pack`, see leds/led_protocol.h), like `encode_frame`.
+ *
+ * Layout (all multi-byte fields little endian):
+ * | Offset | Size     | Field                                          |
+ * |--------|----------|------------------------------------------------|
+ * | 0      | 4        | magic "LDCL"                                   |
+ * | 4      | 1        | version (1)                                    |
+ * | 5      | 1        | reserved (0)                                   |
+ * | 6      | 2        | number of LEDs per frame                       |
+ * | 8      | 4        | number of frames F                             |
+ * | 12     | 4        | frame period in µs                             |
+ * | 16     | 4 * F    | offset of each frame record from the start     |
+ * Frame record:
+ * | 0      | 1        | type (0 key, 1 delta)                          |
+ * | 1      | 3        | reserved (0)                                   |
+ * | 4      | 4        | index of the key frame (delta frames)          |
+ * | 8      | 4        | payload length in bytes                        |
+ * | 12     | ...      | RLE payload                                    |
+ * RLE payload is a sequence of tokens, each starting with a control byte c:
+ * - c & 0x80: a run of (c & 0x7F) + 1 copies of the following {r, g, b}
+ * - otherwise: (c + 1) literal pixels {r, g, b} follow
+ */
+#ifndef CLIP_H
+#define CLIP_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include "etl/span.h"
+#include "../draw.h"
+#include "../leds/led_protocol.h"
+
+
+namespace clip_detail {
+
+    constexpr uint8_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 16;
+    constexpr size_t RECORD_HEADER_SIZE = 12;
+    constexpr uint8_t KEY = 0;
+    constexpr uint8_t DELTA = 1;
+    constexpr uint32_t MAX_TOKEN = 128;
+
+    inline uint32_t read_u16(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8);
+    }
+
+    inline uint32_t read_u32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline void write_u16(uint8_t* p, uint32_t v) {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    inline void write_u32(uint8_t* p, uint32_t v) {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+        p[2] = static_cast<uint8_t>(v >> 16);
+        p[3] = static_cast<uint8_t>(v >> 24);
+    }
+
+    inline uint32_t to_rgb(const RGBValue& c) {
+        return (static_cast<uint32_t>(c.r) << 16) | (static_cast<uint32_t>(c.g) << 8) | c.b;
+    }
+
+    inline uint32_t read_rgb(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+    }
+
+    inline RGBValue from_rgb(uint32_t rgb) {
+        return RGBValue{static_cast<uint8_t>(rgb >> 16), static_cast<uint8_t>(rgb >> 8), static_cast<uint8_t>(rgb)};
+    }
+
+    // Pixel formats a clip can be decoded into: wire words packed for `Protocol`, or `RGBValue`
+    template <typename Protocol>
+    void store(uint32_t& out, uint32_t rgb) { out = Protocol::pack(from_rgb(rgb)); }
+    template <typename Protocol>
+    void store(RGBValue& out, uint32_t rgb) { out = from_rgb(rgb); }
+
+
+    /**
+     * @brief Streaming reader of an RLE payload.
+     */
+    class RleReader {
+
+        private:
+        const uint8_t* p_ = nullptr;
+        const uint8_t* end_ = nullptr;
+        const uint8_t* literal_ = nullptr;
+        uint32_t run_rgb_ = 0;
+        uint32_t remaining_ = 0;
+        bool error_ = false;
+
+        bool load() {
+            if (p_ >= end_) {
+                error_ = true;
+                return false;
+            }
+            uint8_t c = *p_++;
+            uint32_t count = (c & 0x7F) + 1;
+            if (c & 0x80) {
+                if (end_ - p_ < 3) {
+                    error_ = true;
+                    return false;
+                }
+                run_rgb_ = read_rgb(p_);
+                literal_ = nullptr;
+                p_ += 3;
+            } else {
+                if (static_cast<uint32_t>(end_ - p_) < 3 * count) {
+                    error_ = true;
+                    return false;
+                }
+                literal_ = p_;
+                p_ += 3 * count;
+            }
+            remaining_ = count;
+            return true;
+        }
+
+        public:
+
+        /**
+         * @brief Part of a token: a run of `count` x `rgb` if `literal` is null, otherwise
+         * `count` literal pixels at `literal`.
+         */
+        struct Segment {
+            const uint8_t* literal;
+            uint32_t rgb;
+            uint32_t count;
+        };
+
+        RleReader() = default;
+        RleReader(const uint8_t* begin, const uint8_t* end) : p_(begin), end_(end) {}
+
+        /**
+         * @brief Pixels left in the current token (loading the next token if needed). If the
+         * payload is exhausted or corrupt this returns `max` and `next` returns black runs.
+         */
+        uint32_t available(uint32_t max) {
+            if (remaining_ == 0 && (error_ || !load())) {
+                return max;
+            }
+            return std::min(remaining_, max);
+        }
+
+        /**
+         * @brief Consume `count` pixels, which must be <= `available(count)`.
+         */
+        Segment next(uint32_t count) {
+            if (remaining_ == 0) {
+                return Segment{nullptr, 0, count}; // error: black
+            }
+            Segment s{literal_, run_rgb_, count};
+            if (literal_ != nullptr) {
+                literal_ += 3 * count;
+            }
+            remaining_ -= count;
+            return s;
+        }
+
+        bool error() const {
+            return error_;
+        }
+    };
+
+
+    /**
+     * @brief Streaming RLE encoder writing into a fixed buffer.
+     */
+    class RleWriter {
+
+        private:
+        uint8_t* out_;
+        uint8_t* end_;
+        uint8_t* p_;
+        uint8_t* literal_ctrl_ = nullptr;   // control byte of the open literal token
+        uint32_t literal_count_ = 0;
+        uint32_t cur_ = 0;
+        uint32_t cur_count_ = 0;
+        bool overflow_ = false;
+
+        void put_rgb(uint32_t rgb) {
+            p_[0] = static_cast<uint8_t>(rgb >> 16);
+            p_[1] = static_cast<uint8_t>(rgb >> 8);
+            p_[2] = static_cast<uint8_t>(rgb);
+            p_ += 3;
+        }
+
+        void close_literal() {
+            if (literal_ctrl_ != nullptr) {
+                *literal_ctrl_ = static_cast<uint8_t>(literal_count_ - 1);
+                literal_ctrl_ = nullptr;
+                literal_count_ = 0;
+            }
+        }
+
+        void emit(uint32_t rgb, uint32_t count) {
+            if (count >= 2) {
+                close_literal();
+                if (end_ - p_ < 4) {
+                    overflow_ = true;
+                    return;
+                }
+                *p_++ = static_cast<uint8_t>(0x80 | (count - 1));
+                put_rgb(rgb);
+                return;
+            }
+            if (literal_ctrl_ == nullptr) {
+                if (end_ - p_ < 1) {
+                    overflow_ = true;
+                    return;
+                }
+                literal_ctrl_ = p_++;
+            }
+            if (end_ - p_ < 3) {
+                overflow_ = true;
+                return;
+            }
+            put_rgb(rgb);
+            if (++literal_count_ == MAX_TOKEN) {
+                close_literal();
+            }
+        }
+
+        public:
+
+        RleWriter(uint8_t* out, uint8_t* end) : out_(out), end_(end), p_(out) {}
+
+        void put(uint32_t rgb) {
+            if (overflow_) {
+                return;
+            }
+            if (cur_count_ > 0 && (rgb != cur_ || cur_count_ == MAX_TOKEN)) {
+                emit(cur_, cur_count_);
+                cur_count_ = 0;
+            }
+            cur_ = rgb;
+            cur_count_++;
+        }
+
+        /**
+         * @brief Flush pending pixels.
+         *
+         * @return bytes written, or 0 if the buffer was too small
+         */
+        size_t finish() {
+            if (cur_count_ > 0 && !overflow_) {
+                emit(cur_, cur_count_);
+                cur_count_ = 0;
+            }
+            close_literal();
+            return overflow_ ? 0 : static_cast<size_t>(p_ - out_);
+        }
+    };
+}
+
+
+/**
+ * @brief Plays a clip from memory (XIP flash or RAM) without copying it.
+ *
+ * ```cpp
+ * ClipPlayer player;
+ * player.open(clip_bytes);
+ * player.begin_frame(player.frame_at(elapsed_us));
+ * while (player.remaining() > 0) {
+ *     size_t n = player.decode(chunk);  // e.g. a 64 word chunk of the wire buffer
+ *     ...
+ * }
+ * // or a whole frame into the wire buffer, start and end frames included
+ * player.decode_frame(player.frame_at(elapsed_us), wire_words);
+ * ```
+ */
+class ClipPlayer {
+
+    public:
+
+    /**
+     * @brief Result of `open`.
+     */
+    enum class OpenResult {
+        Ok,
+        TooShort,
+        BadMagic,
+        BadVersion,
+        BadIndex        /// a frame record is outside the clip or refers to a bad key frame
+    };
+
+
+    private:
+
+    const uint8_t* clip_ = nullptr;
+    size_t size_ = 0;
+    uint32_t num_leds_ = 0;
+    uint32_t frame_count_ = 0;
+    uint32_t frame_period_us_ = 0;
+
+    clip_detail::RleReader key_;
+    clip_detail::RleReader delta_;
+    bool is_delta_ = false;
+    uint32_t remaining_ = 0;
+
+
+    const uint8_t* record(uint32_t index) const {
+        return clip_ + clip_detail::read_u32(clip_ + clip_detail::HEADER_SIZE + 4 * index);
+    }
+
+    clip_detail::RleReader payload(const uint8_t* rec) const {
+        const uint8_t* begin = rec + clip_detail::RECORD_HEADER_SIZE;
+        return clip_detail::RleReader(begin, begin + clip_detail::read_u32(rec + 8));
+    }
+
+    bool record_ok(uint32_t index) const {
+        using namespace clip_detail;
+        // no sums that could wrap: offset and len come from the clip
+        uint32_t offset = read_u32(clip_ + HEADER_SIZE + 4 * index);
+        if (size_ < RECORD_HEADER_SIZE || offset > size_ - RECORD_HEADER_SIZE) {
+            return false;
+        }
+        const uint8_t* rec = clip_ + offset;
+        uint32_t len = read_u32(rec + 8);
+        return rec[0] <= DELTA && len <= size_ - RECORD_HEADER_SIZE - offset;
+    }
+
+
+    public:
+
+    /**
+     * @brief Open a clip. The clip is not copied and must outlive the player.
+     */
+    OpenResult open(etl::span<const uint8_t> clip) {
+        using namespace clip_detail;
+        clip_ = nullptr;
+        remaining_ = 0;
+
+        if (clip.size() < HEADER_SIZE) {
+            return OpenResult::TooShort;
+        }
+        const uint8_t* p = clip.data();
+        if (p[0] != 'L' || p[1] != 'D' || p[2] != 'C' || p[3] != 'L') {
+            return OpenResult::BadMagic;
+        }
+        if (p[4] != VERSION) {
+            return OpenResult::BadVersion;
+        }
+        uint32_t frame_count = read_u32(p + 8);
+        if (clip.size() < HEADER_SIZE + 4 * static_cast<size_t>(frame_count)) {
+            return OpenResult::TooShort;
+        }
+
+        clip_ = p;
+        size_ = clip.size();
+        num_leds_ = read_u16(p + 6);
+        frame_count_ = frame_count;
+        frame_period_us_ = read_u32(p + 12);
+
+        for (uint32_t i = 0; i < frame_count_; i++) {
+            bool ok = record_ok(i);
+            if (ok && record(i)[0] == DELTA) {
+                uint32_t key = read_u32(record(i) + 4);
+                ok = key < frame_count_ && record_ok(key) && record(key)[0] == KEY;
+            }
+            if (!ok) {
+                clip_ = nullptr;
+                return OpenResult::BadIndex;
+            }
+        }
+        return OpenResult::Ok;
+    }
+
+    bool is_open() const { return clip_ != nullptr; }
+    uint32_t num_leds() const { return num_leds_; }
+    uint32_t frame_count() const { return frame_count_; }
+    uint32_t frame_period_us() const { return frame_period_us_; }
+
+    /**
+     * @brief Index of the frame to show `time_us` after the clip started, looping.
+     */
+    uint32_t frame_at(uint64_t time_us) const {
+        if (frame_count_ == 0 || frame_period_us_ == 0) {
+            return 0;
+        }
+        return static_cast<uint32_t>((time_us / frame_period_us_) % frame_count_);
+    }
+
+    /**
+     * @brief Start decoding frame `index`.
+     *
+     * @return false if the clip isn't open or `index` is out of range
+     */
+    bool begin_frame(uint32_t index) {
+        if (!is_open() || index >= frame_count_) {
+            remaining_ = 0;
+            return false;
+        }
+        const uint8_t* rec = record(index);
+        is_delta_ = rec[0] == clip_detail::DELTA;
+        if (is_delta_) {
+            key_ = payload(record(clip_detail::read_u32(rec + 4)));
+            delta_ = payload(rec);
+        } else {
+            key_ = payload(rec);
+        }
+        remaining_ = num_leds_;
+        return true;
+    }
+
+    /**
+     * @brief Pixels of the current frame not decoded yet.
+     */
+    uint32_t remaining() const {
+        return remaining_;
+    }
+
+    /**
+     * @brief Decode the next pixels of the current frame into `out`.
+     *
+     * Wire words are only the pixels: a frame's first pixel goes `Protocol::header_words()` into
+     * the wire buffer, and the protocol's start and end frames are left to the caller (see
+     * `decode_frame` for a whole frame).
+     *
+     * @param out wire words (`uint32_t`, packed with `Protocol::pack`) or `RGBValue`s
+     * @return number of pixels written: `out.size()`, or fewer at the end of the frame
+     */
+    template <typename Protocol = LedProtocol, typename Pixel>
+    size_t decode(etl::span<Pixel> out) {
+        using clip_detail::RleReader;
+        uint32_t n = static_cast<uint32_t>(std::min<size_t>(out.size(), remaining_));
+        Pixel* dst = out.data();
+        uint32_t i = 0;
+
+        while (i < n) {
+            uint32_t m = key_.available(n - i);
+            if (is_delta_) {
+                m = delta_.available(m);
+            }
+            RleReader::Segment k = key_.next(m);
+
+            if (!is_delta_) {
+                if (k.literal == nullptr) {
+                    Pixel value;
+                    clip_detail::store<Protocol>(value, k.rgb);
+                    std::fill(dst + i, dst + i + m, value);
+                } else {
+                    for (uint32_t j = 0; j < m; j++) {
+                        clip_detail::store<Protocol>(dst[i + j], clip_detail::read_rgb(k.literal + 3 * j));
+                    }
+                }
+            } else {
+                RleReader::Segment d = delta_.next(m);
+                if (k.literal == nullptr && d.literal == nullptr) {
+                    Pixel value;
+                    clip_detail::store<Protocol>(value, k.rgb ^ d.rgb);
+                    std::fill(dst + i, dst + i + m, value);
+                } else {
+                    for (uint32_t j = 0; j < m; j++) {
+                        uint32_t kv = k.literal ? clip_detail::read_rgb(k.literal + 3 * j) : k.rgb;
+                        uint32_t dv = d.literal ? clip_detail::read_rgb(d.literal + 3 * j) : d.rgb;
+                        clip_detail::store<Protocol>(dst[i + j], kv ^ dv);
+                    }
+                }
+            }
+            i += m;
+        }
+
+        remaining_ -= n;
+        return n;
+    }
+
+    /**
+     * @brief Decode frame `index` into `frame` (up to the smaller of the two LED counts).
+     */
+    bool decode_frame(uint32_t index, Frame& frame) {
+        if (!begin_frame(index)) {
+            return false;
+        }
+        decode(frame.data);
+        return true;
+    }
+
+    /**
+     * @brief Decode frame `index` over the frame already in `frame`, and report which pixels
+     * differ from it, e.g. to send only those.
+     *
+     * @return the pixels that changed, or `FrameChange::full()` if the frame can't be decoded
+     */
+    FrameChange decode_frame_changes(uint32_t index, Frame& frame) {
+        if (!begin_frame(index)) {
+            return FrameChange::full();
+        }
+        RGBValue chunk[32];
+        unsigned int first = frame.num_leds;
+        unsigned int last = 0;
+        unsigned int pos = 0;
+        while (pos < frame.num_leds) {
+            size_t n = decode(etl::span<RGBValue>(chunk, std::min<size_t>(32, frame.num_leds - pos)));
+            if (n == 0) {
+                break;
+            }
+            for (size_t i = 0; i < n; i++, pos++) {
+                if (chunk[i].as_RGB() != frame.data[pos].as_RGB()) {
+                    first = std::min(first, pos);
+                    last = pos + 1;
+                    frame.data[pos] = chunk[i];
+                }
+            }
+        }
+        return FrameChange::range(first, last);
+    }
+
+    /**
+     * @brief Decode frame `index` into `words` packed for `Protocol`, with its start and end
+     * frames, as `encode_frame` would pack it.
+     *
+     * @return number of words written, `Protocol::frame_words(num_leds())`, or 0 if the frame
+     * can't be decoded or `words` is too small
+     */
+    template <typename Protocol = LedProtocol>
+    size_t decode_frame(uint32_t index, etl::span<uint32_t> words) {
+        const size_t n = Protocol::frame_words(num_leds_);
+        if (words.size() < n || !begin_frame(index)) {
+            return 0;
+        }
+        uint32_t* out = words.data();
+        for (size_t i = 0; i < Protocol::header_words(); i++) {
+            *out++ = 0;
+        }
+        out += decode<Protocol>(etl::span<uint32_t>(out, num_leds_));
+        for (size_t i = 0; i < Protocol::trailer_words(num_leds_); i++) {
+            *out++ = 0;
+        }
+        return n;
+    }
+};
+
+
+/**
+ * @brief Writes a clip into a fixed buffer, choosing key or delta coding per frame, whichever is
+ * smaller.
+ *
+ * The key frame for deltas is read back from the buffer being written, so no copy of it is
+ * needed in RAM.
+ */
+class ClipWriter {
+
+    private:
+
+    uint8_t* buf_ = nullptr;
+    size_t capacity_ = 0;
+    size_t pos_ = 0;
+    uint32_t num_leds_ = 0;
+    uint32_t max_frames_ = 0;
+    uint32_t frame_count_ = 0;
+    uint32_t key_index_ = 0;
+    bool has_key_ = false;
+    bool overflow_ = false;
+
+    // write record header and payload at `at`, return total record size or 0 if it didn't fit
+    template <typename GetRgb>
+    size_t write_record(size_t at, uint8_t type, uint32_t key_index, GetRgb&& get_rgb) {
+        using namespace clip_detail;
+        if (at + RECORD_HEADER_SIZE > capacity_) {
+            return 0;
+        }
+        uint8_t* rec = buf_ + at;
+        RleWriter rle(rec + RECORD_HEADER_SIZE, buf_ + capacity_);
+        for (uint32_t i = 0; i < num_leds_; i++) {
+            rle.put(get_rgb(i));
+        }
+        size_t len = rle.finish();
+        if (len == 0) {
+            return 0;
+        }
+        rec[0] = type;
+        rec[1] = rec[2] = rec[3] = 0;
+        write_u32(rec + 4, key_index);
+        write_u32(rec + 8, static_cast<uint32_t>(len));
+        return RECORD_HEADER_SIZE + len;
+    }
+
+
+    public:
+
+    /**
+     * @brief Start a clip in `buffer`.
+     *
+     * @param num_leds LEDs per frame (<= 65535)
+     * @param frame_period_us time each frame is shown
+     * @param max_frames most frames that will be added
+     * @return false if the header and index don't fit in `buffer`
+     */
+    bool begin(etl::span<uint8_t> buffer, uint32_t num_leds, uint32_t frame_period_us, uint32_t max_frames) {
+        using namespace clip_detail;
+        buf_ = buffer.data();
+        capacity_ = buffer.size();
+        num_leds_ = num_leds;
+        max_frames_ = max_frames;
+        frame_count_ = 0;
+        has_key_ = false;
+        overflow_ = num_leds > 0xFFFF || capacity_ < HEADER_SIZE + 4 * static_cast<size_t>(max_frames);
+        if (overflow_) {
+            return false;
+        }
+        buf_[0] = 'L'; buf_[1] = 'D'; buf_[2] = 'C'; buf_[3] = 'L';
+        buf_[4] = VERSION;
+        buf_[5] = 0;
+        write_u16(buf_ + 6, num_leds);
+        write_u32(buf_ + 8, 0);
+        write_u32(buf_ + 12, frame_period_us);
+        pos_ = HEADER_SIZE + 4 * static_cast<size_t>(max_frames);
+        return true;
+    }
+
+    /**
+     * @brief Append a frame. Pixels beyond `pixels.size()` are black.
+     *
+     * @return false if it doesn't fit (the clip so far remains valid)
+     */
+    bool add_frame(etl::span<const RGBValue> pixels) {
+        using namespace clip_detail;
+        if (overflow_ || frame_count_ == max_frames_) {
+            return false;
+        }
+
+        auto pixel = [&](uint32_t i) { return i < pixels.size() ? to_rgb(pixels[i]) : 0u; };
+
+        size_t key_size = write_record(pos_, KEY, 0, pixel);
+        uint8_t type = KEY;
+        size_t size = key_size;
+
+        if (has_key_) {
+            // delta against the current key frame, streamed back out of the buffer
+            size_t delta_at = pos_ + key_size;
+            const uint8_t* rec = buf_ + read_u32(buf_ + HEADER_SIZE + 4 * key_index_);
+            RleReader key_reader(rec + RECORD_HEADER_SIZE, rec + RECORD_HEADER_SIZE + read_u32(rec + 8));
+            RleReader::Segment seg{nullptr, 0, 0};
+            uint32_t seg_pos = 0;
+            auto delta = [&](uint32_t i) {
+                if (seg_pos == seg.count) {
+                    seg = key_reader.next(key_reader.available(num_leds_ - i));
+                    seg_pos = 0;
+                }
+                uint32_t kv = seg.literal ? read_rgb(seg.literal + 3 * seg_pos) : seg.rgb;
+                seg_pos++;
+                return pixel(i) ^ kv;
+            };
+            size_t delta_size = write_record(delta_at, DELTA, key_index_, delta);
+            if (delta_size != 0 && (key_size == 0 || delta_size < key_size)) {
+                std::memmove(buf_ + pos_, buf_ + delta_at, delta_size);
+                type = DELTA;
+                size = delta_size;
+            }
+        }
+
+        if (size == 0) {
+            return false;
+        }
+        if (type == KEY) {
+            key_index_ = frame_count_;
+            has_key_ = true;
+        }
+        write_u32(buf_ + HEADER_SIZE + 4 * frame_count_, static_cast<uint32_t>(pos_));
+        pos_ += size;
+        frame_count_++;
+        return true;
+    }
+
+    /**
+     * @brief Finish the clip, removing unused index entries.
+     *
+     * @return the clip (in the buffer passed to `begin`)
+     */
+    etl::span<const uint8_t> finish() {
+        using namespace clip_detail;
+        if (overflow_) {
+            return etl::span<const uint8_t>();
+        }
+        size_t unused = 4 * static_cast<size_t>(max_frames_ - frame_count_);
+        size_t records_at = HEADER_SIZE + 4 * static_cast<size_t>(max_frames_);
+        std::memmove(buf_ + records_at - unused, buf_ + records_at, pos_ - records_at);
+        for (uint32_t i = 0; i < frame_count_; i++) {
+            uint8_t* entry = buf_ + HEADER_SIZE + 4 * i;
+            write_u32(entry, static_cast<uint32_t>(read_u32(entry) - unused));
+        }
+        pos_ -= unused;
+        max_frames_ = frame_count_;
+        write_u32(buf_ + 8, frame_count_);
+        return etl::span<const uint8_t>(buf_, pos_);
+    }
+
+    /**
+     * @brief Number of frames added so far.
+     */
+    uint32_t frame_count() const {
+        return frame_count_;
+    }
+
+    /**
+     * @brief Bytes used so far.
+     */
+    size_t size() const {
+        return pos_;
+    }
+};
+
+
+#endif // CLIP_H
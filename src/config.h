@@ -0,0 +1,96 @@
+/**
+ * @file config.h
+ * @brief Compile-time configuration of the whole LightDancer pipeline.
+ *
+ * Every size that affects memory (LED count, FFT size, buffer depths, ...) is set here, once,
+ * and each subsystem is specialised from it. `RamBudget` in ram_budget.h sums the resulting
+ * memory use and fails the build if it does not fit, instead of hard-faulting at run-time.
+ *
+ * To size a deployment, change the `LightDancerConfig` alias at the bottom of this file.
+ */
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "fixedpoint_fft.h" // WindowType, FixedPointFFT
+
+
+/**
+ * @brief Pipeline configuration.
+ *
+ * @param MaxLeds maximum number of LEDs (drivers) across all lanes
+ * @param Lanes number of LED strips driven in parallel, each gets MaxLeds / Lanes LEDs
+ * @param FftN number of audio samples per FFT (power of 2)
+ * @param FftHop number of new audio samples between FFTs (<= FftN)
+ * @param Window FFT window function
+ * @param Bands number of frequency bands derived from the FFT bins for effects
+ * @param AudioRateHz audio sample rate
+ * @param AudioBlocks number of FFT-sized audio sample buffers (e.g. 2 for double-buffered capture)
+ * @param FrameBuffers number of `Frame`s effects draw into: main.cpp has 1, which the LED driver
+ *        encodes from while the next frame waits (the wire buffer is the back buffer)
+ * @param Core0ArenaBytes size of Core 0's (effects) scratch arena, see arena.h (unused so far)
+ * @param Core1ArenaBytes size of Core 1's (analysis) scratch arena, see arena.h: at least the FFT's
+ *        work buffer, FftN * 4 bytes
+ * @param PeriodicCacheBytes size of the clip buffer one period of a repeating effect is
+ *        pre-rendered into, see effects/periodic_cache.h
+ */
+template <unsigned int MaxLeds = 3800,
+          unsigned int Lanes = 1,
+          uint16_t FftN = 256,
+          uint16_t FftHop = 128,
+          WindowType Window = WindowType::Hann,
+          unsigned int Bands = 16,
+          uint32_t AudioRateHz = 44'100,
+          unsigned int AudioBlocks = 2,
+          unsigned int FrameBuffers = 1,
+          size_t Core0ArenaBytes = 8 * 1024,
+          size_t Core1ArenaBytes = 4 * 1024,
+          size_t PeriodicCacheBytes = 8 * 1024>
+struct PipelineConfig {
+
+    static_assert(MaxLeds > 0, "MaxLeds must be > 0");
+    static_assert(Lanes >= 1 && Lanes <= 8, "Lanes must be between 1 and 8 (PIO state machines)");
+    static_assert(MaxLeds % Lanes == 0, "MaxLeds must be a multiple of Lanes");
+    static_assert(FftHop > 0 && FftHop <= FftN, "FftHop must be between 1 and FftN");
+    static_assert(Bands > 0 && Bands <= FftN / 2 + 1, "Bands must be between 1 and FftN/2+1");
+    static_assert(AudioRateHz > 0, "AudioRateHz must be > 0");
+    static_assert(AudioBlocks >= 1, "AudioBlocks must be >= 1");
+    static_assert(FrameBuffers >= 1, "FrameBuffers must be >= 1");
+
+    static constexpr unsigned int max_leds = MaxLeds;
+    static constexpr unsigned int lanes = Lanes;
+    static constexpr unsigned int leds_per_lane = MaxLeds / Lanes;
+    static constexpr uint16_t fft_n = FftN;
+    static constexpr uint16_t fft_hop = FftHop;
+    static constexpr WindowType fft_window = Window;
+    static constexpr unsigned int fft_bins = FftN / 2 + 1;
+    static constexpr unsigned int bands = Bands;
+    static constexpr uint32_t audio_rate_hz = AudioRateHz;
+    static constexpr unsigned int audio_blocks = AudioBlocks;
+    static constexpr unsigned int frame_buffers = FrameBuffers;
+    static constexpr size_t core0_arena_bytes = Core0ArenaBytes;
+    static constexpr size_t core1_arena_bytes = Core1ArenaBytes;
+    static constexpr size_t periodic_cache_bytes = PeriodicCacheBytes;
+
+    /// FFTs per second
+    static constexpr uint32_t fft_rate_hz = AudioRateHz / FftHop;
+
+    // the LED data rate and time on the wire depend on the chips: see `LedProtocol` (leds/led_protocol.h)
+};
+
+
+/**
+ * @brief FFT type specialised from a `PipelineConfig`. The Linux host runtime uses `FftKernel::Simd`.
+ */
+template <typename Config, FftKernel Kernel = FftKernel::Scalar>
+using PipelineFFT = FixedPointFFT<Config::fft_n, int16_t, uint16_t, Config::fft_window, Kernel>;
+
+
+/**
+ * @brief Configuration used by the application.
+ */
+using LightDancerConfig = PipelineConfig<>;
+
+
+#endif // CONFIG_H
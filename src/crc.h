@@ -0,0 +1,62 @@
+/**
+ * @file crc.h
+ * @brief CRC-32 (IEEE 802.3, as used by zlib and Ethernet) for checking framed binary messages.
+ */
+#ifndef CRC_H
+#define CRC_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "etl/array.h"
+
+
+namespace crc_detail {
+
+    constexpr uint32_t CRC32_POLY = 0xEDB88320; // reflected
+
+    constexpr etl::array<uint32_t, 256> make_crc32_table() {
+        etl::array<uint32_t, 256> table {};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (CRC32_POLY ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+        return table;
+    }
+
+    inline constexpr etl::array<uint32_t, 256> crc32_table = make_crc32_table(); // 1K in flash
+}
+
+
+/**
+ * @brief Incremental CRC-32: `update` with each chunk as it arrives, then read `value`.
+ *
+ * `Crc32().update(data, size).value()` of "123456789" is 0xCBF43926.
+ */
+class Crc32 {
+    uint32_t crc_ = 0xFFFFFFFF;
+
+    public:
+
+    constexpr Crc32& update(const uint8_t* data, size_t size) {
+        uint32_t c = crc_;
+        for (size_t i = 0; i < size; i++) {
+            c = crc_detail::crc32_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+        }
+        crc_ = c;
+        return *this;
+    }
+
+    constexpr uint32_t value() const {
+        return crc_ ^ 0xFFFFFFFF;
+    }
+
+    constexpr void reset() {
+        crc_ = 0xFFFFFFFF;
+    }
+};
+
+
+#endif // CRC_H
@@ -3,10 +3,12 @@
 
 #include <cstdint>
 #include <algorithm>
+#include <type_traits>
 #include "etl/span.h"
 #include "etl/array.h"
+#include "config.h"
 
-#define MAX_LEDS 3800 /// @todo Put this in global config for stack memory layout - or const?
+#define MAX_LEDS static_cast<int>(LightDancerConfig::max_leds) /// set in config.h
 #define MULTIPLE_OF_FOUR(n) ((n + 3) / 4) * 4
 #define MAX_LED_DATA_LEN MULTIPLE_OF_FOUR(MAX_LEDS)
 
@@ -40,16 +42,37 @@ struct RGBValue {
 #define YELLOW RGBValue{0xFF, 0xFF, 0}
 
 
+/**
+ * @brief Pixels an effect draws into: a whole `Frame`, or part of one (e.g. a zone, see
+ * effects/zones.h). It doesn't own the pixels, so it's cheap to make on the stack.
+ */
+class FrameView {
+
+    public:
+
+    etl::span<RGBValue> data;      /// mutable pixel data
+    const unsigned int num_leds;   /// number of LEDs (specifically LED drivers) in this view
+
+    /**
+     * @param pixels pixels of a `Frame`, which must outlive the view
+     */
+    explicit FrameView(etl::span<RGBValue> pixels) : data(pixels),
+                                                     num_leds(static_cast<unsigned int>(pixels.size())) {
+    }
+};
+
+
 /**
  * @brief Memory buffer of LED pixel values.
  * 
- * Memory is allocated on the stack for MAX_LEDS at compile-time, however the actual number of LEDs
- * can be set at runtime in the constructor, capped to MAX_LEDS to prevent stack overrun.
- * Stack requirement is slightly > sizeof(RGBValue) * MAX_LEDS.
+ * Memory is allocated for MAX_LEDS at compile-time, however the actual number of LEDs
+ * can be set at runtime in the constructor, capped to MAX_LEDS to prevent overrun.
+ * Memory requirement is slightly > sizeof(RGBValue) * MAX_LEDS, which is more than a core's 4K
+ * stack, so Frames should be static (see `RamBudget` in ram_budget.h).
  * 
  * Memory can be read, written, and iterated using the 'data` member.
  */
-class Frame {
+class Frame : public FrameView {
     
     private:
     
@@ -59,9 +82,6 @@ class Frame {
 
     public:
 
-    etl::span<RGBValue> data;      /// mutable pixel data (can be less than MAX_LEDS)
-    const unsigned int num_leds;   /// number of LEDs (specifically LED drivers) in this frame
-
     /**
      * @brief Construct a Frame instance.
      * 
@@ -71,8 +91,7 @@ class Frame {
      * (capped) is available in the 'num_leds' member and this should be used for the actual number
      * of leds going forward.  
      */
-    Frame(int num_of_leds) : data(&inner_data_[0], num_of_leds),
-                             num_leds(std::min(num_of_leds, MAX_LEDS)){
+    Frame(int num_of_leds) : FrameView(etl::span<RGBValue>(&inner_data_[0], std::min(num_of_leds, MAX_LEDS))) {
     };
 
     
@@ -81,7 +100,7 @@ class Frame {
 
 
 /**
- * @brief Information passed to `Effect::draw_frame(Frame&, const DrawInfo&)`
+ * @brief Information passed to `Effect::draw_frame(FrameView&, const DrawInfo&)`
  * 
  * @param FreqT data type of the magnitudes of the Fast Fourier Transform (typically some form of
  *        integer)
@@ -93,7 +112,96 @@ struct DrawInfo {
     uint32_t elapsed_time_us; /// Microseconds since `draw_frame` was called last time. The first call may be slightly > 0us
         
     etl::array<FreqT, FreqN>& freq_magnitudes; /// Magnitudes of a FFT spread between 0Hz and the sample rate of the FFT
+
+    uint64_t time_us = 0; /// Time the frame is drawn at: shared µs when controllers are synced (see
+                          /// sync/clock_sync.h), so effects can line up their phase, else local µs
+};
+
+
+
+/**
+ * @brief What `draw_frame` changed since the effect last drew into the same frame: nothing, a
+ * range of pixels, or all of them. The LED pipeline skips encoding and sending what hasn't changed
+ * (see leds/refresh_gate.h).
+ *
+ * An effect reporting less than `Full` relies on the frame still holding what it drew last, so
+ * always draw an effect into the same `Frame`. Its first frame, and the first after the LED count
+ * changes, must be `Full`.
+ */
+struct FrameChange {
+
+    enum class Kind : uint8_t {
+        Unchanged,
+        Range,      /// pixels `begin` to `end - 1`
+        Full
+    };
+
+    Kind kind = Kind::Full;
+    uint16_t begin = 0;
+    uint16_t end = 0;
+
+    static constexpr FrameChange none() {
+        return FrameChange{Kind::Unchanged, 0, 0};
+    }
+
+    static constexpr FrameChange full() {
+        return FrameChange{Kind::Full, 0, 0};
+    }
+
+    /**
+     * @brief Pixels `first` to `last - 1`; nothing if the range is empty.
+     */
+    static constexpr FrameChange range(unsigned int first, unsigned int last) {
+        return first < last ? FrameChange{Kind::Range, static_cast<uint16_t>(first), static_cast<uint16_t>(last)}
+                            : none();
+    }
+
+    constexpr bool unchanged() const {
+        return kind == Kind::Unchanged;
+    }
+
+    /**
+     * @brief Both changes, e.g. of two zones: ranges are joined with the pixels in between.
+     */
+    constexpr FrameChange merge(const FrameChange& other) const {
+        if (kind == Kind::Full || other.kind == Kind::Full) {
+            return full();
+        }
+        if (kind == Kind::Unchanged) {
+            return other;
+        }
+        if (other.kind == Kind::Unchanged) {
+            return *this;
+        }
+        return range(begin < other.begin ? begin : other.begin, end > other.end ? end : other.end);
+    }
+
+    /**
+     * @brief The change of a view of `length` pixels starting at pixel `start`, in the pixels of
+     * the whole frame.
+     */
+    constexpr FrameChange within(unsigned int start, unsigned int length) const {
+        if (kind == Kind::Full) {
+            return range(start, start + length);
+        }
+        return kind == Kind::Range ? range(start + begin, start + end) : none();
+    }
 };
 
 
+/**
+ * @brief `effect.draw_frame(frame, info)` and what it changed. Effects whose `draw_frame` returns
+ * nothing (e.g. test effects) changed everything.
+ */
+template <typename Effect, typename FrameT, typename FreqT, unsigned int FreqN>
+FrameChange draw_effect(Effect& effect, FrameT& frame, DrawInfo<FreqT, FreqN>& info) {
+    if constexpr (std::is_void<decltype(effect.draw_frame(frame, info))>::value) {
+        effect.draw_frame(frame, info);
+        return FrameChange::full();
+    } else {
+        return effect.draw_frame(frame, info);
+    }
+}
+
+
 #endif // DRAW_H
\ No newline at end of file
@@ -7,12 +7,29 @@ EffectFactory::EffectFactory(): ev_(LaserEffect{}){
 
 
 void EffectFactory::set_effect(const size_t index) {
+    generation_++;
     switch (index) {
         case LASER: ev_.emplace<LaserEffect>(); break;
         case BLINK: ev_.emplace<BlinkEffect>(); break;
         case BEATBLINK: ev_.emplace<BeatBlinkEffect>(); break;
+        case VM: ev_.emplace<VmEffect>(); break;
+        case SPECTRUM: ev_.emplace<SpectrumEffect>(); break;
+        case WATERFALL: ev_.emplace<WaterfallEffect>(); break;
+        case TWINKLE: ev_.emplace<TwinkleEffect>(); break;
+        case FIRE: ev_.emplace<FireEffect>(); break;
         
         default: ev_.emplace<LaserEffect>(); break;
     };
 }
 
+
+
+VmEffect::LoadResult EffectFactory::set_program(etl::span<const uint8_t> program) {
+    VmEffect vm;
+    VmEffect::LoadResult result = vm.load(program);
+    if (result == VmEffect::LoadResult::Ok) {
+        ev_.emplace<VmEffect>(vm);
+        generation_++;
+    }
+    return result;
+}
@@ -8,6 +8,8 @@
 
 #include "../draw.h"
 #include "effects_lib.h"
+#include "effect_vm.h"
+#include "etl/span.h"
 
 /** 
  * @brief Variant type containing one LED Effect
@@ -27,7 +29,12 @@ class EffectFactory {
     enum EffectType {
         LASER = 0,
         BLINK = 1,
-        BEATBLINK = 2
+        BEATBLINK = 2,
+        VM = 3,         /// empty `VmEffect`, use `set_program` to load one
+        SPECTRUM = 4,
+        WATERFALL = 5,  /// 16 pixels wide, send frames with `row_offset`
+        TWINKLE = 6,
+        FIRE = 7
     };
 
     /**
@@ -35,16 +42,99 @@ class EffectFactory {
     */
     void set_effect(const size_t index);
 
+    /**
+     * @brief Use a `VmEffect` running `program` (see effect_vm.h). The program is not copied and
+     * must outlive the effect.
+     * 
+     * @return result of loading `program`. If not `Ok`, the current effect is unchanged.
+    */
+    VmEffect::LoadResult set_program(etl::span<const uint8_t> program);
+
+    /**
+     * @brief Draw with the current effect. The first frame after the effect is changed is always
+     * `FrameChange::full()`, since the frame still holds the previous effect.
+     */
     template <typename FreqT, unsigned int FreqN>
-    void draw_frame(Frame& frame, DrawInfo<FreqT, FreqN>& info) {
-        etl::visit([&](auto& obj) {
-            obj.draw_frame(frame, info);
+    FrameChange draw_frame(FrameView& frame, DrawInfo<FreqT, FreqN>& info) {
+        FrameChange change = etl::visit([&](auto& obj) {
+            return draw_effect(obj, frame, info);
         }, ev_);
+        if (drawn_generation_ != generation_) {
+            drawn_generation_ = generation_;
+            return FrameChange::full();
+        }
+        return change;
     };
 
+    /**
+     * @brief Set the runtime parameters (see params.h) of `Effect`, if it is the current effect.
+     * Call it again after `set_effect`: a new effect starts with its default parameters. Like a new
+     * effect, it bumps the `generation` and the next frame is `FrameChange::full()`.
+     *
+     * @return false if the current effect is something else
+     */
+    template <typename Effect>
+    bool set_params(const typename Effect::Params& params) {
+        if (!etl::holds_alternative<Effect>(ev_)) {
+            return false;
+        }
+        etl::get<Effect>(ev_).set_params(params);
+        generation_++;
+        return true;
+    }
+
+    /**
+     * @brief `period_frames` of the current effect (see `EffectBase::period_frames`).
+     */
+    uint32_t period_frames(unsigned int num_leds, uint32_t frame_period_us) const {
+        return etl::visit([&](const auto& obj) {
+            return obj.period_frames(num_leds, frame_period_us);
+        }, ev_);
+    }
+
+    /**
+     * @brief `lod_levels` of the current effect (see `EffectBase::lod_levels`).
+     */
+    uint8_t lod_levels() const {
+        return etl::visit([](const auto& obj) {
+            return obj.lod_levels();
+        }, ev_);
+    }
+
+    /**
+     * @brief Set the level of detail of the current effect (see `EffectBase::set_lod`). A new
+     * effect starts at full detail.
+     */
+    void set_lod(uint8_t level) {
+        etl::visit([&](auto& obj) {
+            obj.set_lod(level);
+        }, ev_);
+    }
+
+    /**
+     * @brief `row_offset` of the current effect (see `EffectBase::row_offset`), for the LED
+     * driver's `PanelMap`.
+     */
+    uint16_t row_offset() const {
+        return etl::visit([](const auto& obj) {
+            return obj.row_offset();
+        }, ev_);
+    }
+
+    /**
+     * @brief Incremented every time the effect or its parameters are changed, so caches of its
+     * frames (e.g. `PeriodicCache`) know to rebuild.
+     */
+    uint32_t generation() const {
+        return generation_;
+    }
+
     private:
-    using EffectVariant = etl::variant<LaserEffect, BlinkEffect, BeatBlinkEffect>;
+    using EffectVariant = etl::variant<LaserEffect, BlinkEffect, BeatBlinkEffect, VmEffect, SpectrumEffect, WaterfallEffect,
+                                      TwinkleEffect, FireEffect>;
     EffectVariant ev_;
+    uint32_t generation_ = 0;
+    uint32_t drawn_generation_ = UINT32_MAX;   // generation of the last frame drawn
 
 
 };
@@ -0,0 +1,514 @@
+/**
+ * @file effect_vm.h
+ * @brief A small register-based bytecode interpreter for effects, so new looks can be loaded
+ * (from flash or RAM) without rebuilding and reflashing.
+ *
+ * A program has two parts:
+ * - a **frame** program, run once per frame, e.g. to advance animation state or read audio, and
+ * - a **pixel** program, run once per LED, which must write a colour with `RGB` or `OUT`.
+ *
+ * There are 16 32-bit integer registers. Before each program runs:
+ * | Register | Frame program               | Pixel program  |
+ * |----------|-----------------------------|----------------|
+ * | r0       | 0                           | LED index      |
+ * | r1       | number of LEDs              | number of LEDs |
+ * | r2       | ms since the effect started | same           |
+ * | r3       | µs since the last frame     | same           |
+ * r4-r7 are scratch. r8-r15 keep their values between programs and frames, so the frame program
+ * can compute values ("uniforms") for the pixel program and keep state from frame to frame.
+ *
+ * All maths is integer/fixed-point (no FPU on the RP2040):
+ * - angles are 16-bit, 65536 = one full turn,
+ * - `SIN`/`COS`/`MULQ15` use Q15 (32767 = 1.0),
+ * - `NOISE` takes an 8.8 fixed-point position and returns 0..255,
+ * - `PAL` takes 0..255 and returns a 0xRRGGBB colour interpolated from the program's palette.
+ *
+ * Blob layout (all multi-byte fields little endian):
+ * | Offset | Size           | Field                                    |
+ * |--------|----------------|------------------------------------------|
+ * | 0      | 4              | magic "LDVM"                             |
+ * | 4      | 1              | version (1)                              |
+ * | 5      | 1              | number of palette entries P (0..16)      |
+ * | 6      | 2              | number of frame instructions F           |
+ * | 8      | 2              | number of pixel instructions X           |
+ * | 10     | 2              | reserved (0)                             |
+ * | 12     | 3 * P          | palette entries {r, g, b}                |
+ * | ...    | 4 * F          | frame instructions                       |
+ * | ...    | 4 * X          | pixel instructions                       |
+ * Instructions are 4 bytes {op, d, a, b}: opcode, destination register and two operands that are
+ * registers, or for `LDI`/`LDHI` a 16-bit immediate (a = low byte) and for `SHLI`/`SHRI` a shift.
+ *
+ * The blob is validated once by `VmEffect::load` so the interpreter loop doesn't need to check
+ * anything, and it is not copied, so it can be executed in place from XIP flash.
+ */
+#ifndef EFFECT_VM_H
+#define EFFECT_VM_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <algorithm>
+#include <initializer_list>
+#include "etl/array.h"
+#include "etl/span.h"
+#include "../draw.h"
+#include "effects_lib.h"
+#include "../trig.h"
+
+
+/**
+ * @brief VM opcodes.
+ *
+ * ** WARNING ** Values are stored in program blobs. Only append new opcodes.
+ */
+enum class VmOp : uint8_t {
+    END = 0,    /// stop the program
+    LDI,        /// d = sign extended 16-bit immediate
+    LDHI,       /// d = (d & 0xFFFF) | (immediate << 16)
+    MOV,        /// d = a
+    ADD,        /// d = a + b
+    SUB,        /// d = a - b
+    MUL,        /// d = a * b
+    MULQ15,     /// d = (a * b) >> 15, saturated to int32
+    SHLI,       /// d = a << b (b is an immediate)
+    SHRI,       /// d = a >> b (b is an immediate, arithmetic)
+    AND,        /// d = a & b
+    OR,         /// d = a | b
+    XOR,        /// d = a ^ b
+    MIN,        /// d = min(a, b)
+    MAX,        /// d = max(a, b)
+    LT,         /// d = a < b ? 1 : 0
+    SEL,        /// d = d ? a : b
+    SIN,        /// d = sin(a) in Q15, a is a 16-bit angle
+    COS,        /// d = cos(a) in Q15, a is a 16-bit angle
+    NOISE,      /// d = smooth value noise 0..255 at 8.8 position a
+    PAL,        /// d = palette colour 0xRRGGBB at a (0..255)
+    AUD,        /// d = FFT magnitude of bin a (clamped to the last bin)
+    AUDSUM,     /// d = sum of FFT magnitudes of bins [a, b)
+    RGB,        /// pixel = {d, a, b} each clamped to 0..255
+    OUT,        /// pixel = a as 0xRRGGBB
+    COUNT_      /// number of opcodes (not an opcode)
+};
+
+
+/**
+ * @brief One VM instruction.
+ */
+struct VmInstr {
+    uint8_t op;     /// `VmOp`
+    uint8_t d;      /// destination register
+    uint8_t a;      /// operand register (or low byte of immediate)
+    uint8_t b;      /// operand register (or high byte of immediate, or shift)
+};
+
+
+/**
+ * @brief Helpers shared by the VM and native effects.
+ */
+namespace vm_detail {
+
+    inline uint8_t hash8(uint32_t x) {
+        x *= 2654435761u;
+        return static_cast<uint8_t>(x >> 24);
+    }
+
+    /**
+     * @brief Smooth 1D value noise at 8.8 fixed-point `pos`, result 0..255.
+     */
+    inline int32_t noise8(uint32_t pos) {
+        uint32_t i = pos >> 8;
+        int32_t t = pos & 0xFF;
+        t = (t * t * (768 - 2 * t)) >> 16;        // smoothstep 3t² - 2t³ in 0..255
+        int32_t a = hash8(i);
+        int32_t b = hash8(i + 1);
+        return a + (((b - a) * t) >> 8);
+    }
+
+    inline int32_t clamp8(int32_t v) {
+        return v < 0 ? 0 : (v > 255 ? 255 : v);
+    }
+
+    /**
+     * @brief Q15 product in 64 bits, so big operands saturate instead of wrapping.
+     */
+    inline int32_t mul_q15(int32_t a, int32_t b) {
+        int64_t p = (static_cast<int64_t>(a) * b) >> 15;
+        return p > INT32_MAX ? INT32_MAX : (p < INT32_MIN ? INT32_MIN : static_cast<int32_t>(p));
+    }
+}
+
+
+/**
+ * @brief Effect that runs a bytecode program (see top of effect_vm.h).
+ *
+ * Until a program is loaded it draws black.
+ */
+class VmEffect : public EffectBase<VmEffect> {
+
+    public:
+
+    static constexpr unsigned int NUM_REGISTERS = 16;
+    static constexpr unsigned int MAX_PALETTE = 16;
+    static constexpr uint8_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 12;
+    static constexpr uint8_t LOD_LEVELS = 4;
+
+    /**
+     * @brief Result of `load`.
+     */
+    enum class LoadResult {
+        Ok,
+        TooShort,       /// blob is smaller than its header says
+        BadMagic,
+        BadVersion,
+        BadPalette,     /// more than MAX_PALETTE entries
+        BadOpcode,
+        BadRegister,
+        NoPixelOutput   /// pixel program never writes a pixel
+    };
+
+
+    private:
+
+    const uint8_t* palette_ = nullptr;
+    uint8_t palette_size_ = 0;
+    const VmInstr* frame_prog_ = nullptr;
+    const VmInstr* pixel_prog_ = nullptr;
+    uint16_t frame_len_ = 0;
+    uint16_t pixel_len_ = 0;
+    uint64_t cum_elapsed_us_ = 0;
+    uint8_t lod_ = 0;
+    int32_t regs_[NUM_REGISTERS] = {};
+
+
+    static LoadResult validate(const VmInstr* prog, uint16_t len, bool is_pixel) {
+        bool writes_pixel = false;
+        for (uint16_t i = 0; i < len; i++) {
+            const VmInstr& in = prog[i];
+            if (in.op >= static_cast<uint8_t>(VmOp::COUNT_)) {
+                return LoadResult::BadOpcode;
+            }
+            VmOp op = static_cast<VmOp>(in.op);
+            bool imm = op == VmOp::LDI || op == VmOp::LDHI;
+            bool shift = op == VmOp::SHLI || op == VmOp::SHRI;
+            if (in.d >= NUM_REGISTERS ||
+                (!imm && in.a >= NUM_REGISTERS) ||
+                (!imm && !shift && in.b >= NUM_REGISTERS) ||
+                (shift && in.b > 31)) {
+                return LoadResult::BadRegister;
+            }
+            writes_pixel |= op == VmOp::RGB || op == VmOp::OUT;
+        }
+        if (is_pixel && !writes_pixel) {
+            return LoadResult::NoPixelOutput;
+        }
+        return LoadResult::Ok;
+    }
+
+
+    int32_t palette_lookup(int32_t index) const {
+        if (palette_size_ == 0) {
+            return 0;
+        }
+        if (palette_size_ == 1) {
+            return (palette_[0] << 16) | (palette_[1] << 8) | palette_[2];
+        }
+
+        // spread 0..255 over the palette, interpolating between neighbouring entries
+        uint32_t pos = static_cast<uint32_t>(vm_detail::clamp8(index)) * (palette_size_ - 1);
+        uint32_t i = pos >> 8;
+        int32_t t = pos & 0xFF;
+        t += t >> 7;                              // 0..256 so 255 reaches the next entry exactly
+        const uint8_t* c0 = &palette_[i * 3];
+        const uint8_t* c1 = i + 1 < palette_size_ ? c0 + 3 : c0;
+        int32_t r = c0[0] + (((c1[0] - c0[0]) * t) >> 8);
+        int32_t g = c0[1] + (((c1[1] - c0[1]) * t) >> 8);
+        int32_t b = c0[2] + (((c1[2] - c0[2]) * t) >> 8);
+        return (r << 16) | (g << 8) | b;
+    }
+
+
+    template <typename FreqT, unsigned int FreqN>
+    void run(const VmInstr* prog, uint16_t len, DrawInfo<FreqT, FreqN>& info, RGBValue* pixel) {
+        int32_t* r = regs_;
+        for (const VmInstr* in = prog; in != prog + len; ++in) {
+            int32_t& d = r[in->d];
+            switch (static_cast<VmOp>(in->op)) {
+                case VmOp::END:     return;
+                case VmOp::LDI:     d = static_cast<int16_t>(in->a | (in->b << 8)); break;
+                case VmOp::LDHI:    d = (d & 0xFFFF) | static_cast<int32_t>(static_cast<uint32_t>(in->a | (in->b << 8)) << 16); break;
+                case VmOp::MOV:     d = r[in->a]; break;
+                // arithmetic wraps (via uint32_t) rather than being undefined on overflow
+                case VmOp::ADD:     d = static_cast<int32_t>(static_cast<uint32_t>(r[in->a]) + static_cast<uint32_t>(r[in->b])); break;
+                case VmOp::SUB:     d = static_cast<int32_t>(static_cast<uint32_t>(r[in->a]) - static_cast<uint32_t>(r[in->b])); break;
+                case VmOp::MUL:     d = static_cast<int32_t>(static_cast<uint32_t>(r[in->a]) * static_cast<uint32_t>(r[in->b])); break;
+                case VmOp::MULQ15:  d = vm_detail::mul_q15(r[in->a], r[in->b]); break;
+                case VmOp::SHLI:    d = static_cast<int32_t>(static_cast<uint32_t>(r[in->a]) << in->b); break;
+                case VmOp::SHRI:    d = r[in->a] >> in->b; break;
+                case VmOp::AND:     d = r[in->a] & r[in->b]; break;
+                case VmOp::OR:      d = r[in->a] | r[in->b]; break;
+                case VmOp::XOR:     d = r[in->a] ^ r[in->b]; break;
+                case VmOp::MIN:     d = std::min(r[in->a], r[in->b]); break;
+                case VmOp::MAX:     d = std::max(r[in->a], r[in->b]); break;
+                case VmOp::LT:      d = r[in->a] < r[in->b] ? 1 : 0; break;
+                case VmOp::SEL:     d = d ? r[in->a] : r[in->b]; break;
+                case VmOp::SIN:     d = trig::sin16(static_cast<uint32_t>(r[in->a])); break;
+                case VmOp::COS:     d = trig::cos16(static_cast<uint32_t>(r[in->a])); break;
+                case VmOp::NOISE:   d = vm_detail::noise8(static_cast<uint32_t>(r[in->a])); break;
+                case VmOp::PAL:     d = palette_lookup(r[in->a]); break;
+                case VmOp::AUD: {
+                    uint32_t bin = std::min(static_cast<uint32_t>(r[in->a]), FreqN - 1);
+                    d = static_cast<int32_t>(info.freq_magnitudes[bin]);
+                    break;
+                }
+                case VmOp::AUDSUM: {
+                    uint32_t from = std::min(static_cast<uint32_t>(r[in->a]), FreqN);
+                    uint32_t to = std::min(static_cast<uint32_t>(r[in->b]), FreqN);
+                    int32_t sum = 0;
+                    for (uint32_t bin = from; bin < to; bin++) {
+                        sum += static_cast<int32_t>(info.freq_magnitudes[bin]);
+                    }
+                    d = sum;
+                    break;
+                }
+                case VmOp::RGB:
+                    if (pixel != nullptr) {
+                        *pixel = RGBValue{static_cast<uint8_t>(vm_detail::clamp8(d)),
+                                          static_cast<uint8_t>(vm_detail::clamp8(r[in->a])),
+                                          static_cast<uint8_t>(vm_detail::clamp8(r[in->b]))};
+                    }
+                    break;
+                case VmOp::OUT:
+                    if (pixel != nullptr) {
+                        uint32_t c = static_cast<uint32_t>(r[in->a]);
+                        *pixel = RGBValue{static_cast<uint8_t>(c >> 16), static_cast<uint8_t>(c >> 8),
+                                          static_cast<uint8_t>(c)};
+                    }
+                    break;
+                case VmOp::COUNT_:  break; // rejected by `load`
+            }
+        }
+    }
+
+
+    public:
+
+    /**
+     * @brief Load a program blob. The blob is not copied and must outlive this effect (e.g. be
+     * in flash or a static buffer).
+     *
+     * If the blob is invalid, the previous program (if any) is kept.
+     */
+    LoadResult load(etl::span<const uint8_t> blob) {
+        if (blob.size() < HEADER_SIZE) {
+            return LoadResult::TooShort;
+        }
+        const uint8_t* p = blob.data();
+        if (p[0] != 'L' || p[1] != 'D' || p[2] != 'V' || p[3] != 'M') {
+            return LoadResult::BadMagic;
+        }
+        if (p[4] != VERSION) {
+            return LoadResult::BadVersion;
+        }
+        uint8_t palette_size = p[5];
+        if (palette_size > MAX_PALETTE) {
+            return LoadResult::BadPalette;
+        }
+        uint16_t frame_len = static_cast<uint16_t>(p[6] | (p[7] << 8));
+        uint16_t pixel_len = static_cast<uint16_t>(p[8] | (p[9] << 8));
+
+        size_t palette_offset = HEADER_SIZE;
+        size_t frame_offset = palette_offset + 3 * palette_size;
+        size_t pixel_offset = frame_offset + sizeof(VmInstr) * frame_len;
+        size_t end = pixel_offset + sizeof(VmInstr) * pixel_len;
+        if (blob.size() < end) {
+            return LoadResult::TooShort;
+        }
+
+        const VmInstr* frame_prog = reinterpret_cast<const VmInstr*>(p + frame_offset);
+        const VmInstr* pixel_prog = reinterpret_cast<const VmInstr*>(p + pixel_offset);
+        LoadResult result = validate(frame_prog, frame_len, false);
+        if (result == LoadResult::Ok) {
+            result = validate(pixel_prog, pixel_len, true);
+        }
+        if (result != LoadResult::Ok) {
+            return result;
+        }
+
+        palette_ = p + palette_offset;
+        palette_size_ = palette_size;
+        frame_prog_ = frame_prog;
+        frame_len_ = frame_len;
+        pixel_prog_ = pixel_prog;
+        pixel_len_ = pixel_len;
+        cum_elapsed_us_ = 0;
+        std::fill(std::begin(regs_), std::end(regs_), 0);
+        return LoadResult::Ok;
+    }
+
+    /**
+     * @brief True if a program is loaded.
+     */
+    bool is_loaded() const {
+        return pixel_prog_ != nullptr;
+    }
+
+    /**
+     * @brief Register value, e.g. to inspect a program's state.
+     */
+    int32_t reg(unsigned int i) const {
+        return regs_[i % NUM_REGISTERS];
+    }
+
+    template <typename FreqT, unsigned int FreqN>
+    FrameChange draw_frame(FrameView& frame, DrawInfo<FreqT, FreqN>& info) {
+        if (!is_loaded()) {
+            std::fill(frame.data.begin(), frame.data.end(), BLACK);
+            return FrameChange::full();
+        }
+
+        cum_elapsed_us_ += info.elapsed_time_us;
+        int32_t num_leds = static_cast<int32_t>(frame.num_leds);
+        int32_t time_ms = static_cast<int32_t>(cum_elapsed_us_ / 1000);
+        int32_t elapsed_us = static_cast<int32_t>(info.elapsed_time_us);
+
+        regs_[0] = 0;
+        regs_[1] = num_leds;
+        regs_[2] = time_ms;
+        regs_[3] = elapsed_us;
+        run(frame_prog_, frame_len_, info, nullptr);
+
+        // at coarser levels of detail run the pixel program on every `stride`-th pixel (and the
+        // last) and interpolate the rest
+        auto draw_pixel = [&](int32_t i) {
+            regs_[0] = i;
+            regs_[1] = num_leds;
+            regs_[2] = time_ms;
+            regs_[3] = elapsed_us;
+            run(pixel_prog_, pixel_len_, info, &frame.data[i]);
+        };
+        const int32_t stride = 1 << lod_;
+        for (int32_t i = 0; i < num_leds; i += stride) {
+            draw_pixel(i);
+        }
+        if (num_leds > 0 && (num_leds - 1) % stride != 0) {
+            draw_pixel(num_leds - 1);
+        }
+        interpolate_decimated(frame.data.first(frame.num_leds), static_cast<unsigned int>(stride));
+        return FrameChange::full();
+    }
+
+    /**
+     * @brief Levels of detail: the pixel program runs on every 1, 2, 4 or 8 pixels.
+     */
+    uint8_t lod_levels() const {
+        return LOD_LEVELS;
+    }
+
+    void set_lod(uint8_t level) {
+        lod_ = level < LOD_LEVELS ? level : LOD_LEVELS - 1;
+    }
+};
+
+
+/**
+ * @brief Builds VM program blobs, e.g. for tests, benchmarks or host tools.
+ *
+ * ```cpp
+ * VmAssembler<256> a;
+ * a.palette({{255, 0, 0}, {0, 0, 255}});
+ * a.pixel(VmOp::SHLI, 4, 0, 6);   // r4 = index << 6
+ * a.pixel(VmOp::PAL, 5, 4);       // r5 = palette(r4)
+ * a.pixel(VmOp::OUT, 0, 5);       // pixel = r5
+ * etl::span<const uint8_t> blob = a.build();
+ * ```
+ *
+ * @param Capacity maximum size of the blob in bytes
+ */
+template <size_t Capacity>
+class VmAssembler {
+
+    private:
+    etl::array<uint8_t, 3 * VmEffect::MAX_PALETTE> palette_ = {};
+    etl::array<VmInstr, Capacity / sizeof(VmInstr)> frame_ = {};
+    etl::array<VmInstr, Capacity / sizeof(VmInstr)> pixel_ = {};
+    etl::array<uint8_t, Capacity> blob_ = {};
+    uint8_t palette_size_ = 0;
+    uint16_t frame_len_ = 0;
+    uint16_t pixel_len_ = 0;
+
+    public:
+
+    void palette(std::initializer_list<RGBValue> colours) {
+        palette_size_ = 0;
+        for (const RGBValue& c : colours) {
+            if (palette_size_ == VmEffect::MAX_PALETTE) {
+                break;
+            }
+            palette_[palette_size_ * 3 + 0] = c.r;
+            palette_[palette_size_ * 3 + 1] = c.g;
+            palette_[palette_size_ * 3 + 2] = c.b;
+            palette_size_++;
+        }
+    }
+
+    /** @brief Append an instruction to the frame program. */
+    void frame(VmOp op, uint8_t d, uint8_t a = 0, uint8_t b = 0) {
+        if (frame_len_ < frame_.size()) {
+            frame_[frame_len_++] = VmInstr{static_cast<uint8_t>(op), d, a, b};
+        }
+    }
+
+    /** @brief Append an instruction to the pixel program. */
+    void pixel(VmOp op, uint8_t d, uint8_t a = 0, uint8_t b = 0) {
+        if (pixel_len_ < pixel_.size()) {
+            pixel_[pixel_len_++] = VmInstr{static_cast<uint8_t>(op), d, a, b};
+        }
+    }
+
+    /** @brief Append "load 32-bit constant into d" to the frame program. */
+    void frame_const(uint8_t d, int32_t value) {
+        frame(VmOp::LDI, d, static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8));
+        if (value < INT16_MIN || value > INT16_MAX) {
+            frame(VmOp::LDHI, d, static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24));
+        }
+    }
+
+    /** @brief Append "load 32-bit constant into d" to the pixel program. */
+    void pixel_const(uint8_t d, int32_t value) {
+        pixel(VmOp::LDI, d, static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8));
+        if (value < INT16_MIN || value > INT16_MAX) {
+            pixel(VmOp::LDHI, d, static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24));
+        }
+    }
+
+    /**
+     * @brief Serialise the program. The span refers to memory in this assembler.
+     *
+     * @return the blob, or an empty span if it doesn't fit in `Capacity` bytes
+     */
+    etl::span<const uint8_t> build() {
+        size_t size = VmEffect::HEADER_SIZE + 3 * palette_size_ + sizeof(VmInstr) * (frame_len_ + pixel_len_);
+        if (size > Capacity) {
+            return etl::span<const uint8_t>();
+        }
+
+        uint8_t* p = blob_.data();
+        *p++ = 'L'; *p++ = 'D'; *p++ = 'V'; *p++ = 'M';
+        *p++ = VmEffect::VERSION;
+        *p++ = palette_size_;
+        *p++ = static_cast<uint8_t>(frame_len_); *p++ = static_cast<uint8_t>(frame_len_ >> 8);
+        *p++ = static_cast<uint8_t>(pixel_len_); *p++ = static_cast<uint8_t>(pixel_len_ >> 8);
+        *p++ = 0; *p++ = 0;
+        p = std::copy(palette_.begin(), palette_.begin() + 3 * palette_size_, p);
+        for (uint16_t i = 0; i < frame_len_; i++) {
+            *p++ = frame_[i].op; *p++ = frame_[i].d; *p++ = frame_[i].a; *p++ = frame_[i].b;
+        }
+        for (uint16_t i = 0; i < pixel_len_; i++) {
+            *p++ = pixel_[i].op; *p++ = pixel_[i].d; *p++ = pixel_[i].a; *p++ = pixel_[i].b;
+        }
+        return etl::span<const uint8_t>(blob_.data(), size);
+    }
+};
+
+
+#endif // EFFECT_VM_H
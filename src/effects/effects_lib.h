@@ -5,6 +5,8 @@
 #define EVENTS_LIB_H
 
 #include "../draw.h" // Frame, DrawInfo
+#include "../fixed_point.h"
+#include "pixel_state.h"
 #include "etl/variant.h"
 
 
@@ -18,9 +20,127 @@ class EffectBase {
     private:
     
     public:
+
+    /**
+     * @brief Draw the next frame and say which pixels changed (see `FrameChange`). Effects can
+     * return `FrameChange::none()` without touching the frame when it would be the same, e.g.
+     * in silence, and the pipeline then skips encoding and sending it.
+     */
     template <typename FreqT, unsigned int FreqN>
-    void draw_frame(Frame& frame, DrawInfo<FreqT, FreqN>& info) {
-        static_cast<Derived*>(this)->draw_frame(frame, info);
+    FrameChange draw_frame(FrameView& frame, DrawInfo<FreqT, FreqN>& info) {
+        return draw_effect(*static_cast<Derived*>(this), frame, info);
+    }
+
+    /**
+     * @brief Number of frames after which the effect repeats exactly, when `draw_frame` is called
+     * every `frame_period_us` with `num_leds` LEDs, or 0 if it doesn't repeat (e.g. it reacts to
+     * audio). Periodic effects can be pre-rendered once by `PeriodicCache`.
+     *
+     * Effects that repeat hide this with their own `period_frames`.
+     */
+    uint32_t period_frames([[maybe_unused]] unsigned int num_leds, [[maybe_unused]] uint32_t frame_period_us) const {
+        return 0;
+    }
+
+    /**
+     * @brief Number of level-of-detail settings: 0 is full detail and each level above is cheaper
+     * to draw (e.g. fewer particles, or rendering every 2^level pixels and interpolating). A
+     * `FrameScheduler` steps the level up when frames overrun their budget.
+     *
+     * Effects with more than one level hide this and `set_lod` with their own.
+     */
+    uint8_t lod_levels() const {
+        return 1;
+    }
+
+    void set_lod([[maybe_unused]] uint8_t level) {
+    }
+
+    /**
+     * @brief Rows the frame is rotated by on a panel (see `PanelMap`), for effects that scroll by
+     * moving the start row rather than the pixels. Pass it to the LED driver with the frame.
+     *
+     * Effects that scroll hide this with their own.
+     */
+    uint16_t row_offset() const {
+        return 0;
+    }
+};
+
+
+/**
+ * @brief Fill the pixels between every `stride`-th pixel (and the last) by linear interpolation,
+ * for effects that render a decimated frame at a coarser level of detail.
+ */
+inline void interpolate_decimated(etl::span<RGBValue> pixels, unsigned int stride) {
+    if (stride <= 1 || pixels.size() < 2) {
+        return;
+    }
+    auto lerp = [](uint8_t a, uint8_t b, unsigned int t, unsigned int n) {
+        return static_cast<uint8_t>(a + (static_cast<int>(b) - a) * static_cast<int>(t) / static_cast<int>(n));
+    };
+    const unsigned int last = static_cast<unsigned int>(pixels.size() - 1);
+    for (unsigned int start = 0; start < last; start += stride) {
+        unsigned int end = start + stride < last ? start + stride : last;
+        const RGBValue a = pixels[start];
+        const RGBValue b = pixels[end];
+        unsigned int n = end - start;
+        for (unsigned int t = 1; t < n; t++) {
+            pixels[start + t] = RGBValue{lerp(a.r, b.r, t, n), lerp(a.g, b.g, t, n), lerp(a.b, b.b, t, n)};
+        }
+    }
+}
+
+
+/**
+ * @brief Heat colour of a level: black, red, yellow, white.
+ */
+inline RGBValue heat_colour(uint8_t level) {
+    uint32_t l = level * 3u;
+    return RGBValue{static_cast<uint8_t>(l > 255 ? 255 : l),
+                    static_cast<uint8_t>(l > 510 ? 255 : (l > 255 ? l - 255 : 0)),
+                    static_cast<uint8_t>(l > 510 ? l - 510 : 0)};
+}
+
+
+/**
+ * @brief Next number of a xorshift32 sequence, for effects that need cheap randomness. `state`
+ * must not be 0.
+ */
+inline uint32_t xorshift32(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+
+/**
+ * @brief Automatic gain for effects that show FFT magnitudes: levels are scaled so the loudest
+ * recent magnitude is 255, and a loud moment is forgotten over ~1s at 60 fps.
+ */
+class AutoGain {
+
+    private:
+
+    uint32_t peak_ = 0;     // decaying maximum magnitude
+    uint32_t gain_ = 0;     // Q16
+
+    public:
+
+    /**
+     * @brief Once per frame, with the loudest magnitude in it.
+     */
+    void update(uint32_t loudest) {
+        peak_ -= peak_ >> 5;
+        peak_ = loudest > peak_ ? loudest : peak_;
+        peak_ = peak_ > 0 ? peak_ : 1;
+        gain_ = ((255u << 16) + peak_ - 1) / peak_;     // rounded up, so the peak is 255
+    }
+
+    uint8_t level(uint32_t magnitude) const {
+        uint64_t l = (static_cast<uint64_t>(magnitude) * gain_) >> 16;
+        return static_cast<uint8_t>(l > 255 ? 255 : l);
     }
 };
 
@@ -31,16 +151,76 @@ class EffectBase {
  **************************************************************************************************/
 class LaserEffect : public EffectBase<LaserEffect>{
     
+    public:
+
+    /**
+     * @brief Runtime parameters (see params.h).
+     */
+    struct Params {
+        uint32_t step_us = 50'000;  /// time for the laser to move its own length, 1 to `MAX_STEP_US`
+        RGBValue colour = RED;
+    };
+
+    /// slowest step: `period_frames` steps through a whole period every frame, so keep it short
+    static constexpr uint32_t MAX_STEP_US = 10'000'000;
+
     private:
+    Params params_;
     unsigned int position = 0; // TODO: are we using size_t somewhere else? needs to be consistent
     unsigned int laser_length = 0;
     uint32_t cum_elapsed_time_us = 0;
+    unsigned int drawn_leds_ = 0;   // frame size last drawn, 0 before the first frame
+    unsigned int drawn_start_ = 0;  // laser pixels last drawn
+    unsigned int drawn_end_ = 0;
+
+    // position after `cum_us`: the laser moves its own `length` every `step_us`. 16.16, so no float
+    unsigned int laser_position(uint32_t cum_us, unsigned int length) const {
+        return static_cast<unsigned int>(mul_sat(Q16_16::ratio(cum_us, params_.step_us), static_cast<int32_t>(length)).to_int());
+    }
 
     public:
+
+    const Params& params() const {
+        return params_;
+    }
+
+    /**
+     * @brief New parameters, from the next frame on (which is drawn whole).
+     */
+    void set_params(const Params& params) {
+        params_ = params;
+        params_.step_us = params_.step_us > 0 ? params_.step_us : 1;
+        params_.step_us = params_.step_us < MAX_STEP_US ? params_.step_us : MAX_STEP_US;
+        drawn_leds_ = 0;
+    }
+
+    /**
+     * @brief The laser restarts on the first frame its position reaches the end of the strip.
+     */
+    uint32_t period_frames(unsigned int num_leds, uint32_t frame_period_us) const {
+        unsigned int length = num_leds / 10;
+        if (length == 0 || frame_period_us == 0) {
+            return 1;   // laser never moves
+        }
+        // same arithmetic as `draw_frame`
+        uint32_t cum_us = 0;
+        uint32_t max_frames = static_cast<uint32_t>((static_cast<uint64_t>(params_.step_us) * num_leds / length) / frame_period_us) + 2;
+        for (uint32_t frames = 1; frames <= max_frames; frames++) {
+            cum_us += frame_period_us;
+            if (laser_position(cum_us, length) >= num_leds) {
+                return frames;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Only the pixels the laser left and moved onto are drawn again.
+     */
     template <typename FreqT, unsigned int FreqN>
-    void draw_frame(Frame& frame, DrawInfo<FreqT, FreqN>& info){
-        if (laser_length == 0) {
-            laser_length = frame.num_leds / 10;
+    FrameChange draw_frame(FrameView& frame, DrawInfo<FreqT, FreqN>& info){
+        if (frame.num_leds != drawn_leds_) {
+            laser_length = frame.num_leds / 10;     // as `period_frames` has it for this strip
         }
         
         // move laser by 1/10 of strip every 50ms
@@ -48,18 +228,34 @@ class LaserEffect : public EffectBase<LaserEffect>{
         // (i.e. info.elapsed_time_us / 50ms < 1 / laser_length) in which case the laser cannot
         // increment it's position ever so we cumulate the elapsed time into cum_elapsed_time
         cum_elapsed_time_us += info.elapsed_time_us;     // in case we are called faster than 100ms / laser_length in which case laser won't move 
-        position = (cum_elapsed_time_us / 50'000.0f) * laser_length; 
+        position = laser_position(cum_elapsed_time_us, laser_length);
          if (position >= frame.num_leds) {
             position = 0;
             cum_elapsed_time_us = 0;
         }
         
-        // draw laser
+        // draw laser, clipped to the end of the strip, over where it was
+        unsigned int laser_end = std::min(position + laser_length + 1, frame.num_leds);
+        FrameChange change = FrameChange::full();
+        if (drawn_leds_ == frame.num_leds) {
+            if (position == drawn_start_ && laser_end == drawn_end_) {
+                return FrameChange::none();
+            }
+            change = FrameChange::range(std::min(position, drawn_start_), std::max(laser_end, drawn_end_));
+        }
         etl::span<RGBValue>::iterator it = frame.data.begin();
-        std::fill(it, frame.data.end(), BLACK);
-        for (unsigned int i = position; i <= position + laser_length; i++) {
-            frame.data[i] = RED; 
+        if (change.kind == FrameChange::Kind::Full) {
+            std::fill(it, frame.data.end(), BLACK);
+        } else {
+            std::fill(it + change.begin, it + change.end, BLACK);
         }
+        for (unsigned int i = position; i < laser_end; i++) {
+            frame.data[i] = params_.colour; 
+        }
+        drawn_leds_ = frame.num_leds;
+        drawn_start_ = position;
+        drawn_end_ = laser_end;
+        return change;
     };
 };
 
@@ -69,14 +265,61 @@ class LaserEffect : public EffectBase<LaserEffect>{
  **************************************************************************************************/
 class BlinkEffect : public EffectBase<BlinkEffect> {
     
+    public:
+
+    /**
+     * @brief Runtime parameters (see params.h).
+     */
+    struct Params {
+        uint16_t frames_per_toggle = 1;     /// frames between switching on and off
+        RGBValue colour = LIME;
+    };
+
     private:
     bool is_on = false;
+    Params params_;
+    uint16_t frames_ = 0;       // frames drawn since the last toggle
+    unsigned int drawn_leds_ = 0;
 
     public:
+
+    /**
+     * @param frames_per_toggle frames between switching on and off; the frames in between are
+     * unchanged
+     */
+    explicit BlinkEffect(uint16_t frames_per_toggle = 1) {
+        set_params(Params{frames_per_toggle, LIME});
+    }
+
+    const Params& params() const {
+        return params_;
+    }
+
+    void set_params(const Params& params) {
+        params_ = params;
+        params_.frames_per_toggle = params_.frames_per_toggle > 0 ? params_.frames_per_toggle : 1;
+        frames_ = 0;
+        drawn_leds_ = 0;
+    }
+
+    /**
+     * @brief On for `frames_per_toggle` frames, then off for as many.
+     */
+    uint32_t period_frames([[maybe_unused]] unsigned int num_leds, [[maybe_unused]] uint32_t frame_period_us) const {
+        return 2u * params_.frames_per_toggle;
+    }
+
      template <typename FreqT, unsigned int FreqN>
-    void draw_frame([[maybe_unused]]Frame& frame, [[maybe_unused]]DrawInfo<FreqT, FreqN>& info){
-        std::fill(frame.data.begin(), frame.data.end(), is_on ? LIME : BLACK);
+    FrameChange draw_frame([[maybe_unused]]FrameView& frame, [[maybe_unused]]DrawInfo<FreqT, FreqN>& info){
+        if (frames_ > 0 && drawn_leds_ == frame.num_leds) {
+            frames_ = frames_ + 1 == params_.frames_per_toggle ? 0 : frames_ + 1;
+            return FrameChange::none();
+        }
+        std::fill(frame.data.begin(), frame.data.end(), is_on ? params_.colour : BLACK);
         is_on = !is_on;
+        frames_ = params_.frames_per_toggle > 1 ? 1 : 0;
+        drawn_leds_ = frame.num_leds;
+        return FrameChange::full();
     };
 };
 
@@ -84,14 +327,461 @@ class BlinkEffect : public EffectBase<BlinkEffect> {
 /***************************************************************************************************
  * @brief Beat Blink
  **************************************************************************************************/
-class BeatBlinkEffect : public EffectBase<BlinkEffect> {
+class BeatBlinkEffect : public EffectBase<BeatBlinkEffect> {
     public:
     template <typename FreqT, unsigned int FreqN>
-    void draw_frame([[maybe_unused]]Frame& frame, [[maybe_unused]]DrawInfo<FreqT, FreqN>& info){
-        
+    FrameChange draw_frame([[maybe_unused]]FrameView& frame, [[maybe_unused]]DrawInfo<FreqT, FreqN>& info){
+        return FrameChange::none();
+    };
+};
+
+
+/***************************************************************************************************
+ * @brief Spectrum analyser: the FFT magnitudes laid along the strip, bass first, as a heat colour
+ * (black, red, yellow, white) interpolated between bins.
+ *
+ * Where each bin lands on the strip (linearly or logarithmically by frequency; bin 0, DC, isn't
+ * shown) is worked out once per LED count, bin count and scale into a map of `MAX_BINS` entries:
+ * the first pixel of each bin-to-bin segment with a Q16 starting weight and weight step. Drawing
+ * is then one pass with no divisions, blending each pixel from its two bins by additions. The
+ * level is scaled to the loudest recent bin (automatic gain). At coarser levels of detail only
+ * every 2nd, 4th or 8th pixel is blended and the rest interpolated.
+ **************************************************************************************************/
+class SpectrumEffect : public EffectBase<SpectrumEffect> {
+
+    public:
+
+    enum class Scale : uint8_t {
+        Linear,     /// equal width per bin
+        Log,        /// equal width per octave, like the ear
+    };
+
+    static constexpr unsigned int MAX_BINS = LightDancerConfig::fft_bins;
+    static constexpr uint8_t LOD_LEVELS = 4;
+
+    private:
+
+    struct Segment {
+        uint16_t start;     // first pixel of this bin's segment
+        uint16_t weight;    // Q16 weight of the next bin at `start`
+        uint32_t step;      // Q16 weight added per pixel
+    };
+
+    etl::array<Segment, MAX_BINS> map_ {};
+    Scale scale_;
+    unsigned int map_leds_ = 0;     // what `map_` was built for, 0 before it's built
+    unsigned int map_bins_ = 0;
+    Scale map_scale_ = Scale::Linear;
+    AutoGain gain_;
+    unsigned int dark_leds_ = 0;    // frame size last drawn all black (silence), else 0
+    uint8_t lod_ = 0;
+
+    // pixel position of bin `b` in Q16 for bins 1 to `bins - 1` across pixels 0 to `leds - 1`
+    uint64_t position(unsigned int b, unsigned int leds, unsigned int bins) const {
+        uint64_t span = static_cast<uint64_t>(leds - 1) << 16;
+        if (scale_ == Scale::Log) {
+            uint64_t octaves = static_cast<uint64_t>(log2_fixed(bins - 1).raw());
+            return span * static_cast<uint64_t>(log2_fixed(b).raw()) / octaves;
+        }
+        return span * (b - 1) / (bins - 2);
+    }
+
+    void build_map(unsigned int leds, unsigned int bins) {
+        uint64_t p0 = position(1, leds, bins);
+        for (unsigned int b = 1; b < bins; b++) {
+            uint64_t p1 = b + 1 < bins ? position(b + 1, leds, bins) : p0;
+            uint64_t start = (p0 + 0xFFFF) >> 16;
+            uint64_t step = p1 > p0 ? (static_cast<uint64_t>(1) << 32) / (p1 - p0) : 0;
+            uint64_t weight = (((start << 16) - p0) * step) >> 16;
+            map_[b] = Segment{static_cast<uint16_t>(start), static_cast<uint16_t>(weight > 0xFFFF ? 0xFFFF : weight),
+                              static_cast<uint32_t>(step > UINT32_MAX ? UINT32_MAX : step)};
+            p0 = p1;
+        }
+        map_leds_ = leds;
+        map_bins_ = bins;
+        map_scale_ = scale_;
+    }
+
+
+    public:
+
+    /**
+     * @brief Runtime parameters (see params.h).
+     */
+    struct Params {
+        Scale scale = Scale::Log;
+    };
+
+    explicit SpectrumEffect(Scale scale = Scale::Log) : scale_(scale) {
+    }
+
+    void set_scale(Scale scale) {
+        scale_ = scale;
+        dark_leds_ = 0;
+    }
+
+    Params params() const {
+        return Params{scale_};
+    }
+
+    void set_params(const Params& params) {
+        set_scale(params.scale == Scale::Linear ? Scale::Linear : Scale::Log);
+    }
+
+    /**
+     * @brief Segment `b` of the map (bins 1 to FreqN - 1), e.g. for tests: its first pixel.
+     */
+    uint16_t segment_start(unsigned int b) const {
+        return map_[b].start;
+    }
+
+    /**
+     * @brief In silence (every magnitude 0) the strip is black, and after the first such frame
+     * nothing is drawn.
+     */
+    template <typename FreqT, unsigned int FreqN>
+    FrameChange draw_frame(FrameView& frame, DrawInfo<FreqT, FreqN>& info) {
+        static_assert(FreqN <= MAX_BINS, "more FFT bins than SpectrumEffect::MAX_BINS");
+        const etl::array<FreqT, FreqN>& mags = info.freq_magnitudes;
+        if (frame.num_leds == 0) {
+            return FrameChange::none();
+        }
+
+        uint32_t loudest = 0;
+        for (unsigned int b = FreqN < 2 ? 0 : 1; b < FreqN; b++) {
+            loudest = static_cast<uint32_t>(mags[b]) > loudest ? static_cast<uint32_t>(mags[b]) : loudest;
+        }
+        gain_.update(loudest > 0 ? loudest : 1);
+        if (loudest == 0 && dark_leds_ == frame.num_leds) {
+            return FrameChange::none();
+        }
+        dark_leds_ = loudest == 0 ? frame.num_leds : 0;
+        auto level = [&](unsigned int b) {
+            return static_cast<int32_t>(gain_.level(static_cast<uint32_t>(mags[b])));
+        };
+
+        if (FreqN < 3 || frame.num_leds < 2) {
+            std::fill(frame.data.begin(), frame.data.end(), heat_colour(static_cast<uint8_t>(level(FreqN - 1))));
+            return FrameChange::full();
+        }
+        if (map_leds_ != frame.num_leds || map_bins_ != FreqN || map_scale_ != scale_) {
+            build_map(frame.num_leds, FreqN);
+        }
+
+        // each segment blends from its bin to the next, on every `stride`-th pixel; the last bin
+        // fills the rest of the strip, which always includes the last pixel
+        const unsigned int stride = 1u << lod_;
+        int32_t a = level(1);
+        for (unsigned int b = 1; b + 1 < FreqN; b++) {
+            int32_t c = level(b + 1);
+            const Segment& s = map_[b];
+            unsigned int end = map_[b + 1].start;
+            unsigned int x = (s.start + stride - 1) & ~(stride - 1);
+            uint32_t w = s.weight + (x - s.start) * s.step;
+            for (; x < end; x += stride) {
+                int32_t v = a + (((c - a) * static_cast<int32_t>(w > 0x10000 ? 0x10000 : w)) >> 16);
+                frame.data[x] = heat_colour(static_cast<uint8_t>(v));
+                w += s.step * stride;
+            }
+            a = c;
+        }
+        std::fill(frame.data.begin() + map_[FreqN - 1].start, frame.data.end(), heat_colour(static_cast<uint8_t>(a)));
+        interpolate_decimated(frame.data.first(frame.num_leds), stride);
+        return FrameChange::full();
+    }
+
+    /**
+     * @brief Levels of detail: every 1, 2, 4 or 8 pixels are blended from the bins.
+     */
+    uint8_t lod_levels() const {
+        return LOD_LEVELS;
+    }
+
+    void set_lod(uint8_t level) {
+        lod_ = level < LOD_LEVELS ? level : LOD_LEVELS - 1;
+    }
+};
+
+
+/***************************************************************************************************
+ * @brief Spectrogram waterfall for matrix panels: each frame's spectrum is a new row of heat
+ * colours at the top, and older rows move down the panel.
+ *
+ * The rows are a ring in the frame: a new spectrum overwrites the oldest row and moves the head
+ * up one, and `row_offset()` tells the LED driver which row to start the panel from (see
+ * `PanelMap`), so a frame costs one row whatever the panel's height and nothing is moved. The ring
+ * lives in the frame's pixels, so always draw into the same `Frame`.
+ *
+ * Columns cover equal ranges of bins (without DC) and show the loudest in their range, scaled by
+ * the loudest recent bin (automatic gain).
+ **************************************************************************************************/
+class WaterfallEffect : public EffectBase<WaterfallEffect> {
+
+    private:
+
+    uint16_t width_;
+    uint16_t rows_ = 0;     // rows in the ring, 0 before the first frame
+    uint16_t head_ = 0;     // newest row
+    AutoGain gain_;
+
+    public:
+
+    /**
+     * @param width panel width in pixels; the panel has `num_leds / width` rows
+     */
+    explicit WaterfallEffect(uint16_t width = 16) : width_(width > 0 ? width : 1) {
+    }
+
+    /**
+     * @brief Change the panel width. The waterfall starts again from black on the next frame.
+     */
+    void set_width(uint16_t width) {
+        width_ = width > 0 ? width : 1;
+        rows_ = 0;
+    }
+
+    uint16_t width() const {
+        return width_;
+    }
+
+    /**
+     * @brief Runtime parameters (see params.h).
+     */
+    struct Params {
+        uint16_t width = 16;    /// panel width in pixels
     };
+
+    Params params() const {
+        return Params{width_};
+    }
+
+    void set_params(const Params& params) {
+        if (params.width != width_) {
+            set_width(params.width);
+        }
+    }
+
+    uint16_t row_offset() const {
+        return head_;
+    }
+
+    /**
+     * @brief Only the new row changes in the frame, but the panel shows every row moved down one:
+     * `row_offset()` has changed too.
+     */
+    template <typename FreqT, unsigned int FreqN>
+    FrameChange draw_frame(FrameView& frame, DrawInfo<FreqT, FreqN>& info) {
+        const etl::array<FreqT, FreqN>& mags = info.freq_magnitudes;
+        const unsigned int rows = frame.num_leds / width_;
+        if (rows == 0) {
+            return FrameChange::none();
+        }
+        bool restarted = false;
+        if (rows != rows_) {
+            std::fill(frame.data.begin(), frame.data.end(), BLACK);
+            rows_ = static_cast<uint16_t>(rows);
+            head_ = 0;
+            restarted = true;
+        }
+
+        uint32_t loudest = 0;
+        for (unsigned int b = FreqN < 2 ? 0 : 1; b < FreqN; b++) {
+            loudest = static_cast<uint32_t>(mags[b]) > loudest ? static_cast<uint32_t>(mags[b]) : loudest;
+        }
+        gain_.update(loudest);
+
+        head_ = head_ == 0 ? static_cast<uint16_t>(rows - 1) : static_cast<uint16_t>(head_ - 1);
+        RGBValue* row = frame.data.data() + static_cast<size_t>(head_) * width_;
+        const unsigned int first = FreqN < 2 ? 0 : 1;
+        const unsigned int bins = FreqN - first;
+        for (unsigned int x = 0; x < width_; x++) {
+            unsigned int lo = first + x * bins / width_;
+            unsigned int hi = first + (x + 1) * bins / width_;
+            uint32_t m = lo < FreqN ? static_cast<uint32_t>(mags[lo]) : 0;
+            for (unsigned int b = lo + 1; b < hi; b++) {
+                m = static_cast<uint32_t>(mags[b]) > m ? static_cast<uint32_t>(mags[b]) : m;
+            }
+            row[x] = heat_colour(gain_.level(m));
+        }
+        return restarted ? FrameChange::full() : FrameChange::range(head_ * width_, (head_ + 1u) * width_);
+    }
 };
 
 
+/***************************************************************************************************
+ * @brief Twinkle: random LEDs flash warm white and fade out over 15 frames.
+ *
+ * Each LED's brightness is 4 bits of `State` (see pixel_state.h): a frame fades every LED with one
+ * bulk `sub_sat`, lights a few new ones and renders. `TwinkleEffect` packs the state 8 LEDs to a
+ * word; `BasicTwinkleEffect<ByteState<4, MAX_LEDS>>` is the byte-per-LED version to compare.
+ **************************************************************************************************/
+template <typename State>
+class BasicTwinkleEffect : public EffectBase<BasicTwinkleEffect<State>> {
+
+    static_assert(State::bits == 4, "twinkle brightness is 4 bits");
+
+    public:
+
+    /**
+     * @brief Runtime parameters (see params.h).
+     */
+    struct Params {
+        RGBValue colour {255, 180, 80};     /// at full brightness
+        uint8_t fade = 1;                   /// brightness lost per frame, of 15
+        uint16_t leds_per_twinkle = 480;    /// a new twinkle each frame per this many LEDs
+    };
+
+    private:
+
+    State state_;
+    uint32_t rng_ = 0x2545F491;
+    Params params_;
+
+    public:
+
+    const Params& params() const {
+        return params_;
+    }
+
+    /**
+     * @brief New parameters, kept in range: they can come from a UART (see params.h).
+     */
+    void set_params(const Params& params) {
+        params_ = params;
+        params_.fade = params_.fade < State::max_value ? params_.fade : State::max_value;
+        params_.leds_per_twinkle = params_.leds_per_twinkle > 0 ? params_.leds_per_twinkle : 1;
+    }
+
+    template <typename FreqT, unsigned int FreqN>
+    FrameChange draw_frame(FrameView& frame, [[maybe_unused]] DrawInfo<FreqT, FreqN>& info) {
+        const unsigned int n = frame.num_leds < State::count ? frame.num_leds : static_cast<unsigned int>(State::count);
+        if (n == 0) {
+            return FrameChange::none();
+        }
+        state_.sub_sat(n, params_.fade);
+        // by default about one LED in 32 lit at a time: each lasts 15 frames
+        for (unsigned int new_leds = n / params_.leds_per_twinkle + 1; new_leds > 0; new_leds--) {
+            state_.set(xorshift32(rng_) % n, State::max_value);
+        }
+        const RGBValue colour = params_.colour;
+        state_.for_each(n, [&frame, colour](size_t i, uint8_t level) {
+            uint32_t l = level * 17u + (level >> 3);    // 0 to 256
+            frame.data[i] = RGBValue{static_cast<uint8_t>((colour.r * l) >> 8), static_cast<uint8_t>((colour.g * l) >> 8),
+                                     static_cast<uint8_t>((colour.b * l) >> 8)};
+        });
+        return FrameChange::range(0, n);
+    }
+};
+
+using TwinkleEffect = BasicTwinkleEffect<PackedState<4, MAX_LEDS>>;
+
+
+/***************************************************************************************************
+ * @brief Fire: flames rise along the strip, one every `FLAME_LEDS` LEDs, from heat that sparks at
+ * their base, drifts up and cools (after Fire2012).
+ *
+ * Heat is 6 bits of `State` per LED. Cooling is one bulk `sub_sat_random` (by default 0-3 off every
+ * LED, a word of LEDs at a time); then each flame is unpacked into a tile on the stack, drifts up
+ * (each LED averages the two below it), sparks, is drawn and is packed back. At coarser levels of
+ * detail the heat still moves on every LED, but only every 2nd, 4th or 8th LED of a flame (and its
+ * tip) is coloured and the rest interpolated.
+ * `FireEffect` packs the heat 5 LEDs to a word; `BasicFireEffect<ByteState<6, MAX_LEDS>>` is the
+ * byte-per-LED version to compare.
+ **************************************************************************************************/
+template <typename State>
+class BasicFireEffect : public EffectBase<BasicFireEffect<State>> {
+
+    static_assert(State::bits == 6, "fire heat is 6 bits");
+
+    public:
+
+    static constexpr unsigned int FLAME_LEDS = 64;
+    static constexpr uint8_t LOD_LEVELS = 4;
+
+    /**
+     * @brief Runtime parameters (see params.h).
+     */
+    struct Params {
+        uint8_t cooling = 3;        /// a random 0 to `cooling` heat (of 63) lost per LED and frame: a
+                                    /// power of 2 minus 1
+        uint8_t sparking = 128;     /// chance of a spark per flame and frame, of 256
+    };
+
+    private:
+
+    State heat_;
+    uint32_t rng_ = 0x9E3779B9;
+    Params params_;
+    uint8_t lod_ = 0;
+
+    public:
+
+    const Params& params() const {
+        return params_;
+    }
+
+    /**
+     * @brief New parameters, kept in range: they can come from a UART (see params.h). `cooling`
+     * is rounded up to a power of 2 minus 1, at most 63.
+     */
+    void set_params(const Params& params) {
+        params_ = params;
+        uint8_t cooling = params_.cooling < State::max_value ? params_.cooling : State::max_value;
+        for (unsigned int shift = 1; shift < 8; shift <<= 1) {
+            cooling |= static_cast<uint8_t>(cooling >> shift);
+        }
+        params_.cooling = cooling;
+    }
+
+    template <typename FreqT, unsigned int FreqN>
+    FrameChange draw_frame(FrameView& frame, [[maybe_unused]] DrawInfo<FreqT, FreqN>& info) {
+        const unsigned int n = frame.num_leds < State::count ? frame.num_leds : static_cast<unsigned int>(State::count);
+        heat_.sub_sat_random(n, [this]() { return xorshift32(rng_); }, params_.cooling);
+
+        // each flame is unpacked into a tile, since drifting up reads the LEDs below
+        const unsigned int stride = 1u << lod_;
+        uint8_t h[FLAME_LEDS];
+        for (unsigned int base = 0; base < n; base += FLAME_LEDS) {
+            const unsigned int len = n - base < FLAME_LEDS ? n - base : FLAME_LEDS;
+            heat_.unpack(base, len, h);
+            for (unsigned int i = len - 1; i >= 2; i--) {
+                h[i] = static_cast<uint8_t>(((h[i - 1] + 2u * h[i - 2]) * 85) >> 8);     // / 3
+            }
+            uint32_t r = xorshift32(rng_);
+            if ((r & 0xFF) < params_.sparking && len > 4) {
+                uint8_t& spark = h[(r >> 8) & 3];
+                uint8_t hot = static_cast<uint8_t>(40 + (r >> 10) % 24);
+                spark = spark > hot ? spark : hot;
+            }
+            auto colour = [&h](unsigned int i) {
+                return heat_colour(static_cast<uint8_t>((h[i] << 2) | (h[i] >> 4)));
+            };
+            for (unsigned int i = 0; i < len; i += stride) {
+                frame.data[base + i] = colour(i);
+            }
+            if ((len - 1) % stride != 0) {
+                frame.data[base + len - 1] = colour(len - 1);
+            }
+            interpolate_decimated(frame.data.subspan(base, len), stride);
+            heat_.pack(base, len, h);
+        }
+        return FrameChange::range(0, n);
+    }
+
+    /**
+     * @brief Levels of detail: every 1, 2, 4 or 8 LEDs of a flame are coloured from its heat.
+     */
+    uint8_t lod_levels() const {
+        return LOD_LEVELS;
+    }
+
+    void set_lod(uint8_t level) {
+        lod_ = level < LOD_LEVELS ? level : LOD_LEVELS - 1;
+    }
+};
+
+using FireEffect = BasicFireEffect<PackedState<6, MAX_LEDS>>;
+
+
 
 #endif  // EVENTS_LIB_H
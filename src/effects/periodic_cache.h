@@ -0,0 +1,199 @@
+/**
+ * @file periodic_cache.h
+ * @brief Render one period of a repeating effect once, then replay it instead of re-rendering.
+ *
+ * Deterministic looping effects (e.g. `LaserEffect`, `BlinkEffect`) compute identical frames
+ * every cycle. If an effect's `period_frames` is non-zero, `PeriodicCache` renders that many
+ * frames into a compressed clip (see clips/clip.h) in its own fixed-size buffer and from then
+ * on only decodes the frame for the current time, freeing CPU for audio analysis.
+ *
+ * A replayed frame reports only the pixels that differ from the frame replayed before it (see
+ * `FrameChange`), and nothing while the time stays within one cached frame, so the LED driver
+ * isn't kept busy re-encoding a frame that didn't change.
+ *
+ * The cache is rebuilt when the effect, the number of LEDs or the effect's generation changes
+ * (see `EffectFactory::generation`), or on `invalidate()`. If the effect isn't periodic or one
+ * period doesn't fit in the buffer, the effect is rendered live as usual.
+ *
+ * main.cpp draws effects whose `period_frames` is non-zero through a cache sized by
+ * `PipelineConfig::periodic_cache_bytes`:
+ * ```cpp
+ * static PeriodicCache<32 * 1024> cache(20'000);   // static: the buffer is in .bss
+ * cache.draw_frame(effect_factory, frame, info);   // instead of effect_factory.draw_frame(...)
+ * ```
+ *
+ * @param Bytes size of the cache buffer
+ */
+#ifndef PERIODIC_CACHE_H
+#define PERIODIC_CACHE_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <type_traits>
+#include "etl/span.h"
+#include "../draw.h"
+#include "../clips/clip.h"
+
+
+namespace periodic_cache_detail {
+
+    template <typename Effect, typename = void>
+    struct has_generation : std::false_type {};
+
+    template <typename Effect>
+    struct has_generation<Effect, std::void_t<decltype(std::declval<const Effect&>().generation())>>
+        : std::true_type {};
+
+    template <typename Effect>
+    uint32_t generation(const Effect& effect) {
+        if constexpr (has_generation<Effect>::value) {
+            return effect.generation();
+        } else {
+            return 0;
+        }
+    }
+}
+
+
+template <size_t Bytes>
+class PeriodicCache {
+
+    private:
+
+    enum class State {
+        Empty,      /// nothing cached, build on next frame
+        Cached,     /// replaying
+        Live        /// not periodic or doesn't fit, render live until the key changes
+    };
+
+    uint8_t buffer_[Bytes];
+    ClipWriter writer_;
+    ClipPlayer player_;
+    State state_ = State::Empty;
+    uint32_t frame_period_us_;
+
+    // what the cache was built for
+    const void* effect_ = nullptr;
+    unsigned int num_leds_ = 0;
+    uint32_t generation_ = 0;
+
+    static constexpr uint32_t NOT_SHOWN = UINT32_MAX;
+
+    uint64_t time_us_ = 0;          // time since the cache was built
+    uint32_t shown_ = NOT_SHOWN;    // index of the cached frame in the frame drawn into
+    uint32_t frames_replayed_ = 0;
+    uint32_t frames_rendered_ = 0;
+    bool live_drawn_ = false;       // a live frame was drawn since the last rebuild
+
+
+    template <typename Effect>
+    bool key_changed(const Effect& effect, const Frame& frame) const {
+        return effect_ != &effect || num_leds_ != frame.num_leds ||
+               generation_ != periodic_cache_detail::generation(effect);
+    }
+
+    // render one period of `effect` into the cache using `frame` as scratch
+    template <typename Effect, typename FreqT, unsigned int FreqN>
+    bool build(Effect& effect, Frame& frame, DrawInfo<FreqT, FreqN>& info, uint32_t period) {
+        etl::span<uint8_t> buffer(buffer_, Bytes);
+        if (!writer_.begin(buffer, frame.num_leds, frame_period_us_, period)) {
+            return false;
+        }
+
+        DrawInfo<FreqT, FreqN> render_info {frame_period_us_, info.freq_magnitudes};
+        for (uint32_t i = 0; i < period; i++) {
+            effect.draw_frame(frame, render_info);
+            frames_rendered_++;
+            if (!writer_.add_frame(frame.data)) {
+                // the effect has advanced by i + 1 frames, it carries on live from there
+                return false;
+            }
+        }
+        return player_.open(writer_.finish()) == ClipPlayer::OpenResult::Ok;
+    }
+
+
+    public:
+
+    /**
+     * @param frame_period_us time between frames the effect is rendered for. Replay picks the
+     * cached frame from the actual elapsed time.
+     */
+    explicit PeriodicCache(uint32_t frame_period_us) : frame_period_us_(frame_period_us) {
+    }
+
+    PeriodicCache(const PeriodicCache&) = delete;
+
+    /**
+     * @brief Draw the next frame of `effect`, from the cache if possible.
+     *
+     * Building the cache renders one whole period of the effect in this call.
+     *
+     * @return what changed: for a frame from the cache, the pixels that differ from the last one
+     * replayed, else what the effect reports
+     */
+    template <typename Effect, typename FreqT, unsigned int FreqN>
+    FrameChange draw_frame(Effect& effect, Frame& frame, DrawInfo<FreqT, FreqN>& info) {
+        if (key_changed(effect, frame)) {
+            effect_ = &effect;
+            num_leds_ = frame.num_leds;
+            generation_ = periodic_cache_detail::generation(effect);
+            state_ = State::Empty;
+        }
+
+        if (state_ == State::Empty) {
+            live_drawn_ = false;
+            uint32_t period = effect.period_frames(frame.num_leds, frame_period_us_);
+            if (period > 0 && build(effect, frame, info, period)) {
+                state_ = State::Cached;
+                time_us_ = 0;
+                shown_ = NOT_SHOWN;     // building left a rendered frame behind
+            } else {
+                state_ = State::Live;
+            }
+        } else if (state_ == State::Cached) {
+            time_us_ += info.elapsed_time_us;
+        }
+
+        if (state_ == State::Cached) {
+            uint32_t index = player_.frame_at(time_us_);
+            frames_replayed_++;
+            if (index == shown_) {
+                return FrameChange::none();
+            }
+            FrameChange change = player_.decode_frame_changes(index, frame);
+            bool first = shown_ == NOT_SHOWN;
+            shown_ = index;
+            return first ? FrameChange::full() : change;
+        }
+        FrameChange change = draw_effect(effect, frame, info);
+        frames_rendered_++;
+        if (!live_drawn_) {
+            live_drawn_ = true;     // the frame held something else before
+            return FrameChange::full();
+        }
+        return change;
+    }
+
+    /**
+     * @brief Rebuild the cache on the next frame, e.g. after changing an effect's parameters.
+     */
+    void invalidate() {
+        state_ = State::Empty;
+    }
+
+    /** @brief True if frames are being replayed from the cache. */
+    bool is_cached() const { return state_ == State::Cached; }
+
+    /** @brief Bytes of the buffer used by the cached clip. */
+    size_t used_bytes() const { return state_ == State::Cached ? writer_.size() : 0; }
+
+    /** @brief Frames decoded from the cache. */
+    uint32_t frames_replayed() const { return frames_replayed_; }
+
+    /** @brief Frames rendered by the effect (live or to build the cache). */
+    uint32_t frames_rendered() const { return frames_rendered_; }
+};
+
+
+#endif // PERIODIC_CACHE_H
@@ -0,0 +1,218 @@
+/**
+ * @file zones.h
+ * @brief Different effects on different parts of one strip, e.g. the bar front, the ceiling and
+ * the DJ booth of one 3800 LED run, drawn into the same frame.
+ *
+ * The zone table is a type: each `Zone` names its effect, first LED, length and the core that
+ * draws it, and the effect's parameters are its constructor arguments. Zones are checked at
+ * compile time not to overlap, and each effect is called directly (no variant dispatch) with a
+ * `FrameView` of its part of the frame, so nothing is copied.
+ *
+ * ```cpp
+ * static ZoneSet zones(time_us_64,
+ *                      Zone<LaserEffect, 0, 1200>{},                                   // bar front
+ *                      Zone<SpectrumEffect, 1200, 1300>{SpectrumEffect::Scale::Linear}, // ceiling
+ *                      Zone<FireEffect, 2500, 1300, 1>{});                              // booth, core 1
+ * zones.draw_frame(frame, info, 0);    // on core 0
+ * zones.draw_frame(frame, info, 1);    // on core 1, at the same time
+ * ```
+ *
+ * Zones on different cores write different pixels, so the cores can draw the same frame at once;
+ * the caller still has to wait for both (e.g. over the multicore FIFO) before sending it.
+ * `stats(i)` has the render time of zone `i`, measured by the core that draws it.
+ *
+ * Effects that scroll by rotating panel rows (their own `row_offset()`, e.g. `WaterfallEffect`)
+ * can't be zones: the LED driver maps the whole frame, not each zone, so they are rejected at
+ * compile time.
+ */
+#ifndef ZONES_H
+#define ZONES_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "etl/array.h"
+#include "../draw.h"
+
+
+namespace zones_detail {
+
+    // `Effect` has its own `row_offset` rather than `EffectBase`'s, which is always 0
+    template <typename Effect, typename = void>
+    struct uses_row_offset : std::false_type {};
+
+    template <typename Effect>
+    struct uses_row_offset<Effect, std::void_t<decltype(&Effect::row_offset)>>
+        : std::is_same<decltype(&Effect::row_offset), uint16_t (Effect::*)() const> {};
+}
+
+
+/**
+ * @brief One zone: `Effect` drawn on LEDs `Start` to `Start + Length - 1` by core `Core`.
+ *
+ * Constructor arguments are passed to the effect, e.g. `Zone<WaterfallEffect, 0, 256>{16}`.
+ */
+template <typename Effect, unsigned int Start, unsigned int Length, unsigned int Core = 0>
+struct Zone {
+
+    static_assert(Length > 0, "a zone needs at least one LED");
+    static_assert(Core <= 1, "the RP2040 has cores 0 and 1");
+    static_assert(!zones_detail::uses_row_offset<Effect>::value,
+                  "the LED driver can't rotate the rows of one zone: row_offset() effects need the whole frame");
+
+    using effect_type = Effect;
+    static constexpr unsigned int start = Start;
+    static constexpr unsigned int length = Length;
+    static constexpr unsigned int core = Core;
+
+    Effect effect;
+
+    template <typename... Args, typename = std::enable_if_t<std::is_constructible<Effect, Args&&...>::value>>
+    explicit Zone(Args&&... args) : effect(std::forward<Args>(args)...) {
+    }
+};
+
+
+/**
+ * @brief Render time of one zone.
+ */
+struct ZoneStats {
+    uint32_t frames = 0;
+    uint32_t last_us = 0;
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;      /// mean is `total_us / frames`
+};
+
+
+namespace zones_detail {
+
+    // no two of the [start, start + length) ranges overlap
+    template <size_t N>
+    constexpr bool disjoint(const unsigned int (&start)[N], const unsigned int (&length)[N]) {
+        for (size_t i = 0; i < N; i++) {
+            for (size_t j = i + 1; j < N; j++) {
+                if (start[i] < start[j] + length[j] && start[j] < start[i] + length[i]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+
+/**
+ * @brief A table of `Zone`s drawn into one frame.
+ */
+template <typename... Zones>
+class ZoneSet {
+
+    public:
+
+    using NowFn = uint64_t (*)();
+
+    static constexpr size_t size = sizeof...(Zones);
+    static constexpr unsigned int ALL_CORES = 0xFF;
+
+    private:
+
+    static_assert(sizeof...(Zones) > 0, "a ZoneSet needs at least one zone");
+
+    static constexpr unsigned int starts[] = {Zones::start...};
+    static constexpr unsigned int lengths[] = {Zones::length...};
+    static_assert(zones_detail::disjoint(starts, lengths), "zones overlap");
+    static_assert(((Zones::start + Zones::length <= static_cast<unsigned int>(MAX_LEDS)) && ...),
+                  "a zone ends past MAX_LEDS");
+
+    std::tuple<Zones...> zones_;
+    NowFn now_us_;
+    etl::array<ZoneStats, sizeof...(Zones)> stats_ {};
+
+    template <size_t I, typename FreqT, unsigned int FreqN>
+    FrameChange draw_zone(FrameView& frame, DrawInfo<FreqT, FreqN>& info, unsigned int core) {
+        using Z = typename std::tuple_element<I, std::tuple<Zones...>>::type;
+        if ((core != ALL_CORES && Z::core != core) || Z::start >= frame.num_leds) {
+            return FrameChange::none();
+        }
+        const unsigned int length = frame.num_leds - Z::start < Z::length ? frame.num_leds - Z::start : Z::length;
+        FrameView view(frame.data.subspan(Z::start, length));
+
+        uint64_t start = now_us_();
+        FrameChange change = draw_effect(std::get<I>(zones_).effect, view, info);
+        uint32_t us = static_cast<uint32_t>(now_us_() - start);
+
+        ZoneStats& stats = stats_[I];
+        stats.frames++;
+        stats.last_us = us;
+        stats.max_us = us > stats.max_us ? us : stats.max_us;
+        stats.total_us += us;
+        return change.within(Z::start, length);
+    }
+
+    template <typename FreqT, unsigned int FreqN, size_t... I>
+    FrameChange draw_zones(FrameView& frame, DrawInfo<FreqT, FreqN>& info, unsigned int core, std::index_sequence<I...>) {
+        FrameChange change = FrameChange::none();
+        ((change = change.merge(draw_zone<I>(frame, info, core))), ...);
+        return change;
+    }
+
+
+    public:
+
+    /**
+     * @param now_us µs clock for the zone timings (e.g. `time_us_64`)
+     */
+    explicit ZoneSet(NowFn now_us, Zones... zones) : zones_(std::move(zones)...), now_us_(now_us) {
+    }
+
+    ZoneSet(const ZoneSet&) = delete;
+
+    /**
+     * @brief Draw every zone of `core` (or all of them) into its part of `frame`. Zones past the
+     * end of the frame are skipped and the last one is cut short; LEDs outside every zone are left
+     * as they are.
+     *
+     * @return the pixels the zones changed, from the first changed to the last
+     */
+    template <typename FreqT, unsigned int FreqN>
+    FrameChange draw_frame(FrameView& frame, DrawInfo<FreqT, FreqN>& info, unsigned int core = ALL_CORES) {
+        return draw_zones(frame, info, core, std::index_sequence_for<Zones...>{});
+    }
+
+    /**
+     * @brief The effect of zone `I`, e.g. to change its parameters.
+     */
+    template <size_t I>
+    auto& effect() {
+        return std::get<I>(zones_).effect;
+    }
+
+    const ZoneStats& stats(size_t zone) const {
+        return stats_[zone];
+    }
+
+    void reset_stats() {
+        stats_.fill(ZoneStats{});
+    }
+
+    // so a `FrameScheduler` can drive the whole set: every zone runs at the same level of detail
+
+    uint8_t lod_levels() const {
+        uint8_t levels = 1;
+        std::apply([&levels](const auto&... zone) {
+            ((levels = zone.effect.lod_levels() > levels ? zone.effect.lod_levels() : levels), ...);
+        }, zones_);
+        return levels;
+    }
+
+    void set_lod(uint8_t level) {
+        std::apply([level](auto&... zone) {
+            (zone.effect.set_lod(level < zone.effect.lod_levels() ? level : static_cast<uint8_t>(zone.effect.lod_levels() - 1)), ...);
+        }, zones_);
+    }
+};
+
+
+#endif // ZONES_H
@@ -0,0 +1,149 @@
+/**
+ * @file fft_simd.h
+ * @brief SIMD radix-2 butterflies for `FixedPointFFT` on hosts with SSE2, AVX2 or NEON (e.g. the
+ * Linux host runtime), bit-exact with the scalar `mul_sat`, `add_sat` and `sub_sat` of
+ * fixed_point.h.
+ *
+ * The widest instruction set the compiler targets is used (`-mavx2` for AVX2; SSE2 is always there
+ * on x86-64, NEON on AArch64). On the RP2040 there's none: `available` is false and the FFT keeps
+ * its scalar loop.
+ *
+ * Q15 products: SSE2/AVX2 put (a * b) >> 15 together from the high and low halves of the 32-bit
+ * product, and clamp the one product that overflows (-1 * -1); NEON's `vqdmulh` is exactly that.
+ */
+#ifndef FFT_SIMD_H
+#define FFT_SIMD_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "fixed_point.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static_assert(sizeof(ComplexQ15) == 2 * sizeof(int16_t), "butterflies load ComplexQ15 as re, im pairs");
+
+
+namespace fft_simd {
+
+#if defined(__AVX2__)
+    constexpr const char* name = "avx2";
+    constexpr size_t lanes = 8;             /// complex values per vector
+#elif defined(__SSE2__)
+    constexpr const char* name = "sse2";
+    constexpr size_t lanes = 4;
+#elif defined(__ARM_NEON)
+    constexpr const char* name = "neon";
+    constexpr size_t lanes = 8;
+#else
+    constexpr const char* name = "none";
+    constexpr size_t lanes = 0;
+#endif
+
+    /// true if there's a SIMD kernel for this target
+    constexpr bool available = lanes > 0;
+
+
+#if defined(__AVX2__)
+
+    // (x * y) >> 15 per 16-bit lane, clamped
+    inline __m256i mul_q15(__m256i x, __m256i y) {
+        __m256i hi = _mm256_mulhi_epi16(x, y);
+        __m256i r = _mm256_or_si256(_mm256_slli_epi16(hi, 1), _mm256_srli_epi16(_mm256_mullo_epi16(x, y), 15));
+        return _mm256_xor_si256(r, _mm256_cmpeq_epi16(hi, _mm256_set1_epi16(0x4000)));
+    }
+
+    // even lane minus (or plus) odd lane of each pair, clamped, as 16 bits in the low half
+    inline __m256i pair_sub(__m256i v) {
+        __m256i d = _mm256_sub_epi32(_mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16), _mm256_srai_epi32(v, 16));
+        return _mm256_packs_epi32(d, d);
+    }
+
+    inline __m256i pair_add(__m256i v) {
+        __m256i s = _mm256_add_epi32(_mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16), _mm256_srai_epi32(v, 16));
+        return _mm256_packs_epi32(s, s);
+    }
+
+    inline void butterfly(int16_t* a, int16_t* b, const int16_t* w) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+        __m256i vw = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w));
+        __m256i swapped = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(vw, 0xB1), 0xB1);   // wi, wr
+        __m256i re = pair_sub(mul_q15(vb, vw));         // br*wr - bi*wi
+        __m256i im = pair_add(mul_q15(vb, swapped));    // br*wi + bi*wr
+        __m256i t = _mm256_unpacklo_epi16(re, im);      // packs and unpack stay in 128-bit lanes
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(b), _mm256_subs_epi16(va, t));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(a), _mm256_adds_epi16(va, t));
+    }
+
+#elif defined(__SSE2__)
+
+    inline __m128i mul_q15(__m128i x, __m128i y) {
+        __m128i hi = _mm_mulhi_epi16(x, y);
+        __m128i r = _mm_or_si128(_mm_slli_epi16(hi, 1), _mm_srli_epi16(_mm_mullo_epi16(x, y), 15));
+        return _mm_xor_si128(r, _mm_cmpeq_epi16(hi, _mm_set1_epi16(0x4000)));
+    }
+
+    inline __m128i pair_sub(__m128i v) {
+        __m128i d = _mm_sub_epi32(_mm_srai_epi32(_mm_slli_epi32(v, 16), 16), _mm_srai_epi32(v, 16));
+        return _mm_packs_epi32(d, d);
+    }
+
+    inline __m128i pair_add(__m128i v) {
+        __m128i s = _mm_add_epi32(_mm_srai_epi32(_mm_slli_epi32(v, 16), 16), _mm_srai_epi32(v, 16));
+        return _mm_packs_epi32(s, s);
+    }
+
+    inline void butterfly(int16_t* a, int16_t* b, const int16_t* w) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        __m128i vw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w));
+        __m128i swapped = _mm_shufflehi_epi16(_mm_shufflelo_epi16(vw, 0xB1), 0xB1);
+        __m128i re = pair_sub(mul_q15(vb, vw));
+        __m128i im = pair_add(mul_q15(vb, swapped));
+        __m128i t = _mm_unpacklo_epi16(re, im);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(b), _mm_subs_epi16(va, t));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(a), _mm_adds_epi16(va, t));
+    }
+
+#elif defined(__ARM_NEON)
+
+    inline void butterfly(int16_t* a, int16_t* b, const int16_t* w) {
+        int16x8x2_t va = vld2q_s16(a);      // re, im
+        int16x8x2_t vb = vld2q_s16(b);
+        int16x8x2_t vw = vld2q_s16(w);
+        int16x8_t re = vqsubq_s16(vqdmulhq_s16(vb.val[0], vw.val[0]), vqdmulhq_s16(vb.val[1], vw.val[1]));
+        int16x8_t im = vqaddq_s16(vqdmulhq_s16(vb.val[0], vw.val[1]), vqdmulhq_s16(vb.val[1], vw.val[0]));
+        int16x8x2_t out;
+        out.val[0] = vqsubq_s16(va.val[0], re);
+        out.val[1] = vqsubq_s16(va.val[1], im);
+        vst2q_s16(b, out);
+        out.val[0] = vqaddq_s16(va.val[0], re);
+        out.val[1] = vqaddq_s16(va.val[1], im);
+        vst2q_s16(a, out);
+    }
+
+#endif
+
+    /**
+     * @brief `count` butterflies, a multiple of `lanes`: for each j, t = b[j] * w[j], then
+     * b[j] = a[j] - t and a[j] = a[j] + t, all clamped as `mul_sat`/`add_sat`/`sub_sat` do.
+     */
+    inline void butterflies([[maybe_unused]] ComplexQ15* a, [[maybe_unused]] ComplexQ15* b,
+                            [[maybe_unused]] const ComplexQ15* w, [[maybe_unused]] size_t count) {
+#if defined(__AVX2__) || defined(__SSE2__) || defined(__ARM_NEON)
+        for (size_t j = 0; j < count; j += lanes) {
+            butterfly(reinterpret_cast<int16_t*>(a + j), reinterpret_cast<int16_t*>(b + j),
+                      reinterpret_cast<const int16_t*>(w + j));
+        }
+#endif
+    }
+}
+
+
+#endif // FFT_SIMD_H
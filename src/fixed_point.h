@@ -0,0 +1,329 @@
+/**
+ * @file fixed_point.h
+ * @brief Fixed-point numbers as strong types: Q15, Q31 and 16.16, with wrapping and saturating
+ * arithmetic and a complex type, for code that must not use floating point on the RP2040.
+ *
+ * ```cpp
+ * using namespace fixed_literals;
+ * constexpr Q15 half = 0.5_q15;                // converted at compile time
+ * Q15 y = mul_sat(x, half);                    // (x * half) >> 15, clamped
+ * Q16_16 t = Q16_16::ratio(elapsed_us, 50'000); // 1.5 after 75ms
+ * int leds = (t * length).to_int();
+ * ```
+ *
+ * Every operation is a constexpr inline function over the raw integer, so it compiles to the same
+ * multiply, shift and clamp as the hand-written code it replaces (see bench/bench_fixed.cpp).
+ * `+`, `-` and `*` wrap on overflow like the underlying integers; `add_sat`, `sub_sat` and
+ * `mul_sat` clamp to the range instead. Products are truncated (rounded towards -infinity).
+ */
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+#include <limits>
+#include <type_traits>
+
+
+/**
+ * @brief Signed fixed-point number with `Frac` fractional bits, stored in `Rep`.
+ *
+ * @param Rep int16_t or int32_t
+ * @param Frac fractional bits, e.g. 15 for Q15 (-1 to 0.99997)
+ */
+template <typename Rep, unsigned int Frac>
+class Fixed {
+
+    static_assert(std::is_same<Rep, int16_t>::value || std::is_same<Rep, int32_t>::value,
+                  "Rep must be int16_t or int32_t");
+    static_assert(Frac < sizeof(Rep) * 8, "Frac must leave a sign bit");
+
+    public:
+
+    using rep = Rep;
+    /// type products and sums are computed in before they're narrowed
+    using wide = typename std::conditional<sizeof(Rep) == 2, int32_t, int64_t>::type;
+    static constexpr unsigned int frac_bits = Frac;
+
+
+    private:
+
+    Rep raw_ = 0;
+
+    static constexpr Rep rep_max = std::numeric_limits<Rep>::max();
+    static constexpr Rep rep_min = std::numeric_limits<Rep>::min();
+
+    constexpr explicit Fixed(Rep raw, int) : raw_(raw) {
+    }
+
+    static constexpr Fixed clamp64(int64_t raw) {
+        return Fixed(raw > rep_max ? rep_max : (raw < rep_min ? rep_min : static_cast<Rep>(raw)), 0);
+    }
+
+
+    public:
+
+    constexpr Fixed() = default;
+
+    static constexpr Fixed from_raw(Rep raw) {
+        return Fixed(raw, 0);
+    }
+
+    /**
+     * @brief Clamp a wide value to the range of `Rep`.
+     */
+    static constexpr Fixed saturate(wide raw) {
+        return Fixed(raw > rep_max ? rep_max : (raw < rep_min ? rep_min : static_cast<Rep>(raw)), 0);
+    }
+
+    /**
+     * @brief Keep the low bits of a wide value, like integer overflow.
+     */
+    static constexpr Fixed wrap(wide raw) {
+        using urep = typename std::make_unsigned<Rep>::type;
+        return Fixed(static_cast<Rep>(static_cast<urep>(raw)), 0);
+    }
+
+    /**
+     * @brief Nearest value to `value`, clamped. For constants: constexpr, so no float at run-time.
+     */
+    static constexpr Fixed from_double(double value) {
+        double scaled = value * static_cast<double>(static_cast<int64_t>(1) << Frac);
+        scaled += scaled < 0 ? -0.5 : 0.5;
+        if (scaled >= static_cast<double>(rep_max)) {
+            return Fixed(rep_max, 0);
+        }
+        if (scaled <= static_cast<double>(rep_min)) {
+            return Fixed(rep_min, 0);
+        }
+        return Fixed(static_cast<Rep>(static_cast<int64_t>(scaled)), 0);
+    }
+
+    static constexpr Fixed from_int(int32_t value) {
+        return clamp64(static_cast<int64_t>(value) * (static_cast<int64_t>(1) << Frac));
+    }
+
+    /**
+     * @brief `num / den`, truncated and clamped, e.g. elapsed time over a period.
+     */
+    static constexpr Fixed ratio(int64_t num, int64_t den) {
+        return clamp64((num * (static_cast<int64_t>(1) << Frac)) / den);
+    }
+
+    static constexpr Fixed max() {
+        return Fixed(rep_max, 0);
+    }
+
+    static constexpr Fixed min() {
+        return Fixed(rep_min, 0);
+    }
+
+    /// 1.0, or the largest value below it if 1.0 isn't representable (Q15, Q31)
+    static constexpr Fixed one() {
+        return Frac == sizeof(Rep) * 8 - 1 ? Fixed(rep_max, 0) : Fixed(static_cast<Rep>(static_cast<wide>(1) << Frac), 0);
+    }
+
+    constexpr Rep raw() const {
+        return raw_;
+    }
+
+    /// integer part, rounded towards -infinity
+    constexpr int32_t to_int() const {
+        return static_cast<int32_t>(raw_ >> Frac);
+    }
+
+    /// for host tools and tests
+    constexpr double to_double() const {
+        return static_cast<double>(raw_) / static_cast<double>(static_cast<int64_t>(1) << Frac);
+    }
+
+    // wrapping arithmetic
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) {
+        return wrap(static_cast<wide>(a.raw_) + b.raw_);
+    }
+
+    friend constexpr Fixed operator-(Fixed a, Fixed b) {
+        return wrap(static_cast<wide>(a.raw_) - b.raw_);
+    }
+
+    friend constexpr Fixed operator-(Fixed a) {
+        return wrap(-static_cast<wide>(a.raw_));
+    }
+
+    friend constexpr Fixed operator*(Fixed a, Fixed b) {
+        return wrap((static_cast<wide>(a.raw_) * b.raw_) >> Frac);
+    }
+
+    /// scale by an integer, e.g. a position by a length
+    friend constexpr Fixed operator*(Fixed a, int32_t n) {
+        return wrap(static_cast<wide>(static_cast<int64_t>(a.raw_) * n));
+    }
+
+    friend constexpr Fixed operator>>(Fixed a, unsigned int shift) {
+        return Fixed(static_cast<Rep>(a.raw_ >> shift), 0);
+    }
+
+    Fixed& operator+=(Fixed b) {
+        return *this = *this + b;
+    }
+
+    Fixed& operator-=(Fixed b) {
+        return *this = *this - b;
+    }
+
+    Fixed& operator>>=(unsigned int shift) {
+        return *this = *this >> shift;
+    }
+
+    // saturating arithmetic
+
+    friend constexpr Fixed add_sat(Fixed a, Fixed b) {
+        return saturate(static_cast<wide>(a.raw_) + b.raw_);
+    }
+
+    friend constexpr Fixed sub_sat(Fixed a, Fixed b) {
+        return saturate(static_cast<wide>(a.raw_) - b.raw_);
+    }
+
+    friend constexpr Fixed mul_sat(Fixed a, Fixed b) {
+        return saturate((static_cast<wide>(a.raw_) * b.raw_) >> Frac);
+    }
+
+    friend constexpr Fixed mul_sat(Fixed a, int32_t n) {
+        return clamp64(static_cast<int64_t>(a.raw_) * n);
+    }
+
+    friend constexpr Fixed abs_sat(Fixed a) {
+        return a.raw_ < 0 ? saturate(-static_cast<wide>(a.raw_)) : a;
+    }
+
+    // comparison
+
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw_ == b.raw_; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw_ != b.raw_; }
+    friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw_ < b.raw_; }
+    friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw_ <= b.raw_; }
+    friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw_ > b.raw_; }
+    friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw_ >= b.raw_; }
+};
+
+
+using Q15 = Fixed<int16_t, 15>;     /// -1 to 1 - 2^-15, e.g. samples, sin/cos, window coefficients
+using Q31 = Fixed<int32_t, 31>;     /// -1 to 1 - 2^-31
+using Q16_16 = Fixed<int32_t, 16>;  /// -32768 to 32768 - 2^-16, e.g. positions and rates
+
+
+/**
+ * @brief Convert between formats, shifting the fraction and clamping to the target's range.
+ */
+template <typename To, typename FromRep, unsigned int FromFrac>
+constexpr To fixed_cast(Fixed<FromRep, FromFrac> from) {
+    int64_t raw = from.raw();
+    if (To::frac_bits >= FromFrac) {
+        raw *= static_cast<int64_t>(1) << (To::frac_bits - FromFrac);  // exact, up to 31 + 31 bits
+    } else {
+        raw >>= (FromFrac - To::frac_bits);
+    }
+    constexpr int64_t hi = std::numeric_limits<typename To::rep>::max();
+    constexpr int64_t lo = std::numeric_limits<typename To::rep>::min();
+    return To::from_raw(static_cast<typename To::rep>(raw > hi ? hi : (raw < lo ? lo : raw)));
+}
+
+
+/**
+ * @brief log2(x) for x > 0, e.g. to space things logarithmically without float. 0 for x = 0.
+ *
+ * Integer part from the top bit, then one fraction bit per squaring; truncated.
+ */
+constexpr Q16_16 log2_fixed(uint32_t x) {
+    if (x == 0) {
+        return Q16_16{};
+    }
+    int32_t result = 0;
+    while (result < 31 && x >= 2u << result) {
+        result++;
+    }
+    uint64_t y = (static_cast<uint64_t>(x) << 30) >> result;    // x / 2^result in [1, 2), Q30
+    result <<= 16;
+    for (int32_t bit = 1 << 15; bit > 0; bit >>= 1) {
+        y = (y * y) >> 30;
+        if (y >= (static_cast<uint64_t>(2) << 30)) {
+            y >>= 1;
+            result |= bit;
+        }
+    }
+    return Q16_16::from_raw(result);
+}
+
+
+/**
+ * @brief Complex fixed-point number, e.g. an FFT bin or twiddle factor.
+ */
+template <typename T>
+struct Complex {
+    T re;
+    T im;
+
+    friend constexpr Complex operator+(Complex a, Complex b) {
+        return {a.re + b.re, a.im + b.im};
+    }
+
+    friend constexpr Complex operator-(Complex a, Complex b) {
+        return {a.re - b.re, a.im - b.im};
+    }
+
+    friend constexpr Complex add_sat(Complex a, Complex b) {
+        return {add_sat(a.re, b.re), add_sat(a.im, b.im)};
+    }
+
+    friend constexpr Complex sub_sat(Complex a, Complex b) {
+        return {sub_sat(a.re, b.re), sub_sat(a.im, b.im)};
+    }
+
+    /**
+     * @brief (a.re * b.re - a.im * b.im) + j(a.re * b.im + a.im * b.re), each product and sum
+     * clamped.
+     */
+    friend constexpr Complex mul_sat(Complex a, Complex b) {
+        return {sub_sat(mul_sat(a.re, b.re), mul_sat(a.im, b.im)),
+                add_sat(mul_sat(a.re, b.im), mul_sat(a.im, b.re))};
+    }
+
+    friend constexpr bool operator==(Complex a, Complex b) {
+        return a.re == b.re && a.im == b.im;
+    }
+
+    friend constexpr bool operator!=(Complex a, Complex b) {
+        return !(a == b);
+    }
+};
+
+using ComplexQ15 = Complex<Q15>;
+using ComplexQ31 = Complex<Q31>;
+
+
+/**
+ * @brief Literals converted at compile time: `0.5_q15`, `-0.25_q31`, `1.5_q16`.
+ */
+namespace fixed_literals {
+
+    constexpr Q15 operator""_q15(long double value) {
+        return Q15::from_double(static_cast<double>(value));
+    }
+
+    constexpr Q31 operator""_q31(long double value) {
+        return Q31::from_double(static_cast<double>(value));
+    }
+
+    constexpr Q16_16 operator""_q16(long double value) {
+        return Q16_16::from_double(static_cast<double>(value));
+    }
+
+    constexpr Q16_16 operator""_q16(unsigned long long value) {
+        return Q16_16::from_int(static_cast<int32_t>(value));
+    }
+
+} // namespace fixed_literals
+
+
+#endif // FIXED_POINT_H
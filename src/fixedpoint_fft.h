@@ -5,6 +5,10 @@
 #include <array>
 #include <type_traits>
 #include "etl/array.h"
+#include "arena.h"
+#include "fixed_point.h"
+#include "fft_simd.h"
+#include "trig.h"
 
 /**
  * The Window Type. 
@@ -23,6 +27,130 @@ enum class WindowType {
 };
 
 
+/**
+ * How the butterflies are computed. `Simd` uses fft_simd.h's kernel on hosts with SSE2, AVX2 or
+ * NEON (e.g. the Linux host runtime) and gives exactly the same magnitudes as `Scalar`; on targets
+ * without, such as the RP2040, it is `Scalar`.
+ */
+enum class FftKernel {
+    Scalar,
+    Simd
+};
+
+
+
+namespace fft_detail {
+
+    /**
+     * @brief The FFT's lookup tables, built at compile time so they sit in flash and constructing
+     * an FFT costs nothing at boot.
+     */
+    template <uint16_t N, WindowType Window>
+    struct Tables {
+        ComplexQ15 twiddle[N/2];
+        Q15 window_coeffs[Window == WindowType::Bartlett ? 1 : N];  // Bartlett is computed on-the-fly
+        uint16_t bit_reverse[N];
+    };
+
+    template <uint16_t N, WindowType Window>
+    constexpr Tables<N, Window> make_tables() {
+        constexpr int16_t Q15_ONE = 32767;
+        Tables<N, Window> t {};
+
+        // Calculate twiddle factors
+        for (uint16_t k = 0; k < N/2; k++) {
+            // W_N^k = e^(-j*2*pi*k/N)
+            // angle = -2*pi*k/N as a 16-bit angle (65536 = 2*pi)
+            uint32_t angle = 0u - (0x10000u * k) / N;
+            t.twiddle[k] = {Q15::from_raw(trig::cos16(angle)), Q15::from_raw(trig::sin16(angle))};
+        }
+
+        // Calculate window coefficients based on window type
+        if constexpr (Window == WindowType::Hann) {
+            // Hann window: w(n) = 0.5 * (1 - cos(2πn/N))
+            for (uint16_t n = 0; n < N; n++) {
+                uint32_t angle = (0x10000u * n) / N;
+                int16_t cos_val = trig::cos16(angle);
+                // w(n) = 0.5 - 0.5*cos_val = 16384 - (cos_val >> 1)
+                t.window_coeffs[n] = Q15::from_raw(static_cast<int16_t>(16384 - (cos_val >> 1)));
+            }
+        } else if constexpr (Window == WindowType::BlackmanHarris) {
+            // Blackman-Harris window
+            // w(n) = a0 - a1*cos(2πn/N) + a2*cos(4πn/N) - a3*cos(6πn/N)
+            // Coefficients: a0 = 0.35875, a1 = 0.48829, a2 = 0.14128, a3 = 0.01168
+            constexpr Q15 a0 = Q15::from_raw(11761);  // 0.35875 * 32767
+            constexpr Q15 a1 = Q15::from_raw(16001);  // 0.48829 * 32767
+            constexpr Q15 a2 = Q15::from_raw(4630);   // 0.14128 * 32767
+            constexpr Q15 a3 = Q15::from_raw(383);    // 0.01168 * 32767
+
+            for (uint16_t n = 0; n < N; n++) {
+                uint32_t angle1 = (0x10000u * n) / N;      // 2πn/N
+                uint32_t angle2 = 2 * angle1;               // 4πn/N
+                uint32_t angle3 = 3 * angle1;               // 6πn/N
+
+                Q15 cos1 = Q15::from_raw(trig::cos16(angle1));
+                Q15 cos2 = Q15::from_raw(trig::cos16(angle2));
+                Q15 cos3 = Q15::from_raw(trig::cos16(angle3));
+
+                int32_t window_val = a0.raw();
+                window_val -= mul_sat(a1, cos1).raw();
+                window_val += mul_sat(a2, cos2).raw();
+                window_val -= mul_sat(a3, cos3).raw();
+
+                if (window_val > Q15_ONE) window_val = Q15_ONE;
+                if (window_val < 0) window_val = 0;
+
+                t.window_coeffs[n] = Q15::from_raw(static_cast<int16_t>(window_val));
+            }
+        }
+
+        // Build bit-reversal lookup table
+        uint16_t bits = 0;
+        for (uint16_t n = N; n > 1; n >>= 1) {
+            bits++;
+        }
+        for (uint16_t i = 0; i < N; i++) {
+            uint16_t x = i;
+            uint16_t result = 0;
+            for (uint16_t b = 0; b < bits; b++) {
+                result = static_cast<uint16_t>((result << 1) | (x & 1));
+                x >>= 1;
+            }
+            t.bit_reverse[i] = result;
+        }
+        return t;
+    }
+
+    /// one copy per FFT size and window, in flash on the RP2040
+    template <uint16_t N, WindowType Window>
+    inline constexpr Tables<N, Window> tables = make_tables<N, Window>();
+
+    /**
+     * @brief The twiddles each butterfly stage uses, contiguous for the SIMD kernel: the stage of
+     * half-size m2 reads `w[m2 - 1]` to `w[2 * m2 - 2]`.
+     */
+    template <uint16_t N>
+    struct StageTwiddles {
+        ComplexQ15 w[N];
+    };
+
+    template <uint16_t N>
+    constexpr StageTwiddles<N> make_stage_twiddles() {
+        StageTwiddles<N> t {};
+        for (uint32_t m2 = 1; m2 < N; m2 <<= 1) {
+            for (uint32_t j = 0; j < m2; j++) {
+                uint32_t angle = 0u - (0x10000u * (j * N / (2 * m2))) / N;    // as twiddle[j * N / m]
+                t.w[m2 - 1 + j] = {Q15::from_raw(trig::cos16(angle)), Q15::from_raw(trig::sin16(angle))};
+            }
+        }
+        return t;
+    }
+
+    /// only used, so only in the binary, with `FftKernel::Simd`
+    template <uint16_t N>
+    inline constexpr StageTwiddles<N> stage_twiddles = make_stage_twiddles<N>();
+}
+
 
 /**
  * @brief Fixed-point Fast Fourier Transform (FFT).
@@ -56,6 +184,7 @@ enum class WindowType {
  * uint32_t if you need higher dynamic range (~192dB vs ~96dB).
  * @param Window Type of windowing function to apply before FFT. Blackman-Harris provides the best
  * sidelobe suppression but is more computationally expensive than the other WindowType variants.
+ * @param Kernel `FftKernel::Simd` for the SSE2/AVX2/NEON butterflies where there are any.
  * 
  * Memory Usage (including input and output buffers):
  * | InputType | WindowType             | Stack Usage      |
@@ -71,7 +200,8 @@ enum class WindowType {
  * The range between frequencies being <code>sample_rate / N</code>.
  
  */
-template<uint16_t N, typename InputType = int16_t, typename OutputType = uint16_t, WindowType Window = WindowType::Bartlett>
+template<uint16_t N, typename InputType = int16_t, typename OutputType = uint16_t, WindowType Window = WindowType::Bartlett,
+         FftKernel Kernel = FftKernel::Scalar>
 class FixedPointFFT {
 
     private:
@@ -86,106 +216,10 @@ class FixedPointFFT {
     // Q15 format: 1 sign bit + 15 fractional bits
     static constexpr int16_t Q15_ONE = 32767;
     
-    // Twiddle factors stored as Q15
-    int16_t twiddle_real[N/2];
-    int16_t twiddle_imag[N/2];
-    
-    // Window coefficients stored as Q15 (only allocated if not Bartlett)
-    int16_t window_coeffs[Window == WindowType::Bartlett ? 1 : N];
-    
-    // Bit reversal lookup table
-    uint16_t bit_reverse[N];
+    // Twiddle factors, window coefficients and bit reversal lookup, computed at compile time
+    static constexpr const fft_detail::Tables<N, Window>& tables_ = fft_detail::tables<N, Window>;
     
 
-    /*
-    Fixed-point sine approximation (Q15 format)
-    Uses Taylor series for small angles
-    */
-    int16_t sin_q15(int32_t angle_q15) {
-        // Normalize angle to -pi to pi range
-        while (angle_q15 > Q15_ONE) angle_q15 -= 2 * Q15_ONE;
-        while (angle_q15 < -Q15_ONE) angle_q15 += 2 * Q15_ONE;
-        
-        // For better accuracy over full range, use symmetry
-        bool negate = false;
-        if (angle_q15 < 0) {
-            negate = true;
-            angle_q15 = -angle_q15;
-        }
-        
-        if (angle_q15 > (Q15_ONE >> 1)) {
-            angle_q15 = Q15_ONE - angle_q15;
-        }
-        
-        // Taylor series: sin(x) ≈ x - x³/6 + x⁵/120
-        int32_t x = angle_q15;
-        int32_t x2 = (x * x) >> 15;
-        int32_t x3 = (x2 * x) >> 15;
-        int32_t x5 = (x3 * x2) >> 15;
-        
-        int32_t result = x - (x3 / 6) + (x5 / 120);
-        
-        // Clamp to Q15 range
-        if (result > Q15_ONE) result = Q15_ONE;
-        if (result < -Q15_ONE) result = -Q15_ONE;
-        
-        return negate ? -result : result;
-    }
-    
-
-    /*
-    Fixed-point cosine (Q15 format)
-    */ 
-    int16_t cos_q15(int32_t angle_q15) {
-        return sin_q15(angle_q15 + (Q15_ONE >> 1)); // cos(x) = sin(x + π/2)
-    }
-    
-
-    /*
-    Saturating multiplication in Q15
-    */
-    int16_t mul_q15(int16_t a, int16_t b) {
-        int32_t result = ((int32_t)a * (int32_t)b) >> 15;
-        if (result > Q15_ONE) return Q15_ONE;
-        if (result < -32768) return -32768;
-        return (int16_t)result;
-    }
-    
-
-    /*
-    Saturating addition
-    */
-    int16_t add_sat(int16_t a, int16_t b) {
-        int32_t result = (int32_t)a + (int32_t)b;
-        if (result > Q15_ONE) return Q15_ONE;
-        if (result < -32768) return -32768;
-        return (int16_t)result;
-    }
-    
-
-    /*
-    Saturating subtraction
-    */
-    int16_t sub_sat(int16_t a, int16_t b) {
-        int32_t result = (int32_t)a - (int32_t)b;
-        if (result > Q15_ONE) return Q15_ONE;
-        if (result < -32768) return -32768;
-        return (int16_t)result;
-    }
-    
-
-    /* 
-    Bit reversal for FFT reordering
-    */
-    uint16_t reverse_bits(uint16_t x, uint16_t bits) {
-        uint16_t result = 0;
-        for (uint16_t i = 0; i < bits; i++) {
-            result = (result << 1) | (x & 1);
-            x >>= 1;
-        }
-        return result;
-    }
-    
     /*
     Calculate number of bits needed
     */
@@ -203,7 +237,7 @@ class FixedPointFFT {
     /*
     Apply a window
     */ 
-    void apply_window(int16_t* data) {
+    void apply_window(ComplexQ15* data) {
         if (Window == WindowType::Bartlett) {
             // Bartlett (triangular) window - computed on-the-fly
             for (uint16_t i = 0; i < N; i++) {
@@ -215,12 +249,12 @@ class FixedPointFFT {
                     // Falling edge: 2*(N-i)/N
                     window_val = (int16_t)(((int32_t)(N - i) * 2 * Q15_ONE) / N);
                 }
-                data[i] = mul_q15(data[i], window_val);
+                data[i].re = mul_sat(data[i].re, Q15::from_raw(window_val));
             }
         } else {
             // Hann or Blackman-Harris - use pre-computed coefficients
             for (uint16_t i = 0; i < N; i++) {
-                data[i] = mul_q15(data[i], window_coeffs[i]);
+                data[i].re = mul_sat(data[i].re, tables_.window_coeffs[i]);
             }
         }
     }
@@ -229,12 +263,12 @@ class FixedPointFFT {
     /*
     Convert input to Q15 format
     */ 
-    int16_t input_to_q15(InputType value) {
+    Q15 input_to_q15(InputType value) {
         if (std::is_same<InputType, int16_t>::value) {
-            return static_cast<int16_t>(value);
+            return Q15::from_raw(static_cast<int16_t>(value));
         } else {
             // int32_t (24-bit) to Q15: shift right by 8
-            return static_cast<int16_t>(value >> 8);
+            return Q15::from_raw(static_cast<int16_t>(value >> 8));
         }
     }
     
@@ -242,9 +276,9 @@ class FixedPointFFT {
     /*
     Compute magnitude and convert to output type
     */
-    OutputType compute_magnitude(int16_t real_val, int16_t imag_val, uint16_t scale_count) {
-        int32_t r = real_val < 0 ? -real_val : real_val;
-        int32_t im = imag_val < 0 ? -imag_val : imag_val;
+    OutputType compute_magnitude(ComplexQ15 x, uint16_t scale_count) {
+        int32_t r = x.re.raw() < 0 ? -x.re.raw() : x.re.raw();
+        int32_t im = x.im.raw() < 0 ? -x.im.raw() : x.im.raw();
         
         int32_t max_val = r > im ? r : im;
         int32_t min_val = r < im ? r : im;
@@ -270,13 +304,13 @@ class FixedPointFFT {
     /*
     Normalize magnitudes for uint16_t output
     */
-    void normalize_magnitudes_uint16(int16_t* real, int16_t* imag, uint16_t scale_count, 
+    void normalize_magnitudes_uint16(const ComplexQ15* x, uint16_t scale_count, 
                                      etl::array<uint16_t, N/2+1>& magnitudes) {
         // First pass: find max magnitude
         int32_t max_magnitude = 0;
         for (uint16_t i = 0; i <= N/2; i++) {
-            int32_t r = real[i] < 0 ? -real[i] : real[i];
-            int32_t im = imag[i] < 0 ? -imag[i] : imag[i];
+            int32_t r = x[i].re.raw() < 0 ? -x[i].re.raw() : x[i].re.raw();
+            int32_t im = x[i].im.raw() < 0 ? -x[i].im.raw() : x[i].im.raw();
             
             int32_t max_val = r > im ? r : im;
             int32_t min_val = r < im ? r : im;
@@ -301,8 +335,8 @@ class FixedPointFFT {
         
         // Second pass: compute normalized magnitudes
         for (uint16_t i = 0; i <= N/2; i++) {
-            int32_t r = real[i] < 0 ? -real[i] : real[i];
-            int32_t im = imag[i] < 0 ? -imag[i] : imag[i];
+            int32_t r = x[i].re.raw() < 0 ? -x[i].re.raw() : x[i].re.raw();
+            int32_t im = x[i].im.raw() < 0 ? -x[i].im.raw() : x[i].im.raw();
             
             int32_t max_val = r > im ? r : im;
             int32_t min_val = r < im ? r : im;
@@ -321,64 +355,9 @@ class FixedPointFFT {
 public:
 
     /**
-     * @brief Construct a new Fixed Point FFT object.
+     * @brief Construct a new Fixed Point FFT object. Free: the tables are built at compile time.
      */
-    FixedPointFFT() {
-        // Calculate twiddle factors
-        for (uint16_t k = 0; k < N/2; k++) {
-            // W_N^k = e^(-j*2*pi*k/N)
-            // angle = -2*pi*k/N in Q15 format
-            int32_t angle = (int32_t)(-2 * Q15_ONE * k) / N;
-            twiddle_real[k] = cos_q15(angle);
-            twiddle_imag[k] = sin_q15(angle);
-        }
-        
-        // Calculate window coefficients based on window type
-        if constexpr (Window == WindowType::Hann) {
-            // Hann window: w(n) = 0.5 * (1 - cos(2πn/N))
-            for (uint16_t n = 0; n < N; n++) {
-                int32_t angle = (int32_t)(2 * Q15_ONE * n) / N;
-                int16_t cos_val = cos_q15(angle);
-                // w(n) = 0.5 - 0.5*cos_val = 16384 - (cos_val >> 1)
-                window_coeffs[n] = 16384 - (cos_val >> 1);
-            }
-        } else if (Window == WindowType::BlackmanHarris) {
-            // Blackman-Harris window
-            // w(n) = a0 - a1*cos(2πn/N) + a2*cos(4πn/N) - a3*cos(6πn/N)
-            // Coefficients: a0 = 0.35875, a1 = 0.48829, a2 = 0.14128, a3 = 0.01168
-            const int16_t a0 = 11761;  // 0.35875 * 32767
-            const int16_t a1 = 16001;  // 0.48829 * 32767
-            const int16_t a2 = 4630;   // 0.14128 * 32767
-            const int16_t a3 = 383;    // 0.01168 * 32767
-            
-            for (uint16_t n = 0; n < N; n++) {
-                int32_t angle1 = (int32_t)(2 * Q15_ONE * n) / N;  // 2πn/N
-                int32_t angle2 = (int32_t)(4 * Q15_ONE * n) / N;  // 4πn/N
-                int32_t angle3 = (int32_t)(6 * Q15_ONE * n) / N;  // 6πn/N
-                
-                int16_t cos1 = cos_q15(angle1);
-                int16_t cos2 = cos_q15(angle2);
-                int16_t cos3 = cos_q15(angle3);
-                
-                int32_t window_val = a0;
-                window_val -= mul_q15(a1, cos1);
-                window_val += mul_q15(a2, cos2);
-                window_val -= mul_q15(a3, cos3);
-                
-                if (window_val > Q15_ONE) window_val = Q15_ONE;
-                if (window_val < 0) window_val = 0;
-                
-                window_coeffs[n] = (int16_t)window_val;
-            }
-        }
-        // Bartlett window computed on-the-fly, no coefficients to store
-        
-        // Build bit-reversal lookup table
-        uint16_t bits = log2_n();
-        for (uint16_t i = 0; i < N; i++) {
-            bit_reverse[i] = reverse_bits(i, bits);
-        }
-    }
+    constexpr FixedPointFFT() = default;
     
     /**
      * @brief Compute FFT and return magnitudes between 0 and the sample rate / 2.
@@ -398,25 +377,49 @@ public:
      * @param [out] to store resulting magnitudes (size N/2 + 1)
      */ 
     void magnitudes(const etl::array<InputType, N>& input, etl::array<OutputType, N/2+1>& magnitudes) {
-        // Working buffers on stack
-        int16_t real[N];
-        int16_t imag[N];
-        
+        // Working buffer on stack
+        ComplexQ15 x[N];
+        transform(input, magnitudes, x);
+    }
+
+    /**
+     * @brief `magnitudes` with its working buffer (`N` `ComplexQ15`, `work_bytes`) allocated from
+     * `scratch` instead of the stack, e.g. Core 1's arena (see arena.h and `RamBudget`). The
+     * buffer is released before returning.
+     *
+     * @return false, and `magnitudes` unchanged, if `scratch` doesn't have room
+     */
+    bool magnitudes(const etl::array<InputType, N>& input, etl::array<OutputType, N/2+1>& magnitudes, Arena& scratch) {
+        ArenaScope scope(scratch);
+        ComplexQ15* x = scratch.allocate<ComplexQ15>(N);
+        if (x == nullptr) {
+            return false;
+        }
+        transform(input, magnitudes, x);
+        return true;
+    }
+
+    /// bytes of the working buffer
+    static constexpr size_t work_bytes = N * sizeof(ComplexQ15);
+
+
+private:
+
+    void transform(const etl::array<InputType, N>& input, etl::array<OutputType, N/2+1>& magnitudes, ComplexQ15* x) {
         // Convert input to Q15 and initialize
         for (uint16_t i = 0; i < N; i++) {
-            real[i] = input_to_q15(input[i]);
-            imag[i] = 0;
+            x[i] = {input_to_q15(input[i]), Q15{}};
         }
         
-        apply_window(real);
+        apply_window(x);
         
         // Bit-reversal permutation
         for (uint16_t i = 0; i < N; i++) {
-            uint16_t j = bit_reverse[i];
+            uint16_t j = tables_.bit_reverse[i];
             if (i < j) {
-                int16_t temp = real[i];
-                real[i] = real[j];
-                real[j] = temp;
+                ComplexQ15 temp = x[i];
+                x[i] = x[j];
+                x[j] = temp;
             }
         }
         
@@ -429,8 +432,8 @@ public:
             // Check if we need to scale this stage to prevent overflow
             bool need_scale = false;
             for (uint16_t i = 0; i < N; i++) {
-                if (real[i] > 16384 || real[i] < -16384 || 
-                    imag[i] > 16384 || imag[i] < -16384) {
+                if (x[i].re.raw() > 16384 || x[i].re.raw() < -16384 || 
+                    x[i].im.raw() > 16384 || x[i].im.raw() < -16384) {
                     need_scale = true;
                     break;
                 }
@@ -438,31 +441,35 @@ public:
             
             if (need_scale) {
                 for (uint16_t i = 0; i < N; i++) {
-                    real[i] >>= 1;
-                    imag[i] >>= 1;
+                    x[i].re >>= 1;
+                    x[i].im >>= 1;
                 }
                 scale_count++;
             }
             
+            if constexpr (Kernel == FftKernel::Simd && fft_simd::available) {
+                if (m2 >= fft_simd::lanes) {
+                    const ComplexQ15* w = &fft_detail::stage_twiddles<N>.w[m2 - 1];
+                    for (uint16_t k = 0; k < N; k += m) {
+                        fft_simd::butterflies(x + k, x + k + m2, w, m2);
+                    }
+                    continue;
+                }
+            }
+
             for (uint16_t k = 0; k < N; k += m) {
                 for (uint16_t j = 0; j < m2; j++) {
                     uint16_t idx = (j * N) / m;
                     
-                    int16_t wr = twiddle_real[idx];
-                    int16_t wi = twiddle_imag[idx];
-                    
                     uint16_t i1 = k + j;
                     uint16_t i2 = i1 + m2;
                     
-                    // Complex multiplication: (real[i2] + j*imag[i2]) * (wr + j*wi)
-                    int16_t tr = sub_sat(mul_q15(real[i2], wr), mul_q15(imag[i2], wi));
-                    int16_t ti = add_sat(mul_q15(real[i2], wi), mul_q15(imag[i2], wr));
+                    // Complex multiplication: x[i2] * W
+                    ComplexQ15 t = mul_sat(x[i2], tables_.twiddle[idx]);
                     
                     // Butterfly without automatic scaling
-                    real[i2] = sub_sat(real[i1], tr);
-                    imag[i2] = sub_sat(imag[i1], ti);
-                    real[i1] = add_sat(real[i1], tr);
-                    imag[i1] = add_sat(imag[i1], ti);
+                    x[i2] = sub_sat(x[i1], t);
+                    x[i1] = add_sat(x[i1], t);
                 }
             }
         }
@@ -470,12 +477,12 @@ public:
         // Compute magnitudes based on output type
         if constexpr (std::is_same<OutputType, uint16_t>::value) {
             // Use normalization for uint16_t output
-            normalize_magnitudes_uint16(real, imag, scale_count, 
+            normalize_magnitudes_uint16(x, scale_count, 
                                        reinterpret_cast<etl::array<uint16_t, N/2+1>&>(magnitudes));
         } else {
             // uint32_t output - no normalization needed
             for (uint16_t i = 0; i <= N/2; i++) {
-                magnitudes[i] = compute_magnitude(real[i], imag[i], scale_count);
+                magnitudes[i] = compute_magnitude(x[i], scale_count);
             }
         }
     }
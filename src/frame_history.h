@@ -0,0 +1,282 @@
+/**
+ * @file frame_history.h
+ * @brief Ring of past frames in a compact format, for echo, delay and feedback effects.
+ *
+ * ```cpp
+ * static FrameHistory<history_format::Yuv422, 32> history;   // static: 32 slots in .bss
+ * effect.draw_frame(frame, info);
+ * history.add_to(frame, frames_per_beat, 0.5_q15, 10);        // half of one beat ago, 10 LEDs on
+ * history.push(frame);
+ * ```
+ *
+ * Frames are stored in one of the `history_format`s, trading colour for RAM:
+ *
+ * | format   | bytes/pixel | colour                                                  |
+ * |----------|-------------|---------------------------------------------------------|
+ * | `Rgb888` | 3           | exact                                                   |
+ * | `Yuv422` | 2           | full brightness per pixel, colour shared by each pair   |
+ * | `Rgb332` | 1           | palette-indexed: 8 reds, 8 greens and 4 blues           |
+ *
+ * `FrameHistory::slot_bytes` and `FrameHistory::bytes` are the RAM cost, known at compile time
+ * (and printed per format by tools/ram_report.cpp).
+ */
+#ifndef FRAME_HISTORY_H
+#define FRAME_HISTORY_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "etl/span.h"
+#include "draw.h"
+#include "fixed_point.h"
+
+
+/**
+ * @brief Storage formats of `FrameHistory`. Each packs pixels into `bytes(n)` bytes and unpacks
+ * any one pixel in O(1), so history can be read in a single pass with the new frame.
+ */
+namespace history_format {
+
+    inline uint8_t clamp_u8(int32_t v) {
+        return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+
+    /**
+     * @brief Exact RGB, 3 bytes per pixel.
+     */
+    struct Rgb888 {
+        static constexpr const char* name = "rgb888";
+
+        static constexpr size_t bytes(size_t num_pixels) {
+            return 3 * num_pixels;
+        }
+
+        static void encode(etl::span<const RGBValue> pixels, uint8_t* out) {
+            for (const RGBValue& p : pixels) {
+                *out++ = p.r;
+                *out++ = p.g;
+                *out++ = p.b;
+            }
+        }
+
+        static RGBValue decode(const uint8_t* in, size_t i) {
+            const uint8_t* p = in + 3 * i;
+            return RGBValue{p[0], p[1], p[2]};
+        }
+    };
+
+    /**
+     * @brief Luma per pixel and chroma per pair of pixels (4:2:2), 2 bytes per pixel: Y0 Y1 U V.
+     *
+     * Y is BT.601 luma in 8 bits; U and V are half of B - Y and R - Y, averaged over the pair.
+     * Brightness, which the eye follows in a moving echo, is kept per pixel; a pair of different
+     * colours share the colour in between.
+     */
+    struct Yuv422 {
+        static constexpr const char* name = "yuv422";
+
+        static constexpr size_t bytes(size_t num_pixels) {
+            return 2 * ((num_pixels + 1) & ~static_cast<size_t>(1));
+        }
+
+        static int32_t luma(RGBValue p) {
+            return (77 * p.r + 150 * p.g + 29 * p.b + 128) >> 8;
+        }
+
+        static void encode(etl::span<const RGBValue> pixels, uint8_t* out) {
+            const size_t n = pixels.size();
+            for (size_t i = 0; i < n; i += 2) {
+                const RGBValue a = pixels[i];
+                const RGBValue b = i + 1 < n ? pixels[i + 1] : a;
+                int32_t ya = luma(a);
+                int32_t yb = luma(b);
+                int32_t u = ((a.b - ya) + (b.b - yb)) >> 2;     // half the average
+                int32_t v = ((a.r - ya) + (b.r - yb)) >> 2;
+                *out++ = static_cast<uint8_t>(ya);
+                *out++ = static_cast<uint8_t>(yb);
+                *out++ = static_cast<uint8_t>(static_cast<int8_t>(u));
+                *out++ = static_cast<uint8_t>(static_cast<int8_t>(v));
+            }
+        }
+
+        static RGBValue decode(const uint8_t* in, size_t i) {
+            const uint8_t* pair = in + 2 * (i & ~static_cast<size_t>(1));
+            int32_t y = pair[i & 1];
+            int32_t db = 2 * static_cast<int8_t>(pair[2]);
+            int32_t dr = 2 * static_cast<int8_t>(pair[3]);
+            int32_t dg = -(((77 * dr + 29 * db) * 437) >> 16);      // 437 = 65536 / 150
+            return RGBValue{clamp_u8(y + dr), clamp_u8(y + dg), clamp_u8(y + db)};
+        }
+    };
+
+    /**
+     * @brief One byte per pixel indexing a fixed 256 colour palette: 3 bits of red and green and 2
+     * of blue. Decoding replicates the bits, so black and full colours are exact.
+     */
+    struct Rgb332 {
+        static constexpr const char* name = "rgb332";
+
+        static constexpr size_t bytes(size_t num_pixels) {
+            return num_pixels;
+        }
+
+        static void encode(etl::span<const RGBValue> pixels, uint8_t* out) {
+            for (const RGBValue& p : pixels) {
+                // nearest of the 8 (or 4) levels
+                uint32_t r = (p.r * 7u + 128) >> 8;
+                uint32_t g = (p.g * 7u + 128) >> 8;
+                uint32_t b = (p.b * 3u + 128) >> 8;
+                *out++ = static_cast<uint8_t>((r << 5) | (g << 2) | b);
+            }
+        }
+
+        static RGBValue decode(const uint8_t* in, size_t i) {
+            uint8_t c = in[i];
+            uint8_t r = c >> 5;
+            uint8_t g = (c >> 2) & 7;
+            uint8_t b = c & 3;
+            return RGBValue{static_cast<uint8_t>((r << 5) | (r << 2) | (r >> 1)),
+                            static_cast<uint8_t>((g << 5) | (g << 2) | (g >> 1)),
+                            static_cast<uint8_t>(b * 85)};
+        }
+    };
+
+} // namespace history_format
+
+
+/**
+ * @brief How `FrameHistory::add_to` combines a past frame with the new one.
+ */
+enum class HistoryBlend : uint8_t {
+    Add,        /// add, saturating: trails and echoes build up
+    Lighten,    /// brightest of the two per channel: echoes never brighten the new frame
+};
+
+
+/**
+ * @brief The last `Slots` frames, in `Format` (see `history_format`).
+ *
+ * `push` encodes a frame into the oldest slot; frame t-k is then slot `head - k` of the ring, so
+ * any past frame is found in O(1). `add_to` decodes a past frame and blends it into a new one in
+ * the same loop, without unpacking it into a temporary frame first.
+ *
+ * Declare it static: it is `bytes` big.
+ *
+ * @param Format a `history_format`
+ * @param Slots number of frames kept
+ * @param MaxLeds LEDs per frame the slots are sized for
+ */
+template <typename Format, unsigned int Slots, unsigned int MaxLeds = MAX_LEDS>
+class FrameHistory {
+
+    static_assert(Slots > 0, "Slots must be > 0");
+
+    public:
+
+    static constexpr size_t slot_bytes = Format::bytes(MaxLeds);   /// RAM per frame kept
+    static constexpr size_t bytes = Slots * slot_bytes;           /// RAM of all the slots
+
+    private:
+
+    uint8_t slots_[Slots][slot_bytes];
+    unsigned int head_ = 0;         // slot the next frame is pushed into
+    unsigned int count_ = 0;        // frames held, up to Slots
+    unsigned int num_leds_ = 0;     // LEDs in each frame held
+
+    const uint8_t* slot(unsigned int k) const {
+        return slots_[(head_ + Slots - k) % Slots];
+    }
+
+    static constexpr int TILE = 32;     // pixels decoded at a time, on the stack
+
+    template <typename Blend>
+    void blend(FrameView& frame, const uint8_t* past, Q15 gain, int shift, Blend op) const {
+        const int32_t g = gain.raw();
+        const int n = static_cast<int>(frame.num_leds < num_leds_ ? frame.num_leds : num_leds_);
+        const int from = shift > 0 ? shift : 0;
+        const int to = shift < 0 ? n + shift : n;
+        // a tile of history is decoded then blended while it's in registers and cache: the past
+        // bytes could alias the frame, so a loop doing both at once doesn't vectorise
+        RGBValue tile[TILE];
+        RGBValue* out = frame.data.data();
+        for (int start = from; start < to; start += TILE) {
+            const int len = to - start < TILE ? to - start : TILE;
+            for (int i = 0; i < len; i++) {
+                tile[i] = Format::decode(past, static_cast<size_t>(start + i - shift));
+            }
+            RGBValue* p = out + start;
+            for (int i = 0; i < len; i++) {
+                p[i].r = op(p[i].r, (tile[i].r * g) >> 15);
+                p[i].g = op(p[i].g, (tile[i].g * g) >> 15);
+                p[i].b = op(p[i].b, (tile[i].b * g) >> 15);
+            }
+        }
+    }
+
+
+    public:
+
+    /**
+     * @brief Keep `frame` as frame t-1, dropping the oldest if the ring is full. A frame with a
+     * different number of LEDs than those held starts the history again.
+     */
+    void push(const FrameView& frame) {
+        unsigned int n = frame.num_leds < MaxLeds ? frame.num_leds : MaxLeds;
+        if (n != num_leds_) {
+            clear();
+            num_leds_ = n;
+        }
+        Format::encode(etl::span<const RGBValue>(frame.data.data(), n), slots_[head_]);
+        head_ = head_ + 1 == Slots ? 0 : head_ + 1;
+        count_ = count_ < Slots ? count_ + 1 : Slots;
+    }
+
+    void clear() {
+        head_ = 0;
+        count_ = 0;
+    }
+
+    /**
+     * @brief Frames held: `k` can be 1 to `size()`.
+     */
+    unsigned int size() const {
+        return count_;
+    }
+
+    /**
+     * @brief Pixel `i` of frame t-`k` (1 is the last pushed), as stored. For tests and effects
+     * that want a few pixels; use `add_to` for whole frames.
+     */
+    RGBValue pixel(unsigned int k, unsigned int i) const {
+        if (k == 0 || k > count_ || i >= num_leds_) {
+            return BLACK;
+        }
+        return Format::decode(slot(k), i);
+    }
+
+    /**
+     * @brief Blend frame t-`k` (1 is the last pushed), times `gain` and moved `shift` LEDs along
+     * the strip, into `frame` in one pass. LEDs shifted in from beyond the ends are left as they
+     * are.
+     *
+     * @return false, leaving `frame` as it is, if fewer than `k` frames are held
+     */
+    bool add_to(FrameView& frame, unsigned int k, Q15 gain, int shift = 0, HistoryBlend mode = HistoryBlend::Add) const {
+        if (k == 0 || k > count_) {
+            return false;
+        }
+        if (mode == HistoryBlend::Add) {
+            blend(frame, slot(k), gain, shift, [](uint8_t a, int32_t b) {
+                int32_t s = a + b;
+                return static_cast<uint8_t>(s > 255 ? 255 : s);
+            });
+        } else {
+            blend(frame, slot(k), gain, shift, [](uint8_t a, int32_t b) {
+                return static_cast<uint8_t>(a > b ? a : b);
+            });
+        }
+        return true;
+    }
+};
+
+
+#endif // FRAME_HISTORY_H
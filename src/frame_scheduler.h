@@ -0,0 +1,204 @@
+/**
+ * @file frame_scheduler.h
+ * @brief Keeps the frame rate constant by lowering an effect's level of detail when rendering
+ * overruns the frame budget, and raising it again when there's headroom.
+ *
+ * Effects declare levels with `lod_levels`/`set_lod` (see `EffectBase`); level 0 is full detail.
+ * The scheduler times every `draw_frame` and `LodGovernor` steps the level up (cheaper) after a
+ * few consecutive overruns and back down (more detail) only after many frames that would still
+ * fit at the next finer level, so it doesn't oscillate between two levels.
+ */
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <stdint.h>
+#include "draw.h"
+
+
+/**
+ * @brief Tunables for `LodGovernor`.
+ */
+struct LodParams {
+    uint8_t overruns_to_coarsen = 2;    /// consecutive overruns before dropping detail, at least 1
+    uint16_t frames_to_refine = 60;     /// consecutive frames with headroom before adding detail, at
+                                        /// least 1
+    uint8_t headroom_shift = 1;         /// headroom is render <= budget / 2^shift: each level is
+                                        /// assumed to cost up to 2x the next coarser one. Up to 31
+};
+
+
+/**
+ * @brief Chooses a level of detail from render times. No timing of its own, so it's testable.
+ */
+class LodGovernor {
+
+    public:
+
+    struct Stats {
+        uint32_t frames = 0;
+        uint32_t overruns = 0;      /// frames that took longer than the budget
+        uint32_t coarsened = 0;     /// level increased (less detail)
+        uint32_t refined = 0;       /// level decreased (more detail)
+    };
+
+
+    private:
+
+    uint32_t budget_us_;
+    LodParams params_;
+    uint8_t levels_ = 1;
+    uint8_t level_ = 0;
+    uint16_t overruns_ = 0;
+    uint16_t headroom_frames_ = 0;
+    Stats stats_;
+
+
+    public:
+
+    /**
+     * @param budget_us time available to render a frame
+     */
+    explicit LodGovernor(uint32_t budget_us, const LodParams& params = LodParams{}) : budget_us_(budget_us) {
+        set_params(params);
+    }
+
+    /**
+     * @brief Number of levels the current effect has; the level is clamped to them.
+     */
+    void set_levels(uint8_t levels) {
+        levels_ = levels == 0 ? 1 : levels;
+        if (level_ >= levels_) {
+            level_ = static_cast<uint8_t>(levels_ - 1);
+        }
+    }
+
+    /**
+     * @brief Account for a frame that took `render_us` at the current level.
+     *
+     * @return level for the next frame
+     */
+    uint8_t update(uint32_t render_us) {
+        stats_.frames++;
+        if (render_us > budget_us_) {
+            stats_.overruns++;
+            headroom_frames_ = 0;
+            if (++overruns_ >= params_.overruns_to_coarsen && level_ + 1 < levels_) {
+                level_++;
+                overruns_ = 0;
+                stats_.coarsened++;
+            }
+            return level_;
+        }
+
+        overruns_ = 0;
+        if (level_ > 0 && render_us <= (budget_us_ >> params_.headroom_shift)) {
+            if (++headroom_frames_ >= params_.frames_to_refine) {
+                level_--;
+                headroom_frames_ = 0;
+                stats_.refined++;
+            }
+        } else {
+            headroom_frames_ = 0;
+        }
+        return level_;
+    }
+
+    uint8_t level() const {
+        return level_;
+    }
+
+    uint32_t budget_us() const {
+        return budget_us_;
+    }
+
+    const LodParams& params() const {
+        return params_;
+    }
+
+    /**
+     * @brief New tunables, e.g. from a parameter block (see params.h), kept in range since they
+     * can come from a UART. The level is kept.
+     */
+    void set_params(const LodParams& params) {
+        params_ = params;
+        params_.overruns_to_coarsen = params_.overruns_to_coarsen > 0 ? params_.overruns_to_coarsen : 1;
+        params_.frames_to_refine = params_.frames_to_refine > 0 ? params_.frames_to_refine : 1;
+        params_.headroom_shift = params_.headroom_shift < 32 ? params_.headroom_shift : 31;
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+};
+
+
+/**
+ * @brief Draws frames with an effect at the level of detail that fits the frame period.
+ *
+ * ```cpp
+ * static FrameScheduler scheduler(16'667, time_us_64);
+ * scheduler.draw_frame(effect_factory, frame, info);   // any effect or EffectFactory
+ * ```
+ */
+class FrameScheduler {
+
+    public:
+
+    using NowFn = uint64_t (*)();
+
+
+    private:
+
+    NowFn now_us_;
+    LodGovernor governor_;
+    uint32_t last_render_us_ = 0;
+
+
+    public:
+
+    /**
+     * @param budget_us time available to render each frame, e.g. the frame period when the LED
+     * driver sends the previous frame by DMA meanwhile
+     * @param now_us µs clock (e.g. `time_us_64`)
+     */
+    FrameScheduler(uint32_t budget_us, NowFn now_us, const LodParams& params = LodParams{})
+        : now_us_(now_us), governor_(budget_us, params) {
+    }
+
+    /**
+     * @brief Draw a frame with `effect` at the current level of detail, then adjust the level.
+     *
+     * @return what the effect changed (see `FrameChange`)
+     */
+    template <typename Effect, typename FreqT, unsigned int FreqN>
+    FrameChange draw_frame(Effect& effect, Frame& frame, DrawInfo<FreqT, FreqN>& info) {
+        governor_.set_levels(effect.lod_levels());
+        effect.set_lod(governor_.level());
+
+        uint64_t start = now_us_();
+        FrameChange change = draw_effect(effect, frame, info);
+        last_render_us_ = static_cast<uint32_t>(now_us_() - start);
+
+        governor_.update(last_render_us_);
+        return change;
+    }
+
+    uint8_t level() const {
+        return governor_.level();
+    }
+
+    uint32_t last_render_us() const {
+        return last_render_us_;
+    }
+
+    const LodGovernor& governor() const {
+        return governor_;
+    }
+
+    void set_params(const LodParams& params) {
+        governor_.set_params(params);
+    }
+};
+
+
+#endif // FRAME_SCHEDULER_H
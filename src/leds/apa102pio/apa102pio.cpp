@@ -0,0 +1,184 @@
+#include "apa102pio.h"
+
+#include <cstdlib>
+#include <cstdio>
+
+extern "C" {
+#include "apa102.pio.h" // header autogenerated by CMake (see pico_generate_pio_header).
+                        // To manually generate it: pioasm -o c-sdk apa102.pio > apa102.pio.h
+
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+}
+
+#include "../../draw.h"
+#include "../../effects/effects_lib.h"
+#include "../led_protocol.h"
+
+static_assert(LedProtocol::clocked, "Apa102Pio drives clocked LEDs, use WS2811Pio for single wire ones");
+
+// frame packed for the PIO with start and end frames (see led_protocol.h), DMA'd from here
+static uint32_t wire_words[LedProtocol::frame_words(MAX_LEDS)];
+
+//
+// constructor
+//
+Apa102Pio::Apa102Pio(uint bps, uint8_t data_pin, uint8_t clock_pin) : health_(hal_, 0, 0) {
+    install_pio_and_run(data_pin, clock_pin, bps);
+    hal_.pio = pio_;
+    health_.set_state_machine(sm_);
+    setup_dma();
+}
+
+
+//
+// install_pio_and_run
+//
+void Apa102Pio::install_pio_and_run(uint8_t data_pin, uint8_t clock_pin, uint bps) {
+    // load PIO program into State Machine
+    bool is_added = pio_claim_free_sm_and_add_program(&apa102pio_program, &pio_, &sm_, &offset_);
+    if (!is_added) {
+        std::abort();
+    }
+
+    apa102pio_program_init(pio_, sm_, offset_, data_pin, clock_pin, bps);
+}
+
+
+//
+// Set up DMA channel to PIO State Machine once State Machine has been allocated.
+//
+void Apa102Pio::setup_dma() {
+    // the PIO State Machine issues a DREQ when ready, transfer 32-bits at a time from incrementing
+    // memory addresses to the TX FIFO
+    dma_chan_ = (uint)dma_claim_unused_channel(true); // aborts if none are free
+    dma_channel_config_t cfg = dma_channel_get_default_config(dma_chan_);
+    channel_config_set_dreq(&cfg, pio_get_dreq(pio_, sm_, true));
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+
+    dma_channel_configure(dma_chan_,
+                        &cfg,
+                        &pio_->txf[sm_],// write address: write to PIO FIFO
+                        NULL,           // don't provide a read address yet
+                        1,              // fake number of transfers (provided in `send`)
+                        false);         // don't start yet
+}
+
+
+//
+// destructor
+//
+Apa102Pio::~Apa102Pio() {
+    pio_remove_program_and_unclaim_sm(&apa102pio_program, pio_, sm_, offset_);
+
+    dma_channel_cleanup(dma_chan_);
+    dma_channel_unclaim(dma_chan_);
+}
+
+
+//
+// Pack the frame and start a DMA transfer to the PIO state machine's TX FIFO
+//
+void Apa102Pio::send(const Frame& frame, const PanelMap& map) {
+    send(frame, Refresh{FrameChange::full(), true}, map);
+}
+
+
+//
+// Pack what changed and send, if anything is to be sent
+//
+void Apa102Pio::send(const Frame& frame, const Refresh& refresh, const PanelMap& map) {
+    if (!refresh.send) {
+        return;
+    }
+    // block until current DMA xfer complete (if any), the buffer is reused
+    bool waited = dma_channel_is_busy(dma_chan_);
+    dma_channel_wait_for_finish_blocking(dma_chan_);
+    if (!enabled_) {
+        set_enabled(true);
+    }
+
+    // the pixels that didn't change are as last sent
+    etl::span<const RGBValue> pixels = frame.data.first(frame.num_leds);
+    size_t num_words = LedProtocol::frame_words(frame.num_leds);
+    if (refresh.encode.kind == FrameChange::Kind::Full || words_stale_) {
+        num_words = encode_frame<LedProtocol>(pixels, wire_words, map);
+        words_stale_ = false;
+    } else if (refresh.encode.kind == FrameChange::Kind::Range) {
+        num_words = encode_pixels<LedProtocol>(pixels, wire_words, refresh.encode.begin, refresh.encode.end, map);
+    }
+    dma_channel_set_transfer_count(dma_chan_, dma_encode_transfer_count(num_words), false);
+    dma_channel_set_read_addr(dma_chan_, wire_words, true);
+    health_.on_send(waited);
+}
+
+
+//
+// Send prepacked words, e.g. from flash, straight to the PIO
+//
+void Apa102Pio::send_words(etl::span<const uint32_t> words) {
+    bool waited = dma_channel_is_busy(dma_chan_);
+    dma_channel_wait_for_finish_blocking(dma_chan_);
+    if (!enabled_) {
+        set_enabled(true);
+    }
+    words_stale_ = true;
+    dma_channel_set_transfer_count(dma_chan_, dma_encode_transfer_count(words.size()), false);
+    dma_channel_set_read_addr(dma_chan_, words.data(), true);
+    health_.on_send(waited);
+}
+
+
+//
+// Wait for the DMA, then for the FIFO and the last word in the OSR to be clocked out
+//
+void Apa102Pio::wait_until_latched() {
+    dma_channel_wait_for_finish_blocking(dma_chan_);
+    while (!pio_sm_is_tx_fifo_empty(pio_, sm_)) {
+        tight_loop_contents();
+    }
+    busy_wait_us(1 + 64'000'000 / LedProtocol::bps); // last word in the OSR
+}
+
+
+//
+// Gate the state machine between frames
+//
+void Apa102Pio::set_enabled(bool enabled) {
+    if (enabled == enabled_) {
+        return;
+    }
+    if (!enabled) {
+        // let the current frame shift out before stopping the clock
+        wait_until_latched();
+    }
+    pio_sm_set_enabled(pio_, sm_, enabled);
+    enabled_ = enabled;
+}
+
+
+/**
+ * @brief Test LEDs work with `LaserEffect` sent by DMA.
+ *
+ * This blocks forever.
+ */
+void Apa102Pio::test(size_t num_leds) {
+    static Frame frame(num_leds);
+    etl::array<unsigned short, 1> fft_mags {1};
+    DrawInfo<unsigned short, 1> info {(unsigned short)0, fft_mags};
+    LaserEffect effect;
+
+    uint64_t last_called_time_us = time_us_64();
+    while (true) {
+        uint64_t now_us = time_us_64();
+        info.elapsed_time_us = now_us - last_called_time_us;
+        last_called_time_us = now_us;
+
+        effect.draw_frame(frame, info);
+        send(frame);
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef APA102PIO_H
+#define APA102PIO_H
+
+extern "C" {
+#include "hardware/pio.h"
+}
+#include "../../draw.h"
+#include "../led_health.h"
+#include "../led_protocol.h"
+#include "../pio_hal_pico.h"
+#include "../refresh_gate.h"
+
+#include <cstdint>
+
+/**
+ * @brief Driver for APA102/SK9822 (clocked) LEDs using Raspberry Pi Pico Programmable I/O (PIO).
+ *
+ * Frames are packed for `LedProtocol` (led_protocol.h) and sent by DMA, so `send(const Frame&)`
+ * returns before the frame is sent. The start and end frames are part of the DMA'd data and the
+ * strip latches without a RESET time, so unlike `WS2811Pio` no IRQ handler is needed. At 10 MHz a
+ * 3800 LED frame takes ~12ms on the wire, against ~114ms for WS2811 at 800 kHz.
+ *
+ * The encoded frame is in a static buffer, so there should be only one instance.
+ */
+class Apa102Pio final {
+
+    private:
+
+    PIO pio_ = nullptr;             // PIO in use
+    uint sm_ = 0;                   // State Machine in use
+    uint offset_ = 0;               // Offset in SM, pio code starts at
+    uint dma_chan_;                 // DMA channel for data transfer from RAM to PIO State Machine
+    bool enabled_ = true;           // PIO state machine running (false when gated)
+    bool words_stale_ = false;      // the word buffer doesn't hold the last frame (see `send_words`)
+    PioHal hal_;                    // FDEBUG access for `health_`
+    LedHealthMonitor<PioHal> health_; // frames & late sends
+
+    void install_pio_and_run(uint8_t data_pin, uint8_t clock_pin, uint bps);
+    void setup_dma();
+
+
+    public:
+
+    Apa102Pio() = delete;
+    Apa102Pio(const Apa102Pio&) = delete;
+    ~Apa102Pio();
+
+    /**
+     * @brief Construct an instance.  If an instance cannot be constructed, abort() is called.
+     *
+     * @param [in] bps Clock frequency in bits per second, typically `LedProtocol::bps`.
+     * @param [in] data_pin Number of the GPIO pin for data out.
+     * @param [in] clock_pin Number of the GPIO pin for clock out.
+     */
+    Apa102Pio(uint bps, uint8_t data_pin, uint8_t clock_pin);
+
+    /**
+     * @brief Send a frame to the LED strip to display.  Returns immediately; a subsequent call
+     * blocks until the prior frame is completely sent.
+     *
+     * @param [in] map where the frame's pixels go on a panel (see `PanelMap`), default a strip
+     */
+    void send(const Frame& frame, const PanelMap& map = PanelMap{});
+
+    /**
+     * @brief Send what `refresh` says (see refresh_gate.h): pack only the pixels that changed
+     * into the last frame's words, and skip the transfer when nothing did.
+     */
+    void send(const Frame& frame, const Refresh& refresh, const PanelMap& map = PanelMap{});
+
+    /**
+     * @brief Send words already packed for `LedProtocol`, e.g. the boot look in flash (boot.h):
+     * DMA reads them where they are, with nothing to encode. The next `send` encodes its whole
+     * frame, whatever its `Refresh` says.
+     */
+    void send_words(etl::span<const uint32_t> words);
+
+    /**
+     * @brief Block until the frame being sent, end frame included, has been clocked out, so the
+     * LEDs show it, e.g. to time when the boot look is showing.
+     */
+    void wait_until_latched();
+
+    /**
+     * @brief Stop (gate) or restart the PIO state machine, e.g. between frames in low power.
+     *
+     * Stopping waits for the frame being sent to finish. `send()` restarts a stopped state machine.
+     */
+    void set_enabled(bool enabled);
+
+    /**
+     * @brief Test LEDs work by drawing `LaserEffect` forever.
+     */
+    void test(size_t num_leds);
+
+    /**
+     * @brief Frame and late send counters (see led_health.h). A clocked strip just pauses when
+     * the TX FIFO runs dry and the DMA is paced by the FIFO, so there are no underruns or latch
+     * times to count.
+     */
+    const LedHealthStats& health() const {
+        return health_.stats();
+    }
+};
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * @file led_health.h
+ * @brief Detects LED driver underruns from the PIO's FIFO debug flags and keeps health counters.
+ *
+ * A single wire strip latches whenever its data line stays low for the RESET time, so if the TX
+ * FIFO runs dry mid-frame (e.g. the CPU or DMA is late refilling it) the strip shows a partial
+ * frame and nothing else notices. The PIO records this in its FDEBUG register: TXSTALL is set when
+ * a state machine stalls on an empty TX FIFO, TXOVER when a write to a full TX FIFO is lost.
+ *
+ * `LedHealthMonitor` clears the flags once a frame is flowing, reads them when the last word has
+ * been queued (before the FIFO drains, so the normal stall at the end of the frame isn't counted)
+ * and times the idle (latch) gap between frames. It reaches the hardware only through a `Hal`, so
+ * tests can inject stalls:
+ *
+ * ```cpp
+ * struct Hal {
+ *     uint32_t read_fdebug();             // PIO FDEBUG register
+ *     void clear_fdebug(uint32_t mask);   // write 1s to clear
+ *     uint64_t now_us();
+ * };
+ * ```
+ *
+ * `PioHal` in pio_hal_pico.h is the Pico implementation.
+ */
+#ifndef LED_HEALTH_H
+#define LED_HEALTH_H
+
+#include <stdint.h>
+
+
+/**
+ * @brief FDEBUG bits of state machine `sm` (RP2040 datasheet, PIO FDEBUG).
+ */
+namespace pio_fdebug {
+    constexpr uint32_t txstall(unsigned int sm) {
+        return 1u << (24 + sm);
+    }
+
+    constexpr uint32_t txover(unsigned int sm) {
+        return 1u << (16 + sm);
+    }
+}
+
+
+/**
+ * @brief LED driver health counters.
+ */
+struct LedHealthStats {
+    uint32_t frames = 0;
+    uint32_t underruns = 0;         /// TX FIFO ran dry before the frame was queued: partial frame latched
+    uint32_t overflows = 0;         /// frames with words lost to a full TX FIFO
+    uint32_t late_sends = 0;        /// `send` had to wait for the previous frame, i.e. frames faster than the wire
+    uint32_t short_latches = 0;     /// line idle for less than the RESET time: the strip may not have latched
+    uint32_t last_latch_us = 0;     /// line idle between the last two frames
+    uint32_t min_latch_us = UINT32_MAX;
+    uint32_t max_latch_us = 0;
+};
+
+
+/**
+ * @brief Health counters of one PIO state machine driving LEDs.
+ *
+ * @param Hal access to FDEBUG and a µs clock, see above
+ */
+template <typename Hal>
+class LedHealthMonitor {
+
+    private:
+
+    Hal& hal_;
+    uint32_t txstall_ = 0;
+    uint32_t txover_ = 0;
+    uint32_t reset_us_;
+    uint32_t drain_us_;
+    uint64_t idle_from_us_ = 0;     // when the line went low after the last frame
+    bool idle_ = false;
+    LedHealthStats stats_;
+
+
+    public:
+
+    /**
+     * @param hal PIO and clock access
+     * @param reset_us low time the strip needs to latch
+     * @param drain_us time to shift out a full TX FIFO and OSR after the last word is queued
+     */
+    LedHealthMonitor(Hal& hal, uint32_t reset_us, uint32_t drain_us)
+        : hal_(hal), reset_us_(reset_us), drain_us_(drain_us) {
+    }
+
+    /**
+     * @brief State machine driving the LEDs, once it's claimed.
+     */
+    void set_state_machine(unsigned int sm) {
+        txstall_ = pio_fdebug::txstall(sm);
+        txover_ = pio_fdebug::txover(sm);
+    }
+
+    /**
+     * @brief A frame has started: its first words are in the TX FIFO.
+     *
+     * @param waited the previous frame was still being sent when `send` was called
+     */
+    void on_send(bool waited) {
+        stats_.frames++;
+        if (waited) {
+            stats_.late_sends++;
+        }
+        if (idle_) {
+            uint64_t now = hal_.now_us();
+            uint32_t latch = now > idle_from_us_ ? static_cast<uint32_t>(now - idle_from_us_) : 0;
+            stats_.last_latch_us = latch;
+            stats_.min_latch_us = latch < stats_.min_latch_us ? latch : stats_.min_latch_us;
+            stats_.max_latch_us = latch > stats_.max_latch_us ? latch : stats_.max_latch_us;
+            if (latch < reset_us_) {
+                stats_.short_latches++;
+            }
+            idle_ = false;
+        }
+        // the state machine stalled between frames, only stalls from here on count
+        hal_.clear_fdebug(txstall_ | txover_);
+    }
+
+    /**
+     * @brief The frame's last word has been queued (e.g. DMA complete). Call before anything
+     * else is written to the FIFO, e.g. a RESET.
+     */
+    void on_data_queued() {
+        uint32_t flags = hal_.read_fdebug();
+        if (flags & txstall_) {
+            stats_.underruns++;
+        }
+        if (flags & txover_) {
+            stats_.overflows++;
+        }
+        hal_.clear_fdebug(flags & (txstall_ | txover_));
+        idle_from_us_ = hal_.now_us() + drain_us_;
+        idle_ = true;
+    }
+
+    const LedHealthStats& stats() const {
+        return stats_;
+    }
+
+    void reset_stats() {
+        stats_ = LedHealthStats{};
+    }
+};
+
+
+#endif // LED_HEALTH_H
@@ -0,0 +1,350 @@
+/**
+ * @file led_protocol.h
+ * @brief LED chip protocols: wire timing and how a frame is packed into 32-bit words for the PIO.
+ *
+ * Every protocol packs a frame into words that a PIO state machine shifts out MSB first, so both
+ * drivers DMA a word buffer from `encode_frame` straight into the TX FIFO:
+ * - single wire (WS2811, WS2812B, SK6812): one left-aligned word per pixel, 24 or 32 (RGBW) bits
+ *   used, latched by holding the line low for `reset_us` (`WS2811Pio`)
+ * - clocked (APA102, SK9822): a zero start frame, one word per pixel and an end frame of zeros to
+ *   clock the data through the strip (`Apa102Pio`)
+ *
+ * The protocol is chosen at compile time with `-DLIGHTDANCER_LED=...` (see CMakeLists.txt), which
+ * selects `LedProtocol` at the bottom of this file. No hardware access, so it's tested and
+ * benchmarked on the host.
+ */
+#ifndef LED_PROTOCOL_H
+#define LED_PROTOCOL_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "etl/span.h"
+#include "../draw.h"
+
+
+namespace led_protocol {
+
+    /**
+     * @brief Single wire bit timing in PIO cycles (see ws2811.pio). A bit is `t1h + t1l` cycles:
+     * high for `t0h` (0) or `t1h` (1) cycles then low for the rest.
+     */
+    struct PioTiming {
+        uint8_t t0h;
+        uint8_t t1h;
+        uint8_t t1l;
+
+        constexpr uint8_t cycles_per_bit() const {
+            return static_cast<uint8_t>(t1h + t1l);
+        }
+    };
+
+    /// ws2811.pio uses 1 optional side-set pin, leaving 3 bits of delay in each instruction
+    constexpr uint8_t MAX_DELAY = 7;
+    constexpr uint16_t DELAY_MASK = 0x0700;
+
+    /**
+     * @brief `instr` with its delay field set to `delay` cycles (side-set bits are kept).
+     */
+    constexpr uint16_t with_delay(uint16_t instr, uint8_t delay) {
+        return static_cast<uint16_t>((instr & ~DELAY_MASK) | ((delay & MAX_DELAY) << 8));
+    }
+
+    /**
+     * @brief Split a colour into RGB and a white channel: white is the part common to all three.
+     */
+    struct Rgbw {
+        uint8_t r, g, b, w;
+    };
+
+    constexpr Rgbw to_rgbw(RGBValue p) {
+        uint8_t w = p.r < p.g ? (p.r < p.b ? p.r : p.b) : (p.g < p.b ? p.g : p.b);
+        return {static_cast<uint8_t>(p.r - w), static_cast<uint8_t>(p.g - w), static_cast<uint8_t>(p.b - w), w};
+    }
+
+    constexpr uint32_t word(uint8_t b3, uint8_t b2, uint8_t b1, uint8_t b0) {
+        return (static_cast<uint32_t>(b3) << 24) | (static_cast<uint32_t>(b2) << 16) |
+               (static_cast<uint32_t>(b1) << 8) | b0;
+    }
+
+} // namespace led_protocol
+
+
+/**
+ * @brief Single wire (NRZ) protocols.
+ *
+ * @param Bps bit rate
+ * @param ResetUs low time that latches the data
+ * @param T0H, T1H, T1L bit timing in PIO cycles, see `led_protocol::PioTiming`
+ * @param Rgbw 32-bit pixels with a white channel instead of 24-bit RGB
+ */
+template <uint32_t Bps, uint32_t ResetUs, uint8_t T0H, uint8_t T1H, uint8_t T1L, bool Rgbw>
+struct SingleWireProtocol {
+
+    static_assert(T0H >= 1 && T1H > T0H && T1L >= 1, "bit timing must be T0H < T1H with T1L low");
+    static_assert(T0H - 1 <= led_protocol::MAX_DELAY && T1H - T0H - 1 <= led_protocol::MAX_DELAY &&
+                  T1L - 1 <= led_protocol::MAX_DELAY, "bit timing doesn't fit ws2811.pio's delay fields");
+
+    static constexpr bool clocked = false;
+    static constexpr bool rgbw = Rgbw;
+    static constexpr uint8_t bits_per_pixel = Rgbw ? 32 : 24;
+    static constexpr uint32_t bps = Bps;
+    static constexpr uint32_t reset_us = ResetUs;
+    static constexpr led_protocol::PioTiming timing {T0H, T1H, T1L};
+
+    static constexpr size_t header_words() {
+        return 0;
+    }
+
+    static constexpr size_t trailer_words([[maybe_unused]] size_t num_leds) {
+        return 0;
+    }
+
+    static constexpr size_t frame_words(size_t num_leds) {
+        return num_leds;
+    }
+
+    /**
+     * @brief Time to send `num_leds` pixels and latch them, i.e. the fastest refresh.
+     */
+    static constexpr uint32_t wire_time_us(size_t num_leds) {
+        return static_cast<uint32_t>(static_cast<uint64_t>(num_leds) * bits_per_pixel * 1'000'000 / Bps) + ResetUs;
+    }
+};
+
+
+/**
+ * @brief WS2811 at 800 kHz, RGB order: 250ns/1000ns high for 0/1 in a 1250ns bit.
+ */
+struct WS2811Protocol : SingleWireProtocol<800'000, 50, 1, 4, 1, false> {
+    static constexpr const char* name = "ws2811";
+
+    static constexpr uint32_t pack(RGBValue p) {
+        return led_protocol::word(p.r, p.g, p.b, 0);
+    }
+};
+
+
+/**
+ * @brief WS2812B, GRB order: 375ns/875ns high for 0/1 in a 1250ns bit, latched after 280us low
+ * (recent datasheets; older parts need only 50us).
+ */
+struct WS2812BProtocol : SingleWireProtocol<800'000, 280, 3, 7, 3, false> {
+    static constexpr const char* name = "ws2812b";
+
+    static constexpr uint32_t pack(RGBValue p) {
+        return led_protocol::word(p.g, p.r, p.b, 0);
+    }
+};
+
+
+/**
+ * @brief SK6812 RGBW, GRBW order: 375ns/750ns high for 0/1 in a 1250ns bit, 80us latch. White
+ * takes over the part of the colour common to red, green and blue.
+ */
+struct SK6812RgbwProtocol : SingleWireProtocol<800'000, 80, 3, 6, 4, true> {
+    static constexpr const char* name = "sk6812_rgbw";
+
+    static constexpr uint32_t pack(RGBValue p) {
+        led_protocol::Rgbw c = led_protocol::to_rgbw(p);
+        return led_protocol::word(c.g, c.r, c.b, c.w);
+    }
+};
+
+
+/**
+ * @brief Clocked (SPI-like) protocols: data is sampled on the rising clock edge, so the bit rate
+ * is only limited by the strip (APA102 and SK9822 take 10+ MHz) and there's no latch time.
+ *
+ * @param Bps clock rate
+ * @param ResetWords zero words before the end frame (SK9822 needs one to latch)
+ */
+template <uint32_t Bps, size_t ResetWords>
+struct ClockedProtocol {
+
+    static constexpr bool clocked = true;
+    static constexpr bool rgbw = false;
+    static constexpr uint8_t bits_per_pixel = 32;
+    static constexpr uint32_t bps = Bps;
+    static constexpr uint8_t global_brightness = 31;   /// 5-bit brightness of every pixel
+
+    /// 32 zero bits start a frame
+    static constexpr size_t header_words() {
+        return 1;
+    }
+
+    /// every LED delays the data by half a clock, so push it through with num_leds / 2 more clocks
+    static constexpr size_t trailer_words(size_t num_leds) {
+        return ResetWords + (num_leds + 63) / 64;
+    }
+
+    static constexpr size_t frame_words(size_t num_leds) {
+        return header_words() + num_leds + trailer_words(num_leds);
+    }
+
+    static constexpr uint32_t wire_time_us(size_t num_leds) {
+        return static_cast<uint32_t>(static_cast<uint64_t>(frame_words(num_leds)) * 32 * 1'000'000 / Bps);
+    }
+
+    /**
+     * @brief 0b111 and the global brightness, then blue, green, red.
+     */
+    static constexpr uint32_t pack(RGBValue p) {
+        return led_protocol::word(static_cast<uint8_t>(0xE0 | global_brightness), p.b, p.g, p.r);
+    }
+};
+
+
+/**
+ * @brief APA102 (DotStar) at 10 MHz.
+ */
+struct APA102Protocol : ClockedProtocol<10'000'000, 0> {
+    static constexpr const char* name = "apa102";
+};
+
+
+/**
+ * @brief SK9822 (APA102 clone) at 10 MHz. Latches on a zero frame after the data rather than on
+ * the next start frame, so it gets one before the end frame.
+ */
+struct SK9822Protocol : ClockedProtocol<10'000'000, 1> {
+    static constexpr const char* name = "sk9822";
+};
+
+
+/**
+ * @brief Pack `pixels` into `words` for `Protocol`, with its start and end frames.
+ *
+ * @return number of words written, `Protocol::frame_words(pixels.size())`, or 0 if `words` is
+ * too small
+ */
+template <typename Protocol>
+size_t encode_frame(etl::span<const RGBValue> pixels, etl::span<uint32_t> words) {
+    const size_t n = Protocol::frame_words(pixels.size());
+    if (words.size() < n) {
+        return 0;
+    }
+    uint32_t* out = words.data();
+    for (size_t i = 0; i < Protocol::header_words(); i++) {
+        *out++ = 0;
+    }
+    for (const RGBValue& p : pixels) {
+        *out++ = Protocol::pack(p);
+    }
+    for (size_t i = 0; i < Protocol::trailer_words(pixels.size()); i++) {
+        *out++ = 0;
+    }
+    return n;
+}
+
+
+/**
+ * @brief Where frame pixels go on a matrix panel wired row by row: the logical-to-physical
+ * mapping, applied while a frame is encoded.
+ *
+ * The frame is rows of `width` pixels, top row first. `row_offset` rotates the rows, so physical
+ * row y shows frame row (y + row_offset) % rows: an effect can scroll the whole panel by changing
+ * it instead of moving pixels (see `WaterfallEffect`). Serpentine panels run every other row
+ * backwards. Pixels after the last whole row are sent as they are. The default, width 0, is a
+ * strip: pixel i to LED i.
+ */
+struct PanelMap {
+    uint16_t width = 0;
+    bool serpentine = false;
+    uint16_t row_offset = 0;
+
+    /**
+     * @brief True if frame pixel i goes to LED i for a frame of `num_pixels`.
+     */
+    bool is_identity(size_t num_pixels) const {
+        const size_t rows = width > 0 ? num_pixels / width : 0;
+        return rows == 0 || (row_offset % rows == 0 && !serpentine);
+    }
+};
+
+
+/**
+ * @brief `encode_frame` through `map`. Still one `pack` per pixel: the mapping only changes where
+ * each row is read from.
+ */
+template <typename Protocol>
+size_t encode_frame(etl::span<const RGBValue> pixels, etl::span<uint32_t> words, const PanelMap& map) {
+    if (map.is_identity(pixels.size())) {
+        return encode_frame<Protocol>(pixels, words);
+    }
+    const size_t width = map.width;
+    const size_t rows = pixels.size() / width;
+    const size_t n = Protocol::frame_words(pixels.size());
+    if (words.size() < n) {
+        return 0;
+    }
+    uint32_t* out = words.data();
+    for (size_t i = 0; i < Protocol::header_words(); i++) {
+        *out++ = 0;
+    }
+    size_t row = map.row_offset % rows;
+    for (size_t y = 0; y < rows; y++) {
+        const RGBValue* src = pixels.data() + row * width;
+        if (map.serpentine && (y & 1)) {
+            for (size_t x = width; x-- > 0;) {
+                *out++ = Protocol::pack(src[x]);
+            }
+        } else {
+            for (size_t x = 0; x < width; x++) {
+                *out++ = Protocol::pack(src[x]);
+            }
+        }
+        row = row + 1 == rows ? 0 : row + 1;
+    }
+    for (size_t i = rows * width; i < pixels.size(); i++) {
+        *out++ = Protocol::pack(pixels[i]);
+    }
+    for (size_t i = 0; i < Protocol::trailer_words(pixels.size()); i++) {
+        *out++ = 0;
+    }
+    return n;
+}
+
+
+/**
+ * @brief Pack pixels `begin` to `end - 1` again into `words`, which hold `pixels` as encoded by
+ * `encode_frame` with the same `map`: after a partial change (see `FrameChange`) only the changed
+ * pixels are packed. A rotated or serpentine panel is encoded whole.
+ *
+ * @return number of words in the frame, or 0 if `words` is too small
+ */
+template <typename Protocol>
+size_t encode_pixels(etl::span<const RGBValue> pixels, etl::span<uint32_t> words, size_t begin, size_t end,
+                     const PanelMap& map = PanelMap{}) {
+    if (!map.is_identity(pixels.size())) {
+        return encode_frame<Protocol>(pixels, words, map);
+    }
+    const size_t n = Protocol::frame_words(pixels.size());
+    if (words.size() < n) {
+        return 0;
+    }
+    end = end < pixels.size() ? end : pixels.size();
+    uint32_t* out = words.data() + Protocol::header_words();
+    for (size_t i = begin; i < end; i++) {
+        out[i] = Protocol::pack(pixels[i]);
+    }
+    return n;
+}
+
+
+/**
+ * @brief Protocol of the LEDs this build drives (`-DLIGHTDANCER_LED=...`, default ws2811).
+ */
+#if defined(LIGHTDANCER_LED_WS2812B)
+using LedProtocol = WS2812BProtocol;
+#elif defined(LIGHTDANCER_LED_SK6812_RGBW)
+using LedProtocol = SK6812RgbwProtocol;
+#elif defined(LIGHTDANCER_LED_APA102)
+using LedProtocol = APA102Protocol;
+#elif defined(LIGHTDANCER_LED_SK9822)
+using LedProtocol = SK9822Protocol;
+#else
+using LedProtocol = WS2811Protocol;
+#endif
+
+
+#endif // LED_PROTOCOL_H
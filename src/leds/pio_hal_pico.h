@@ -0,0 +1,36 @@
+/**
+ * @file pio_hal_pico.h
+ * @brief Pico implementation of the PIO debug `Hal` used by `LedHealthMonitor` (led_health.h).
+ */
+#ifndef PIO_HAL_PICO_H
+#define PIO_HAL_PICO_H
+
+#include <stdint.h>
+
+extern "C" {
+#include "hardware/pio.h"
+#include "pico/time.h"
+}
+
+
+/**
+ * @brief FDEBUG register and µs clock of one PIO block.
+ */
+struct PioHal {
+    PIO pio = nullptr;
+
+    uint32_t read_fdebug() {
+        return pio->fdebug;
+    }
+
+    void clear_fdebug(uint32_t mask) {
+        pio->fdebug = mask;     // write 1 to clear
+    }
+
+    uint64_t now_us() {
+        return time_us_64();
+    }
+};
+
+
+#endif // PIO_HAL_PICO_H
@@ -0,0 +1,148 @@
+/**
+ * @file refresh_gate.h
+ * @brief Decides each frame what the LED driver encodes and sends, from what the effect changed
+ * (see `FrameChange` in draw.h).
+ *
+ * A frame the effect left unchanged is neither encoded nor sent, except for a keep-alive every
+ * `keep_alive_us` so a strip that glitched or was powered up late shows the right frame again. A
+ * changed range is packed alone into the driver's word buffer, which still holds the rest of the
+ * last frame, and then the whole buffer is sent. The first frame, a new LED count or panel mapping,
+ * and `invalidate()` encode the whole frame, as does any change on a rotated or serpentine panel.
+ *
+ * No hardware access, like power_policy.h: the driver applies the `Refresh`.
+ *
+ * ```cpp
+ * static RefreshGate gate(1'000'000);
+ * FrameChange change = scheduler.draw_frame(effect_factory, frame, info);
+ * PanelMap panel {16, true, effect_factory.row_offset()};
+ * leds.send(frame, gate.update(change, frame.num_leds, time_us_64(), panel), panel);
+ * ```
+ */
+#ifndef REFRESH_GATE_H
+#define REFRESH_GATE_H
+
+#include <stdint.h>
+#include "../draw.h"
+#include "led_protocol.h"
+
+
+/**
+ * @brief What the LED driver does with a frame.
+ */
+struct Refresh {
+    FrameChange encode;     /// pixels to pack again: none, a range or the whole frame
+    bool send;              /// send the word buffer
+};
+
+
+/**
+ * @brief Work done and skipped by `RefreshGate`.
+ */
+struct RefreshStats {
+    uint32_t frames = 0;
+    uint32_t unchanged = 0;         /// frames the effect left as they were
+    uint32_t partial = 0;           /// frames with a range of pixels changed
+    uint32_t sends = 0;             /// frames sent, keep-alives included
+    uint32_t keep_alives = 0;       /// unchanged frames sent anyway
+    uint64_t pixels = 0;            /// pixels in every frame
+    uint64_t pixels_encoded = 0;    /// pixels packed again
+
+    /// percent of pixels not packed again
+    uint32_t encode_skipped_percent() const {
+        return pixels == 0 ? 0 : static_cast<uint32_t>(100 - pixels_encoded * 100 / pixels);
+    }
+
+    /// percent of frames not sent
+    uint32_t send_skipped_percent() const {
+        return frames == 0 ? 0 : static_cast<uint32_t>(100 - static_cast<uint64_t>(sends) * 100 / frames);
+    }
+};
+
+
+/**
+ * @brief Turns each frame's `FrameChange` into a `Refresh`, with keep-alives.
+ */
+class RefreshGate {
+
+    private:
+
+    uint32_t keep_alive_us_;
+    bool valid_ = false;            // the driver's buffer holds the last frame
+    unsigned int num_leds_ = 0;
+    PanelMap map_;
+    uint64_t last_send_us_ = 0;
+    RefreshStats stats_;
+
+    bool same_map(const PanelMap& map) const {
+        return map.width == map_.width && map.serpentine == map_.serpentine && map.row_offset == map_.row_offset;
+    }
+
+
+    public:
+
+    /**
+     * @param keep_alive_us longest time between sends while nothing changes
+     */
+    explicit RefreshGate(uint32_t keep_alive_us = 1'000'000) : keep_alive_us_(keep_alive_us) {
+    }
+
+    /**
+     * @param change what the effect changed in the frame
+     * @param num_leds LEDs in the frame
+     * @param now_us µs clock
+     * @param map panel mapping the frame is sent with
+     */
+    Refresh update(FrameChange change, unsigned int num_leds, uint64_t now_us, const PanelMap& map = PanelMap{}) {
+        if (!valid_ || num_leds != num_leds_ || !same_map(map)) {
+            change = FrameChange::full();
+            valid_ = true;
+            num_leds_ = num_leds;
+            map_ = map;
+        } else if (change.kind == FrameChange::Kind::Range) {
+            change = map.is_identity(num_leds) ? FrameChange::range(change.begin, change.end < num_leds ? change.end : num_leds)
+                                               : FrameChange::full();
+        }
+
+        stats_.frames++;
+        stats_.pixels += num_leds;
+        Refresh refresh {change, true};
+        switch (change.kind) {
+            case FrameChange::Kind::Unchanged:
+                stats_.unchanged++;
+                refresh.send = now_us - last_send_us_ >= keep_alive_us_;
+                stats_.keep_alives += refresh.send ? 1 : 0;
+                break;
+            case FrameChange::Kind::Range:
+                stats_.partial++;
+                stats_.pixels_encoded += change.end - change.begin;
+                break;
+            case FrameChange::Kind::Full:
+                stats_.pixels_encoded += num_leds;
+                break;
+        }
+        if (refresh.send) {
+            stats_.sends++;
+            last_send_us_ = now_us;
+        }
+        return refresh;
+    }
+
+    /**
+     * @brief Encode and send the whole next frame, e.g. after the driver's buffer was used for
+     * something else.
+     */
+    void invalidate() {
+        valid_ = false;
+    }
+
+    const RefreshStats& stats() const {
+        return stats_;
+    }
+
+    void reset_stats() {
+        stats_ = RefreshStats{};
+    }
+};
+
+
+#endif // REFRESH_GATE_H
@@ -18,13 +18,41 @@ extern "C" {
 
 #include "../../draw.h"
 #include "../../effects/effects_lib.h"
+#include "../led_protocol.h"
 
-constexpr int reset_time_ns = 50'000;   /// Number of nanoseconds LOW for WS2811 RESET signal
+static_assert(!LedProtocol::clocked, "WS2811Pio drives single wire LEDs, use Apa102Pio for clocked ones");
+
+constexpr int reset_time_ns = LedProtocol::reset_us * 1000;   /// Number of nanoseconds LOW for RESET
+
+// frame packed for the PIO (see led_protocol.h), DMA'd from here
+static uint32_t wire_words[LedProtocol::frame_words(MAX_LEDS)];
+
+// ws2811.pio with the delays of its bit loop (instructions 1-3) set for `LedProtocol::timing`
+static uint16_t timed_instructions[sizeof(ws2811pio_program_instructions) / sizeof(uint16_t)];
+static pio_program_t timed_program;
+
+// time to shift out the joined 8 word TX FIFO and the OSR
+static uint32_t drain_time_us(uint bps) {
+    return static_cast<uint32_t>(9ull * LedProtocol::bits_per_pixel * 1'000'000 / bps) + 1;
+}
+
+static const pio_program_t* program_for_timing(led_protocol::PioTiming t) {
+    for (size_t i = 0; i < sizeof(timed_instructions) / sizeof(uint16_t); i++) {
+        timed_instructions[i] = ws2811pio_program_instructions[i];
+    }
+    timed_instructions[1] = led_protocol::with_delay(timed_instructions[1], t.t0h - 1);          // out x, 1
+    timed_instructions[2] = led_protocol::with_delay(timed_instructions[2], t.t1h - t.t0h - 1);  // mov pins, x
+    timed_instructions[3] = led_protocol::with_delay(timed_instructions[3], t.t1l - 1);          // pull ifempty
+    timed_program = ws2811pio_program;
+    timed_program.instructions = timed_instructions;
+    return &timed_program;
+}
 
 //
 // constructor
 //
-WS2811Pio::WS2811Pio(uint bps, uint8_t pin) {
+WS2811Pio::WS2811Pio(uint bps, uint8_t pin)
+    : health_(hal_, LedProtocol::reset_us, drain_time_us(bps)) {
     // ensure only one instance or die
     if (instance_ != nullptr) {
         abort();
@@ -32,6 +60,8 @@ WS2811Pio::WS2811Pio(uint bps, uint8_t pin) {
     instance_ = this;
 
     install_pio_and_run(pin, bps);
+    hal_.pio = pio_;
+    health_.set_state_machine(sm_);
 
     setup_dma();
 
@@ -48,14 +78,15 @@ WS2811Pio::WS2811Pio(uint bps, uint8_t pin) {
 void WS2811Pio::install_pio_and_run(uint8_t pin, uint bps)
 {
     // load PIO program into State Machine
-    bool is_added = pio_claim_free_sm_and_add_program(&ws2811pio_program, &pio_, &sm_, &offset_);
+    const pio_program_t* program = program_for_timing(LedProtocol::timing);
+    bool is_added = pio_claim_free_sm_and_add_program(program, &pio_, &sm_, &offset_);
     if (!is_added)
     {
         assert("Failed to load pio program");
         std::abort();
     }
 
-    ws2811pio_program_init(pio_, sm_, offset_, pin, bps, false);
+    ws2811pio_program_init(pio_, sm_, offset_, pin, bps, LedProtocol::timing.cycles_per_bit(), LedProtocol::rgbw);
 }
 
 
@@ -95,7 +126,7 @@ void WS2811Pio::setup_dma() {
 // destructor
 //
 WS2811Pio::~WS2811Pio() {
-    pio_remove_program_and_unclaim_sm(&ws2811pio_program, pio_, sm_, offset_);
+    pio_remove_program_and_unclaim_sm(&timed_program, pio_, sm_, offset_);
     
     dma_channel_cleanup(dma_chan_);
     dma_channel_unclaim(dma_chan_);
@@ -114,6 +145,7 @@ void WS2811Pio::dma_irq_handler_c_wrapper(void) {
 void WS2811Pio::dma_irq_handler() {
     if (dma_channel_get_irq0_status(dma_chan_)) {
         dma_channel_acknowledge_irq0(dma_chan_); // clear IRQ flag
+        health_.on_data_queued();   // before the RESET words refill the FIFO
         send_reset_signal();  
     }
 }
@@ -134,21 +166,95 @@ void WS2811Pio::send_reset_signal() {
 //
 // Initiate DMA transfer from frame.data to PIO state machines TX FIFO
 //
-void WS2811Pio::send(const Frame& frame) {
-    // block until current DMA xfer complete (if any)
+void WS2811Pio::send(const Frame& frame, const PanelMap& map) {
+    send(frame, Refresh{FrameChange::full(), true}, map);
+}
+
+
+//
+// Pack what changed and send, if anything is to be sent
+//
+void WS2811Pio::send(const Frame& frame, const Refresh& refresh, const PanelMap& map) {
+    if (!refresh.send) {
+        return;
+    }
+    // block until current DMA xfer complete (if any), the buffer is reused
+    bool waited = dma_channel_is_busy(dma_chan_);
     dma_channel_wait_for_finish_blocking(dma_chan_);
-    printf("DMA chan ready");
+    if (!enabled_) {
+        set_enabled(true);
+    }
+    // pack pixels into one word each, as the PIO shifts them out; the rest are as last sent
+    etl::span<const RGBValue> pixels = frame.data.first(frame.num_leds);
+    size_t num_words = LedProtocol::frame_words(frame.num_leds);
+    if (refresh.encode.kind == FrameChange::Kind::Full || words_stale_) {
+        num_words = encode_frame<LedProtocol>(pixels, wire_words, map);
+        words_stale_ = false;
+    } else if (refresh.encode.kind == FrameChange::Kind::Range) {
+        num_words = encode_pixels<LedProtocol>(pixels, wire_words, refresh.encode.begin, refresh.encode.end, map);
+    }
+
     // how many words (32bit) to transfer over DMA
-    dma_channel_set_transfer_count(dma_chan_, dma_encode_transfer_count(frame.num_leds), false);
-    //printf("DMA transfer count %u", dma_encode_transfer_count(frame.num_leds));
+    dma_channel_set_transfer_count(dma_chan_, dma_encode_transfer_count(num_words), false);
 
-    // DMA reads from frame and go!
+    // DMA reads from the packed frame and go!
     bool start_now = true;
-    dma_channel_set_read_addr(dma_chan_, &frame.data[0], start_now); 
+    dma_channel_set_read_addr(dma_chan_, wire_words, start_now); 
+
+    // once data is flowing, any stall is an underrun
+    while (pio_sm_is_tx_fifo_empty(pio_, sm_) && dma_channel_is_busy(dma_chan_)) {
+        tight_loop_contents();
+    }
+    health_.on_send(waited);
     
 };
 
 
+//
+// Send prepacked words, e.g. from flash, straight to the PIO
+//
+void WS2811Pio::send_words(etl::span<const uint32_t> words) {
+    bool waited = dma_channel_is_busy(dma_chan_);
+    dma_channel_wait_for_finish_blocking(dma_chan_);
+    if (!enabled_) {
+        set_enabled(true);
+    }
+    words_stale_ = true;
+    dma_channel_set_transfer_count(dma_chan_, dma_encode_transfer_count(words.size()), false);
+    dma_channel_set_read_addr(dma_chan_, words.data(), true);
+    health_.on_send(waited);
+}
+
+
+//
+// Wait for the DMA, then for the IRQ handler's RESET words to leave the FIFO and the line to be
+// low for the RESET time
+//
+void WS2811Pio::wait_until_latched() {
+    dma_channel_wait_for_finish_blocking(dma_chan_);
+    while (!pio_sm_is_tx_fifo_empty(pio_, sm_)) {
+        tight_loop_contents();
+    }
+    busy_wait_us(reset_time_ns / 1000);
+}
+
+
+//
+// Gate the state machine between frames
+//
+void WS2811Pio::set_enabled(bool enabled) {
+    if (enabled == enabled_) {
+        return;
+    }
+    if (!enabled) {
+        // let the current frame and its RESET words shift out before stopping the clock
+        wait_until_latched();
+    }
+    pio_sm_set_enabled(pio_, sm_, enabled);
+    enabled_ = enabled;
+}
+
+
 /**
  * @brief Test LEDs work without using DMA transfer
  * 
@@ -191,9 +297,14 @@ void WS2811Pio::test(size_t num_leds) {
         
         effect.draw_frame(frame, info);
 
+        // a blocking put loop is where the FIFO runs dry if the CPU is late: count it
         for (uint i = 0; i < frame.num_leds; i++) {
-              pio_sm_put_blocking(pio_, sm_, frame.data[i].as_RGB());  
+              pio_sm_put_blocking(pio_, sm_, LedProtocol::pack(frame.data[i]));  
+              if (i == 0) {
+                  health_.on_send(false);
+              }
         }
+        health_.on_data_queued();
         
         #ifndef NDEBUG
             //less than 800us LEDs don't latch at 400kBs during debugging
@@ -5,12 +5,19 @@ extern "C" {
 #include "hardware/pio.h"
 }
 #include "../../draw.h"
+#include "../led_health.h"
+#include "../led_protocol.h"
+#include "../pio_hal_pico.h"
+#include "../refresh_gate.h"
 
 #include <cstdint>
 
 /**
  * @brief Driver for WS2811 LED using Raspberry Pi Pico Programmable I/O (PIO).
  * 
+ * Also drives the other single wire chips in led_protocol.h (WS2812B, SK6812 RGBW): the bit
+ * timing, colour order and RGBW packing come from `LedProtocol`, chosen at compile time.
+ * 
  * Raspberry Pi PIO does not run on a CPU core but on a separate state machine, keeping the CPU
  * free for other tasks.  It is available on RP2040 and RP2350 microcontrollers.
  * 
@@ -32,6 +39,10 @@ class WS2811Pio final {
     uint offset_ = 0;               // Offset in SM, pio code starts at
     uint dma_chan_;                 // DMA channel for data transfer from RAM to PIO State Machine
     int num_words_to_reset_;        // No o 32-bit words required to send RESET signal
+    bool enabled_ = true;           // PIO state machine running (false when gated)
+    bool words_stale_ = false;      // the word buffer doesn't hold the last frame (see `send_words`)
+    PioHal hal_;                    // FDEBUG access for `health_`
+    LedHealthMonitor<PioHal> health_; // underruns, late sends & latch times
 
     static void dma_irq_handler_c_wrapper(void); // IRQ handler to be registered with Pico SDK
     void dma_irq_handler();                      // IRQ handler that can use member variables
@@ -51,7 +62,7 @@ class WS2811Pio final {
      * is called.
      * 
      * @param [in] num_leds Number of LEDs on LED strip
-     * @param [in] bps Transmission frequency in bits per second, typically 800,000 or 400,000.
+     * @param [in] bps Transmission frequency in bits per second, typically `LedProtocol::bps`.
      * @param [in] pin Number of the GPIO pin for data out.
      */
     WS2811Pio(uint bps, uint8_t pin);
@@ -62,8 +73,37 @@ class WS2811Pio final {
      * @brief Send a frame to the LED strip to display.  This may block until the frame is completely
      * sent or it may return immediately (e.g. if the driver uses DMA).  If it returns immediately,
      * a subsequent call to `send()` will block until the prior frame is completely sent.
+     *
+     * @param [in] map where the frame's pixels go on a panel (see `PanelMap`), default a strip
+     */
+    void send(const Frame& frame, const PanelMap& map = PanelMap{});
+
+    /**
+     * @brief Send what `refresh` says (see refresh_gate.h): pack only the pixels that changed
+     * into the last frame's words, and skip the transfer when nothing did.
+     */
+    void send(const Frame& frame, const Refresh& refresh, const PanelMap& map = PanelMap{});
+
+    /**
+     * @brief Send words already packed for `LedProtocol`, e.g. the boot look in flash (boot.h):
+     * DMA reads them where they are, with nothing to encode. The next `send` encodes its whole
+     * frame, whatever its `Refresh` says.
+     */
+    void send_words(etl::span<const uint32_t> words);
+
+    /**
+     * @brief Block until the frame being sent has shifted out and the LEDs have latched it
+     * (its RESET time has passed), e.g. to time when the boot look is showing.
+     */
+    void wait_until_latched();
+
+    /**
+     * @brief Stop (gate) or restart the PIO state machine, e.g. between frames in low power.
+     *
+     * Stopping waits for the frame being sent to finish. `send()` restarts a stopped state machine.
+     * The data line stays low while stopped, which the LEDs see as a long RESET.
      */
-    void send(const Frame& frame);
+    void set_enabled(bool enabled);
 
     /**
      * @brief Test LEDs work with alternating pattern of Red, Green, & Blue colours.
@@ -72,6 +112,13 @@ class WS2811Pio final {
      * steady pattern of alternating Red, Green, & Blue. 
      */
     void test(size_t num_leds);
+
+    /**
+     * @brief Underrun, late send and latch time counters (see led_health.h).
+     */
+    const LedHealthStats& health() const {
+        return health_.stats();
+    }
 };
 
 #endif
\ No newline at end of file
@@ -3,11 +3,147 @@
 #include "etl/random.h"
 
 extern "C" {
+#include "pico/multicore.h"
 #include "pico/stdlib.h"
 }
+#include "config.h"
+#include "ram_budget.h"
+#include "boot.h"
 #include "draw.h"
 #include "effects/effect_factory.h"
+#include "effects/periodic_cache.h"
+#include "frame_scheduler.h"
+#include "leds/led_protocol.h"
+#include "leds/refresh_gate.h"
+#if defined(LIGHTDANCER_LED_APA102) || defined(LIGHTDANCER_LED_SK9822)
+#include "leds/apa102pio/apa102pio.h"
+#else
 #include "leds/ws2811pio/ws2811pio.h"
+#endif
+#ifdef LIGHTDANCER_NETWORK
+#include "swap_chain.h"
+#include "net/dmx_udp_pico.h"
+#endif
+#ifdef LIGHTDANCER_SERIAL_STREAM
+#ifdef LIGHTDANCER_NETWORK
+#error "LIGHTDANCER_SERIAL_STREAM and LIGHTDANCER_NETWORK each replace the effects, choose one"
+#endif
+#include "swap_chain.h"
+#include "serial/frame_stream_uart_pico.h"
+#endif
+#ifdef LIGHTDANCER_SYNC_UDP
+#include "sync/sync_udp_pico.h"
+#endif
+#ifdef LIGHTDANCER_SYNC_UART
+#include "sync/sync_uart_pico.h"
+#endif
+#if defined(LIGHTDANCER_SYNC_UDP) || defined(LIGHTDANCER_SYNC_UART)
+#define LIGHTDANCER_SYNC 1
+#endif
+#ifdef LIGHTDANCER_PARAM_UART
+#if defined(LIGHTDANCER_SERIAL_STREAM) || defined(LIGHTDANCER_SYNC_UART)
+#error "LIGHTDANCER_PARAM_UART needs uart1 to itself"
+#endif
+#include "params.h"
+#include "serial/param_uart_pico.h"
+#endif
+
+using Config = LightDancerConfig;
+static_assert(RamBudget<Config>::fits, "RAM budget exceeded (see ram_budget.h)");
+
+// LEDs the frames sent below cover
+#if defined(LIGHTDANCER_NETWORK)
+constexpr int lit_leds = 1000;
+#elif defined(LIGHTDANCER_SERIAL_STREAM)
+constexpr int lit_leds = MAX_LEDS;
+#else
+constexpr int lit_leds = 100;
+#endif
+
+// Pipeline buffers are static, not on the 4K core stacks, and are accounted for in `RamBudget`
+static Frame frame(lit_leds);
+static_assert(Config::frame_buffers == 1, "RamBudget counts Config::frame_buffers Frames: main has one");
+static etl::array<uint16_t, Config::fft_bins> fft_mags {1};
+
+// Shown from reset until the first frame: packed at compile time, DMA'd from flash. Only as long
+// as the frames, so the first one overwrites all of it and it's on the wire no longer than they are.
+static constexpr auto boot_look = boot::encode_look<LedProtocol, lit_leds>(boot::ember);
+static BootTimes boot_times;
+
+#ifdef LIGHTDANCER_NETWORK
+// Network pixel node: frames come from E1.31/Art-Net (universe 1 onwards) instead of effects
+constexpr int network_leds = lit_leds;
+static FrameSwapChain dmx_frames(network_leds);
+static DmxReceiver dmx_receiver(dmx_frames, 1, DmxReceiver::universes_for(network_leds));
+#endif
+
+#ifdef LIGHTDANCER_SERIAL_STREAM
+// Tethered: frames come from a host PC over uart1 (RX on GPIO5) instead of effects
+constexpr uint stream_baud = 3'000'000;
+constexpr uint8_t stream_rx_pin = 5;
+static FrameSwapChain stream_frames(lit_leds);
+static FrameStreamReceiver stream_receiver(stream_frames);
+#endif
+
+#ifdef LIGHTDANCER_SYNC
+// Effects run on time shared with the other controllers (the leader's clock)
+#ifdef LIGHTDANCER_SYNC_LEADER
+static SyncNode sync_node(SyncNode::Role::Leader);
+#else
+static SyncNode sync_node(SyncNode::Role::Follower);
+#endif
+#endif
+
+#ifdef LIGHTDANCER_PARAM_UART
+// Tunables changed over uart1 (TX on GPIO4, RX on GPIO5) while running, see params.h. An effect's
+// block id is its `EffectFactory::EffectType`. Add new blocks to `RamBudget::param_blocks` too.
+constexpr uint8_t lod_params_id = 0x40;
+static ParamBlock<LaserEffect::Params> laser_params;
+static ParamBlock<BlinkEffect::Params> blink_params;
+static ParamBlock<SpectrumEffect::Params> spectrum_params;
+static ParamBlock<WaterfallEffect::Params> waterfall_params;
+static ParamBlock<TwinkleEffect::Params> twinkle_params;
+static ParamBlock<FireEffect::Params> fire_params;
+static ParamBlock<LodParams> lod_params;
+static ParamStore params;
+
+// pass the live parameters on; effects other than the current one ignore theirs
+static void set_params(EffectFactory& effect_factory, FrameScheduler& scheduler) {
+    effect_factory.set_params<LaserEffect>(laser_params.get());
+    effect_factory.set_params<BlinkEffect>(blink_params.get());
+    effect_factory.set_params<SpectrumEffect>(spectrum_params.get());
+    effect_factory.set_params<WaterfallEffect>(waterfall_params.get());
+    effect_factory.set_params<TwinkleEffect>(twinkle_params.get());
+    effect_factory.set_params<FireEffect>(fire_params.get());
+    scheduler.set_params(lod_params.get());
+}
+#endif
+
+
+// Once a second from each loop: what `send` saw of the LEDs' timing
+template <typename Leds>
+static void print_led_health(const Leds& leds) {
+    const LedHealthStats& health = leds.health();
+    printf("LEDs: %u frames, %u underruns, %u overflows, %u late sends, %u short latches, latch %u..%u us\n",
+           static_cast<unsigned>(health.frames), static_cast<unsigned>(health.underruns),
+           static_cast<unsigned>(health.overflows), static_cast<unsigned>(health.late_sends),
+           static_cast<unsigned>(health.short_latches), static_cast<unsigned>(health.min_latch_us),
+           static_cast<unsigned>(health.max_latch_us));
+}
+
+
+// Core 1: audio analysis, brought up while core 0 starts the effects
+static void analysis_core() {
+    static PipelineFFT<Config> fft;     // nothing to build, its tables are in flash
+    Arena& scratch = CoreArenas<Config>::core1;    // the FFT's work buffer, off the 4K stack
+    (void)fft;
+    (void)scratch;
+    // no audio capture driver yet: `fft_mags` keep their values. Each block will be
+    // `fft.magnitudes(block, fft_mags, scratch)`.
+    while (true) {
+        tight_loop_contents();
+    }
+}
 
 
 void loop() {
@@ -42,13 +178,23 @@ void loop() {
 
 int main() {
     
-    // Pico init
-    stdio_init_all();
-
-    // LED init
+    // LED init first, so the boot look is latched while everything else starts
     uint8_t gpio_pin = 2;
-    uint bps = 800'000;
+    uint bps = LedProtocol::bps;
+#if defined(LIGHTDANCER_LED_APA102) || defined(LIGHTDANCER_LED_SK9822)
+    uint8_t clock_pin = 3;
+    Apa102Pio leds(bps, gpio_pin, clock_pin);
+#else
     WS2811Pio leds(bps, gpio_pin);
+#endif
+    leds.send_words(boot_look.span());
+    multicore_launch_core1(analysis_core);
+    // measured, not estimated: the look is on the wire for `LedProtocol::wire_time_us(lit_leds)`
+    leds.wait_until_latched();
+    boot_times.mark(BootTimes::Stage::FirstLatch, time_us_64());
+
+    // Pico init
+    stdio_init_all();
     printf("LightDancer is up.\n");
     // loop
     //      get effect
@@ -74,19 +220,130 @@ int main() {
     //etl::random_xorshift rng;
     //auto i = rng.range(0, 1);
 
-    Frame frame(100);
-    EffectFactory effect_factory;
+#ifdef LIGHTDANCER_NETWORK
+    dmx_udp_start(dmx_receiver, WIFI_SSID, WIFI_PASSWORD);
+    uint32_t shown = 0;
+    absolute_time_t next_report = make_timeout_time_ms(1000);
+    while (1) {
+        if (dmx_frames.presented() != shown) {
+            shown = dmx_frames.presented();
+            leds.send(dmx_frames.front());
+        }
+        if (time_reached(next_report)) {
+            print_led_health(leds);
+            next_report = make_timeout_time_ms(1000);
+        }
+    }
+#endif
+
+#ifdef LIGHTDANCER_SERIAL_STREAM
+    FrameStreamUart stream_uart(uart1, stream_baud, stream_rx_pin, stream_receiver);
+    uint32_t last_frames = 0;
+    uint32_t shown = 0;
+    absolute_time_t next_report = make_timeout_time_ms(1000);
+    while (1) {
+        if (stream_frames.presented() != shown) {
+            shown = stream_frames.presented();
+            leds.send(stream_frames.front());
+        }
+        if (time_reached(next_report)) {
+            uint32_t frames = stream_receiver.stats().frames;
+            printf("Frame stream: %u fps, %u CRC errors\n", static_cast<unsigned>(frames - last_frames),
+                   static_cast<unsigned>(stream_receiver.stats().crc_errors));
+            print_led_health(leds);
+            last_frames = frames;
+            next_report = make_timeout_time_ms(1000);
+        }
+    }
+#endif
+
+#ifdef LIGHTDANCER_SYNC_UDP
+    sync_udp_start(sync_node, WIFI_SSID, WIFI_PASSWORD);
+#endif
+#ifdef LIGHTDANCER_SYNC_UART
+    SyncUart sync_uart(uart1, 115'200, 4, 5, sync_node);
+#endif
+
+    static EffectFactory effect_factory;   // too big for the stack, see `RamBudget`
     effect_factory.set_effect(0); // LASER
+    // drop effects' level of detail rather than the frame rate when they can't keep up
+    constexpr uint32_t frame_period_us = 16'667;   // 60 fps
+    FrameScheduler scheduler(frame_period_us, time_us_64);
+    // repeating effects are rendered for one period, then replayed (see `RamBudget`)
+    static PeriodicCache<Config::periodic_cache_bytes> periodic_cache(frame_period_us);
+    // only encode and send what the effect changed, with a keep-alive every second
+    RefreshGate refresh_gate(1'000'000);
+#ifdef LIGHTDANCER_PARAM_UART
+    params.add(EffectFactory::LASER, laser_params);
+    params.add(EffectFactory::BLINK, blink_params);
+    params.add(EffectFactory::SPECTRUM, spectrum_params);
+    params.add(EffectFactory::WATERFALL, waterfall_params);
+    params.add(EffectFactory::TWINKLE, twinkle_params);
+    params.add(EffectFactory::FIRE, fire_params);
+    params.add(lod_params_id, lod_params);
+    set_params(effect_factory, scheduler);
+    ParamUart param_uart(uart1, 115'200, 4, 5, params);
+#endif
 
-    etl::array<unsigned short, 1> fft_mags {1};
-    DrawInfo<unsigned short, 1> info {(unsigned short)100, fft_mags};
+    DrawInfo<uint16_t, Config::fft_bins> info {0, fft_mags};
+#ifdef LIGHTDANCER_SYNC
+    SharedFrameClock frame_clock;
+    frame_clock.tick(sync_node, time_us_64());
+#else
+    uint64_t last_frame_us = time_us_64();
+#endif
+    absolute_time_t next_frame = get_absolute_time();
+    absolute_time_t next_health_report = make_timeout_time_ms(1000);
     
     while (1) {
-        leds.test(100);
+        // one frame per frame period: an unchanged frame isn't sent, so nothing else paces the loop
+        sleep_until(next_frame);
+        next_frame = delayed_by_us(next_frame, frame_period_us);
+
+#ifdef LIGHTDANCER_SYNC
+        // effects run at the leader's rate, and see its time to line up their phase
+        SharedFrameClock::Tick tick = frame_clock.tick(sync_node, time_us_64());
+        info.elapsed_time_us = tick.elapsed_us;
+        info.time_us = tick.shared_us;
+#else
+        uint64_t frame_us = time_us_64();
+        info.elapsed_time_us = static_cast<uint32_t>(frame_us - last_frame_us);
+        info.time_us = frame_us;
+        last_frame_us = frame_us;
+#endif
+
+#ifdef LIGHTDANCER_PARAM_UART
+        // new parameters take effect between frames, never during one
+        if (params.apply()) {
+            set_params(effect_factory, scheduler);
+        }
+#endif
+
+        // a periodic effect (e.g. the laser) is decoded from the cache, which rebuilds itself when
+        // the effect or its parameters change; the rest are drawn at the level of detail that fits
+        FrameChange change = effect_factory.period_frames(frame.num_leds, frame_period_us) > 0
+                                 ? periodic_cache.draw_frame(effect_factory, frame, info)
+                                 : scheduler.draw_frame(effect_factory, frame, info);
+        PanelMap panel {0, false, effect_factory.row_offset()};
+        Refresh refresh = refresh_gate.update(change, frame.num_leds, time_us_64(), panel);
+        leds.send(frame, refresh, panel);
+
+        boot_times.mark(BootTimes::Stage::Effects, time_us_64());
+        if (boot_times.take_report()) {
+            printf("Boot: first light at %u us, effects at %u us\n",
+                   static_cast<unsigned>(boot_times.us(BootTimes::Stage::FirstLatch)),
+                   static_cast<unsigned>(boot_times.us(BootTimes::Stage::Effects)));
+        }
 
-        effect_factory.draw_frame(frame, info);
-        printf("Frame drawn");
-        //leds.send(frame);
+        if (time_reached(next_health_report)) {
+            print_led_health(leds);
+            const RefreshStats& refreshes = refresh_gate.stats();
+            printf("Refresh: %u frames, %u unchanged, %u%% encoding and %u%% sends skipped\n",
+                   static_cast<unsigned>(refreshes.frames), static_cast<unsigned>(refreshes.unchanged),
+                   static_cast<unsigned>(refreshes.encode_skipped_percent()),
+                   static_cast<unsigned>(refreshes.send_skipped_percent()));
+            next_health_report = make_timeout_time_ms(1000);
+        }
     }
 
     return 0;
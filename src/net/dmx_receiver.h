@@ -0,0 +1,441 @@
+/**
+ * @file dmx_receiver.h
+ * @brief E1.31 (sACN) and Art-Net receiver that maps DMX universes straight into the back buffer
+ * of a `FrameSwapChain`, so LightDancer can act as a network pixel node driven by a lighting desk.
+ *
+ * This is only the parsing and mapping: it takes UDP payloads from anywhere (lwIP on the Pico W,
+ * see dmx_udp_pico.cpp, or sockets on a host) so it can be tested without a network.
+ *
+ * Mapping: universe `first_universe + u` carries pixels `u * pixels_per_universe` onwards, 3
+ * channels per pixel in R, G, B order starting at channel 1 (the usual 170 pixels = 510 channels
+ * per universe). DMX data is copied directly into the back buffer's pixels, there is no
+ * intermediate frame.
+ *
+ * Latching (calling `FrameSwapChain::present`):
+ * - if the sender uses synchronisation (E1.31 sync address or Art-Net ArtSync), on each sync
+ *   packet, so universes sent across several packets change together;
+ * - otherwise when every mapped universe has been received, or when a universe arrives again
+ *   before the rest (a packet was lost), in which case the partial frame is latched.
+ */
+#ifndef DMX_RECEIVER_H
+#define DMX_RECEIVER_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include "etl/span.h"
+#include "../draw.h"
+#include "../swap_chain.h"
+
+static_assert(sizeof(RGBValue) == 3, "DMX channels are copied straight into RGBValue pixels");
+
+
+namespace dmx {
+
+    constexpr uint16_t E131_PORT = 5568;
+    constexpr uint16_t ARTNET_PORT = 6454;
+    constexpr unsigned int MAX_CHANNELS = 512;
+    constexpr unsigned int MAX_UNIVERSES = 64;
+
+    // E1.31 offsets and vectors (ANSI E1.31-2016)
+    constexpr size_t E131_ROOT_VECTOR = 18;
+    constexpr size_t E131_FRAMING_VECTOR = 40;
+    constexpr size_t E131_SYNC_ADDRESS = 109;
+    constexpr size_t E131_SEQUENCE = 111;
+    constexpr size_t E131_OPTIONS = 112;
+    constexpr size_t E131_UNIVERSE = 113;
+    constexpr size_t E131_PROPERTY_COUNT = 123;
+    constexpr size_t E131_START_CODE = 125;
+    constexpr size_t E131_DATA = 126;
+    constexpr size_t E131_SYNC_SEQUENCE = 44;
+    constexpr size_t E131_SYNC_UNIVERSE = 45;
+    constexpr size_t E131_SYNC_SIZE = 49;
+    constexpr uint32_t VECTOR_ROOT_E131_DATA = 0x00000004;
+    constexpr uint32_t VECTOR_ROOT_E131_EXTENDED = 0x00000008;
+    constexpr uint32_t VECTOR_E131_DATA_PACKET = 0x00000002;
+    constexpr uint32_t VECTOR_E131_EXTENDED_SYNCHRONIZATION = 0x00000001;
+    constexpr uint8_t E131_OPTION_PREVIEW = 0x80;
+    constexpr uint8_t E131_OPTION_TERMINATED = 0x40;
+    constexpr uint8_t ACN_IDENTIFIER[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+
+    // Art-Net offsets and op codes (Art-Net 4)
+    constexpr size_t ARTNET_OPCODE = 8;
+    constexpr size_t ARTNET_SEQUENCE = 12;
+    constexpr size_t ARTNET_SUBUNI = 14;
+    constexpr size_t ARTNET_NET = 15;
+    constexpr size_t ARTNET_LENGTH = 16;
+    constexpr size_t ARTNET_DATA = 18;
+    constexpr uint16_t ARTNET_OP_DMX = 0x5000;
+    constexpr uint16_t ARTNET_OP_SYNC = 0x5200;
+    constexpr uint8_t ARTNET_ID[8] = {'A', 'r', 't', '-', 'N', 'e', 't', 0};
+
+    inline uint16_t read_be16(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    inline uint32_t read_be32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    inline void write_be16(uint8_t* p, uint16_t v) {
+        p[0] = static_cast<uint8_t>(v >> 8);
+        p[1] = static_cast<uint8_t>(v);
+    }
+
+    inline void write_be32(uint8_t* p, uint32_t v) {
+        p[0] = static_cast<uint8_t>(v >> 24);
+        p[1] = static_cast<uint8_t>(v >> 16);
+        p[2] = static_cast<uint8_t>(v >> 8);
+        p[3] = static_cast<uint8_t>(v);
+    }
+
+
+    /**
+     * @brief Build an E1.31 data packet (e.g. for tests or a sender).
+     *
+     * @param out buffer of at least E131_DATA + data.size() bytes
+     * @return packet length, or 0 if `out` is too small or there are more than 512 channels
+     */
+    inline size_t build_e131_data(etl::span<uint8_t> out, uint16_t universe, uint8_t sequence,
+                                  etl::span<const uint8_t> data, uint16_t sync_address = 0) {
+        if (data.size() > MAX_CHANNELS || out.size() < E131_DATA + data.size()) {
+            return 0;
+        }
+        uint8_t* p = out.data();
+        size_t len = E131_DATA + data.size();
+        std::memset(p, 0, E131_DATA);
+        write_be16(p + 0, 0x0010);
+        std::memcpy(p + 4, ACN_IDENTIFIER, sizeof(ACN_IDENTIFIER));
+        write_be16(p + 16, static_cast<uint16_t>(0x7000 | (len - 16)));
+        write_be32(p + E131_ROOT_VECTOR, VECTOR_ROOT_E131_DATA);
+        write_be16(p + 38, static_cast<uint16_t>(0x7000 | (len - 38)));
+        write_be32(p + E131_FRAMING_VECTOR, VECTOR_E131_DATA_PACKET);
+        std::memcpy(p + 44, "LightDancer", 11);
+        p[108] = 100; // priority
+        write_be16(p + E131_SYNC_ADDRESS, sync_address);
+        p[E131_SEQUENCE] = sequence;
+        write_be16(p + E131_UNIVERSE, universe);
+        write_be16(p + 115, static_cast<uint16_t>(0x7000 | (len - 115)));
+        p[117] = 0x02;
+        p[118] = 0xa1;
+        write_be16(p + 121, 1);
+        write_be16(p + E131_PROPERTY_COUNT, static_cast<uint16_t>(data.size() + 1));
+        std::memcpy(p + E131_DATA, data.data(), data.size());
+        return len;
+    }
+
+    /**
+     * @brief Build an E1.31 synchronisation packet.
+     *
+     * @return packet length, or 0 if `out` is too small
+     */
+    inline size_t build_e131_sync(etl::span<uint8_t> out, uint16_t sync_address, uint8_t sequence) {
+        if (out.size() < E131_SYNC_SIZE) {
+            return 0;
+        }
+        uint8_t* p = out.data();
+        std::memset(p, 0, E131_SYNC_SIZE);
+        write_be16(p + 0, 0x0010);
+        std::memcpy(p + 4, ACN_IDENTIFIER, sizeof(ACN_IDENTIFIER));
+        write_be16(p + 16, static_cast<uint16_t>(0x7000 | (E131_SYNC_SIZE - 16)));
+        write_be32(p + E131_ROOT_VECTOR, VECTOR_ROOT_E131_EXTENDED);
+        write_be16(p + 38, static_cast<uint16_t>(0x7000 | (E131_SYNC_SIZE - 38)));
+        write_be32(p + E131_FRAMING_VECTOR, VECTOR_E131_EXTENDED_SYNCHRONIZATION);
+        p[E131_SYNC_SEQUENCE] = sequence;
+        write_be16(p + E131_SYNC_UNIVERSE, sync_address);
+        return E131_SYNC_SIZE;
+    }
+
+    /**
+     * @brief Build an Art-Net ArtDmx packet.
+     *
+     * @param universe 15-bit port address (Net:SubNet:Universe)
+     * @return packet length, or 0 if `out` is too small or there are more than 512 channels
+     */
+    inline size_t build_artnet_dmx(etl::span<uint8_t> out, uint16_t universe, uint8_t sequence,
+                                   etl::span<const uint8_t> data) {
+        size_t channels = data.size() + (data.size() & 1); // length must be even
+        if (channels > MAX_CHANNELS || out.size() < ARTNET_DATA + channels) {
+            return 0;
+        }
+        uint8_t* p = out.data();
+        std::memcpy(p, ARTNET_ID, sizeof(ARTNET_ID));
+        p[ARTNET_OPCODE] = static_cast<uint8_t>(ARTNET_OP_DMX);
+        p[ARTNET_OPCODE + 1] = static_cast<uint8_t>(ARTNET_OP_DMX >> 8);
+        p[10] = 0;
+        p[11] = 14;
+        p[ARTNET_SEQUENCE] = sequence;
+        p[13] = 0;
+        p[ARTNET_SUBUNI] = static_cast<uint8_t>(universe);
+        p[ARTNET_NET] = static_cast<uint8_t>((universe >> 8) & 0x7F);
+        write_be16(p + ARTNET_LENGTH, static_cast<uint16_t>(channels));
+        std::memcpy(p + ARTNET_DATA, data.data(), data.size());
+        if (channels != data.size()) {
+            p[ARTNET_DATA + data.size()] = 0;
+        }
+        return ARTNET_DATA + channels;
+    }
+
+    /**
+     * @brief Build an Art-Net ArtSync packet.
+     *
+     * @return packet length, or 0 if `out` is too small
+     */
+    inline size_t build_artnet_sync(etl::span<uint8_t> out) {
+        if (out.size() < 14) {
+            return 0;
+        }
+        uint8_t* p = out.data();
+        std::memset(p, 0, 14);
+        std::memcpy(p, ARTNET_ID, sizeof(ARTNET_ID));
+        p[ARTNET_OPCODE] = static_cast<uint8_t>(ARTNET_OP_SYNC);
+        p[ARTNET_OPCODE + 1] = static_cast<uint8_t>(ARTNET_OP_SYNC >> 8);
+        p[11] = 14;
+        return 14;
+    }
+}
+
+
+/**
+ * @brief Parses E1.31 and Art-Net packets and writes their pixels into a `FrameSwapChain`.
+ *
+ * Not thread-safe: call `on_packet` from one context (e.g. the lwIP callback).
+ */
+class DmxReceiver {
+
+    public:
+
+    /**
+     * @brief What `on_packet` did with a packet.
+     */
+    enum class Result {
+        Data,       /// pixels written to the back buffer
+        Latched,    /// pixels written (if any) and the frame presented
+        Ignored,    /// valid but not for us (other universe, preview data, non-zero start code, ...)
+        Invalid     /// not E1.31 or Art-Net, or malformed
+    };
+
+    /**
+     * @brief Counters, e.g. for instrumentation.
+     */
+    struct Stats {
+        uint32_t packets = 0;
+        uint32_t invalid = 0;
+        uint32_t ignored = 0;
+        uint32_t out_of_order = 0;   /// E1.31 packets discarded by sequence number
+        uint32_t latched = 0;        /// frames presented
+        uint32_t partial = 0;        /// frames presented with universes missing
+        uint32_t syncs = 0;
+    };
+
+
+    private:
+
+    FrameSwapChain& chain_;
+    uint16_t first_universe_;
+    uint16_t num_universes_;
+    uint16_t pixels_per_universe_;
+
+    uint64_t received_ = 0;             // bit per universe received since the last latch
+    uint64_t all_universes_;
+    bool synced_ = false;               // sender uses sync packets, latch on those only
+    uint8_t sequence_[dmx::MAX_UNIVERSES] = {};
+    bool has_sequence_[dmx::MAX_UNIVERSES] = {};
+    Stats stats_;
+
+
+    Result latch(bool partial) {
+        chain_.present();
+        received_ = 0;
+        stats_.latched++;
+        if (partial) {
+            stats_.partial++;
+        }
+        return Result::Latched;
+    }
+
+    Result ignored() {
+        stats_.ignored++;
+        return Result::Ignored;
+    }
+
+    Result invalid() {
+        stats_.invalid++;
+        return Result::Invalid;
+    }
+
+    // copy `channels` into the pixels of `universe`, latching if this completes the frame
+    Result on_dmx(uint16_t universe, const uint8_t* channels, size_t count) {
+        if (universe < first_universe_ || universe - first_universe_ >= num_universes_) {
+            return ignored();
+        }
+        unsigned int u = universe - first_universe_;
+
+        // a universe repeating before the frame is complete means packets were lost: show what
+        // we have rather than stalling
+        Result result = Result::Data;
+        uint64_t bit = 1ull << u;
+        if (!synced_ && (received_ & bit)) {
+            latch(true);
+            result = Result::Latched;
+        }
+
+        Frame& frame = chain_.back();
+        unsigned int first_pixel = u * pixels_per_universe_;
+        if (first_pixel < frame.num_leds) {
+            size_t pixels = std::min<size_t>({count / 3, pixels_per_universe_, frame.num_leds - first_pixel});
+            std::memcpy(&frame.data[first_pixel], channels, pixels * sizeof(RGBValue));
+        }
+        received_ |= bit;
+
+        if (!synced_ && received_ == all_universes_) {
+            return latch(false);
+        }
+        return result;
+    }
+
+    Result on_sync() {
+        stats_.syncs++;
+        synced_ = true;
+        // nothing new since the last latch: presenting would show the frame before last
+        if (received_ == 0) {
+            return ignored();
+        }
+        return latch(false);
+    }
+
+    // E1.31 sequence check (E1.31-2016 6.7.2): discard if -20 < new - last <= 0
+    bool in_order(unsigned int u, uint8_t sequence) {
+        if (has_sequence_[u]) {
+            int8_t diff = static_cast<int8_t>(sequence - sequence_[u]);
+            if (diff <= 0 && diff > -20) {
+                return false;
+            }
+        }
+        sequence_[u] = sequence;
+        has_sequence_[u] = true;
+        return true;
+    }
+
+    Result on_e131(const uint8_t* p, size_t len) {
+        using namespace dmx;
+        if (len < E131_SYNC_SIZE || read_be16(p) != 0x0010 ||
+            std::memcmp(p + 4, ACN_IDENTIFIER, sizeof(ACN_IDENTIFIER)) != 0) {
+            return invalid();
+        }
+
+        uint32_t root_vector = read_be32(p + E131_ROOT_VECTOR);
+        if (root_vector == VECTOR_ROOT_E131_EXTENDED) {
+            if (read_be32(p + E131_FRAMING_VECTOR) != VECTOR_E131_EXTENDED_SYNCHRONIZATION) {
+                return ignored(); // e.g. universe discovery
+            }
+            return on_sync();
+        }
+        if (root_vector != VECTOR_ROOT_E131_DATA || len < E131_DATA ||
+            read_be32(p + E131_FRAMING_VECTOR) != VECTOR_E131_DATA_PACKET) {
+            return invalid();
+        }
+
+        uint16_t count = read_be16(p + E131_PROPERTY_COUNT);
+        if (count == 0 || count - 1u > MAX_CHANNELS || E131_DATA + count - 1u > len) {
+            return invalid();
+        }
+        uint8_t options = p[E131_OPTIONS];
+        uint16_t universe = read_be16(p + E131_UNIVERSE);
+        if ((options & (E131_OPTION_PREVIEW | E131_OPTION_TERMINATED)) || p[E131_START_CODE] != 0) {
+            return ignored();
+        }
+        if (universe >= first_universe_ && universe - first_universe_ < num_universes_ &&
+            !in_order(universe - first_universe_, p[E131_SEQUENCE])) {
+            stats_.out_of_order++;
+            return Result::Ignored;
+        }
+        if (read_be16(p + E131_SYNC_ADDRESS) != 0) {
+            synced_ = true;
+        }
+        return on_dmx(universe, p + E131_DATA, count - 1u);
+    }
+
+    Result on_artnet(const uint8_t* p, size_t len) {
+        using namespace dmx;
+        if (len < 12 || std::memcmp(p, ARTNET_ID, sizeof(ARTNET_ID)) != 0) {
+            return invalid();
+        }
+        uint16_t opcode = static_cast<uint16_t>(p[ARTNET_OPCODE] | (p[ARTNET_OPCODE + 1] << 8));
+        if (opcode == ARTNET_OP_SYNC) {
+            return on_sync();
+        }
+        if (opcode != ARTNET_OP_DMX) {
+            return ignored(); // e.g. ArtPoll
+        }
+        if (len < ARTNET_DATA) {
+            return invalid();
+        }
+        uint16_t channels = read_be16(p + ARTNET_LENGTH);
+        if (channels > MAX_CHANNELS || ARTNET_DATA + channels > len) {
+            return invalid();
+        }
+        uint16_t universe = static_cast<uint16_t>(p[ARTNET_SUBUNI] | ((p[ARTNET_NET] & 0x7F) << 8));
+        return on_dmx(universe, p + ARTNET_DATA, channels);
+    }
+
+
+    public:
+
+    /**
+     * @param chain frames to write into
+     * @param first_universe universe of the first pixel (E1.31 universes start at 1, Art-Net at 0)
+     * @param num_universes number of universes to map (<= 64)
+     * @param pixels_per_universe pixels in each universe (<= 170)
+     */
+    DmxReceiver(FrameSwapChain& chain, uint16_t first_universe, uint16_t num_universes,
+                uint16_t pixels_per_universe = 170)
+        : chain_(chain),
+          first_universe_(first_universe),
+          num_universes_(std::min<uint16_t>(num_universes, dmx::MAX_UNIVERSES)),
+          pixels_per_universe_(std::min<uint16_t>(pixels_per_universe, dmx::MAX_CHANNELS / 3)),
+          all_universes_(num_universes_ >= 64 ? ~0ull : (1ull << num_universes_) - 1) {
+    }
+
+    /**
+     * @brief Number of universes needed for `num_leds` LEDs at `pixels_per_universe`.
+     */
+    static constexpr uint16_t universes_for(unsigned int num_leds, uint16_t pixels_per_universe = 170) {
+        return static_cast<uint16_t>((num_leds + pixels_per_universe - 1) / pixels_per_universe);
+    }
+
+    /**
+     * @brief Handle one UDP payload (E1.31 or Art-Net, detected from its content).
+     */
+    Result on_packet(etl::span<const uint8_t> packet) {
+        stats_.packets++;
+        if (packet.size() >= 8 && packet[0] == 'A' && packet[1] == 'r') {
+            return on_artnet(packet.data(), packet.size());
+        }
+        return on_e131(packet.data(), packet.size());
+    }
+
+    /**
+     * @brief True once the sender has used sync packets, after which frames latch on sync only.
+     */
+    bool is_synced() const {
+        return synced_;
+    }
+
+    uint16_t first_universe() const {
+        return first_universe_;
+    }
+
+    uint16_t num_universes() const {
+        return num_universes_;
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+};
+
+
+#endif // DMX_RECEIVER_H
@@ -0,0 +1,67 @@
+#include "dmx_udp_pico.h"
+#include "wifi_pico.h"
+
+#include <cstdlib>
+#include <cstdio>
+
+extern "C" {
+#include "pico/cyw43_arch.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/igmp.h"
+}
+
+static uint8_t packet_buffer[dmx::E131_DATA + dmx::MAX_CHANNELS]; // only for chained pbufs
+
+
+//
+// lwIP receive callback, runs in the background (IRQ) context
+//
+static void on_udp(void* arg, struct udp_pcb*, struct pbuf* p, const ip_addr_t*, u16_t) {
+    DmxReceiver* receiver = static_cast<DmxReceiver*>(arg);
+
+    // a DMX packet normally fits in one pbuf, so parse it in place; copy only if lwIP chained it
+    if (p->len == p->tot_len) {
+        receiver->on_packet(etl::span<const uint8_t>(static_cast<const uint8_t*>(p->payload), p->len));
+    } else {
+        u16_t len = pbuf_copy_partial(p, packet_buffer, sizeof(packet_buffer), 0);
+        receiver->on_packet(etl::span<const uint8_t>(packet_buffer, len));
+    }
+    pbuf_free(p);
+}
+
+
+//
+// bind a UDP port to the receiver or die
+//
+static void listen(DmxReceiver& receiver, u16_t port) {
+    struct udp_pcb* pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    if (pcb == nullptr || udp_bind(pcb, IP_ANY_TYPE, port) != ERR_OK) {
+        printf("DMX: can't listen on UDP port %u\n", port);
+        std::abort();
+    }
+    udp_recv(pcb, on_udp, &receiver);
+}
+
+
+//
+// dmx_udp_start
+//
+void dmx_udp_start(DmxReceiver& receiver, const char* ssid, const char* password) {
+    wifi_join(ssid, password);
+
+    cyw43_arch_lwip_begin();
+    listen(receiver, dmx::E131_PORT);
+    listen(receiver, dmx::ARTNET_PORT);
+    // E1.31 senders multicast universe u to 239.255.u_hi.u_lo
+    for (uint16_t u = 0; u < receiver.num_universes(); u++) {
+        uint16_t universe = receiver.first_universe() + u;
+        ip4_addr_t group;
+        IP4_ADDR(&group, 239, 255, universe >> 8, universe & 0xFF);
+        igmp_joingroup_netif(netif_list, &group);
+    }
+    cyw43_arch_lwip_end();
+
+    printf("DMX: listening for universes %u-%u\n", receiver.first_universe(),
+           receiver.first_universe() + receiver.num_universes() - 1);
+}
@@ -0,0 +1,26 @@
+/**
+ * @file dmx_udp_pico.h
+ * @brief Pico W glue: receive E1.31 and Art-Net over Wi-Fi (lwIP) into a `DmxReceiver`.
+ *
+ * Only built with -DLIGHTDANCER_NETWORK=ON (see CMakeLists.txt).
+ */
+#ifndef DMX_UDP_PICO_H
+#define DMX_UDP_PICO_H
+
+#include "dmx_receiver.h"
+
+
+/**
+ * @brief Join a Wi-Fi network and listen for E1.31 (port 5568) and Art-Net (port 6454).
+ *
+ * Packets are handed to `receiver` from the lwIP background context, so `receiver` and its
+ * `FrameSwapChain` must outlive the program (make them static). Joins Wi-Fi with `wifi_join`.
+ *
+ * @param receiver receiver to pass each UDP payload to
+ * @param ssid Wi-Fi network name
+ * @param password Wi-Fi password (WPA2)
+ */
+void dmx_udp_start(DmxReceiver& receiver, const char* ssid, const char* password);
+
+
+#endif // DMX_UDP_PICO_H
@@ -0,0 +1,33 @@
+#include "wifi_pico.h"
+
+#include <cstdlib>
+#include <cstdio>
+
+extern "C" {
+#include "pico/cyw43_arch.h"
+}
+
+constexpr uint32_t wifi_timeout_ms = 30'000;
+
+static bool joined = false;
+
+
+//
+// wifi_join
+//
+void wifi_join(const char* ssid, const char* password) {
+    if (joined) {
+        return;
+    }
+    if (cyw43_arch_init() != 0) {
+        printf("Wi-Fi: init failed\n");
+        std::abort();
+    }
+    cyw43_arch_enable_sta_mode();
+    if (cyw43_arch_wifi_connect_timeout_ms(ssid, password, CYW43_AUTH_WPA2_AES_PSK, wifi_timeout_ms) != 0) {
+        printf("Wi-Fi: can't join network %s\n", ssid);
+        std::abort();
+    }
+    joined = true;
+    printf("Wi-Fi: joined %s as %s\n", ssid, ip4addr_ntoa(netif_ip4_addr(netif_list)));
+}
@@ -0,0 +1,18 @@
+/**
+ * @file wifi_pico.h
+ * @brief Pico W: join a Wi-Fi network once, for everything that uses the network (DMX, sync).
+ */
+#ifndef WIFI_PICO_H
+#define WIFI_PICO_H
+
+
+/**
+ * @brief Initialise the CYW43 and join a WPA2 network. Calls after the first are no-ops.
+ *
+ * Aborts if Wi-Fi can't be initialised or joined, like the LED drivers do when their hardware is
+ * unavailable.
+ */
+void wifi_join(const char* ssid, const char* password);
+
+
+#endif // WIFI_PICO_H
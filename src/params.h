@@ -0,0 +1,222 @@
+/**
+ * @file params.h
+ * @brief Runtime parameter blocks: effect speeds, colours and analysis thresholds that can be
+ * changed on site (over UART, see serial/param_command.h) without reflashing.
+ *
+ * Each effect and analysis stage has a fixed-layout `Params` struct (e.g. `LaserEffect::Params`,
+ * `PowerPolicyParams`). A `ParamBlock<T>` holds two copies of one: the live copy the engine reads
+ * and a shadow copy that commands write. A committed shadow is copied over the live copy by
+ * `ParamStore::apply()` at the frame boundary, so an effect never sees half an update and the
+ * render loop never waits for a command. With nothing committed, `apply()` is one atomic load.
+ *
+ * ```cpp
+ * static ParamBlock<LaserEffect::Params> laser_params;
+ * static ParamStore params;
+ * params.add(1, laser_params);
+ * // each frame, before drawing
+ * if (params.apply()) {
+ *     effect_factory.set_params<LaserEffect>(laser_params.get());
+ * }
+ * ```
+ *
+ * Commands (`write`, `commit`, `read`) come from one context, e.g. a UART IRQ; `apply()` from the
+ * render loop, on the same core or the other. A block can't be written between its commit and the
+ * next `apply()` (`Busy`), so the two never touch the same copy at once.
+ */
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include "etl/array.h"
+#include "etl/span.h"
+
+
+/**
+ * @brief Live and shadow copies of a parameter struct `T`, which is written as bytes: it must be
+ * trivially copyable with a standard layout (plain fields, no pointers).
+ */
+template <typename T>
+class ParamBlock {
+
+    static_assert(std::is_trivially_copyable<T>::value && std::is_standard_layout<T>::value,
+                  "parameter blocks are written as bytes");
+
+    private:
+
+    T live_;
+    T shadow_;
+
+    friend class ParamStore;
+
+
+    public:
+
+    explicit ParamBlock(const T& initial = T{}) : live_(initial), shadow_(initial) {
+    }
+
+    ParamBlock(const ParamBlock&) = delete;
+
+    /**
+     * @brief The live parameters, for the render loop.
+     */
+    const T& get() const {
+        return live_;
+    }
+};
+
+
+/**
+ * @brief The parameter blocks of a build, by id, and the commit/apply handshake between the
+ * command side and the render loop.
+ */
+class ParamStore {
+
+    public:
+
+    static constexpr size_t MAX_BLOCKS = 16;
+
+    enum class Status : uint8_t {
+        Ok = 0,
+        UnknownBlock = 1,
+        BadRange = 2,       /// offset and length past the end of the block
+        Busy = 3,           /// committed and not applied yet: try again after the next frame
+    };
+
+
+    private:
+
+    struct Slot {
+        uint8_t id;
+        uint16_t size;
+        uint8_t* live;
+        uint8_t* shadow;
+        std::atomic<bool> pending;
+    };
+
+    etl::array<Slot, MAX_BLOCKS> slots_ {};
+    size_t count_ = 0;
+    std::atomic<uint32_t> commits_ {0};     // written by the command side only
+    uint32_t applied_ = 0;                  // commits seen by `apply`, render loop only
+
+    Slot* find(uint8_t id) {
+        for (size_t i = 0; i < count_; i++) {
+            if (slots_[i].id == id) {
+                return &slots_[i];
+            }
+        }
+        return nullptr;
+    }
+
+
+    public:
+
+    ParamStore() = default;
+    ParamStore(const ParamStore&) = delete;
+
+    /**
+     * @brief Register `block` as `id`. The block must outlive the store.
+     *
+     * @return false if the id is taken or the store is full
+     */
+    template <typename T>
+    bool add(uint8_t id, ParamBlock<T>& block) {
+        static_assert(sizeof(T) <= UINT16_MAX, "parameter block too big");
+        if (count_ == MAX_BLOCKS || find(id) != nullptr) {
+            return false;
+        }
+        Slot& slot = slots_[count_++];
+        slot.id = id;
+        slot.size = static_cast<uint16_t>(sizeof(T));
+        slot.live = reinterpret_cast<uint8_t*>(&block.live_);
+        slot.shadow = reinterpret_cast<uint8_t*>(&block.shadow_);
+        slot.pending.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Size of block `id` in bytes, or 0 if there's no such block.
+     */
+    uint16_t size(uint8_t id) {
+        Slot* slot = find(id);
+        return slot != nullptr ? slot->size : 0;
+    }
+
+    // command side
+
+    /**
+     * @brief Write `data` into the shadow copy of block `id` from byte `offset`.
+     */
+    Status write(uint8_t id, uint16_t offset, etl::span<const uint8_t> data) {
+        Slot* slot = find(id);
+        if (slot == nullptr) {
+            return Status::UnknownBlock;
+        }
+        if (offset + data.size() > slot->size) {
+            return Status::BadRange;
+        }
+        if (slot->pending.load(std::memory_order_acquire)) {
+            return Status::Busy;
+        }
+        std::memcpy(slot->shadow + offset, data.data(), data.size());
+        return Status::Ok;
+    }
+
+    /**
+     * @brief Make the shadow copy of block `id` live at the next `apply()`.
+     */
+    Status commit(uint8_t id) {
+        Slot* slot = find(id);
+        if (slot == nullptr) {
+            return Status::UnknownBlock;
+        }
+        slot->pending.store(true, std::memory_order_release);
+        commits_.store(commits_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        return Status::Ok;
+    }
+
+    /**
+     * @brief Copy `out.size()` bytes of the shadow copy of block `id` from `offset`: the live
+     * values, plus any writes not committed yet.
+     */
+    Status read(uint8_t id, uint16_t offset, etl::span<uint8_t> out) {
+        Slot* slot = find(id);
+        if (slot == nullptr) {
+            return Status::UnknownBlock;
+        }
+        if (offset + out.size() > slot->size) {
+            return Status::BadRange;
+        }
+        std::memcpy(out.data(), slot->shadow + offset, out.size());
+        return Status::Ok;
+    }
+
+    // render loop
+
+    /**
+     * @brief At the frame boundary: make committed blocks live.
+     *
+     * @return true if any block changed, so the engine passes the new values on
+     */
+    bool apply() {
+        const uint32_t commits = commits_.load(std::memory_order_acquire);
+        if (commits == applied_) {
+            return false;
+        }
+        applied_ = commits;
+        for (size_t i = 0; i < count_; i++) {
+            Slot& slot = slots_[i];
+            if (slot.pending.load(std::memory_order_acquire)) {
+                std::memcpy(slot.live, slot.shadow, slot.size);
+                slot.pending.store(false, std::memory_order_release);
+            }
+        }
+        return true;
+    }
+};
+
+
+#endif // PARAMS_H
@@ -0,0 +1,214 @@
+/**
+ * @file power_policy.h
+ * @brief Silence-aware power states: full rate while there's sound, throttled between sets.
+ *
+ * Every audio block (`Config::fft_hop` new samples) is measured with `EnvelopeFollower` and
+ * `NoiseFloor` (audio_level.h), which is cheap enough to run even when the FFT is not. Sound is
+ * an envelope clearly above the noise floor (or above an absolute level). After
+ * `hold_blocks` of silence the policy goes `Idle`: the FFT only runs on every
+ * `idle_fft_divider`-th block, frames drop to a keep-alive rate, and the LED driver's PIO is
+ * gated between frames. The first block with sound goes straight back to `Active`, so full rate
+ * returns within one audio block.
+ *
+ * No hardware access: an application applies `settings()`, so the policy can be tested with
+ * recorded audio on the host. It isn't wired into main.cpp until there's an audio capture driver
+ * to feed it blocks, so for now nothing throttles the FFT or frame rate or calls
+ * `WS2811Pio::set_enabled(false)`.
+ */
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <stdint.h>
+#include "etl/span.h"
+#include "config.h"
+#include "audio_level.h"
+
+
+namespace power_policy {
+
+    /// silence before going idle
+    constexpr uint32_t HOLD_US = 10'000'000;
+
+    /**
+     * @brief Length of one audio block (`Config::fft_hop` samples) in µs.
+     */
+    template <typename Config>
+    constexpr uint32_t block_us() {
+        return static_cast<uint32_t>(static_cast<uint64_t>(Config::fft_hop) * 1'000'000 / Config::audio_rate_hz);
+    }
+}
+
+
+/**
+ * @brief Tunables for `PowerPolicy`. Levels are mean absolute sample values (0..32767).
+ *
+ * Block counts depend on the audio block length: the defaults are for `LightDancerConfig`, start
+ * from `PowerPolicy<Config>::default_params()` for another configuration.
+ */
+struct PowerPolicyParams {
+    uint16_t min_level = 40;            /// below this is always silence (~-58 dBFS)
+    uint16_t max_floor = 1000;          /// above this is always sound (~-30 dBFS)
+    uint8_t floor_ratio_shift = 1;      /// sound is envelope > floor * 2^shift (+6 dB)
+    /// silence before going idle (10s)
+    uint32_t hold_blocks = power_policy::HOLD_US / power_policy::block_us<LightDancerConfig>();
+    uint16_t idle_fft_divider = 16;     /// run the FFT on 1 in this many blocks when idle
+    uint32_t active_frame_period_us = 16'667;
+    uint32_t idle_frame_period_us = 500'000;   /// keep-alive
+};
+
+
+/**
+ * @brief What the pipeline should do in the current power state.
+ */
+struct PowerSettings {
+    uint16_t fft_divider;        /// run the FFT on 1 in this many audio blocks
+    uint32_t frame_period_us;    /// time between frames
+    bool gate_leds;              /// stop the LED driver's PIO between frames
+};
+
+
+/**
+ * @brief Power state machine driven by audio activity.
+ *
+ * @param Config pipeline configuration (block size is `Config::fft_hop`)
+ */
+template <typename Config>
+class PowerPolicy {
+
+    public:
+
+    enum class State : uint8_t {
+        Active,     /// sound: full rate
+        Hangover,   /// silence for less than `hold_blocks`: still full rate, e.g. a pause in a track
+        Idle        /// low power
+    };
+
+    struct Stats {
+        uint32_t blocks = 0;
+        uint32_t idle_blocks = 0;
+        uint32_t ffts = 0;
+        uint32_t wakeups = 0;   /// Idle -> Active
+    };
+
+
+    private:
+
+    PowerPolicyParams params_;
+    EnvelopeFollower<> envelope_;
+    NoiseFloor<> floor_;
+    State state_ = State::Active;
+    uint32_t silent_blocks_ = 0;
+    uint16_t fft_phase_ = 0;
+    Stats stats_;
+
+    bool is_sound(uint16_t envelope, uint16_t floor) const {
+        if (envelope < params_.min_level) {
+            return false;
+        }
+        if (envelope > params_.max_floor) {
+            return true;
+        }
+        uint32_t threshold = static_cast<uint32_t>(floor) << params_.floor_ratio_shift;
+        return envelope > threshold;
+    }
+
+
+    public:
+
+    /**
+     * @brief The default tunables, with `hold_blocks` for this configuration's audio blocks.
+     */
+    static PowerPolicyParams default_params() {
+        PowerPolicyParams params;
+        params.hold_blocks = power_policy::HOLD_US / block_us();
+        return params;
+    }
+
+    explicit PowerPolicy(const PowerPolicyParams& params = default_params())
+        : params_(params), floor_(params.max_floor) {
+        set_params(params);
+    }
+
+    const PowerPolicyParams& params() const {
+        return params_;
+    }
+
+    /**
+     * @brief New tunables, e.g. from a parameter block (see params.h). The state is kept.
+     */
+    void set_params(const PowerPolicyParams& params) {
+        params_ = params;
+        params_.idle_fft_divider = params_.idle_fft_divider > 0 ? params_.idle_fft_divider : 1;
+        fft_phase_ = static_cast<uint16_t>(fft_phase_ % params_.idle_fft_divider);
+    }
+
+    /**
+     * @brief Measure the next audio block and update the state.
+     *
+     * @param samples the block's new samples (`Config::fft_hop` of them)
+     * @return true if the FFT should run for this block
+     */
+    bool on_audio_block(etl::span<const int16_t> samples) {
+        uint16_t level = block_level(samples);
+        // the envelope reacts within this block; the floor is updated after the decision so a
+        // sudden loud block can't raise its own threshold
+        uint16_t envelope = envelope_.update(level);
+        bool sound = is_sound(envelope, floor_.value());
+        floor_.update(level);
+        stats_.blocks++;
+
+        if (sound) {
+            if (state_ == State::Idle) {
+                stats_.wakeups++;
+                fft_phase_ = 0;
+            }
+            state_ = State::Active;
+            silent_blocks_ = 0;
+        } else if (state_ != State::Idle) {
+            silent_blocks_++;
+            state_ = silent_blocks_ >= params_.hold_blocks ? State::Idle : State::Hangover;
+        }
+
+        bool run_fft = true;
+        if (state_ == State::Idle) {
+            stats_.idle_blocks++;
+            run_fft = fft_phase_ == 0;
+            fft_phase_ = static_cast<uint16_t>((fft_phase_ + 1) % params_.idle_fft_divider);
+        }
+        stats_.ffts += run_fft ? 1 : 0;
+        return run_fft;
+    }
+
+    PowerSettings settings() const {
+        if (state_ == State::Idle) {
+            return {params_.idle_fft_divider, params_.idle_frame_period_us, true};
+        }
+        return {1, params_.active_frame_period_us, false};
+    }
+
+    State state() const {
+        return state_;
+    }
+
+    uint16_t envelope() const {
+        return envelope_.value();
+    }
+
+    uint16_t noise_floor() const {
+        return floor_.value();
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+
+    /**
+     * @brief Length of one audio block in µs, e.g. to convert block counts to time.
+     */
+    static constexpr uint32_t block_us() {
+        return power_policy::block_us<Config>();
+    }
+};
+
+
+#endif // POWER_POLICY_H
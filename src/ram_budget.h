@@ -0,0 +1,176 @@
+/**
+ * @file ram_budget.h
+ * @brief Whole-system RAM budget of a `PipelineConfig`, checked at compile-time.
+ *
+ * RAM is split as described in README.md: statics (.data/.bss) in main SRAM, and each core's
+ * stack in its own 4K scratch bank. `RamBudget` adds up what each subsystem needs in each region
+ * and `static_assert`s it against the region's size, so an over-sized configuration fails to
+ * build rather than hard-faulting after flashing.
+ *
+ * Core 0 renders effects and drives the LEDs, Core 1 runs audio analysis. Core 1's scratch arena
+ * (arena.h) holds the FFT's working buffer, which would otherwise take a quarter of its stack. Core
+ * 0's arena isn't counted: nothing allocates from it, and a `CoreArenas` member is only in .bss
+ * once it's used. Add it here when something does.
+ *
+ * Buffers only linked into some builds are only counted in those builds, e.g. the DMX receiver's
+ * swap chain with `LIGHTDANCER_NETWORK`, the serial stream's with `LIGHTDANCER_SERIAL_STREAM` or
+ * the parameter blocks with `LIGHTDANCER_PARAM_UART`, so define the same options when including
+ * this.
+ */
+#ifndef RAM_BUDGET_H
+#define RAM_BUDGET_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "etl/array.h"
+#include "config.h"
+#include "draw.h"
+#include "leds/led_protocol.h"
+#include "effects/effect_factory.h"
+#include "effects/periodic_cache.h"
+#if defined(LIGHTDANCER_NETWORK) || defined(LIGHTDANCER_SERIAL_STREAM)
+#include "swap_chain.h"
+#endif
+#ifdef LIGHTDANCER_PARAM_UART
+#include "frame_scheduler.h"
+#include "params.h"
+#endif
+
+
+/**
+ * @brief RAM available on the RP2040 with the SDK's default linker script.
+ */
+struct RP2040Memory {
+    static constexpr size_t static_bytes = 256 * 1024;  /// main SRAM for .data, .bss & heap
+    static constexpr size_t core0_stack_bytes = 4 * 1024; /// SCRATCH_Y
+    static constexpr size_t core1_stack_bytes = 4 * 1024; /// SCRATCH_X
+    static constexpr size_t sdk_reserved_bytes = 16 * 1024; /// SDK, stdio, vector table, .data
+    static constexpr size_t call_overhead_bytes = 512; /// per-core frames of main/loop/IRQs
+};
+
+
+/**
+ * @brief Region of RAM a `RamBudget` item is allocated in.
+ */
+enum class RamRegion {
+    Static,     /// .data/.bss
+    Core0Stack,
+    Core1Stack
+};
+
+
+/**
+ * @brief RAM required by a pipeline configuration.
+ *
+ * Instantiating this (e.g. `static_assert(RamBudget<LightDancerConfig>::fits)`) fails the build
+ * if any region is over budget.
+ *
+ * @param Config a `PipelineConfig`
+ * @param Memory RAM available, e.g. `RP2040Memory`
+ * @param EffectStackBytes stack needed by the largest effect's `draw_frame`
+ */
+template <typename Config, typename Memory = RP2040Memory, size_t EffectStackBytes = 512>
+struct RamBudget {
+
+    /**
+     * @brief One line of the budget.
+     */
+    struct Item {
+        const char* name;
+        RamRegion region;
+        size_t bytes;
+    };
+
+    // .bss
+    static constexpr size_t frame_buffers = Config::frame_buffers * sizeof(Frame);
+    // PipelineFFT itself is empty: its twiddle and window tables are in flash
+    static constexpr size_t audio_buffers = Config::audio_blocks * Config::fft_n * sizeof(int16_t);
+    static constexpr size_t fft_magnitudes = Config::fft_bins * sizeof(uint16_t);
+    static constexpr size_t core1_arena = Config::core1_arena_bytes;   // FFT work buffer
+    static constexpr size_t led_wire_buffer = LedProtocol::frame_words(Config::leds_per_lane) * sizeof(uint32_t);
+    static constexpr size_t effects = sizeof(EffectFactory);    // largest effect, e.g. FireEffect's heat
+    static constexpr size_t periodic_cache = sizeof(PeriodicCache<Config::periodic_cache_bytes>);
+
+    // stack scratch
+    static constexpr size_t effect_scratch = EffectStackBytes;
+
+    // core 1 arena
+    static constexpr size_t fft_scratch = PipelineFFT<Config>::work_bytes;
+
+#ifdef LIGHTDANCER_NETWORK
+    static constexpr size_t dmx_frames = sizeof(FrameSwapChain);      // front and back frames
+#endif
+#ifdef LIGHTDANCER_SERIAL_STREAM
+    static constexpr size_t stream_frames = sizeof(FrameSwapChain);   // front and back frames
+#endif
+#ifdef LIGHTDANCER_PARAM_UART
+    // live and shadow copies of every block main.cpp registers
+    static constexpr size_t param_blocks =
+        sizeof(ParamBlock<LaserEffect::Params>) + sizeof(ParamBlock<BlinkEffect::Params>) +
+        sizeof(ParamBlock<SpectrumEffect::Params>) + sizeof(ParamBlock<WaterfallEffect::Params>) +
+        sizeof(ParamBlock<TwinkleEffect::Params>) + sizeof(ParamBlock<FireEffect::Params>) +
+        sizeof(ParamBlock<LodParams>);
+    static constexpr size_t param_store = sizeof(ParamStore);
+#endif
+
+    static constexpr Item items[] = {
+        {"sdk reserved",     RamRegion::Static,     Memory::sdk_reserved_bytes},
+        {"frame buffers",    RamRegion::Static,     frame_buffers},
+        {"audio buffers",    RamRegion::Static,     audio_buffers},
+        {"fft magnitudes",   RamRegion::Static,     fft_magnitudes},
+        {"core1 arena",      RamRegion::Static,     core1_arena},
+        {"led wire buffer",  RamRegion::Static,     led_wire_buffer},
+        {"effects",          RamRegion::Static,     effects},
+        {"periodic cache",   RamRegion::Static,     periodic_cache},
+#ifdef LIGHTDANCER_NETWORK
+        {"dmx frames",       RamRegion::Static,     dmx_frames},
+#endif
+#ifdef LIGHTDANCER_SERIAL_STREAM
+        {"stream frames",    RamRegion::Static,     stream_frames},
+#endif
+#ifdef LIGHTDANCER_PARAM_UART
+        {"param blocks",     RamRegion::Static,     param_blocks},
+        {"param store",      RamRegion::Static,     param_store},
+#endif
+        {"core0 call stack", RamRegion::Core0Stack, Memory::call_overhead_bytes},
+        {"effect scratch",   RamRegion::Core0Stack, effect_scratch},
+        {"core1 call stack", RamRegion::Core1Stack, Memory::call_overhead_bytes},
+    };
+
+    static constexpr size_t total(RamRegion region) {
+        size_t sum = 0;
+        for (const Item& item : items) {
+            if (item.region == region) {
+                sum += item.bytes;
+            }
+        }
+        return sum;
+    }
+
+    static constexpr size_t capacity(RamRegion region) {
+        switch (region) {
+            case RamRegion::Static: return Memory::static_bytes;
+            case RamRegion::Core0Stack: return Memory::core0_stack_bytes;
+            case RamRegion::Core1Stack: return Memory::core1_stack_bytes;
+        }
+        return 0;
+    }
+
+    static constexpr size_t static_total = total(RamRegion::Static);
+    static constexpr size_t core0_stack_total = total(RamRegion::Core0Stack);
+    static constexpr size_t core1_stack_total = total(RamRegion::Core1Stack);
+
+    static_assert(static_total <= Memory::static_bytes,
+                  "RAM budget: statics (.data/.bss) exceed main SRAM, reduce MaxLeds, FrameBuffers, FftN or AudioBlocks");
+    static_assert(core0_stack_total <= Memory::core0_stack_bytes,
+                  "RAM budget: Core 0 stack (effects & LED output) exceeds its scratch bank");
+    static_assert(core1_stack_total <= Memory::core1_stack_bytes,
+                  "RAM budget: Core 1 stack (audio analysis) exceeds its scratch bank");
+    static_assert(fft_scratch <= Config::core1_arena_bytes,
+                  "RAM budget: the FFT work buffer doesn't fit Core 1's arena, raise Core1ArenaBytes or reduce FftN");
+
+    static constexpr bool fits = true; // only reachable if the static_asserts pass
+};
+
+
+#endif // RAM_BUDGET_H
@@ -0,0 +1,258 @@
+/**
+ * @file frame_stream.h
+ * @brief Framed binary protocol for streaming whole LED frames from a host PC over UART or USB CDC.
+ *
+ * Packet (little endian):
+ *
+ *     | sync 0xA5 0x5A | type u8 | pixel count u16 | pixels (count * 3 bytes, R G B) | CRC-32 u32 |
+ *
+ * The CRC covers type, count and pixels. `FrameStreamReceiver` is the protocol core and does no
+ * I/O: the Pico feeds it by DMA (frame_stream_uart_pico.cpp), the host tests through a pty. Pixels
+ * are received straight into the back buffer of a `FrameSwapChain` and the chain is presented
+ * when the CRC checks, so receiving frame N+1 overlaps the LED driver sending frame N.
+ */
+#ifndef FRAME_STREAM_H
+#define FRAME_STREAM_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include "etl/span.h"
+#include "../draw.h"
+#include "../crc.h"
+#include "../swap_chain.h"
+
+static_assert(sizeof(RGBValue) == 3, "pixels are received straight into RGBValue frames");
+
+
+namespace frame_stream {
+
+    constexpr uint8_t SYNC[2] = {0xA5, 0x5A};
+    constexpr size_t HEADER_BYTES = 3;      // type, count
+    constexpr size_t CRC_BYTES = 4;
+    constexpr size_t OVERHEAD_BYTES = sizeof(SYNC) + HEADER_BYTES + CRC_BYTES;
+
+    /**
+     * @brief Packet types.
+     */
+    enum class Type : uint8_t {
+        Frame = 0x01   /// pixels from the first LED (count <= the receiver's LEDs, the rest keep old values)
+    };
+
+    constexpr size_t packet_bytes(unsigned int num_leds) {
+        return OVERHEAD_BYTES + num_leds * sizeof(RGBValue);
+    }
+
+    /**
+     * @brief Upper bound on frames/s over a UART (8N1, 10 bits per byte) for `num_leds`.
+     */
+    constexpr uint32_t max_fps(uint32_t baud, unsigned int num_leds) {
+        return static_cast<uint32_t>(baud / 10 / packet_bytes(num_leds));
+    }
+
+    /**
+     * @brief Encode a frame packet (host side, or for tests).
+     *
+     * @return packet length, or 0 if `out` is too small or there are more than 65535 pixels
+     */
+    inline size_t encode(etl::span<const RGBValue> pixels, etl::span<uint8_t> out) {
+        size_t len = packet_bytes(pixels.size());
+        if (pixels.size() > 0xFFFF || out.size() < len) {
+            return 0;
+        }
+        uint8_t* p = out.data();
+        p[0] = SYNC[0];
+        p[1] = SYNC[1];
+        p[2] = static_cast<uint8_t>(Type::Frame);
+        p[3] = static_cast<uint8_t>(pixels.size());
+        p[4] = static_cast<uint8_t>(pixels.size() >> 8);
+        std::memcpy(p + 5, pixels.data(), pixels.size_bytes());
+        uint32_t crc = Crc32().update(p + 2, HEADER_BYTES + pixels.size_bytes()).value();
+        uint8_t* c = p + 5 + pixels.size_bytes();
+        for (int i = 0; i < 4; i++) {
+            c[i] = static_cast<uint8_t>(crc >> (8 * i));
+        }
+        return len;
+    }
+}
+
+
+/**
+ * @brief Receives frame packets into a `FrameSwapChain`.
+ *
+ * Two ways to feed it:
+ * - `feed(bytes)` copies bytes from wherever they were read (host, USB CDC);
+ * - `rx_buffer()` says where the next bytes should go and how many are expected, and
+ *   `received(n)` is called once `n` bytes are there. During a packet's pixels `rx_buffer()` is the
+ *   back frame itself, so a DMA channel can receive straight into it without a copy.
+ *
+ * Corrupt packets (bad CRC, unknown type, too many pixels) are dropped and the receiver hunts for
+ * the next sync; the front frame is unaffected. Not thread-safe: call from one context.
+ */
+class FrameStreamReceiver {
+
+    public:
+
+    /**
+     * @brief Counters, e.g. to report throughput.
+     */
+    struct Stats {
+        uint32_t frames = 0;         /// good frames presented
+        uint32_t crc_errors = 0;
+        uint32_t bad_headers = 0;    /// unknown type or too many pixels
+        uint32_t skipped_bytes = 0;  /// bytes discarded while hunting for sync
+        uint64_t bytes = 0;
+    };
+
+
+    private:
+
+    enum class State : uint8_t {
+        Sync,
+        Header,
+        Pixels,
+        Crc
+    };
+
+    FrameSwapChain& chain_;
+    State state_ = State::Sync;
+    uint8_t sync_matched_ = 0;
+    uint8_t header_[frame_stream::HEADER_BYTES];
+    uint8_t crc_bytes_[frame_stream::CRC_BYTES];
+    size_t filled_ = 0;         // bytes of the current field received
+    size_t pixel_bytes_ = 0;    // size of the current packet's pixels
+    Crc32 crc_;
+    Stats stats_;
+
+
+    uint8_t* pixel_bytes() {
+        return reinterpret_cast<uint8_t*>(chain_.back().data.data());
+    }
+
+    void on_sync_byte(uint8_t byte) {
+        if (byte == frame_stream::SYNC[sync_matched_]) {
+            if (++sync_matched_ == sizeof(frame_stream::SYNC)) {
+                sync_matched_ = 0;
+                state_ = State::Header;
+                filled_ = 0;
+                crc_.reset();
+            }
+            return;
+        }
+        stats_.skipped_bytes += sync_matched_ + 1u;
+        sync_matched_ = (byte == frame_stream::SYNC[0]) ? 1 : 0;
+        stats_.skipped_bytes -= sync_matched_;
+    }
+
+    void on_header() {
+        crc_.update(header_, sizeof(header_));
+        unsigned int count = header_[1] | (header_[2] << 8);
+        if (header_[0] != static_cast<uint8_t>(frame_stream::Type::Frame) || count > chain_.num_leds()) {
+            stats_.bad_headers++;
+            state_ = State::Sync;
+            return;
+        }
+        pixel_bytes_ = count * sizeof(RGBValue);
+        state_ = pixel_bytes_ == 0 ? State::Crc : State::Pixels;
+        filled_ = 0;
+    }
+
+    void on_crc() {
+        uint32_t expected = crc_bytes_[0] | (crc_bytes_[1] << 8) | (crc_bytes_[2] << 16) |
+                            (static_cast<uint32_t>(crc_bytes_[3]) << 24);
+        if (crc_.value() == expected) {
+            chain_.present();
+            stats_.frames++;
+        } else {
+            stats_.crc_errors++;
+        }
+        state_ = State::Sync;
+    }
+
+
+    public:
+
+    explicit FrameStreamReceiver(FrameSwapChain& chain) : chain_(chain) {
+    }
+
+    /**
+     * @brief Where the next bytes should be received and how many are expected (at least 1).
+     *
+     * Receiving fewer is fine; receiving more than `size()` is not.
+     */
+    etl::span<uint8_t> rx_buffer() {
+        switch (state_) {
+            case State::Header:
+                return etl::span<uint8_t>(header_ + filled_, sizeof(header_) - filled_);
+            case State::Pixels:
+                return etl::span<uint8_t>(pixel_bytes() + filled_, pixel_bytes_ - filled_);
+            case State::Crc:
+                return etl::span<uint8_t>(crc_bytes_ + filled_, sizeof(crc_bytes_) - filled_);
+            case State::Sync:
+            default:
+                return etl::span<uint8_t>(header_, 1);  // one byte at a time until in sync
+        }
+    }
+
+    /**
+     * @brief `n` bytes (<= `rx_buffer().size()`) have been written to `rx_buffer()`.
+     */
+    void received(size_t n) {
+        stats_.bytes += n;
+        switch (state_) {
+            case State::Sync:
+                if (n > 0) {
+                    on_sync_byte(header_[0]);
+                }
+                return;
+            case State::Header:
+                filled_ += n;
+                if (filled_ == sizeof(header_)) {
+                    on_header();
+                }
+                return;
+            case State::Pixels:
+                crc_.update(pixel_bytes() + filled_, n);
+                filled_ += n;
+                if (filled_ == pixel_bytes_) {
+                    state_ = State::Crc;
+                    filled_ = 0;
+                }
+                return;
+            case State::Crc:
+                filled_ += n;
+                if (filled_ == sizeof(crc_bytes_)) {
+                    on_crc();
+                }
+                return;
+        }
+    }
+
+    /**
+     * @brief Receive `bytes` that were read into some other buffer.
+     */
+    void feed(etl::span<const uint8_t> bytes) {
+        while (!bytes.empty()) {
+            etl::span<uint8_t> dest = rx_buffer();
+            size_t n = std::min(dest.size(), bytes.size());
+            std::memcpy(dest.data(), bytes.data(), n);
+            received(n);
+            bytes = bytes.subspan(n);
+        }
+    }
+
+    /**
+     * @brief True between packets, e.g. to time how long the host takes to send one.
+     */
+    bool is_idle() const {
+        return state_ == State::Sync && sync_matched_ == 0;
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+};
+
+
+#endif // FRAME_STREAM_H
@@ -0,0 +1,97 @@
+#include "frame_stream_uart_pico.h"
+
+#include <cstdlib>
+#include <cstdio>
+
+extern "C" {
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+}
+
+
+//
+// constructor
+//
+FrameStreamUart::FrameStreamUart(uart_inst_t* uart, uint baud, uint8_t rx_pin, FrameStreamReceiver& receiver)
+    : uart_(uart), receiver_(receiver) {
+    // ensure only one instance or die
+    if (instance_ != nullptr) {
+        abort();
+    }
+    instance_ = this;
+
+    uint actual_baud = uart_init(uart_, baud);
+    gpio_set_function(rx_pin, GPIO_FUNC_UART);
+    uart_set_fifo_enabled(uart_, true);
+    printf("Frame stream: %u baud, up to %u fps at %u LEDs\n", actual_baud,
+           static_cast<unsigned>(frame_stream::max_fps(actual_baud, MAX_LEDS)), static_cast<unsigned>(MAX_LEDS));
+
+    // configure a DMA channel:
+    //   the UART issues a DREQ when its RX FIFO has data
+    //   transfer 8 bits at a time
+    //   read from the same address (the data register)
+    //   increment write addresses (the receiver's buffer)
+    int chan = dma_claim_unused_channel(false);
+    if (chan < 0) {
+        printf("Frame stream: no free DMA channel\n");
+        std::abort();
+    }
+    dma_chan_ = static_cast<uint>(chan);
+    dma_channel_config_t cfg = dma_channel_get_default_config(dma_chan_);
+    channel_config_set_dreq(&cfg, uart_get_dreq(uart_, false));
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&cfg, false);
+    channel_config_set_write_increment(&cfg, true);
+    dma_channel_configure(dma_chan_,
+                          &cfg,
+                          NULL,                       // write address set per transfer
+                          &uart_get_hw(uart_)->dr,    // read address: UART data register
+                          1,
+                          false);
+
+    irq_set_exclusive_handler(DMA_IRQ_1, dma_irq_handler_c_wrapper);
+    dma_channel_set_irq1_enabled(dma_chan_, true);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    start_transfer();
+}
+
+
+//
+// destructor
+//
+FrameStreamUart::~FrameStreamUart() {
+    dma_channel_set_irq1_enabled(dma_chan_, false);
+    dma_channel_abort(dma_chan_);
+    dma_channel_unclaim(dma_chan_);
+    uart_deinit(uart_);
+    instance_ = nullptr;
+}
+
+
+//
+// Receive the next field of the packet (header, pixels or CRC) in one transfer
+//
+void FrameStreamUart::start_transfer() {
+    etl::span<uint8_t> buffer = receiver_.rx_buffer();
+    pending_ = static_cast<uint32_t>(buffer.size());
+    dma_channel_transfer_to_buffer_now(dma_chan_, buffer.data(), pending_);
+}
+
+
+// C Wrapper for IRQ handler for DMA transfers. This is static so allows us to register IRQ
+// handler with Pico SDK
+void FrameStreamUart::dma_irq_handler_c_wrapper(void) {
+    instance_->dma_irq_handler();
+}
+
+
+void FrameStreamUart::dma_irq_handler() {
+    if (dma_channel_get_irq1_status(dma_chan_)) {
+        dma_channel_acknowledge_irq1(dma_chan_);
+        receiver_.received(pending_);
+        start_transfer();
+    }
+}
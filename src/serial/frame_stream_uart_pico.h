@@ -0,0 +1,55 @@
+#ifndef FRAME_STREAM_UART_PICO_H
+#define FRAME_STREAM_UART_PICO_H
+
+extern "C" {
+#include "hardware/uart.h"
+}
+#include "frame_stream.h"
+
+#include <cstdint>
+
+/**
+ * @brief Receives `frame_stream` packets on a UART by DMA straight into a `FrameSwapChain`.
+ *
+ * A DMA channel is pointed at `FrameStreamReceiver::rx_buffer()` for exactly the bytes the
+ * receiver expects next; its completion IRQ (DMA_IRQ_1, DMA_IRQ_0 is used by `WS2811Pio`) calls
+ * `received()` and restarts it on the next buffer. Pixel data therefore never passes through the
+ * CPU, apart from the CRC.
+ *
+ * Use a UART other than the stdio one (uart0). Designed to have only one instance, because it
+ * registers an IRQ handler.
+ */
+class FrameStreamUart final {
+
+    private:
+
+    static inline FrameStreamUart *instance_ = nullptr;   // singleton instance
+    uart_inst_t* uart_;
+    FrameStreamReceiver& receiver_;
+    uint dma_chan_;                 // DMA channel from the UART RX FIFO to the receiver
+    uint32_t pending_ = 0;          // bytes in the current DMA transfer
+
+    static void dma_irq_handler_c_wrapper(void);
+    void dma_irq_handler();
+    void start_transfer();
+
+
+    public:
+
+    FrameStreamUart() = delete;
+    FrameStreamUart(const FrameStreamUart&) = delete;
+    ~FrameStreamUart();
+
+    /**
+     * @brief Set up the UART and DMA and start receiving. If this fails, abort() is called.
+     *
+     * @param [in] uart UART to receive on, e.g. uart1
+     * @param [in] baud baud rate, e.g. 3'000'000 (see `frame_stream::max_fps`)
+     * @param [in] rx_pin GPIO for UART RX
+     * @param [in] receiver protocol core to receive into (must outlive this)
+     */
+    FrameStreamUart(uart_inst_t* uart, uint baud, uint8_t rx_pin, FrameStreamReceiver& receiver);
+};
+
+
+#endif // FRAME_STREAM_UART_PICO_H
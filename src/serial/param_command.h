@@ -0,0 +1,280 @@
+/**
+ * @file param_command.h
+ * @brief Compact command protocol to read and write runtime parameter blocks (see params.h) over
+ * a UART, e.g. from a terminal script on a laptop at the venue.
+ *
+ * Request and reply (little endian), framed like frame_stream.h:
+ *
+ *     | sync 0xA5 0x5A | type u8 | block u8 | offset u16 | length u8 | data | CRC-32 u32 |
+ *     | sync 0xA5 0x5A | type + 0x80 u8 | block u8 | status u8 | length u8 | data | CRC-32 u32 |
+ *
+ * The CRC covers everything after the sync. A request carries data only for `Write`; a reply only
+ * for `Read` (the bytes read) and `Info` (the block's size, u16). `status` is a
+ * `ParamStore::Status`. Requests with a bad CRC or header get no reply: the host times out and
+ * tries again.
+ *
+ * `ParamCommandParser` does no I/O, so it's tested on the host; param_uart_pico.cpp feeds it on the
+ * Pico.
+ */
+#ifndef PARAM_COMMAND_H
+#define PARAM_COMMAND_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <cstring>
+#include "etl/span.h"
+#include "../crc.h"
+#include "../params.h"
+
+
+namespace param_command {
+
+    constexpr uint8_t SYNC[2] = {0xA5, 0x5A};
+    constexpr size_t REQUEST_HEADER_BYTES = 5;  // type, block, offset, length
+    constexpr size_t REPLY_HEADER_BYTES = 4;    // type, block, status, length
+    constexpr size_t CRC_BYTES = 4;
+    constexpr size_t MAX_DATA = 64;             /// most bytes written or read by one command
+    constexpr size_t MAX_REQUEST_BYTES = sizeof(SYNC) + REQUEST_HEADER_BYTES + MAX_DATA + CRC_BYTES;
+    constexpr size_t MAX_REPLY_BYTES = sizeof(SYNC) + REPLY_HEADER_BYTES + MAX_DATA + CRC_BYTES;
+    constexpr uint8_t REPLY = 0x80;             /// set in a reply's type
+
+    /**
+     * @brief Request types, after frame_stream's (0x01).
+     */
+    enum class Type : uint8_t {
+        Write = 0x10,   /// `length` bytes of data into the block's shadow copy at `offset`
+        Commit = 0x11,  /// make the shadow copy live at the next frame
+        Read = 0x12,    /// `length` bytes of the shadow copy from `offset`
+        Info = 0x13     /// the block's size
+    };
+
+    inline void put_crc(uint8_t* packet, size_t len) {
+        uint32_t crc = Crc32().update(packet + sizeof(SYNC), len - sizeof(SYNC)).value();
+        for (int i = 0; i < 4; i++) {
+            packet[len + i] = static_cast<uint8_t>(crc >> (8 * i));
+        }
+    }
+
+    inline bool crc_ok(const uint8_t* packet, size_t len) {
+        const uint8_t* c = packet + len - CRC_BYTES;
+        uint32_t expected = c[0] | (c[1] << 8) | (c[2] << 16) | (static_cast<uint32_t>(c[3]) << 24);
+        return Crc32().update(packet + sizeof(SYNC), len - sizeof(SYNC) - CRC_BYTES).value() == expected;
+    }
+
+    /**
+     * @brief Encode a request (host side, or for tests).
+     *
+     * @param data bytes to write for `Write`, ignored otherwise
+     * @param length bytes to read for `Read`, ignored otherwise
+     * @return request length, or 0 if `out` is too small or there's more than `MAX_DATA`
+     */
+    inline size_t encode_request(Type type, uint8_t block, uint16_t offset, etl::span<const uint8_t> data,
+                                 uint8_t length, etl::span<uint8_t> out) {
+        if (type == Type::Write) {
+            length = static_cast<uint8_t>(data.size());
+        } else {
+            data = etl::span<const uint8_t>();
+            length = type == Type::Read ? length : 0;
+        }
+        size_t len = sizeof(SYNC) + REQUEST_HEADER_BYTES + data.size() + CRC_BYTES;
+        if (data.size() > MAX_DATA || length > MAX_DATA || out.size() < len) {
+            return 0;
+        }
+        uint8_t* p = out.data();
+        p[0] = SYNC[0];
+        p[1] = SYNC[1];
+        p[2] = static_cast<uint8_t>(type);
+        p[3] = block;
+        p[4] = static_cast<uint8_t>(offset);
+        p[5] = static_cast<uint8_t>(offset >> 8);
+        p[6] = length;
+        if (!data.empty()) {
+            std::memcpy(p + 7, data.data(), data.size());
+        }
+        put_crc(p, len - CRC_BYTES);
+        return len;
+    }
+
+    /**
+     * @brief A decoded reply.
+     */
+    struct Reply {
+        Type type;
+        uint8_t block;
+        ParamStore::Status status;
+        etl::span<const uint8_t> data;      /// points into the decoded bytes
+    };
+
+    /**
+     * @brief Decode a whole reply (host side, or for tests).
+     *
+     * @return false if it's not a valid reply
+     */
+    inline bool decode_reply(etl::span<const uint8_t> in, Reply& reply) {
+        constexpr size_t min_len = sizeof(SYNC) + REPLY_HEADER_BYTES + CRC_BYTES;
+        if (in.size() < min_len || in[0] != SYNC[0] || in[1] != SYNC[1] || (in[2] & REPLY) == 0 ||
+            in.size() != min_len + in[5] || !crc_ok(in.data(), in.size())) {
+            return false;
+        }
+        reply.type = static_cast<Type>(in[2] & ~REPLY);
+        reply.block = in[3];
+        reply.status = static_cast<ParamStore::Status>(in[4]);
+        reply.data = in.subspan(sizeof(SYNC) + REPLY_HEADER_BYTES, in[5]);
+        return true;
+    }
+}
+
+
+/**
+ * @brief Parses requests a byte at a time, runs them on a `ParamStore` and makes the replies.
+ *
+ * Runs in the command context of the store, e.g. the UART RX IRQ. Corrupt requests (bad CRC,
+ * unknown type, too long) are dropped and the parser hunts for the next sync.
+ */
+class ParamCommandParser {
+
+    public:
+
+    /**
+     * @brief Counters, e.g. for the health report.
+     */
+    struct Stats {
+        uint32_t commands = 0;      /// requests run, whatever their status
+        uint32_t crc_errors = 0;
+        uint32_t bad_headers = 0;   /// unknown type or too much data
+        uint32_t skipped_bytes = 0; /// bytes discarded while hunting for sync
+    };
+
+
+    private:
+
+    ParamStore& store_;
+    uint8_t buffer_[param_command::MAX_REQUEST_BYTES];
+    size_t count_ = 0;
+    uint8_t reply_[param_command::MAX_REPLY_BYTES];
+    Stats stats_;
+
+    // drop bytes from the front until the buffer could be the start of a request
+    void resync() {
+        size_t start = 1;
+        for (; start < count_; start++) {
+            size_t n = count_ - start < sizeof(param_command::SYNC) ? count_ - start : sizeof(param_command::SYNC);
+            if (std::memcmp(buffer_ + start, param_command::SYNC, n) == 0) {
+                break;
+            }
+        }
+        stats_.skipped_bytes += static_cast<uint32_t>(start);
+        std::memmove(buffer_, buffer_ + start, count_ - start);
+        count_ -= start;
+    }
+
+    // bytes in the request at the front of the buffer, or 0 if its header is bad
+    static size_t request_bytes(const uint8_t* p) {
+        using namespace param_command;
+        const uint8_t type = p[2];
+        const uint8_t length = p[6];
+        if (type < static_cast<uint8_t>(Type::Write) || type > static_cast<uint8_t>(Type::Info) || length > MAX_DATA) {
+            return 0;
+        }
+        const size_t data = type == static_cast<uint8_t>(Type::Write) ? length : 0;
+        return sizeof(SYNC) + REQUEST_HEADER_BYTES + data + CRC_BYTES;
+    }
+
+    etl::span<const uint8_t> run(const uint8_t* p) {
+        using namespace param_command;
+        const Type type = static_cast<Type>(p[2]);
+        const uint8_t block = p[3];
+        const uint16_t offset = static_cast<uint16_t>(p[4] | (p[5] << 8));
+        const uint8_t length = p[6];
+        uint8_t* data = reply_ + sizeof(SYNC) + REPLY_HEADER_BYTES;
+        size_t data_bytes = 0;
+        ParamStore::Status status = ParamStore::Status::Ok;
+        switch (type) {
+            case Type::Write:
+                status = store_.write(block, offset, etl::span<const uint8_t>(p + 7, length));
+                break;
+            case Type::Commit:
+                status = store_.commit(block);
+                break;
+            case Type::Read:
+                status = store_.read(block, offset, etl::span<uint8_t>(data, length));
+                data_bytes = status == ParamStore::Status::Ok ? length : 0;
+                break;
+            case Type::Info: {
+                uint16_t size = store_.size(block);
+                status = size > 0 ? ParamStore::Status::Ok : ParamStore::Status::UnknownBlock;
+                data[0] = static_cast<uint8_t>(size);
+                data[1] = static_cast<uint8_t>(size >> 8);
+                data_bytes = 2;
+                break;
+            }
+        }
+        stats_.commands++;
+
+        reply_[0] = SYNC[0];
+        reply_[1] = SYNC[1];
+        reply_[2] = static_cast<uint8_t>(static_cast<uint8_t>(type) | REPLY);
+        reply_[3] = block;
+        reply_[4] = static_cast<uint8_t>(status);
+        reply_[5] = static_cast<uint8_t>(data_bytes);
+        size_t len = sizeof(SYNC) + REPLY_HEADER_BYTES + data_bytes;
+        put_crc(reply_, len);
+        return etl::span<const uint8_t>(reply_, len + CRC_BYTES);
+    }
+
+
+    public:
+
+    explicit ParamCommandParser(ParamStore& store) : store_(store) {
+    }
+
+    ParamCommandParser(const ParamCommandParser&) = delete;
+
+    /**
+     * @brief Add one byte, and run the request if it completes one.
+     *
+     * @return the reply to send back, valid until the next `feed`, or an empty span
+     */
+    etl::span<const uint8_t> feed(uint8_t byte) {
+        using namespace param_command;
+        buffer_[count_++] = byte;
+        while (count_ > 0) {
+            if (count_ <= sizeof(SYNC)) {
+                if (buffer_[count_ - 1] != SYNC[count_ - 1]) {
+                    resync();
+                    continue;
+                }
+                return {};
+            }
+            if (count_ < sizeof(SYNC) + REQUEST_HEADER_BYTES) {
+                return {};
+            }
+            const size_t len = request_bytes(buffer_);
+            if (len == 0) {
+                stats_.bad_headers++;
+                resync();
+                continue;
+            }
+            if (count_ < len) {
+                return {};
+            }
+            if (!crc_ok(buffer_, len)) {
+                stats_.crc_errors++;
+                resync();
+                continue;
+            }
+            etl::span<const uint8_t> reply = run(buffer_);
+            std::memmove(buffer_, buffer_ + len, count_ - len);
+            count_ -= len;
+            return reply;
+        }
+        return {};
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+};
+
+
+#endif // PARAM_COMMAND_H
@@ -0,0 +1,74 @@
+#include "param_uart_pico.h"
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+}
+
+
+//
+// constructor
+//
+ParamUart::ParamUart(uart_inst_t* uart, uint baud, uint8_t tx_pin, uint8_t rx_pin, ParamStore& store)
+    : uart_(uart), parser_(store) {
+    // ensure only one instance or die
+    if (instance_ != nullptr) {
+        abort();
+    }
+    instance_ = this;
+
+    uint actual_baud = uart_init(uart_, baud);
+    gpio_set_function(tx_pin, GPIO_FUNC_UART);
+    gpio_set_function(rx_pin, GPIO_FUNC_UART);
+    printf("Parameters: commands on UART at %u baud\n", actual_baud);
+
+    uart_set_fifo_enabled(uart_, true);
+    uint irq = uart_ == uart0 ? UART0_IRQ : UART1_IRQ;
+    irq_set_exclusive_handler(irq, uart_irq_handler_c_wrapper);
+    irq_set_enabled(irq, true);
+    uart_set_irq_enables(uart_, true, false);   // TX IRQ only while a reply is being sent
+}
+
+
+//
+// destructor
+//
+ParamUart::~ParamUart() {
+    uart_set_irq_enables(uart_, false, false);
+    uart_deinit(uart_);
+    instance_ = nullptr;
+}
+
+
+// C Wrapper for the UART IRQ handler. This is static so allows us to register IRQ handler with
+// Pico SDK
+void ParamUart::uart_irq_handler_c_wrapper(void) {
+    instance_->uart_irq_handler();
+}
+
+
+void ParamUart::uart_irq_handler() {
+    while (uart_is_readable(uart_)) {
+        etl::span<const uint8_t> reply = parser_.feed(static_cast<uint8_t>(uart_getc(uart_)));
+        if (reply.empty()) {
+            continue;
+        }
+        if (tx_sent_ < tx_len_) {
+            dropped_replies_++;
+            continue;
+        }
+        std::memcpy(tx_, reply.data(), reply.size());
+        tx_len_ = reply.size();
+        tx_sent_ = 0;
+    }
+
+    while (tx_sent_ < tx_len_ && uart_is_writable(uart_)) {
+        uart_putc_raw(uart_, static_cast<char>(tx_[tx_sent_++]));
+    }
+    uart_set_irq_enables(uart_, true, tx_sent_ < tx_len_);
+}
@@ -0,0 +1,64 @@
+#ifndef PARAM_UART_PICO_H
+#define PARAM_UART_PICO_H
+
+extern "C" {
+#include "hardware/uart.h"
+}
+#include "param_command.h"
+
+#include <cstdint>
+
+/**
+ * @brief Runs `param_command` requests from a UART on a `ParamStore`.
+ *
+ * Requests are parsed a byte at a time in the UART RX IRQ, and each reply is copied out and sent
+ * from the TX IRQ, so neither the IRQ nor the render loop waits for the UART. A request that
+ * arrives before the last reply is sent gets no reply (the host sends one request at a time).
+ *
+ * Use a UART other than the stdio one (uart0). Designed to have only one instance, because it
+ * registers an IRQ handler.
+ */
+class ParamUart final {
+
+    private:
+
+    static inline ParamUart *instance_ = nullptr;   // singleton instance
+    uart_inst_t* uart_;
+    ParamCommandParser parser_;
+    uint8_t tx_[param_command::MAX_REPLY_BYTES];
+    size_t tx_len_ = 0;             // bytes of the reply being sent
+    size_t tx_sent_ = 0;
+    uint32_t dropped_replies_ = 0;
+
+    static void uart_irq_handler_c_wrapper(void);
+    void uart_irq_handler();
+
+
+    public:
+
+    ParamUart() = delete;
+    ParamUart(const ParamUart&) = delete;
+    ~ParamUart();
+
+    /**
+     * @brief Set up the UART and start taking commands. If this fails, abort() is called.
+     *
+     * @param [in] uart UART to use, e.g. uart1
+     * @param [in] baud baud rate, e.g. 115'200
+     * @param [in] tx_pin GPIO for UART TX (replies)
+     * @param [in] rx_pin GPIO for UART RX (requests)
+     * @param [in] store parameter blocks to run requests on (must outlive this)
+     */
+    ParamUart(uart_inst_t* uart, uint baud, uint8_t tx_pin, uint8_t rx_pin, ParamStore& store);
+
+    const ParamCommandParser::Stats& stats() const {
+        return parser_.stats();
+    }
+
+    uint32_t dropped_replies() const {
+        return dropped_replies_;
+    }
+};
+
+
+#endif // PARAM_UART_PICO_H
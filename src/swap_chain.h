@@ -0,0 +1,77 @@
+/**
+ * @file swap_chain.h
+ * @brief Double-buffered frames: a producer (effect, network or serial receiver) fills the back
+ * buffer while the LED driver sends the front buffer.
+ */
+#ifndef SWAP_CHAIN_H
+#define SWAP_CHAIN_H
+
+#include <stdint.h>
+#include <atomic>
+#include "draw.h"
+
+
+/**
+ * @brief Two `Frame`s, a front (being displayed) and a back (being drawn).
+ *
+ * `present()` swaps them so the next `front()` is the frame just drawn. It's a single 32-bit
+ * store so it's safe with the producer on one core and the consumer on the other, as long as the
+ * consumer finishes with the front buffer (e.g. its DMA transfer completes) before the producer
+ * presents twice more; `presented()` lets the consumer detect new frames.
+ *
+ * Declare it static: two Frames are too big for a core stack.
+ */
+class FrameSwapChain {
+
+    private:
+    Frame frames_[2];
+    std::atomic<uint32_t> presented_ {0}; // number of presents, bit 0 is the index of the front buffer
+
+    public:
+
+    /**
+     * @param num_leds number of LEDs in each frame (capped to MAX_LEDS)
+     */
+    explicit FrameSwapChain(int num_leds) : frames_{Frame(num_leds), Frame(num_leds)} {
+        for (Frame& frame : frames_) {
+            std::fill(frame.data.begin(), frame.data.end(), BLACK);
+        }
+    }
+
+    FrameSwapChain(const FrameSwapChain&) = delete;
+
+    /**
+     * @brief Frame to draw into.
+     */
+    Frame& back() {
+        return frames_[(presented_.load(std::memory_order_relaxed) & 1) ^ 1];
+    }
+
+    /**
+     * @brief Frame to display.
+     */
+    const Frame& front() const {
+        return frames_[presented_.load(std::memory_order_acquire) & 1];
+    }
+
+    /**
+     * @brief Make the back buffer the front buffer. The new back buffer holds the frame before.
+     */
+    void present() {
+        presented_.store(presented_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Number of times `present()` has been called, e.g. to check for a new frame.
+     */
+    uint32_t presented() const {
+        return presented_.load(std::memory_order_acquire);
+    }
+
+    unsigned int num_leds() const {
+        return frames_[0].num_leds;
+    }
+};
+
+
+#endif // SWAP_CHAIN_H
@@ -0,0 +1,514 @@
+/**
+ * @file clock_sync.h
+ * @brief Time and beat synchronisation between several LightDancer controllers.
+ *
+ * One controller is the leader: it periodically sends a beacon with its clock, and its beat
+ * (the time of a beat and the beat period). The others are followers: they discipline their own
+ * µs clock to the leader's with a PI controller on offset and skew (`DisciplinedClock`) and take
+ * the beat from the beacon, so effects on every controller see the same shared time and beat
+ * phase.
+ *
+ * Transport independent: beacons are a fixed 36-byte message that is sent as a UDP datagram
+ * (sync_udp_pico.cpp) or over a UART (sync_uart_pico.cpp, using `SyncStreamParser`).
+ */
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <cstring>
+#include "etl/span.h"
+#include "../crc.h"
+
+
+namespace sync_msg {
+
+    constexpr uint8_t MAGIC[4] = {'L', 'D', 'S', 'Y'};
+    constexpr uint8_t VERSION = 1;
+    constexpr size_t SIZE = 36;
+    constexpr uint16_t UDP_PORT = 5570;
+
+    enum class Type : uint8_t {
+        Beacon = 1
+    };
+
+    /**
+     * @brief Contents of a beacon.
+     */
+    struct Beacon {
+        uint8_t leader_id = 0;
+        uint8_t sequence = 0;
+        uint64_t leader_us = 0;         /// leader's clock when the beacon was sent
+        uint64_t beat_epoch_us = 0;     /// leader time of beat number `beat_number`
+        uint32_t beat_period_us = 0;    /// 0 if there is no beat (e.g. silence)
+        uint32_t beat_number = 0;
+    };
+
+    inline void put_le(uint8_t* p, uint64_t v, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+    }
+
+    inline uint64_t get_le(const uint8_t* p, int bytes) {
+        uint64_t v = 0;
+        for (int i = bytes - 1; i >= 0; i--) {
+            v = (v << 8) | p[i];
+        }
+        return v;
+    }
+
+    /**
+     * @brief Serialise `beacon` into `out` (at least SIZE bytes).
+     *
+     * @return SIZE, or 0 if `out` is too small
+     */
+    inline size_t encode(const Beacon& beacon, etl::span<uint8_t> out) {
+        if (out.size() < SIZE) {
+            return 0;
+        }
+        uint8_t* p = out.data();
+        std::memcpy(p, MAGIC, sizeof(MAGIC));
+        p[4] = VERSION;
+        p[5] = static_cast<uint8_t>(Type::Beacon);
+        p[6] = beacon.leader_id;
+        p[7] = beacon.sequence;
+        put_le(p + 8, beacon.leader_us, 8);
+        put_le(p + 16, beacon.beat_epoch_us, 8);
+        put_le(p + 24, beacon.beat_period_us, 4);
+        put_le(p + 28, beacon.beat_number, 4);
+        put_le(p + 32, Crc32().update(p, 32).value(), 4);
+        return SIZE;
+    }
+
+    /**
+     * @brief Parse a beacon.
+     *
+     * @return false if `in` isn't a valid beacon (size, magic, version, type or CRC)
+     */
+    inline bool decode(etl::span<const uint8_t> in, Beacon& beacon) {
+        const uint8_t* p = in.data();
+        if (in.size() != SIZE || std::memcmp(p, MAGIC, sizeof(MAGIC)) != 0 || p[4] != VERSION ||
+            p[5] != static_cast<uint8_t>(Type::Beacon) ||
+            get_le(p + 32, 4) != Crc32().update(p, 32).value()) {
+            return false;
+        }
+        beacon.leader_id = p[6];
+        beacon.sequence = p[7];
+        beacon.leader_us = get_le(p + 8, 8);
+        beacon.beat_epoch_us = get_le(p + 16, 8);
+        beacon.beat_period_us = static_cast<uint32_t>(get_le(p + 24, 4));
+        beacon.beat_number = static_cast<uint32_t>(get_le(p + 28, 4));
+        return true;
+    }
+}
+
+
+/**
+ * @brief A local µs clock disciplined to a reference (the leader's) clock.
+ *
+ * shared = local + offset + (local - ref) * rate, where `offset` and `rate` (skew, ppb) are
+ * steered by a PI controller on the error between each beacon's time and our shared time when
+ * it arrives. Large errors are treated as outliers (e.g. a beacon delayed by Wi-Fi) unless they
+ * persist, in which case the clock steps, as it does on the first beacon.
+ *
+ * Delay on the path from leader to follower is not measured (beacons are one-way); a constant
+ * delay can be set with `set_path_delay_us`, e.g. UART bytes at the baud rate.
+ */
+class DisciplinedClock {
+
+    public:
+
+    static constexpr int64_t STEP_THRESHOLD_US = 5'000;  /// larger errors are outliers, or a step
+    static constexpr int OUTLIERS_BEFORE_STEP = 3;
+    static constexpr int64_t MAX_RATE_PPB = 1'000'000;   /// crystals are within ~±50 ppm; 1000 ppm is broken
+
+    private:
+
+    // PI gains as shifts: Kp = 1/8, Ki = 1/128. Low enough that Wi-Fi jitter on single beacons
+    // averages out; the phase still settles within ~20 beacons (1s at 20 Hz)
+    static constexpr int KP_SHIFT = 3;
+    static constexpr int KI_SHIFT = 7;
+
+    int64_t offset_us_ = 0;
+    uint64_t ref_local_us_ = 0;
+    int64_t rate_ppb_ = 0;
+    int64_t path_delay_us_ = 0;
+    int64_t last_error_us_ = 0;
+    int outliers_ = 0;
+    bool locked_ = false;
+    uint32_t steps_ = 0;
+
+    int64_t drift_us(uint64_t local_us) const {
+        int64_t since = static_cast<int64_t>(local_us - ref_local_us_);
+        return since * rate_ppb_ / 1'000'000'000;
+    }
+
+    void step(uint64_t reference_us, uint64_t local_us) {
+        offset_us_ = static_cast<int64_t>(reference_us - local_us);
+        ref_local_us_ = local_us;
+        locked_ = true;
+        outliers_ = 0;
+        steps_++;
+    }
+
+
+    public:
+
+    /**
+     * @brief Shared (reference) time at local time `local_us`. Before the first sample it's the
+     * local time.
+     */
+    uint64_t now_us(uint64_t local_us) const {
+        return local_us + static_cast<uint64_t>(offset_us_ + drift_us(local_us));
+    }
+
+    /**
+     * @brief Steer the clock with a sample: the reference clock read `reference_us` when the local
+     * clock read `local_us` (minus the path delay).
+     */
+    void on_sample(uint64_t reference_us, uint64_t local_us) {
+        reference_us += static_cast<uint64_t>(path_delay_us_);
+        if (!locked_) {
+            step(reference_us, local_us);
+            last_error_us_ = 0;
+            return;
+        }
+
+        int64_t error = static_cast<int64_t>(reference_us - now_us(local_us));
+        last_error_us_ = error;
+        if (error > STEP_THRESHOLD_US || error < -STEP_THRESHOLD_US) {
+            if (++outliers_ >= OUTLIERS_BEFORE_STEP) {
+                step(reference_us, local_us);
+            }
+            return;
+        }
+        outliers_ = 0;
+
+        // re-base at this sample so the rate applies from here on
+        int64_t interval = static_cast<int64_t>(local_us - ref_local_us_);
+        offset_us_ += drift_us(local_us);
+        ref_local_us_ = local_us;
+
+        offset_us_ += error / (1 << KP_SHIFT);
+        if (interval > 0) {
+            rate_ppb_ += (error * 1'000'000'000 / interval) / (1 << KI_SHIFT);
+            rate_ppb_ = rate_ppb_ > MAX_RATE_PPB ? MAX_RATE_PPB : (rate_ppb_ < -MAX_RATE_PPB ? -MAX_RATE_PPB : rate_ppb_);
+        }
+    }
+
+    void set_path_delay_us(int64_t delay_us) {
+        path_delay_us_ = delay_us;
+    }
+
+    /**
+     * @brief Error (reference - shared) at the last sample, in µs.
+     */
+    int64_t last_error_us() const {
+        return last_error_us_;
+    }
+
+    /**
+     * @brief Estimated skew of the reference relative to the local clock, ppb.
+     */
+    int64_t rate_ppb() const {
+        return rate_ppb_;
+    }
+
+    bool is_locked() const {
+        return locked_;
+    }
+
+    uint32_t steps() const {
+        return steps_;
+    }
+};
+
+
+/**
+ * @brief Beat position in shared time: a beat at `epoch_us` and a period.
+ */
+class BeatClock {
+
+    uint64_t epoch_us_ = 0;
+    uint32_t period_us_ = 0;
+    uint32_t number_ = 0;
+
+    public:
+
+    struct Position {
+        uint32_t beat;      /// beat number
+        uint16_t phase;     /// fraction of the beat, 0..65535 (Q16)
+    };
+
+    /**
+     * @brief Set the tempo: beat number `number` is at `epoch_us`, and beats are `period_us` apart
+     * (0 = no beat).
+     */
+    void set(uint64_t epoch_us, uint32_t period_us, uint32_t number = 0) {
+        epoch_us_ = epoch_us;
+        period_us_ = period_us;
+        number_ = number;
+    }
+
+    bool has_beat() const {
+        return period_us_ != 0;
+    }
+
+    uint32_t period_us() const {
+        return period_us_;
+    }
+
+    uint64_t epoch_us() const {
+        return epoch_us_;
+    }
+
+    uint32_t number() const {
+        return number_;
+    }
+
+    /**
+     * @brief Beat and phase at shared time `now_us` (beat `number()` at phase 0 if there's no beat
+     * or `now_us` is before the epoch).
+     */
+    Position at(uint64_t now_us) const {
+        if (period_us_ == 0 || now_us < epoch_us_) {
+            return {number_, 0};
+        }
+        uint64_t since = now_us - epoch_us_;
+        uint64_t beats = since / period_us_;
+        uint64_t within = since - beats * period_us_;
+        return {static_cast<uint32_t>(number_ + beats), static_cast<uint16_t>((within << 16) / period_us_)};
+    }
+};
+
+
+/**
+ * @brief One controller's view of shared time and beat, as leader or follower.
+ *
+ * The leader's shared time is its local time; it calls `make_beacon` periodically (e.g. every
+ * 50ms) and sends the bytes. Followers pass every message received to `on_message` with the local
+ * time it arrived.
+ */
+class SyncNode {
+
+    public:
+
+    enum class Role : uint8_t {
+        Leader,
+        Follower
+    };
+
+    struct Stats {
+        uint32_t beacons = 0;       /// beacons accepted
+        uint32_t invalid = 0;       /// not a beacon, or corrupt
+        uint32_t lost = 0;          /// gaps in the leader's sequence numbers
+    };
+
+
+    private:
+
+    Role role_;
+    uint8_t id_;
+    uint8_t sequence_ = 0;
+    bool has_sequence_ = false;
+    DisciplinedClock clock_;
+    BeatClock beat_;
+    Stats stats_;
+
+
+    public:
+
+    /**
+     * @param role leader or follower
+     * @param id leader id sent in beacons (ignored for followers)
+     */
+    explicit SyncNode(Role role, uint8_t id = 0) : role_(role), id_(id) {
+    }
+
+    Role role() const {
+        return role_;
+    }
+
+    /**
+     * @brief Shared time at local time `local_us`.
+     */
+    uint64_t shared_us(uint64_t local_us) const {
+        return role_ == Role::Leader ? local_us : clock_.now_us(local_us);
+    }
+
+    /**
+     * @brief Beat and phase at local time `local_us`.
+     */
+    BeatClock::Position beat(uint64_t local_us) const {
+        return beat_.at(shared_us(local_us));
+    }
+
+    /**
+     * @brief Leader: set the beat (e.g. from the beat tracker), in local (= shared) time.
+     */
+    void set_beat(uint64_t epoch_us, uint32_t period_us, uint32_t number = 0) {
+        beat_.set(epoch_us, period_us, number);
+    }
+
+    /**
+     * @brief Leader: encode a beacon for local time `local_us` into `out`.
+     *
+     * @return bytes to send, 0 if not the leader or `out` is too small
+     */
+    size_t make_beacon(uint64_t local_us, etl::span<uint8_t> out) {
+        if (role_ != Role::Leader) {
+            return 0;
+        }
+        sync_msg::Beacon beacon;
+        beacon.leader_id = id_;
+        beacon.sequence = sequence_++;
+        beacon.leader_us = local_us;
+        beacon.beat_epoch_us = beat_.epoch_us();
+        beacon.beat_period_us = beat_.period_us();
+        beacon.beat_number = beat_.number();
+        return sync_msg::encode(beacon, out);
+    }
+
+    /**
+     * @brief Follower: handle a message that arrived at local time `local_us`.
+     *
+     * @return true if it was a valid beacon
+     */
+    bool on_message(etl::span<const uint8_t> message, uint64_t local_us) {
+        sync_msg::Beacon beacon;
+        if (!sync_msg::decode(message, beacon)) {
+            stats_.invalid++;
+            return false;
+        }
+        if (role_ != Role::Follower) {
+            return true;
+        }
+        if (has_sequence_) {
+            stats_.lost += static_cast<uint8_t>(beacon.sequence - sequence_ - 1);
+        }
+        sequence_ = beacon.sequence;
+        has_sequence_ = true;
+        stats_.beacons++;
+
+        clock_.on_sample(beacon.leader_us, local_us);
+        beat_.set(beacon.beat_epoch_us, beacon.beat_period_us, beacon.beat_number);
+        return true;
+    }
+
+    DisciplinedClock& clock() {
+        return clock_;
+    }
+
+    const DisciplinedClock& clock() const {
+        return clock_;
+    }
+
+    const Stats& stats() const {
+        return stats_;
+    }
+};
+
+
+/**
+ * @brief Frame timing on shared time: how far effects advance each frame, and the shared time
+ * each frame is drawn at.
+ *
+ * Effects advance by the shared clock, so every controller runs at the leader's rate. A step of
+ * the clock (the first beacon, or the leader restarting) isn't passed on as elapsed time, which
+ * would freeze effects for a backward step or jump them for a forward one: that frame advances by
+ * the local clock, and the shared clock is followed again from there. Elapsed time only lines up
+ * rates; effects that need the same phase on every controller use the absolute `shared_us`.
+ */
+class SharedFrameClock {
+
+    public:
+
+    struct Tick {
+        uint32_t elapsed_us;    /// since the last tick, 0 for the first
+        uint64_t shared_us;     /// shared time now
+    };
+
+
+    private:
+
+    uint64_t last_local_us_ = 0;
+    uint64_t last_shared_us_ = 0;
+    uint32_t steps_ = 0;
+    bool started_ = false;
+
+
+    public:
+
+    /**
+     * @brief Next frame, at local time `local_us`.
+     */
+    Tick tick(const SyncNode& node, uint64_t local_us) {
+        const uint64_t shared_us = node.shared_us(local_us);
+        const uint32_t steps = node.clock().steps();
+        uint64_t elapsed = 0;
+        if (started_) {
+            // the discipline can also nudge shared time back a little between steps
+            const bool continuous = steps == steps_ && shared_us >= last_shared_us_;
+            elapsed = continuous ? shared_us - last_shared_us_ : local_us - last_local_us_;
+        }
+        started_ = true;
+        last_local_us_ = local_us;
+        last_shared_us_ = shared_us;
+        steps_ = steps;
+        return Tick{elapsed > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(elapsed), shared_us};
+    }
+};
+
+
+/**
+ * @brief Finds beacons in a byte stream (UART), resynchronising after noise or lost bytes.
+ */
+class SyncStreamParser {
+
+    uint8_t buffer_[sync_msg::SIZE];
+    size_t count_ = 0;
+
+    // drop bytes from the front until the buffer could be the start of a message
+    void resync() {
+        size_t start = 1;
+        for (; start < count_; start++) {
+            size_t n = count_ - start < sizeof(sync_msg::MAGIC) ? count_ - start : sizeof(sync_msg::MAGIC);
+            if (std::memcmp(buffer_ + start, sync_msg::MAGIC, n) == 0) {
+                break;
+            }
+        }
+        std::memmove(buffer_, buffer_ + start, count_ - start);
+        count_ -= start;
+    }
+
+    public:
+
+    /**
+     * @brief Add one byte.
+     *
+     * @return a complete, valid beacon message to pass to `SyncNode::on_message`, or an empty span
+     */
+    etl::span<const uint8_t> feed(uint8_t byte) {
+        buffer_[count_++] = byte;
+        if (count_ <= sizeof(sync_msg::MAGIC)) {
+            if (buffer_[count_ - 1] != sync_msg::MAGIC[count_ - 1]) {
+                resync();
+            }
+            return {};
+        }
+        if (count_ < sync_msg::SIZE) {
+            return {};
+        }
+        sync_msg::Beacon beacon;
+        if (sync_msg::decode(etl::span<const uint8_t>(buffer_, count_), beacon)) {
+            count_ = 0;
+            return etl::span<const uint8_t>(buffer_, sync_msg::SIZE);
+        }
+        resync();
+        return {};
+    }
+};
+
+
+#endif // CLOCK_SYNC_H
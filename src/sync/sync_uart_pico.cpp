@@ -0,0 +1,88 @@
+#include "sync_uart_pico.h"
+
+#include <cstdlib>
+#include <cstdio>
+
+extern "C" {
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "pico/time.h"
+}
+
+
+//
+// constructor
+//
+SyncUart::SyncUart(uart_inst_t* uart, uint baud, uint8_t tx_pin, uint8_t rx_pin, SyncNode& node,
+                   uint32_t beacon_interval_ms)
+    : uart_(uart), node_(node) {
+    // ensure only one instance or die
+    if (instance_ != nullptr) {
+        abort();
+    }
+    instance_ = this;
+
+    uint actual_baud = uart_init(uart_, baud);
+    gpio_set_function(tx_pin, GPIO_FUNC_UART);
+    gpio_set_function(rx_pin, GPIO_FUNC_UART);
+
+    if (node_.role() == SyncNode::Role::Leader) {
+        if (!add_repeating_timer_ms(-static_cast<int32_t>(beacon_interval_ms), beacon_timer_callback, this,
+                                    &beacon_timer_)) {
+            printf("Sync: no timer for beacons\n");
+            std::abort();
+        }
+    } else {
+        // beacon time is when its first byte was sent, we see the last: 10 bits per byte
+        node_.clock().set_path_delay_us(static_cast<int64_t>(sync_msg::SIZE) * 10 * 1'000'000 / actual_baud);
+
+        // no FIFO, so the IRQ (and timestamp) is per byte
+        uart_set_fifo_enabled(uart_, false);
+        uint irq = uart_ == uart0 ? UART0_IRQ : UART1_IRQ;
+        irq_set_exclusive_handler(irq, uart_irq_handler_c_wrapper);
+        irq_set_enabled(irq, true);
+        uart_set_irq_enables(uart_, true, false);
+    }
+}
+
+
+//
+// destructor
+//
+SyncUart::~SyncUart() {
+    if (node_.role() == SyncNode::Role::Leader) {
+        cancel_repeating_timer(&beacon_timer_);
+    } else {
+        uart_set_irq_enables(uart_, false, false);
+    }
+    uart_deinit(uart_);
+    instance_ = nullptr;
+}
+
+
+// C Wrapper for the UART IRQ handler. This is static so allows us to register IRQ handler with
+// Pico SDK
+void SyncUart::uart_irq_handler_c_wrapper(void) {
+    instance_->uart_irq_handler();
+}
+
+
+void SyncUart::uart_irq_handler() {
+    while (uart_is_readable(uart_)) {
+        uint64_t now = time_us_64();
+        etl::span<const uint8_t> message = parser_.feed(static_cast<uint8_t>(uart_getc(uart_)));
+        if (!message.empty()) {
+            node_.on_message(message, now);
+        }
+    }
+}
+
+
+bool SyncUart::beacon_timer_callback(repeating_timer_t* timer) {
+    SyncUart* self = static_cast<SyncUart*>(timer->user_data);
+    uint8_t beacon[sync_msg::SIZE];
+    size_t len = self->node_.make_beacon(time_us_64(), beacon);
+    uart_write_blocking(self->uart_, beacon, len);  // blocks for at most 4 byte times: TX FIFO is 32
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef SYNC_UART_PICO_H
+#define SYNC_UART_PICO_H
+
+extern "C" {
+#include "hardware/uart.h"
+#include "pico/time.h"
+}
+#include "clock_sync.h"
+
+#include <cstdint>
+
+/**
+ * @brief Time and beat sync beacons over a UART, e.g. daisy-chained controllers.
+ *
+ * A leader writes a beacon every `beacon_interval_ms` from a repeating timer. A follower
+ * receives in the UART RX IRQ and timestamps each beacon at its last byte; the time to send a
+ * beacon (36 bytes at the baud rate) is compensated as the path delay.
+ *
+ * Use a UART other than the stdio one (uart0). Designed to have only one instance, because it
+ * registers an IRQ handler.
+ */
+class SyncUart final {
+
+    private:
+
+    static inline SyncUart *instance_ = nullptr;   // singleton instance
+    uart_inst_t* uart_;
+    SyncNode& node_;
+    SyncStreamParser parser_;
+    repeating_timer_t beacon_timer_;
+
+    static void uart_irq_handler_c_wrapper(void);
+    void uart_irq_handler();
+    static bool beacon_timer_callback(repeating_timer_t* timer);
+
+
+    public:
+
+    SyncUart() = delete;
+    SyncUart(const SyncUart&) = delete;
+    ~SyncUart();
+
+    /**
+     * @brief Set up the UART and start syncing `node`. If this fails, abort() is called.
+     *
+     * @param [in] uart UART to use, e.g. uart1
+     * @param [in] baud baud rate, e.g. 115'200
+     * @param [in] tx_pin GPIO for UART TX (used by the leader)
+     * @param [in] rx_pin GPIO for UART RX (used by followers)
+     * @param [in] node leader or follower (must outlive this)
+     * @param [in] beacon_interval_ms leader's beacon interval
+     */
+    SyncUart(uart_inst_t* uart, uint baud, uint8_t tx_pin, uint8_t rx_pin, SyncNode& node,
+             uint32_t beacon_interval_ms = 50);
+};
+
+
+#endif // SYNC_UART_PICO_H
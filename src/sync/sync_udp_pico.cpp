@@ -0,0 +1,79 @@
+#include "sync_udp_pico.h"
+#include "../net/wifi_pico.h"
+
+#include <cstdlib>
+#include <cstdio>
+
+extern "C" {
+#include "pico/cyw43_arch.h"
+#include "pico/time.h"
+#include "pico/async_context.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+}
+
+static struct udp_pcb* pcb = nullptr;
+static async_at_time_worker_t beacon_worker;
+static uint32_t beacon_interval;
+
+
+//
+// lwIP receive callback (follower), runs in the background (IRQ) context
+//
+static void on_udp(void* arg, struct udp_pcb*, struct pbuf* p, const ip_addr_t*, u16_t) {
+    uint64_t now = time_us_64(); // as early as possible: latency here is sync error
+    SyncNode* node = static_cast<SyncNode*>(arg);
+    uint8_t message[sync_msg::SIZE];
+    u16_t len = pbuf_copy_partial(p, message, sizeof(message), 0);
+    if (p->tot_len == sync_msg::SIZE) {
+        node->on_message(etl::span<const uint8_t>(message, len), now);
+    }
+    pbuf_free(p);
+}
+
+
+//
+// async context worker (leader), runs where lwIP calls are safe and reschedules itself
+//
+static void send_beacon(async_context_t* context, async_at_time_worker_t* worker) {
+    SyncNode* node = static_cast<SyncNode*>(worker->user_data);
+    struct pbuf* p = pbuf_alloc(PBUF_TRANSPORT, sync_msg::SIZE, PBUF_RAM);
+    if (p != nullptr) { // else out of buffers, try next time
+        node->make_beacon(time_us_64(), etl::span<uint8_t>(static_cast<uint8_t*>(p->payload), sync_msg::SIZE));
+        udp_sendto(pcb, p, IP_ADDR_BROADCAST, sync_msg::UDP_PORT);
+        pbuf_free(p);
+    }
+    async_context_add_at_time_worker_in_ms(context, worker, beacon_interval);
+}
+
+
+//
+// sync_udp_start
+//
+void sync_udp_start(SyncNode& node, const char* ssid, const char* password, uint32_t beacon_interval_ms) {
+    wifi_join(ssid, password);
+
+    cyw43_arch_lwip_begin();
+    pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    if (pcb == nullptr || udp_bind(pcb, IP_ANY_TYPE, sync_msg::UDP_PORT) != ERR_OK) {
+        printf("Sync: can't use UDP port %u\n", sync_msg::UDP_PORT);
+        std::abort();
+    }
+    ip_set_option(pcb, SOF_BROADCAST);
+    if (node.role() == SyncNode::Role::Follower) {
+        udp_recv(pcb, on_udp, &node);
+    }
+    cyw43_arch_lwip_end();
+
+    if (node.role() == SyncNode::Role::Leader) {
+        beacon_interval = beacon_interval_ms;
+        beacon_worker.do_work = send_beacon;
+        beacon_worker.user_data = &node;
+        if (!async_context_add_at_time_worker_in_ms(cyw43_arch_async_context(), &beacon_worker, beacon_interval)) {
+            printf("Sync: can't schedule beacons\n");
+            std::abort();
+        }
+    }
+    printf("Sync: %s on UDP port %u\n", node.role() == SyncNode::Role::Leader ? "leader" : "follower",
+           sync_msg::UDP_PORT);
+}
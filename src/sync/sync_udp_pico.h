@@ -0,0 +1,24 @@
+/**
+ * @file sync_udp_pico.h
+ * @brief Pico W glue: time and beat sync beacons over UDP broadcast (port 5570).
+ *
+ * Only built with -DLIGHTDANCER_SYNC=udp (see CMakeLists.txt).
+ */
+#ifndef SYNC_UDP_PICO_H
+#define SYNC_UDP_PICO_H
+
+#include <stdint.h>
+#include "clock_sync.h"
+
+
+/**
+ * @brief Join Wi-Fi (see `wifi_join`) and start syncing `node`.
+ *
+ * A leader broadcasts a beacon every `beacon_interval_ms` from the CYW43 async context; a follower
+ * listens and timestamps each beacon as it arrives in the lwIP background context. `node` must
+ * outlive the program (make it static). Aborts if the socket or beacons can't be set up.
+ */
+void sync_udp_start(SyncNode& node, const char* ssid, const char* password, uint32_t beacon_interval_ms = 50);
+
+
+#endif // SYNC_UDP_PICO_H
@@ -0,0 +1,143 @@
+/**
+ * @file trig.h
+ * @brief Integer sine, cosine and atan2 from a quarter-wave table, for the FFT, effects and
+ * test signals. No floating point at run-time.
+ *
+ * Angles are 16-bit: 65536 is a full turn (2π), so they wrap for free and a phase accumulator's
+ * top 16 bits can be used directly. Results are Q15 (see fixed_point.h), ±32767 at the peaks.
+ *
+ * ```cpp
+ * int16_t s = trig::sin16(0x4000);             // sin(π/2) = 32767
+ * uint16_t a = trig::atan2(-100, 0);           // -π/2 = 0xC000
+ * ```
+ *
+ * Everything is constexpr, so it can build other tables at compile time. The table itself is
+ * generated at compile time and, being constexpr, is placed in flash on the RP2040.
+ */
+#ifndef TRIG_H
+#define TRIG_H
+
+#include <stdint.h>
+
+
+namespace trig {
+
+    /// table steps per quarter turn; 256 keeps the error to about 1 LSB of Q15
+    constexpr uint32_t QUARTER_STEPS = 256;
+    constexpr uint32_t QUARTER_TURN = 0x4000;
+    constexpr uint32_t HALF_TURN = 0x8000;
+
+    constexpr double PI = 3.14159265358979323846;
+
+    /**
+     * @brief sin(x) for 0 <= x <= π/2 by Taylor series, only for building tables at compile time.
+     */
+    constexpr double taylor_sin(double x) {
+        double term = x;
+        double sum = x;
+        for (int n = 1; n < 12; n++) {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    struct QuarterTable {
+        int16_t v[QUARTER_STEPS + 1];
+    };
+
+    constexpr QuarterTable make_quarter_table() {
+        QuarterTable table {};
+        for (uint32_t i = 0; i <= QUARTER_STEPS; i++) {
+            double s = 32767.0 * taylor_sin(PI / 2 * i / QUARTER_STEPS);
+            table.v[i] = static_cast<int16_t>(s + 0.5);
+        }
+        return table;
+    }
+
+    /// Q15 sin over the first quarter turn, `QUARTER_STEPS + 1` entries
+    inline constexpr QuarterTable quarter_sin = make_quarter_table();
+
+    /**
+     * @brief sin of a 16-bit angle (65536 = 2π) in Q15, linearly interpolated. Higher bits of
+     * `angle` are ignored.
+     */
+    constexpr int16_t sin16(uint32_t angle) {
+        angle &= 0xFFFF;
+        uint32_t quadrant = angle >> 14;
+        uint32_t idx = angle & (QUARTER_TURN - 1);      // position within quadrant, 14 bits
+        if (quadrant & 1) {
+            idx = QUARTER_TURN - idx;
+        }
+        uint32_t i = idx >> 6;                          // 256 steps of 64
+        int32_t frac = static_cast<int32_t>(idx & 63);
+        int32_t v = quarter_sin.v[i];
+        if (i < QUARTER_STEPS) {
+            v += ((quarter_sin.v[i + 1] - v) * frac + 32) >> 6;
+        }
+        return static_cast<int16_t>((quadrant & 2) ? -v : v);
+    }
+
+    constexpr int16_t cos16(uint32_t angle) {
+        return sin16(angle + QUARTER_TURN);
+    }
+
+    /**
+     * @brief sin of an 8-bit angle (256 = 2π) as a brightness: 128 + 127 * sin, so 1 to 255.
+     */
+    constexpr uint8_t sin8(uint8_t angle) {
+        return static_cast<uint8_t>(128 + ((sin16(static_cast<uint32_t>(angle) << 8) * 127 + 16384) >> 15));
+    }
+
+    /**
+     * @brief atan(z) for 0 <= z <= 1 (Q15), as a 16-bit angle.
+     *
+     * Odd minimax polynomial (|error| < 1e-5 rad) evaluated in Q15.
+     */
+    constexpr uint32_t atan_unit(int32_t z) {
+        constexpr int64_t c1 = 32764;       // 0.9998660 in Q15
+        constexpr int64_t c3 = -10823;      // -0.3302995
+        constexpr int64_t c5 = 5903;        // 0.1801410
+        constexpr int64_t c7 = -2790;       // -0.0851330
+        constexpr int64_t c9 = 683;         // 0.0208351
+        int64_t z2 = (static_cast<int64_t>(z) * z) >> 15;
+        int64_t p = c7 + ((c9 * z2) >> 15);
+        p = c5 + ((p * z2) >> 15);
+        p = c3 + ((p * z2) >> 15);
+        p = c1 + ((p * z2) >> 15);
+        int64_t rad = (p * z) >> 15;                    // Q15 radians, up to π/4
+        return static_cast<uint32_t>((rad * 20861 + 32768) >> 16);   // * 65536 / 2π / 32768
+    }
+
+    /**
+     * @brief Angle of (x, y) as a 16-bit angle (65536 = 2π), e.g. 0x4000 for (0, 1).
+     *
+     * Octant reduction and one integer division, within 2 steps (0.0002 rad); 0 for (0, 0).
+     */
+    constexpr uint16_t atan2(int32_t y, int32_t x) {
+        uint32_t ax = x < 0 ? 0u - static_cast<uint32_t>(x) : static_cast<uint32_t>(x);
+        uint32_t ay = y < 0 ? 0u - static_cast<uint32_t>(y) : static_cast<uint32_t>(y);
+        if (ax == 0 && ay == 0) {
+            return 0;
+        }
+        // keep the ratio's division in 32 bits
+        while (ax > 0xFFFF || ay > 0xFFFF) {
+            ax >>= 1;
+            ay >>= 1;
+        }
+        uint32_t angle = ay <= ax
+            ? atan_unit(static_cast<int32_t>((ay << 15) / ax))
+            : QUARTER_TURN - atan_unit(static_cast<int32_t>((ax << 15) / ay));
+        if (x < 0) {
+            angle = HALF_TURN - angle;
+        }
+        if (y < 0) {
+            angle = 0x10000 - angle;
+        }
+        return static_cast<uint16_t>(angle);
+    }
+
+} // namespace trig
+
+
+#endif // TRIG_H
@@ -1,43 +1,318 @@
+/**
+ * @file wavegen.h
+ * @brief Streaming test signal generator: tones, chirps, click tracks, noise and envelopes.
+ */
+#ifndef WAVEGEN_H
+#define WAVEGEN_H
+
 #include <cstddef>
 #include <stdint.h>
 #include "etl/array.h"
+#include "etl/span.h"
+#include "audio_source.h"
+#include "fixed_point.h"
+#include "trig.h"
+
+
+/**
+ * @brief Colour of `WaveGen` noise.
+ */
+enum class NoiseColor : uint8_t {
+    None,
+    White,
+    Pink,       /// -3 dB/octave (Voss-McCartney)
+};
+
+
 /**
-* @brief Compile-time Waveform Generator.
-* 
-* Generates a sine wave at a specified frequency, sample rate and number of samples.
+ * @brief Repeating amplitude envelope: ramp up over `attack`, stay for `hold`, ramp down over
+ * `release`, then silence for `gap` samples. All 0 (the default) is a constant full level.
+ */
+struct Envelope {
+    uint32_t attack = 0;
+    uint32_t hold = 0;
+    uint32_t release = 0;
+    uint32_t gap = 0;
+
+    uint32_t period() const {
+        return attack + hold + release + gap;
+    }
+};
+
+
+/**
+* @brief Streaming, phase-continuous signal generator with the audio source interface
+* (audio_source.h), for soak tests and benchmarks.
+*
+* The signal is the sum of up to `MaxTones` sine tones, a linear chirp, a click track at a tempo
+* and white or pink noise, times an envelope, saturated to int16_t. Every part runs from integer
+* phase accumulators (NCOs) and `trig::sin16`, so blocks join up seamlessly across `read` calls,
+* and the output depends only on the settings and seed: hours of audio are reproducible to the
+* sample.
 *
 * e.g.
 * @code{.cpp}
-* WaveGen<44000, 512> generator; // 512 samples at 44kHz sample rate
-* etl::array<int16_t, 512> samples = generator.sin(1000); // for 1000Hz sine wave
+* using namespace fixed_literals;
+* WaveGen<44'100> gen;
+* gen.add_tone(220, 0.25_q15);
+* gen.set_clicks(128, 0.5_q15);              // 128 BPM kick
+* gen.set_noise(NoiseColor::Pink, 0.05_q15);
+* etl::array<int16_t, 128> block;
+* gen.read(block);                           // and again for the next 128 samples
 * @endcode
-* 
+*
 * @param Fs sampling frequency in samples per second
-* @param N number of samples to generate - must be even
-* 
+* @param MaxTones number of tones that can be added
 */
-template<size_t Fs, size_t N> 
+template <uint32_t Fs, unsigned int MaxTones = 4>
 class WaveGen {
-    
+
+    static_assert(Fs > 0, "Fs must be > 0");
+
+    private:
+
+    struct Tone {
+        uint32_t phase;
+        uint32_t step;
+        int32_t amplitude;      // Q15
+    };
+
+    etl::array<Tone, MaxTones> tones_ {};
+    unsigned int num_tones_ = 0;
+
+    // chirp: the step moves linearly from its start to its end value, then starts again
+    uint32_t chirp_phase_ = 0;
+    int64_t chirp_step_ = 0;    // phase step << 16
+    int64_t chirp_start_ = 0;
+    int64_t chirp_slope_ = 0;   // per sample, << 16
+    uint32_t chirp_samples_ = 0;
+    uint32_t chirp_pos_ = 0;
+    int32_t chirp_amplitude_ = 0;
+
+    // clicks: a decaying sine burst each time the beat phase wraps
+    uint32_t beat_phase_ = 0;
+    uint32_t beat_step_ = 0;
+    uint32_t click_phase_ = 0;
+    uint32_t click_step_ = 0;
+    int32_t click_amplitude_ = 0;
+    uint32_t click_level_ = 0;  // Q15 << 16, decays to 0
+    uint32_t click_decay_ = 0;
+    uint32_t beats_ = 0;
+
+    NoiseColor noise_ = NoiseColor::None;
+    int32_t noise_amplitude_ = 0;
+    uint32_t rng_;
+    uint32_t pink_count_ = 0;
+    etl::array<int32_t, 16> pink_rows_ {};
+    int32_t pink_sum_ = 0;
+
+    Envelope envelope_;
+    uint32_t envelope_pos_ = 0;
+
+    uint64_t sample_ = 0;
+
+    static constexpr uint32_t phase_step(uint32_t freq_hz) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(freq_hz) << 32) / Fs);
+    }
+
+    uint32_t random() {
+        // xorshift32
+        rng_ ^= rng_ << 13;
+        rng_ ^= rng_ >> 17;
+        rng_ ^= rng_ << 5;
+        return rng_;
+    }
+
+    int32_t white() {
+        return static_cast<int32_t>(static_cast<int16_t>(random() >> 16));
+    }
+
+    int32_t pink() {
+        // one of 16 rows of white noise changes per sample: row n every 2^(n+1) samples
+        pink_count_++;
+        unsigned int row = 0;
+        for (uint32_t c = pink_count_; (c & 1) == 0 && row < pink_rows_.size() - 1; c >>= 1) {
+            row++;
+        }
+        int32_t value = white() >> 2;
+        pink_sum_ += value - pink_rows_[row];
+        pink_rows_[row] = value;
+        return pink_sum_ + (white() >> 2);     // 17 rows of a quarter: about white noise's RMS
+    }
+
+    // Q15 gain of the envelope at the current sample
+    int32_t envelope_gain() {
+        const Envelope& e = envelope_;
+        uint32_t period = e.period();
+        if (period == 0) {
+            return 32767;
+        }
+        uint32_t pos = envelope_pos_;
+        envelope_pos_ = envelope_pos_ + 1 == period ? 0 : envelope_pos_ + 1;
+        if (pos < e.attack) {
+            return static_cast<int32_t>(static_cast<uint64_t>(pos) * 32767 / e.attack);
+        }
+        pos -= e.attack;
+        if (pos < e.hold) {
+            return 32767;
+        }
+        pos -= e.hold;
+        if (pos < e.release) {
+            return static_cast<int32_t>(static_cast<uint64_t>(e.release - pos) * 32767 / e.release);
+        }
+        return 0;
+    }
+
+    int16_t next() {
+        int32_t sum = 0;
+        for (unsigned int i = 0; i < num_tones_; i++) {
+            Tone& t = tones_[i];
+            sum += (trig::sin16(t.phase >> 16) * t.amplitude) >> 15;
+            t.phase += t.step;
+        }
+
+        if (chirp_samples_ > 0) {
+            sum += (trig::sin16(chirp_phase_ >> 16) * chirp_amplitude_) >> 15;
+            chirp_phase_ += static_cast<uint32_t>(chirp_step_ >> 16);
+            chirp_step_ += chirp_slope_;
+            if (++chirp_pos_ == chirp_samples_) {
+                chirp_pos_ = 0;
+                chirp_step_ = chirp_start_;
+            }
+        }
+
+        if (beat_step_ > 0) {
+            uint32_t before = beat_phase_;
+            beat_phase_ += beat_step_;
+            if (beat_phase_ < before) {
+                beats_++;
+                click_phase_ = 0;
+                click_level_ = static_cast<uint32_t>(click_amplitude_) << 16;
+            }
+            if (click_level_ > 0) {
+                int32_t level = static_cast<int32_t>(click_level_ >> 16);
+                sum += (trig::sin16(click_phase_ >> 16) * level) >> 15;
+                click_phase_ += click_step_;
+                click_level_ = click_level_ > click_decay_ ? click_level_ - click_decay_ : 0;
+            }
+        }
+
+        if (noise_ == NoiseColor::White) {
+            sum += (white() * noise_amplitude_) >> 15;
+        } else if (noise_ == NoiseColor::Pink) {
+            // pink reaches about 17 * 8192, past what a 32-bit product with a Q15 gain holds
+            sum += static_cast<int32_t>((static_cast<int64_t>(pink()) * noise_amplitude_) >> 15);
+        }
+
+        sum = static_cast<int32_t>((static_cast<int64_t>(sum) * envelope_gain()) >> 15);
+        sample_++;
+        return static_cast<int16_t>(sum > 32767 ? 32767 : (sum < -32768 ? -32768 : sum));
+    }
+
+
     public:
-    
-    static_assert(!(N & 1), "N must be even");
-    static constexpr double amplitude_max = 32767;
-    
-    /**
-     * @brief Generate a sine wave at the specified frequency.
-     */
-    etl::array<int16_t, N> sin(const double freq) {
-        
-        etl::array<int16_t, N> wave;
-        
-        // Generate the sine wave
-        for (int i = 0; i < N; ++i) {
-            double time = static_cast<double>(i) / static_cast<double>(Fs);
-            wave[i] = static_cast<int16_t>(amplitude_max * std::sin(2 * M_PI * freq * i / (double)Fs));
-        }
-        
-        return wave;
-    }
-    
+
+    static constexpr uint32_t sample_rate_hz = Fs;
+
+    /**
+     * @param seed noise seed, any value but 0
+     */
+    explicit WaveGen(uint32_t seed = 1) : rng_(seed == 0 ? 1 : seed) {
+    }
+
+    /**
+     * @brief Add a sine tone. Returns false if there are already `MaxTones`.
+     *
+     * @param amplitude peak, e.g. `0.5_q15`
+     */
+    bool add_tone(uint32_t freq_hz, Q15 amplitude) {
+        if (num_tones_ == MaxTones) {
+            return false;
+        }
+        tones_[num_tones_++] = Tone{0, phase_step(freq_hz), amplitude.raw()};
+        return true;
+    }
+
+    void clear_tones() {
+        num_tones_ = 0;
+    }
+
+    /**
+     * @brief Sweep a tone linearly from `from_hz` to `to_hz` over `samples`, then again. 0
+     * `samples` turns the chirp off.
+     */
+    void set_chirp(uint32_t from_hz, uint32_t to_hz, uint32_t samples, Q15 amplitude) {
+        chirp_start_ = static_cast<int64_t>(phase_step(from_hz)) << 16;
+        int64_t end = static_cast<int64_t>(phase_step(to_hz)) << 16;
+        chirp_slope_ = samples > 0 ? (end - chirp_start_) / samples : 0;
+        chirp_step_ = chirp_start_;
+        chirp_samples_ = samples;
+        chirp_pos_ = 0;
+        chirp_amplitude_ = amplitude.raw();
+    }
+
+    /**
+     * @brief A click (a decaying sine burst, like a kick drum) on every beat at `bpm`, starting
+     * with the first sample. 0 `bpm` turns clicks off.
+     *
+     * @param click_hz pitch of the click
+     * @param click_ms time for the click to decay to silence
+     */
+    void set_clicks(uint32_t bpm, Q15 amplitude, uint32_t click_hz = 60, uint32_t click_ms = 100) {
+        beat_step_ = static_cast<uint32_t>((static_cast<uint64_t>(bpm) << 32) / (60ull * Fs));
+        beat_phase_ = 0u - beat_step_;     // wraps on the next sample
+        click_step_ = phase_step(click_hz);
+        click_amplitude_ = amplitude.raw();
+        uint32_t click_samples = static_cast<uint32_t>(static_cast<uint64_t>(Fs) * click_ms / 1000);
+        click_decay_ = (static_cast<uint32_t>(click_amplitude_) << 16) / (click_samples > 0 ? click_samples : 1);
+        click_level_ = 0;
+    }
+
+    /**
+     * @param amplitude level of the noise: white noise peaks there, pink noise has about the same
+     * RMS (0.58 of it) but higher peaks
+     */
+    void set_noise(NoiseColor color, Q15 amplitude) {
+        noise_ = color;
+        noise_amplitude_ = amplitude.raw();
+    }
+
+    /**
+     * @brief Shape the whole signal, starting at the attack from the next sample.
+     */
+    void set_envelope(const Envelope& envelope) {
+        envelope_ = envelope;
+        envelope_pos_ = 0;
+    }
+
+    uint32_t sample_rate() const {
+        return Fs;
+    }
+
+    /**
+     * @brief Fill `samples` with the next samples; always fills all of them.
+     */
+    size_t read(etl::span<int16_t> samples) {
+        for (int16_t& s : samples) {
+            s = next();
+        }
+        return samples.size();
+    }
+
+    /**
+     * @brief Samples generated so far.
+     */
+    uint64_t position() const {
+        return sample_;
+    }
+
+    /**
+     * @brief Clicks started so far, the ground truth for beat tracking.
+     */
+    uint32_t beats() const {
+        return beats_;
+    }
 };
+
+
+#endif // WAVEGEN_H
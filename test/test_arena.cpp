@@ -0,0 +1,98 @@
+#include "../src/arena.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+
+TEST(Arena, AllocatesAlignedAndFailsWhenFull) {
+    StaticArena<64> arena;
+
+    uint8_t* a = arena.allocate<uint8_t>(3);
+    ASSERT_NE(a, nullptr);
+    uint32_t* b = arena.allocate<uint32_t>(2);
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % alignof(uint32_t), 0u);
+    EXPECT_EQ(arena.used(), 12u); // 3 bytes, 1 padding, 8 bytes
+
+    EXPECT_EQ(arena.allocate<uint8_t>(100), nullptr);
+    EXPECT_EQ(arena.failures(), 1u);
+    EXPECT_EQ(arena.used(), 12u);   // failed allocation doesn't move the top
+
+    etl::span<int16_t> s = arena.allocate_span<int16_t>(100);
+    EXPECT_TRUE(s.empty());
+}
+
+// a count whose size doesn't fit size_t fails rather than wrapping to a small allocation
+TEST(Arena, OverflowingCountFails) {
+    StaticArena<64> arena;
+    EXPECT_EQ(arena.allocate<uint32_t>(SIZE_MAX / 2), nullptr);
+    EXPECT_EQ(arena.allocate<uint32_t>(SIZE_MAX / sizeof(uint32_t) + 1), nullptr);
+    EXPECT_EQ(arena.allocate(SIZE_MAX, 1), nullptr);
+    EXPECT_EQ(arena.failures(), 3u);
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_NE(arena.allocate<uint32_t>(16), nullptr);
+}
+
+TEST(Arena, ScopesReleaseInLifoOrder) {
+    StaticArena<256> arena;
+    {
+        ArenaScope outer(arena);
+        arena.allocate<uint32_t>(8);
+        EXPECT_EQ(arena.used(), 32u);
+        {
+            ArenaScope inner(arena);
+            arena.allocate<uint32_t>(16);
+            EXPECT_EQ(arena.used(), 96u);
+        }
+        EXPECT_EQ(arena.used(), 32u);
+    }
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_EQ(arena.high_water(), 96u);
+}
+
+TEST(Arena, NoLeaksAcrossMillionFrames) {
+    static StaticArena<8 * 1024> arena;
+    constexpr uint32_t frames = 1'000'000;
+
+    size_t max_frame_use = 0;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        ArenaScope frame_scope(arena);
+
+        // vary sizes and alignment from frame to frame like effects with different temporaries
+        etl::span<int16_t> fft_scratch = arena.allocate_span<int16_t>(256 + (frame % 7));
+        ASSERT_FALSE(fft_scratch.empty());
+        fft_scratch[0] = static_cast<int16_t>(frame);
+
+        {
+            ArenaScope effect_scope(arena);
+            uint8_t* bytes = arena.allocate<uint8_t>(1 + (frame % 13));
+            ASSERT_NE(bytes, nullptr);
+            uint32_t* words = arena.allocate<uint32_t>(64);
+            ASSERT_NE(words, nullptr);
+            words[63] = frame;
+            if (arena.used() > max_frame_use) {
+                max_frame_use = arena.used();
+            }
+        }
+    }
+
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_EQ(arena.failures(), 0u);
+    EXPECT_EQ(arena.high_water(), max_frame_use);
+    EXPECT_LT(arena.high_water(), arena.capacity());
+}
+
+struct TestConfig {
+    static constexpr size_t core0_arena_bytes = 128;
+    static constexpr size_t core1_arena_bytes = 64;
+};
+
+TEST(Arena, CoreArenasAreSeparate) {
+    Arena& core0 = CoreArenas<TestConfig>::get(0);
+    Arena& core1 = CoreArenas<TestConfig>::get(1);
+    EXPECT_NE(&core0, &core1);
+    EXPECT_EQ(core0.capacity(), 128u);
+    EXPECT_EQ(core1.capacity(), 64u);
+
+    ArenaScope scope(core0);
+    core0.allocate<uint8_t>(10);
+    EXPECT_EQ(core1.used(), 0u);
+}
@@ -0,0 +1,68 @@
+#include "../src/boot.h"
+#include "../src/leds/led_protocol.h"
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+
+constexpr RGBValue ramp(size_t i, size_t) {
+    return RGBValue{static_cast<uint8_t>(i), static_cast<uint8_t>(i * 2), static_cast<uint8_t>(255 - i)};
+}
+
+// the boot look packed at compile time is what `encode_frame` packs at run-time
+template <typename Protocol>
+void check_look() {
+    constexpr size_t n = 100;
+    static constexpr auto look = boot::encode_look<Protocol, n>(ramp);
+    std::vector<RGBValue> pixels;
+    for (size_t i = 0; i < n; i++) {
+        pixels.push_back(ramp(i, n));
+    }
+    std::vector<uint32_t> words(Protocol::frame_words(n));
+    ASSERT_EQ(encode_frame<Protocol>(etl::span<const RGBValue>(pixels.data(), n),
+                                     etl::span<uint32_t>(words.data(), words.size())), words.size());
+    ASSERT_EQ(look.span().size(), words.size());
+    for (size_t i = 0; i < words.size(); i++) {
+        EXPECT_EQ(look.words[i], words[i]) << i;
+    }
+}
+
+} // namespace
+
+
+TEST(Boot, LookMatchesEncoder) {
+    check_look<WS2811Protocol>();
+    check_look<SK6812RgbwProtocol>();
+    check_look<APA102Protocol>();
+    check_look<SK9822Protocol>();
+}
+
+TEST(Boot, EmberIsDimAndWarm) {
+    constexpr size_t n = 3800;
+    for (size_t i = 0; i < n; i++) {
+        RGBValue p = boot::ember(i, n);
+        ASSERT_LE(p.r, 32);
+        ASSERT_GE(p.r, 8);
+        ASSERT_GE(p.r, p.g);
+        ASSERT_GE(p.g, p.b);
+    }
+    EXPECT_EQ(boot::ember(n / 2, n).r, 32);
+    EXPECT_EQ(boot::ember(0, 1).r, 32);
+}
+
+TEST(Boot, Times) {
+    BootTimes times;
+    EXPECT_FALSE(times.take_report());
+    times.mark(BootTimes::Stage::FirstLatch, 1'500);
+    EXPECT_FALSE(times.reached(BootTimes::Stage::Effects));
+    EXPECT_FALSE(times.take_report());
+    times.mark(BootTimes::Stage::Effects, 20'000);
+    times.mark(BootTimes::Stage::Effects, 40'000);      // only the first counts
+    EXPECT_TRUE(times.reached(BootTimes::Stage::Effects));
+    EXPECT_TRUE(times.complete());
+    EXPECT_TRUE(times.take_report());
+    EXPECT_FALSE(times.take_report());                  // once
+    EXPECT_EQ(times.us(BootTimes::Stage::FirstLatch), 1'500u);
+    EXPECT_EQ(times.us(BootTimes::Stage::Effects), 20'000u);
+}
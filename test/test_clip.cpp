@@ -0,0 +1,194 @@
+#include "../src/clips/clip.h"
+#include "../src/effects/effects_lib.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include "etl/array.h"
+
+namespace {
+
+constexpr int NUM_LEDS = 300;
+
+// A frame of mostly black with some coloured gradients and noise so both runs and literals occur
+void make_frame(Frame& frame, uint32_t t) {
+    for (unsigned int i = 0; i < frame.num_leds; i++) {
+        frame.data[i] = BLACK;
+        if (i > 50 && i < 100) {
+            frame.data[i] = RGBValue{static_cast<uint8_t>(i + t), static_cast<uint8_t>(t), 7};
+        }
+        if ((i * 7 + t) % 31 == 0) {
+            frame.data[i] = RGBValue{static_cast<uint8_t>(t * 13), 200, static_cast<uint8_t>(i)};
+        }
+    }
+}
+
+} // namespace
+
+
+TEST(Clip, RoundTripsFramesInChunks) {
+    constexpr uint32_t frames = 40;
+    std::vector<uint8_t> buffer(256 * 1024);
+    ClipWriter writer;
+    ASSERT_TRUE(writer.begin(etl::span<uint8_t>(buffer.data(), buffer.size()), NUM_LEDS, 20'000, 64));
+
+    std::vector<std::vector<uint32_t>> expected;
+    Frame frame(NUM_LEDS);
+    for (uint32_t t = 0; t < frames; t++) {
+        make_frame(frame, t);
+        ASSERT_TRUE(writer.add_frame(frame.data));
+        std::vector<uint32_t> words;
+        for (unsigned int i = 0; i < frame.num_leds; i++) {
+            words.push_back(frame.data[i].as_RGB());
+        }
+        expected.push_back(words);
+    }
+    etl::span<const uint8_t> clip = writer.finish();
+    ASSERT_FALSE(clip.empty());
+    EXPECT_LT(clip.size(), static_cast<size_t>(frames * NUM_LEDS * 3 / 3));
+
+    ClipPlayer player;
+    ASSERT_EQ(player.open(clip), ClipPlayer::OpenResult::Ok);
+    EXPECT_EQ(player.frame_count(), frames);
+    EXPECT_EQ(player.num_leds(), static_cast<uint32_t>(NUM_LEDS));
+    EXPECT_EQ(player.frame_at(20'000 * 41), 1u);
+
+    // decode in odd-sized chunks (like a chunk ring) and in reverse order (random access)
+    etl::array<uint32_t, 37> chunk;
+    for (uint32_t f = frames; f-- > 0;) {
+        ASSERT_TRUE(player.begin_frame(f));
+        size_t at = 0;
+        while (player.remaining() > 0) {
+            size_t n = player.decode(etl::span<uint32_t>(chunk.data(), chunk.size()));
+            for (size_t i = 0; i < n; i++) {
+                ASSERT_EQ(chunk[i], expected[f][at + i]) << "frame " << f << " pixel " << at + i;
+            }
+            at += n;
+        }
+        EXPECT_EQ(at, static_cast<size_t>(NUM_LEDS));
+    }
+}
+
+TEST(Clip, DecodesIntoFrame) {
+    std::vector<uint8_t> buffer(64 * 1024);
+    ClipWriter writer;
+    writer.begin(etl::span<uint8_t>(buffer.data(), buffer.size()), NUM_LEDS, 50'000, 100);
+
+    LaserEffect laser;
+    etl::array<uint16_t, 1> mags {0};
+    DrawInfo<uint16_t, 1> info {50'000, mags};
+    Frame frame(NUM_LEDS);
+    for (int i = 0; i < 10; i++) {
+        laser.draw_frame(frame, info);
+        ASSERT_TRUE(writer.add_frame(frame.data));
+    }
+    etl::span<const uint8_t> clip = writer.finish();
+
+    // laser frames are mostly black so compress well
+    EXPECT_LT(clip.size(), 10u * NUM_LEDS * 3 / 20);
+
+    ClipPlayer player;
+    ASSERT_EQ(player.open(clip), ClipPlayer::OpenResult::Ok);
+    Frame decoded(NUM_LEDS);
+    ASSERT_TRUE(player.decode_frame(9, decoded));
+    for (unsigned int i = 0; i < frame.num_leds; i++) {
+        EXPECT_EQ(decoded.data[i].as_RGB(), frame.data[i].as_RGB());
+    }
+}
+
+// wire words are packed for the protocol, with its start and end frames, as `encode_frame` packs them
+TEST(Clip, DecodesWireWordsForProtocol) {
+    std::vector<uint8_t> buffer(64 * 1024);
+    ClipWriter writer;
+    writer.begin(etl::span<uint8_t>(buffer.data(), buffer.size()), NUM_LEDS, 20'000, 2);
+    Frame frame(NUM_LEDS);
+    make_frame(frame, 3);
+    ASSERT_TRUE(writer.add_frame(frame.data));
+    make_frame(frame, 4);
+    ASSERT_TRUE(writer.add_frame(frame.data));   // a delta frame
+    ClipPlayer player;
+    ASSERT_EQ(player.open(writer.finish()), ClipPlayer::OpenResult::Ok);
+
+    auto expect_frame = [&](auto protocol) {
+        using Protocol = decltype(protocol);
+        std::vector<uint32_t> expected(Protocol::frame_words(NUM_LEDS));
+        ASSERT_EQ(encode_frame<Protocol>(frame.data, etl::span<uint32_t>(expected.data(), expected.size())),
+                  expected.size());
+        std::vector<uint32_t> words(expected.size(), 0xDEADBEEF);
+        EXPECT_EQ((player.decode_frame<Protocol>(1, etl::span<uint32_t>(words.data(), words.size()))),
+                  expected.size());
+        EXPECT_EQ(words, expected) << Protocol::name;
+        EXPECT_EQ(player.decode_frame<Protocol>(1, etl::span<uint32_t>(words.data(), words.size() - 1)), 0u);
+    };
+    expect_frame(WS2811Protocol{});
+    expect_frame(WS2812BProtocol{});
+    expect_frame(SK6812RgbwProtocol{});
+    expect_frame(APA102Protocol{});
+    expect_frame(SK9822Protocol{});
+
+    // chunks are just the pixels
+    etl::array<uint32_t, 16> chunk;
+    ASSERT_TRUE(player.begin_frame(1));
+    ASSERT_EQ(player.decode<WS2812BProtocol>(etl::span<uint32_t>(chunk.data(), chunk.size())), chunk.size());
+    for (size_t i = 0; i < chunk.size(); i++) {
+        EXPECT_EQ(chunk[i], WS2812BProtocol::pack(frame.data[i]));
+    }
+}
+
+TEST(Clip, RejectsCorruptClipsAndOverflow) {
+    std::vector<uint8_t> buffer(512);
+    ClipWriter writer;
+    ASSERT_TRUE(writer.begin(etl::span<uint8_t>(buffer.data(), buffer.size()), NUM_LEDS, 1000, 4));
+
+    Frame frame(NUM_LEDS);
+    for (unsigned int i = 0; i < frame.num_leds; i++) {
+        frame.data[i] = RGBValue{static_cast<uint8_t>(i), static_cast<uint8_t>(i * 3), 1};
+    }
+    EXPECT_FALSE(writer.add_frame(frame.data)); // all literals, too big for 512 bytes
+    std::fill(frame.data.begin(), frame.data.end(), RED);
+    EXPECT_TRUE(writer.add_frame(frame.data));
+    etl::span<const uint8_t> clip = writer.finish();
+
+    ClipPlayer player;
+    EXPECT_EQ(player.open(clip), ClipPlayer::OpenResult::Ok);
+    EXPECT_EQ(player.frame_count(), 1u);
+
+    std::vector<uint8_t> bad(clip.begin(), clip.end());
+    bad[4] = 99;
+    EXPECT_EQ(player.open(etl::span<const uint8_t>(bad.data(), bad.size())), ClipPlayer::OpenResult::BadVersion);
+    bad[4] = 1;
+    bad[16] = 0xFF; // frame 0 offset out of range
+    EXPECT_EQ(player.open(etl::span<const uint8_t>(bad.data(), bad.size())), ClipPlayer::OpenResult::BadIndex);
+    EXPECT_FALSE(player.begin_frame(0));
+}
+
+// offsets and lengths near 2^32 are rejected, not wrapped round to look in range (as on the Pico's
+// 32-bit size_t)
+TEST(Clip, RejectsHugeOffsetsAndLengths) {
+    std::vector<uint8_t> buffer(512);
+    ClipWriter writer;
+    ASSERT_TRUE(writer.begin(etl::span<uint8_t>(buffer.data(), buffer.size()), 10, 1000, 4));
+    Frame frame(10);
+    std::fill(frame.data.begin(), frame.data.end(), RED);
+    ASSERT_TRUE(writer.add_frame(frame.data));
+    etl::span<const uint8_t> clip = writer.finish();
+    ClipPlayer player;
+    ASSERT_EQ(player.open(clip), ClipPlayer::OpenResult::Ok);
+
+    auto set_u32 = [](std::vector<uint8_t>& bytes, size_t at, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            bytes[at + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    };
+    const uint32_t offset = clip_detail::read_u32(clip.data() + clip_detail::HEADER_SIZE);
+
+    std::vector<uint8_t> bad(clip.begin(), clip.end());
+    set_u32(bad, clip_detail::HEADER_SIZE, 0xFFFFFFF8);     // + the record header wraps to 4
+    EXPECT_EQ(player.open(etl::span<const uint8_t>(bad.data(), bad.size())), ClipPlayer::OpenResult::BadIndex);
+
+    bad.assign(clip.begin(), clip.end());
+    set_u32(bad, offset + 8, 0xFFFFFFFF);                   // payload length
+    EXPECT_EQ(player.open(etl::span<const uint8_t>(bad.data(), bad.size())), ClipPlayer::OpenResult::BadIndex);
+
+    bad.assign(clip.begin(), clip.end());
+    set_u32(bad, offset + 8, static_cast<uint32_t>(bad.size() - offset - clip_detail::RECORD_HEADER_SIZE + 1));
+    EXPECT_EQ(player.open(etl::span<const uint8_t>(bad.data(), bad.size())), ClipPlayer::OpenResult::BadIndex);
+}
@@ -0,0 +1,238 @@
+#include "../src/sync/clock_sync.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t monotonic_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+// a follower's crystal: runs `skew_ppm` fast and started `offset_us` apart
+uint64_t local_clock(uint64_t true_us, int64_t skew_ppm, uint64_t offset_us) {
+    return true_us + static_cast<uint64_t>(static_cast<int64_t>(true_us) * skew_ppm / 1'000'000) + offset_us;
+}
+
+} // namespace
+
+
+TEST(ClockSync, BeaconRoundTrip) {
+    sync_msg::Beacon beacon;
+    beacon.leader_id = 3;
+    beacon.sequence = 200;
+    beacon.leader_us = 0x0123456789ABCDEFull;
+    beacon.beat_epoch_us = 42'000'000;
+    beacon.beat_period_us = 500'000;
+    beacon.beat_number = 77;
+    etl::array<uint8_t, sync_msg::SIZE> bytes;
+    ASSERT_EQ(sync_msg::encode(beacon, bytes), sync_msg::SIZE);
+
+    sync_msg::Beacon decoded;
+    ASSERT_TRUE(sync_msg::decode(bytes, decoded));
+    EXPECT_EQ(decoded.leader_id, 3);
+    EXPECT_EQ(decoded.sequence, 200);
+    EXPECT_EQ(decoded.leader_us, beacon.leader_us);
+    EXPECT_EQ(decoded.beat_epoch_us, beacon.beat_epoch_us);
+    EXPECT_EQ(decoded.beat_period_us, beacon.beat_period_us);
+    EXPECT_EQ(decoded.beat_number, 77u);
+
+    bytes[20] ^= 1;
+    EXPECT_FALSE(sync_msg::decode(bytes, decoded));
+}
+
+TEST(ClockSync, StreamParserResyncs) {
+    SyncNode leader(SyncNode::Role::Leader);
+    etl::array<uint8_t, sync_msg::SIZE> beacon;
+    leader.make_beacon(1000, beacon);
+
+    SyncStreamParser parser;
+    int found = 0;
+    auto feed = [&](const uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            found += parser.feed(data[i]).empty() ? 0 : 1;
+        }
+    };
+    const uint8_t noise[] = {'L', 'D', 0x00, 'L', 'L', 'D', 'S', 'Y', 0x01};
+    feed(noise, sizeof(noise));
+    feed(beacon.data(), beacon.size());
+    feed(beacon.data(), 20);        // lost the end of one
+    feed(beacon.data(), beacon.size());
+    feed(beacon.data(), beacon.size());
+    EXPECT_EQ(found, 3);
+}
+
+TEST(ClockSync, DisciplinedClockConverges) {
+    constexpr int64_t skew_ppm = 200;
+    constexpr uint64_t offset_us = 3'000'000;
+    DisciplinedClock clock;
+    uint32_t lcg = 1;
+
+    uint64_t true_us = 10'000'000;
+    for (int i = 0; i < 400; i++) {     // 20s of beacons every 50ms
+        true_us += 50'000;
+        lcg = lcg * 1664525 + 1013904223;
+        uint64_t delay = (lcg >> 8) % 300;     // network delay jitter, 0-300us
+        clock.on_sample(true_us, local_clock(true_us + delay, skew_ppm, offset_us));
+    }
+    EXPECT_TRUE(clock.is_locked());
+    EXPECT_EQ(clock.steps(), 1u);
+
+    // reference runs 200 ppm slow relative to local: -199960 ppb, give or take jitter / interval
+    EXPECT_NEAR(static_cast<double>(clock.rate_ppb()), -199960.0, 80'000.0);
+    // half way between beacons, error within the delay jitter
+    uint64_t mid_us = true_us + 25'000;
+    int64_t error = static_cast<int64_t>(clock.now_us(local_clock(mid_us, skew_ppm, offset_us)) - mid_us);
+    EXPECT_LT(std::abs(error), 300) << error;
+}
+
+TEST(ClockSync, OutliersThenStep) {
+    DisciplinedClock clock;
+    clock.on_sample(1'000'000, 0);
+    clock.on_sample(1'050'000, 50'000 + 20'000);   // one beacon 20ms late: ignored
+    EXPECT_EQ(clock.steps(), 1u);
+    EXPECT_EQ(clock.now_us(100'000), 1'100'000u);
+    for (int i = 0; i < DisciplinedClock::OUTLIERS_BEFORE_STEP; i++) {   // leader restarted
+        clock.on_sample(10'000 + i * 50'000, 100'000 + i * 50'000);
+    }
+    EXPECT_EQ(clock.steps(), 2u);
+    EXPECT_EQ(clock.now_us(300'000), 210'000u);
+}
+
+// a leader that boots after the follower steps the follower's clock back: effects keep moving
+TEST(ClockSync, FrameClockThroughSteps) {
+    SyncNode follower(SyncNode::Role::Follower);
+    SyncNode leader(SyncNode::Role::Leader, 1);
+    etl::array<uint8_t, sync_msg::SIZE> beacon;
+    SharedFrameClock frames;
+
+    EXPECT_EQ(frames.tick(follower, 3'600'000'000).elapsed_us, 0u);   // up an hour on its own
+    EXPECT_EQ(frames.tick(follower, 3'600'016'667).elapsed_us, 16'667u);
+
+    leader.make_beacon(1'000'000, beacon);      // leader booted a second ago
+    ASSERT_TRUE(follower.on_message(beacon, 3'600'020'000));
+    SharedFrameClock::Tick tick = frames.tick(follower, 3'600'033'334);
+    EXPECT_EQ(tick.elapsed_us, 16'667u);        // local time across the step, not 0 for an hour
+    EXPECT_EQ(tick.shared_us, 1'013'334u);
+    EXPECT_EQ(frames.tick(follower, 3'600'050'001).elapsed_us, 16'667u);
+
+    // the leader restarts: its beacons step the shared clock back again
+    for (int i = 0; i < DisciplinedClock::OUTLIERS_BEFORE_STEP; i++) {
+        ASSERT_TRUE(follower.on_message(beacon, 3'600'055'000 + i * 1000));
+    }
+    tick = frames.tick(follower, 3'600'066'668);
+    EXPECT_EQ(tick.elapsed_us, 16'667u);
+    EXPECT_LT(tick.shared_us, 1'013'334u);
+
+    // a step forward by more than 2^32 µs doesn't wrap either
+    for (int i = 0; i < DisciplinedClock::OUTLIERS_BEFORE_STEP; i++) {
+        follower.clock().on_sample(10'000'000'000, 3'600'070'000);
+    }
+    tick = frames.tick(follower, 3'600'083'335);
+    EXPECT_EQ(tick.elapsed_us, 16'667u);
+    EXPECT_EQ(tick.shared_us, 10'000'013'335u);
+    EXPECT_EQ(frames.tick(follower, 3'600'100'002).elapsed_us, 16'667u);
+}
+
+TEST(ClockSync, BeatFollowsLeader) {
+    SyncNode leader(SyncNode::Role::Leader, 1);
+    SyncNode follower(SyncNode::Role::Follower);
+    leader.set_beat(2'000'000, 500'000, 10);     // 120 bpm, beat 10 at t = 2s
+
+    etl::array<uint8_t, sync_msg::SIZE> beacon;
+    leader.make_beacon(3'000'000, beacon);
+    ASSERT_TRUE(follower.on_message(beacon, 7'000'000));   // follower's clock is 4s ahead
+
+    BeatClock::Position pos = follower.beat(7'125'000);
+    EXPECT_EQ(pos.beat, 12u);
+    EXPECT_EQ(pos.phase, 16384);    // quarter beat
+    EXPECT_EQ(follower.stats().beacons, 1u);
+
+    leader.make_beacon(3'050'000, beacon);  // lost
+    leader.make_beacon(3'100'000, beacon);
+    follower.on_message(beacon, 7'100'000);
+    EXPECT_EQ(follower.stats().lost, 1u);
+}
+
+TEST(ClockSync, MultiProcessLoopback) {
+    constexpr int followers = 3;
+    constexpr int64_t skews_ppm[followers] = {-80, 40, 150};
+    constexpr uint64_t duration_us = 1'500'000;
+    constexpr uint64_t interval_us = 20'000;
+
+    int sockets[followers];
+    sockaddr_in addrs[followers];
+    int pipes[followers][2];
+    pid_t pids[followers];
+
+    for (int i = 0; i < followers; i++) {
+        sockets[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(sockets[i], 0);
+        addrs[i] = {};
+        addrs[i].sin_family = AF_INET;
+        addrs[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ASSERT_EQ(bind(sockets[i], reinterpret_cast<sockaddr*>(&addrs[i]), sizeof(addrs[i])), 0);
+        socklen_t len = sizeof(addrs[i]);
+        ASSERT_EQ(getsockname(sockets[i], reinterpret_cast<sockaddr*>(&addrs[i]), &len), 0);
+        ASSERT_EQ(pipe(pipes[i]), 0);
+    }
+
+    const uint64_t start = monotonic_us();
+    for (int i = 0; i < followers; i++) {
+        pids[i] = fork();
+        ASSERT_GE(pids[i], 0);
+        if (pids[i] == 0) {
+            // follower process: its own skewed clock, disciplined by beacons
+            SyncNode node(SyncNode::Role::Follower);
+            timeval timeout {0, 100'000};
+            setsockopt(sockets[i], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            uint8_t buffer[64];
+            while (monotonic_us() - start < duration_us) {
+                ssize_t n = recv(sockets[i], buffer, sizeof(buffer), 0);
+                uint64_t local = local_clock(monotonic_us(), skews_ppm[i], 1'000'000 * (i + 1));
+                if (n > 0) {
+                    node.on_message(etl::span<const uint8_t>(buffer, static_cast<size_t>(n)), local);
+                }
+            }
+            uint64_t now = monotonic_us();
+            int64_t error = static_cast<int64_t>(node.shared_us(local_clock(now, skews_ppm[i], 1'000'000 * (i + 1))) - now);
+            ssize_t written = write(pipes[i][1], &error, sizeof(error));
+            _exit(written == sizeof(error) && node.stats().beacons > 0 ? 0 : 1);
+        }
+    }
+
+    // leader: the real monotonic clock
+    int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    SyncNode leader(SyncNode::Role::Leader);
+    etl::array<uint8_t, sync_msg::SIZE> beacon;
+    while (monotonic_us() - start < duration_us) {
+        for (int i = 0; i < followers; i++) {
+            leader.make_beacon(monotonic_us(), beacon);
+            sendto(tx, beacon.data(), beacon.size(), 0, reinterpret_cast<sockaddr*>(&addrs[i]), sizeof(addrs[i]));
+        }
+        usleep(interval_us);
+    }
+    close(tx);
+
+    for (int i = 0; i < followers; i++) {
+        int status = 0;
+        waitpid(pids[i], &status, 0);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "follower " << i;
+        int64_t error = 0;
+        ASSERT_EQ(read(pipes[i][0], &error, sizeof(error)), static_cast<ssize_t>(sizeof(error)));
+        std::printf("follower %d (%+lld ppm): sync error %lld us\n", i, static_cast<long long>(skews_ppm[i]),
+                    static_cast<long long>(error));
+        EXPECT_LT(std::abs(error), 2000) << "follower " << i;
+        close(pipes[i][0]);
+        close(pipes[i][1]);
+        close(sockets[i]);
+    }
+}
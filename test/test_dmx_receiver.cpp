@@ -0,0 +1,172 @@
+#include "../src/net/dmx_receiver.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+etl::array<uint8_t, 638> packet;
+etl::array<uint8_t, 510> channels;
+
+void fill_channels(uint8_t seed) {
+    for (size_t i = 0; i < channels.size(); i++) {
+        channels[i] = static_cast<uint8_t>(seed + i);
+    }
+}
+
+etl::span<const uint8_t> e131(uint16_t universe, uint8_t sequence, uint16_t sync = 0) {
+    size_t len = dmx::build_e131_data(packet, universe, sequence, channels, sync);
+    return etl::span<const uint8_t>(packet.data(), len);
+}
+
+etl::span<const uint8_t> artnet(uint16_t universe) {
+    size_t len = dmx::build_artnet_dmx(packet, universe, 0, channels);
+    return etl::span<const uint8_t>(packet.data(), len);
+}
+
+bool pixel_is(const Frame& frame, unsigned int i, uint8_t r) {
+    const RGBValue& p = frame.data[i];
+    return p.r == r && p.g == static_cast<uint8_t>(r + 1) && p.b == static_cast<uint8_t>(r + 2);
+}
+
+} // namespace
+
+
+TEST(DmxReceiver, E131LatchesWhenAllUniversesArrive) {
+    static FrameSwapChain chain(300);
+    DmxReceiver rx(chain, 1, DmxReceiver::universes_for(300));
+
+    fill_channels(0);
+    EXPECT_EQ(rx.on_packet(e131(1, 0)), DmxReceiver::Result::Data);
+    EXPECT_EQ(chain.presented(), 0u);
+    fill_channels(100);
+    EXPECT_EQ(rx.on_packet(e131(2, 0)), DmxReceiver::Result::Latched);
+    EXPECT_EQ(chain.presented(), 1u);
+
+    const Frame& front = chain.front();
+    EXPECT_TRUE(pixel_is(front, 0, 0));
+    EXPECT_TRUE(pixel_is(front, 169, static_cast<uint8_t>(169 * 3)));
+    EXPECT_TRUE(pixel_is(front, 170, 100));
+    EXPECT_TRUE(pixel_is(front, 299, static_cast<uint8_t>(100 + 129 * 3)));
+    EXPECT_EQ(rx.stats().partial, 0u);
+}
+
+TEST(DmxReceiver, E131Sync) {
+    static FrameSwapChain chain(340);
+    DmxReceiver rx(chain, 1, 2);
+    etl::array<uint8_t, 64> sync;
+
+    EXPECT_EQ(rx.on_packet(e131(1, 0, 7)), DmxReceiver::Result::Data);
+    EXPECT_EQ(rx.on_packet(e131(2, 0, 7)), DmxReceiver::Result::Data);    // waits for sync
+    EXPECT_EQ(rx.on_packet(e131(1, 1, 7)), DmxReceiver::Result::Data);    // no partial latch
+    EXPECT_EQ(chain.presented(), 0u);
+    size_t len = dmx::build_e131_sync(sync, 7, 0);
+    EXPECT_EQ(rx.on_packet(etl::span<const uint8_t>(sync.data(), len)), DmxReceiver::Result::Latched);
+    EXPECT_EQ(chain.presented(), 1u);
+    EXPECT_TRUE(rx.is_synced());
+}
+
+TEST(DmxReceiver, SyncWithoutDataKeepsFront) {
+    static FrameSwapChain chain(340);
+    DmxReceiver rx(chain, 1, 2);
+    etl::array<uint8_t, 64> sync;
+    size_t len = dmx::build_e131_sync(sync, 7, 0);
+    etl::span<const uint8_t> sync_packet(sync.data(), len);
+
+    fill_channels(10);
+    EXPECT_EQ(rx.on_packet(e131(1, 0, 7)), DmxReceiver::Result::Data);
+    EXPECT_EQ(rx.on_packet(e131(2, 0, 7)), DmxReceiver::Result::Data);
+    EXPECT_EQ(rx.on_packet(sync_packet), DmxReceiver::Result::Latched);
+    const Frame* front = &chain.front();
+    EXPECT_TRUE(pixel_is(*front, 0, 10));
+
+    // a repeated sync doesn't present the back buffer, which holds the frame before last
+    EXPECT_EQ(rx.on_packet(sync_packet), DmxReceiver::Result::Ignored);
+    EXPECT_EQ(chain.presented(), 1u);
+    EXPECT_EQ(&chain.front(), front);
+    EXPECT_TRUE(pixel_is(chain.front(), 0, 10));
+    EXPECT_EQ(rx.stats().syncs, 2u);
+}
+
+TEST(DmxReceiver, E131SequenceAndFiltering) {
+    static FrameSwapChain chain(170);
+    DmxReceiver rx(chain, 1, 1);
+
+    EXPECT_EQ(rx.on_packet(e131(1, 10)), DmxReceiver::Result::Latched);
+    EXPECT_EQ(rx.on_packet(e131(1, 9)), DmxReceiver::Result::Ignored);     // late
+    EXPECT_EQ(rx.on_packet(e131(1, 10)), DmxReceiver::Result::Ignored);    // duplicate
+    EXPECT_EQ(rx.on_packet(e131(1, 200)), DmxReceiver::Result::Latched);   // jump ahead
+    EXPECT_EQ(rx.stats().out_of_order, 2u);
+
+    EXPECT_EQ(rx.on_packet(e131(5, 201)), DmxReceiver::Result::Ignored);   // not our universe
+    auto preview = e131(1, 201);
+    packet[dmx::E131_OPTIONS] = dmx::E131_OPTION_PREVIEW;
+    EXPECT_EQ(rx.on_packet(preview), DmxReceiver::Result::Ignored);
+
+    auto truncated = e131(1, 202);
+    EXPECT_EQ(rx.on_packet(truncated.first(200)), DmxReceiver::Result::Invalid);
+    etl::array<uint8_t, 4> junk {1, 2, 3, 4};
+    EXPECT_EQ(rx.on_packet(junk), DmxReceiver::Result::Invalid);
+}
+
+TEST(DmxReceiver, ArtNetPartialFrameOnLoss) {
+    static FrameSwapChain chain(510);
+    DmxReceiver rx(chain, 0, 3);
+
+    fill_channels(3);
+    EXPECT_EQ(rx.on_packet(artnet(0)), DmxReceiver::Result::Data);
+    EXPECT_EQ(rx.on_packet(artnet(1)), DmxReceiver::Result::Data);
+    // universe 2 lost, the next frame starts: latch what we have
+    EXPECT_EQ(rx.on_packet(artnet(0)), DmxReceiver::Result::Latched);
+    EXPECT_EQ(rx.stats().partial, 1u);
+    EXPECT_TRUE(pixel_is(chain.front(), 200, static_cast<uint8_t>(3 + 30 * 3)));
+
+    etl::array<uint8_t, 14> sync;
+    dmx::build_artnet_sync(sync);
+    EXPECT_EQ(rx.on_packet(sync), DmxReceiver::Result::Latched);
+    EXPECT_EQ(chain.presented(), 2u);
+}
+
+TEST(DmxReceiver, UdpLoopback) {
+    int rx_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int tx_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(rx_sock, 0);
+    ASSERT_GE(tx_sock, 0);
+
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;   // any free port, E1.31's 5568 may be in use
+    ASSERT_EQ(bind(rx_sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    socklen_t addr_len = sizeof(addr);
+    ASSERT_EQ(getsockname(rx_sock, reinterpret_cast<sockaddr*>(&addr), &addr_len), 0);
+
+    static FrameSwapChain chain(1000);
+    const uint16_t universes = DmxReceiver::universes_for(1000);
+    DmxReceiver rx(chain, 1, universes);
+    constexpr int frames = 50;
+
+    etl::array<uint8_t, 638> buffer;
+    for (int f = 0; f < frames; f++) {
+        fill_channels(static_cast<uint8_t>(f));
+        for (uint16_t u = 1; u <= universes; u++) {
+            auto p = e131(u, static_cast<uint8_t>(f));
+            ASSERT_EQ(sendto(tx_sock, p.data(), p.size(), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)),
+                      static_cast<ssize_t>(p.size()));
+            ssize_t n = recv(rx_sock, buffer.data(), buffer.size(), 0);
+            ASSERT_GT(n, 0);
+            rx.on_packet(etl::span<const uint8_t>(buffer.data(), static_cast<size_t>(n)));
+        }
+        ASSERT_EQ(chain.presented(), static_cast<uint32_t>(f + 1));
+        ASSERT_TRUE(pixel_is(chain.front(), 999, static_cast<uint8_t>(f + (999 - 5 * 170) * 3)));
+    }
+    EXPECT_EQ(rx.stats().packets, static_cast<uint32_t>(frames * universes));
+    EXPECT_EQ(rx.stats().partial, 0u);
+
+    close(tx_sock);
+    close(rx_sock);
+}
@@ -0,0 +1,147 @@
+#include "../src/effects/effect_vm.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+namespace {
+
+etl::array<uint16_t, 4> mags {10, 20, 30, 40};
+
+void draw(VmEffect& vm, Frame& frame, uint32_t elapsed_us = 1000) {
+    DrawInfo<uint16_t, 4> info {elapsed_us, mags};
+    vm.draw_frame(frame, info);
+}
+
+} // namespace
+
+
+TEST(EffectVm, RejectsInvalidBlobs) {
+    VmEffect vm;
+    const uint8_t short_blob[] = {'L', 'D', 'V', 'M'};
+    EXPECT_EQ(vm.load(etl::span<const uint8_t>(short_blob, sizeof(short_blob))), VmEffect::LoadResult::TooShort);
+
+    VmAssembler<64> no_output;
+    no_output.pixel(VmOp::MOV, 4, 0);
+    EXPECT_EQ(vm.load(no_output.build()), VmEffect::LoadResult::NoPixelOutput);
+
+    VmAssembler<64> bad_reg;
+    bad_reg.pixel(VmOp::OUT, 0, 16);
+    EXPECT_EQ(vm.load(bad_reg.build()), VmEffect::LoadResult::BadRegister);
+
+    VmAssembler<64> bad_op;
+    bad_op.pixel(static_cast<VmOp>(200), 0, 0);
+    bad_op.pixel(VmOp::OUT, 0, 0);
+    EXPECT_EQ(vm.load(bad_op.build()), VmEffect::LoadResult::BadOpcode);
+
+    VmAssembler<64> ok;
+    ok.pixel(VmOp::OUT, 0, 0);
+    etl::span<const uint8_t> blob = ok.build();
+    etl::array<uint8_t, 64> corrupt;
+    std::copy(blob.begin(), blob.end(), corrupt.begin());
+    corrupt[0] = 'X';
+    EXPECT_EQ(vm.load(etl::span<const uint8_t>(corrupt.data(), blob.size())), VmEffect::LoadResult::BadMagic);
+    EXPECT_FALSE(vm.is_loaded());
+}
+
+TEST(EffectVm, DrawsBlackWithoutProgram) {
+    VmEffect vm;
+    Frame frame(8);
+    std::fill(frame.data.begin(), frame.data.end(), WHITE);
+    draw(vm, frame);
+    EXPECT_EQ(frame.data[7].r, 0);
+}
+
+TEST(EffectVm, PixelProgramWritesEveryLed) {
+    // red = index * 10, green clamped from 300, blue = FFT bin 2
+    VmAssembler<128> a;
+    a.pixel_const(4, 10);
+    a.pixel(VmOp::MUL, 5, 0, 4);
+    a.pixel_const(6, 300);
+    a.pixel_const(7, 2);
+    a.pixel(VmOp::AUD, 7, 7);
+    a.pixel(VmOp::RGB, 5, 6, 7);
+
+    VmEffect vm;
+    ASSERT_EQ(vm.load(a.build()), VmEffect::LoadResult::Ok);
+    Frame frame(10);
+    draw(vm, frame);
+    for (unsigned int i = 0; i < frame.num_leds; i++) {
+        EXPECT_EQ(frame.data[i].r, i * 10);
+        EXPECT_EQ(frame.data[i].g, 255);
+        EXPECT_EQ(frame.data[i].b, 30);
+    }
+}
+
+TEST(EffectVm, FrameProgramKeepsStateAndPalette) {
+    // r8 counts frames, pixels are the palette at 0 (first entry) or 255 (last entry)
+    VmAssembler<128> a;
+    a.palette({RED, BLUE});
+    a.frame_const(4, 1);
+    a.frame(VmOp::ADD, 8, 8, 4);
+    a.pixel_const(4, 1);
+    a.pixel(VmOp::AND, 4, 0, 4);        // odd LED?
+    a.pixel_const(5, 255);
+    a.pixel(VmOp::MUL, 4, 4, 5);
+    a.pixel(VmOp::PAL, 4, 4);
+    a.pixel(VmOp::OUT, 0, 4);
+
+    VmEffect vm;
+    ASSERT_EQ(vm.load(a.build()), VmEffect::LoadResult::Ok);
+    Frame frame(4);
+    for (int i = 0; i < 3; i++) {
+        draw(vm, frame);
+    }
+    EXPECT_EQ(vm.reg(8), 3);
+    EXPECT_EQ(frame.data[0].r, 255);
+    EXPECT_EQ(frame.data[0].b, 0);
+    EXPECT_EQ(frame.data[1].r, 0);
+    EXPECT_EQ(frame.data[1].b, 255);
+}
+
+TEST(EffectVm, LargeConstants) {
+    VmAssembler<64> a;
+    a.pixel_const(4, 0x00123456);
+    a.pixel(VmOp::OUT, 0, 4);
+    VmEffect vm;
+    ASSERT_EQ(vm.load(a.build()), VmEffect::LoadResult::Ok);
+    Frame frame(1);
+    draw(vm, frame);
+    EXPECT_EQ(frame.data[0].r, 0x12);
+    EXPECT_EQ(frame.data[0].g, 0x34);
+    EXPECT_EQ(frame.data[0].b, 0x56);
+}
+
+namespace {
+
+// MULQ15 of two constants, read back through OUT: the low 24 bits, then the top 8
+int32_t run_mulq15(int32_t x, int32_t y) {
+    uint32_t result = 0;
+    for (uint8_t shift : {0, 24}) {
+        VmAssembler<64> a;
+        a.pixel_const(4, x);
+        a.pixel_const(5, y);
+        a.pixel(VmOp::MULQ15, 6, 4, 5);
+        a.pixel(VmOp::SHRI, 6, 6, shift);
+        a.pixel(VmOp::OUT, 0, 6);
+        VmEffect vm;
+        EXPECT_EQ(vm.load(a.build()), VmEffect::LoadResult::Ok);
+        Frame frame(1);
+        draw(vm, frame);
+        const RGBValue& c = frame.data[0];
+        uint32_t rgb = (static_cast<uint32_t>(c.r) << 16) | (static_cast<uint32_t>(c.g) << 8) | c.b;
+        result |= shift == 0 ? rgb : (rgb & 0xFF) << 24;
+    }
+    return static_cast<int32_t>(result);
+}
+
+} // namespace
+
+// the product is taken in 64 bits: operands past Q15 range scale, then saturate, rather than wrap
+TEST(EffectVm, MulQ15LargeOperands) {
+    EXPECT_EQ(run_mulq15(16384, 16384), 8192);                 // 0.5 * 0.5
+    EXPECT_EQ(run_mulq15(-32768, 32767), -32767);
+    EXPECT_EQ(run_mulq15(1 << 20, 1 << 20), 1 << 25);          // 2^40 >> 15, wrapped to 0 in 32 bits
+    EXPECT_EQ(run_mulq15(100'000, -300'000), -915'528);       // the shift rounds down
+    EXPECT_EQ(run_mulq15(INT32_MAX, INT32_MAX), INT32_MAX);
+    EXPECT_EQ(run_mulq15(INT32_MIN, INT32_MAX), INT32_MIN);
+    EXPECT_EQ(run_mulq15(INT32_MIN, INT32_MIN), INT32_MAX);
+}
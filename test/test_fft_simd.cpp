@@ -0,0 +1,102 @@
+#include "../src/fft_simd.h"
+#include "../src/fixedpoint_fft.h"
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+namespace {
+
+uint32_t next(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 16;
+}
+
+// the SIMD butterflies clamp exactly as `mul_sat`, `add_sat` and `sub_sat` do
+TEST(FftSimd, ButterfliesMatchScalar) {
+    if (!fft_simd::available) {
+        GTEST_SKIP() << "no SIMD kernel for this target";
+    }
+    constexpr size_t n = 64;
+    const int16_t extremes[] = {-32768, -32767, -16384, -1, 0, 1, 16384, 32767};
+    uint32_t state = 7;
+    for (int round = 0; round < 200; round++) {
+        ComplexQ15 a[n];
+        ComplexQ15 b[n];
+        ComplexQ15 w[n];
+        for (size_t i = 0; i < n; i++) {
+            // every other round from the extremes only, where the clamping is
+            auto value = [&]() {
+                uint32_t r = next(state);
+                return round % 2 == 0 ? static_cast<int16_t>(r) : extremes[r % 8];
+            };
+            a[i] = {Q15::from_raw(value()), Q15::from_raw(value())};
+            b[i] = {Q15::from_raw(value()), Q15::from_raw(value())};
+            w[i] = {Q15::from_raw(value()), Q15::from_raw(value())};
+        }
+        ComplexQ15 expected_a[n];
+        ComplexQ15 expected_b[n];
+        for (size_t i = 0; i < n; i++) {
+            ComplexQ15 t = mul_sat(b[i], w[i]);
+            expected_b[i] = sub_sat(a[i], t);
+            expected_a[i] = add_sat(a[i], t);
+        }
+        fft_simd::butterflies(a, b, w, n);
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(a[i].re.raw(), expected_a[i].re.raw()) << round << " " << i;
+            ASSERT_EQ(a[i].im.raw(), expected_a[i].im.raw()) << round << " " << i;
+            ASSERT_EQ(b[i].re.raw(), expected_b[i].re.raw()) << round << " " << i;
+            ASSERT_EQ(b[i].im.raw(), expected_b[i].im.raw()) << round << " " << i;
+        }
+    }
+}
+
+// the stage twiddles are the ones the scalar loop reads from the table
+TEST(FftSimd, StageTwiddlesMatchTable) {
+    constexpr uint16_t N = 256;
+    const auto& table = fft_detail::tables<N, WindowType::Hann>.twiddle;
+    const auto& stages = fft_detail::stage_twiddles<N>.w;
+    for (uint32_t m2 = 1; m2 < N; m2 <<= 1) {
+        for (uint32_t j = 0; j < m2; j++) {
+            const uint32_t idx = j * N / (2 * m2);
+            EXPECT_EQ(stages[m2 - 1 + j].re.raw(), table[idx].re.raw()) << m2 << " " << j;
+            EXPECT_EQ(stages[m2 - 1 + j].im.raw(), table[idx].im.raw()) << m2 << " " << j;
+        }
+    }
+}
+
+template <uint16_t N, typename OutputType, WindowType Window>
+void check_kernels(uint32_t seed) {
+    static FixedPointFFT<N, int16_t, OutputType, Window, FftKernel::Scalar> scalar;
+    static FixedPointFFT<N, int16_t, OutputType, Window, FftKernel::Simd> simd;
+    uint32_t state = seed;
+    for (int round = 0; round < 20; round++) {
+        etl::array<int16_t, N> input;
+        for (size_t i = 0; i < N; i++) {
+            // quiet noise, full scale noise, a full scale square wave, all -32768
+            uint32_t r = next(state);
+            switch (round % 4) {
+                case 0: input[i] = static_cast<int16_t>(static_cast<int16_t>(r) / 64); break;
+                case 1: input[i] = static_cast<int16_t>(r); break;
+                case 2: input[i] = (i / 8) % 2 == 0 ? 32767 : -32768; break;
+                default: input[i] = -32768; break;
+            }
+        }
+        etl::array<OutputType, N / 2 + 1> expected;
+        etl::array<OutputType, N / 2 + 1> actual;
+        scalar.magnitudes(input, expected);
+        simd.magnitudes(input, actual);
+        for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_EQ(actual[i], expected[i]) << "N " << N << " round " << round << " bin " << i;
+        }
+    }
+}
+
+TEST(FftSimd, MagnitudesBitExact) {
+    check_kernels<64, uint16_t, WindowType::Bartlett>(1);
+    check_kernels<256, uint16_t, WindowType::Hann>(2);
+    check_kernels<256, uint32_t, WindowType::BlackmanHarris>(3);
+    check_kernels<1024, uint16_t, WindowType::Hann>(4);
+    check_kernels<1024, uint32_t, WindowType::Bartlett>(5);
+}
+
+} // namespace
@@ -0,0 +1,122 @@
+#include "../src/fixed_point.h"
+#include <gtest/gtest.h>
+
+using namespace fixed_literals;
+
+namespace {
+
+// compile-time conversions
+static_assert(0.5_q15 == Q15::from_raw(16384), "0.5 in Q15");
+static_assert(Q15::from_double(-1.0) == Q15::min(), "-1 is representable");
+static_assert(-1.0_q15 == -Q15::max(), "a literal's sign is unary minus on the literal");
+static_assert(1.0_q15 == Q15::max(), "1 clamps to the largest Q15");
+static_assert(0.25_q31 == Q31::from_raw(1 << 29), "0.25 in Q31");
+static_assert(1.5_q16 == Q16_16::from_raw(3 << 15), "1.5 in 16.16");
+static_assert(3_q16 == Q16_16::from_int(3), "integer literal");
+static_assert(sizeof(Q15) == 2 && sizeof(ComplexQ15) == 4, "no overhead over the raw integers");
+
+// The helpers FixedPointFFT had before it used Q15, to check the types give the same results
+int16_t old_mul_q15(int16_t a, int16_t b) {
+    int32_t result = ((int32_t)a * (int32_t)b) >> 15;
+    if (result > 32767) return 32767;
+    if (result < -32768) return -32768;
+    return (int16_t)result;
+}
+
+int16_t old_add_sat(int16_t a, int16_t b) {
+    int32_t result = (int32_t)a + (int32_t)b;
+    if (result > 32767) return 32767;
+    if (result < -32768) return -32768;
+    return (int16_t)result;
+}
+
+int16_t old_sub_sat(int16_t a, int16_t b) {
+    int32_t result = (int32_t)a - (int32_t)b;
+    if (result > 32767) return 32767;
+    if (result < -32768) return -32768;
+    return (int16_t)result;
+}
+
+} // namespace
+
+
+TEST(FixedPoint, SaturatingQ15) {
+    EXPECT_EQ(add_sat(0.75_q15, 0.5_q15), Q15::max());
+    EXPECT_EQ(sub_sat(-0.75_q15, 0.5_q15), Q15::min());
+    EXPECT_EQ(mul_sat(Q15::min(), Q15::min()), Q15::max());    // -1 * -1
+    EXPECT_EQ(abs_sat(Q15::min()), Q15::max());
+    EXPECT_EQ(mul_sat(0.5_q15, 0.5_q15), 0.25_q15);
+    EXPECT_EQ(mul_sat(-0.5_q15, 0.5_q15), -0.25_q15);
+
+    // products truncate towards -infinity, like `>> 15`
+    EXPECT_EQ(mul_sat(Q15::from_raw(-1), Q15::from_raw(1)).raw(), -1);
+    EXPECT_EQ(mul_sat(Q15::from_raw(1), Q15::from_raw(1)).raw(), 0);
+}
+
+TEST(FixedPoint, WrappingQ15) {
+    EXPECT_EQ((0.75_q15 + 0.5_q15).raw(), static_cast<int16_t>(24576 + 16384 - 65536));
+    EXPECT_EQ(-Q15::min(), Q15::min());
+    EXPECT_EQ(Q15::min() - Q15::from_raw(1), Q15::max());
+
+    Q15 x = 0.5_q15;
+    x >>= 1;
+    EXPECT_EQ(x, 0.25_q15);
+    x += 0.25_q15;
+    EXPECT_EQ(x, 0.5_q15);
+}
+
+TEST(FixedPoint, Q31AndQ16_16) {
+    EXPECT_EQ(mul_sat(0.5_q31, -0.5_q31), -0.25_q31);
+    EXPECT_EQ(mul_sat(Q31::min(), Q31::min()), Q31::max());
+    EXPECT_EQ(add_sat(Q31::max(), 0.5_q31), Q31::max());
+
+    EXPECT_EQ((1.5_q16 * 2.5_q16), 3.75_q16);
+    EXPECT_EQ((1.5_q16 * 3).to_int(), 4);
+    EXPECT_EQ((-1.5_q16).to_int(), -2);        // floor
+    EXPECT_EQ(Q16_16::ratio(75'000, 50'000), 1.5_q16);
+    EXPECT_EQ(Q16_16::ratio(1, 3).raw(), 65536 / 3);
+    EXPECT_EQ(Q16_16::from_int(40'000), Q16_16::max());
+    EXPECT_EQ(mul_sat(Q16_16::from_int(20'000), 2), Q16_16::max());
+    EXPECT_DOUBLE_EQ((-2.25_q16).to_double(), -2.25);
+}
+
+TEST(FixedPoint, Casts) {
+    EXPECT_EQ(fixed_cast<Q31>(0.5_q15).raw(), 1 << 30);
+    EXPECT_EQ(fixed_cast<Q15>(-0.25_q31), -0.25_q15);
+    EXPECT_EQ(fixed_cast<Q16_16>(-0.5_q15), -0.5_q16);
+    EXPECT_EQ(fixed_cast<Q15>(2_q16), Q15::max());
+    EXPECT_EQ(fixed_cast<Q15>(-2_q16), Q15::min());
+}
+
+TEST(FixedPoint, Complex) {
+    // (0.5 + 0.25j) * (0 + 1j) = -0.25 + 0.5j
+    ComplexQ15 a {0.5_q15, 0.25_q15};
+    ComplexQ15 j {Q15{}, Q15::max()};
+    ComplexQ15 p = mul_sat(a, j);
+    EXPECT_NEAR(p.re.to_double(), -0.25, 1e-4);
+    EXPECT_NEAR(p.im.to_double(), 0.5, 1e-4);
+
+    EXPECT_EQ(add_sat(a, a), (ComplexQ15{Q15::max(), 0.5_q15}));
+    EXPECT_EQ(sub_sat(a, a), ComplexQ15{});
+    EXPECT_EQ(a + a - a, a);
+}
+
+TEST(FixedPoint, MatchesHandWrittenHelpers) {
+    uint32_t lcg = 1;
+    auto next = [&lcg]() {
+        lcg = lcg * 1664525 + 1013904223;
+        return static_cast<int16_t>(lcg >> 16);
+    };
+    for (int i = 0; i < 100'000; i++) {
+        int16_t a = next();
+        int16_t b = next();
+        // include the edges, where saturation happens
+        if (i % 16 == 0) a = -32768;
+        if (i % 16 == 1) b = 32767;
+        Q15 qa = Q15::from_raw(a);
+        Q15 qb = Q15::from_raw(b);
+        ASSERT_EQ(mul_sat(qa, qb).raw(), old_mul_q15(a, b));
+        ASSERT_EQ(add_sat(qa, qb).raw(), old_add_sat(a, b));
+        ASSERT_EQ(sub_sat(qa, qb).raw(), old_sub_sat(a, b));
+    }
+}
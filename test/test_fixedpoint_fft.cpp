@@ -1,6 +1,7 @@
 #include "../src/fixedpoint_fft.h"
 #include <gtest/gtest.h>
 #include "etl/array.h"
+#include <cstring>
 
 // Demonstrate some basic assertions.
 TEST(eFFT_Fixed_Unknown, SineWave) {
@@ -64,11 +65,50 @@ TEST(eFFT_Fixed_Unknown, SineWave) {
     fft.magnitudes(samples, magnitudes);
 
     printf("FFT abs output ):\n");
-    for (size_t i = 0; i < 256; ++i) {
-        printf("[%03d] %d\n", i, magnitudes[i]);
+    for (size_t i = 0; i < magnitudes.size(); ++i) {
+        printf("[%03zu] %d\n", i, magnitudes[i]);
     }
     printf("\n");
     //EXPECT_EQ(out[0].real, 205407); // DC component should be near zero for AC-coupled input
     
 
-}
\ No newline at end of file
+}
+TEST(eFFT_Fixed_Unknown, TablesAtCompileTime) {
+    // the tables are constants shared by every FFT of a size and window, so an FFT is empty
+    constexpr const fft_detail::Tables<256, WindowType::Hann>& tables = fft_detail::tables<256, WindowType::Hann>;
+    static_assert(tables.twiddle[0].re.raw() == 32767 && tables.twiddle[0].im.raw() == 0, "W^0 = 1");
+    static_assert(tables.twiddle[64].re.raw() == 0 && tables.twiddle[64].im.raw() == -32767, "W^(N/4) = -j");
+    static_assert(tables.window_coeffs[0].raw() <= 1 && tables.window_coeffs[64].raw() == 16384, "Hann");
+    static_assert(tables.bit_reverse[1] == 128 && tables.bit_reverse[255] == 255, "8 bit reversal");
+    static_assert(sizeof(FixedPointFFT<256, int16_t, uint16_t, WindowType::Hann>) == 1, "no tables per FFT");
+
+    bool seen[256] = {};
+    for (uint16_t j : tables.bit_reverse) {
+        EXPECT_FALSE(seen[j]);
+        seen[j] = true;
+    }
+}
+
+// the work buffer from an arena gives the same magnitudes, and is given back
+TEST(eFFT_Fixed_Unknown, ArenaWorkBuffer) {
+    constexpr int N = 256;
+    using FFT = FixedPointFFT<N, int16_t, uint16_t, WindowType::Hann>;
+    etl::array<int16_t, N> samples;
+    for (int i = 0; i < N; i++) {
+        samples[i] = static_cast<int16_t>((i * 7919) % 20000 - 10000);
+    }
+    FFT fft;
+    etl::array<uint16_t, N / 2 + 1> expected;
+    etl::array<uint16_t, N / 2 + 1> actual;
+    fft.magnitudes(samples, expected);
+
+    StaticArena<FFT::work_bytes> arena;
+    ASSERT_TRUE(fft.magnitudes(samples, actual, arena));
+    EXPECT_TRUE(actual == expected);
+    EXPECT_EQ(arena.used(), 0u);
+    EXPECT_EQ(arena.high_water(), FFT::work_bytes);
+
+    StaticArena<FFT::work_bytes - 4> small;
+    EXPECT_FALSE(fft.magnitudes(samples, actual, small));
+    EXPECT_EQ(small.failures(), 1u);
+}
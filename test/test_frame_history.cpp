@@ -0,0 +1,140 @@
+#include "../src/frame_history.h"
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+using namespace fixed_literals;
+
+namespace {
+
+RGBValue colour(unsigned int seed) {
+    uint32_t x = seed * 2654435761u;
+    return RGBValue{static_cast<uint8_t>(x >> 24), static_cast<uint8_t>(x >> 16), static_cast<uint8_t>(x >> 8)};
+}
+
+void fill(Frame& frame, RGBValue c) {
+    std::fill(frame.data.begin(), frame.data.end(), c);
+}
+
+// largest difference in any channel
+template <typename Format>
+int round_trip_error(RGBValue a, RGBValue b) {
+    etl::array<RGBValue, 2> pixels {a, b};
+    uint8_t packed[Format::bytes(2)];
+    Format::encode(pixels, packed);
+    int err = 0;
+    for (size_t i = 0; i < 2; i++) {
+        RGBValue d = Format::decode(packed, i);
+        err = std::max({err, std::abs(d.r - pixels[i].r), std::abs(d.g - pixels[i].g), std::abs(d.b - pixels[i].b)});
+    }
+    return err;
+}
+
+} // namespace
+
+
+TEST(FrameHistory, SlotSizes) {
+    static_assert(FrameHistory<history_format::Rgb888, 4, 100>::slot_bytes == 300, "3 bytes/pixel");
+    static_assert(FrameHistory<history_format::Yuv422, 4, 100>::slot_bytes == 200, "2 bytes/pixel");
+    static_assert(FrameHistory<history_format::Yuv422, 4, 101>::slot_bytes == 204, "whole pairs");
+    static_assert(FrameHistory<history_format::Rgb332, 4, 100>::bytes == 400, "1 byte/pixel");
+    EXPECT_GE(sizeof(FrameHistory<history_format::Rgb332, 4, 100>), 400u);
+}
+
+TEST(FrameHistory, Formats) {
+    for (unsigned int i = 0; i < 1000; i++) {
+        RGBValue c = colour(i);
+        ASSERT_EQ(round_trip_error<history_format::Rgb888>(c, colour(i + 1)), 0);
+        ASSERT_LE(round_trip_error<history_format::Rgb332>(c, colour(i + 1)), 43);     // nearest level; blue's are 85 apart
+        // a pair of one colour keeps it, up to rounding
+        ASSERT_LE(round_trip_error<history_format::Yuv422>(c, c), 5) << i;
+    }
+    // black, white and full colours are exact
+    for (RGBValue c : {BLACK, WHITE, RED, LIME, BLUE, YELLOW}) {
+        EXPECT_EQ(round_trip_error<history_format::Rgb332>(c, c), 0);
+        EXPECT_LE(round_trip_error<history_format::Yuv422>(c, c), 2);
+    }
+    // 4:2:2 keeps each pixel's brightness: exactly for greys (e.g. a fading white trail), and
+    // the brighter of a pair of colours stays brighter
+    EXPECT_LE(round_trip_error<history_format::Yuv422>(WHITE, RGBValue{40, 40, 40}), 1);
+    etl::array<RGBValue, 2> pair {RGBValue{200, 0, 0}, RGBValue{0, 0, 40}};
+    uint8_t packed[4];
+    history_format::Yuv422::encode(pair, packed);
+    EXPECT_GT(history_format::Yuv422::luma(history_format::Yuv422::decode(packed, 0)),
+              history_format::Yuv422::luma(history_format::Yuv422::decode(packed, 1)) + 30);
+}
+
+TEST(FrameHistory, Ring) {
+    static FrameHistory<history_format::Rgb888, 4, 16> history;
+    Frame frame(16);
+    EXPECT_EQ(history.size(), 0u);
+    EXPECT_FALSE(history.add_to(frame, 1, 0.5_q15));
+
+    for (unsigned int t = 0; t < 10; t++) {
+        fill(frame, colour(t));
+        history.push(frame);
+        ASSERT_EQ(history.size(), std::min(t + 1, 4u));
+        // frame t-k is the one pushed k frames ago
+        for (unsigned int k = 1; k <= history.size(); k++) {
+            ASSERT_EQ(history.pixel(k, 15).as_RGB(), colour(t + 1 - k).as_RGB()) << t << " " << k;
+        }
+        EXPECT_EQ(history.pixel(history.size() + 1, 0).as_RGB(), 0u);
+    }
+
+    // another strip length starts again
+    Frame other(8);
+    history.push(other);
+    EXPECT_EQ(history.size(), 1u);
+    history.clear();
+    EXPECT_EQ(history.size(), 0u);
+}
+
+TEST(FrameHistory, Echo) {
+    static FrameHistory<history_format::Rgb888, 8, 32> history;
+    Frame frame(32);
+    fill(frame, BLACK);
+    frame.data[4] = RGBValue{200, 100, 0};
+    history.push(frame);
+    fill(frame, BLACK);
+    history.push(frame);
+
+    // half of the frame before last, 10 LEDs on
+    fill(frame, RGBValue{10, 10, 10});
+    ASSERT_TRUE(history.add_to(frame, 2, 0.5_q15, 10));
+    EXPECT_EQ(frame.data[14].as_RGB(), (RGBValue{110, 60, 10}.as_RGB()));
+    EXPECT_EQ(frame.data[4].as_RGB(), (RGBValue{10, 10, 10}.as_RGB()));
+    // LEDs shifted in from before the start are left alone
+    for (unsigned int i = 0; i < 10; i++) {
+        EXPECT_EQ(frame.data[i].as_RGB(), (RGBValue{10, 10, 10}.as_RGB())) << i;
+    }
+
+    // backwards, and saturating
+    fill(frame, RGBValue{250, 0, 0});
+    ASSERT_TRUE(history.add_to(frame, 2, Q15::max(), -3));
+    EXPECT_EQ(frame.data[1].as_RGB(), (RGBValue{255, 99, 0}.as_RGB()));
+
+    // lighten: the brightest of the two
+    fill(frame, RGBValue{150, 150, 150});
+    ASSERT_TRUE(history.add_to(frame, 2, Q15::max(), 0, HistoryBlend::Lighten));
+    EXPECT_EQ(frame.data[4].as_RGB(), (RGBValue{199, 150, 150}.as_RGB()));
+}
+
+TEST(FrameHistory, Feedback) {
+    // a dot moving one LED per frame leaves a trail that fades by half each frame
+    static FrameHistory<history_format::Yuv422, 2, 64> history;
+    Frame frame(64);
+    for (unsigned int t = 0; t < 20; t++) {
+        fill(frame, BLACK);
+        frame.data[t] = WHITE;
+        history.add_to(frame, 1, 0.5_q15);
+        history.push(frame);
+    }
+    EXPECT_EQ(frame.data[19].as_RGB(), 0xFFFFFF00u);
+    int previous = 255;
+    for (unsigned int i = 18; i > 10; i--) {
+        int level = frame.data[i].g;
+        EXPECT_NEAR(level, previous / 2, 2) << i;
+        previous = level;
+    }
+    EXPECT_EQ(frame.data[20].as_RGB(), 0u);
+}
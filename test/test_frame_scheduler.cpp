@@ -0,0 +1,202 @@
+#include "../src/frame_scheduler.h"
+#include "../src/effects/effect_factory.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+namespace {
+
+uint64_t fake_now = 0;
+
+uint64_t fake_clock() {
+    return fake_now;
+}
+
+etl::array<uint16_t, 4> mags {10, 20, 30, 40};
+
+// a clock on which every frame takes 10ms
+uint64_t slow_clock() {
+    static uint64_t now = 0;
+    return now += 10'000;
+}
+
+/**
+ * @brief An effect whose frames take `cost_us >> level` on the fake clock.
+ */
+class SlowEffect : public EffectBase<SlowEffect> {
+
+    public:
+
+    uint32_t cost_us = 0;
+    uint8_t lod = 0;
+
+    template <typename FreqT, unsigned int FreqN>
+    void draw_frame([[maybe_unused]] Frame& frame, [[maybe_unused]] DrawInfo<FreqT, FreqN>& info) {
+        fake_now += cost_us >> lod;
+    }
+
+    uint8_t lod_levels() const {
+        return 4;
+    }
+
+    void set_lod(uint8_t level) {
+        lod = level;
+    }
+};
+
+constexpr uint32_t BUDGET_US = 16'667;
+
+} // namespace
+
+
+TEST(FrameScheduler, StepsDownOnOverrunsAndBackUpWithHysteresis) {
+    FrameScheduler scheduler(BUDGET_US, fake_clock);
+    SlowEffect effect;
+    Frame frame(8);
+    DrawInfo<uint16_t, 4> info {BUDGET_US, mags};
+
+    effect.cost_us = 10'000;
+    for (int i = 0; i < 100; i++) {
+        scheduler.draw_frame(effect, frame, info);
+    }
+    EXPECT_EQ(scheduler.level(), 0);
+    EXPECT_EQ(scheduler.governor().stats().overruns, 0u);
+
+    // 3.6x over budget: level 2 (1/4 the cost) is the first that fits
+    effect.cost_us = 60'000;
+    LodParams params;
+    int frames_to_settle = 0;
+    while (scheduler.level() < 2) {
+        scheduler.draw_frame(effect, frame, info);
+        frames_to_settle++;
+        ASSERT_LT(frames_to_settle, 10);
+    }
+    EXPECT_EQ(frames_to_settle, 2 * params.overruns_to_coarsen);
+
+    // settled: no more overruns and no oscillation, even though level 1 would almost fit
+    uint32_t overruns = scheduler.governor().stats().overruns;
+    for (int i = 0; i < 300; i++) {
+        scheduler.draw_frame(effect, frame, info);
+        ASSERT_EQ(scheduler.level(), 2);
+    }
+    EXPECT_EQ(scheduler.governor().stats().overruns, overruns);
+    EXPECT_LE(scheduler.last_render_us(), BUDGET_US);
+
+    // the load drops: detail comes back one level at a time after `frames_to_refine` frames each
+    effect.cost_us = 6'000;
+    for (int i = 0; i < params.frames_to_refine - 1; i++) {
+        scheduler.draw_frame(effect, frame, info);
+    }
+    EXPECT_EQ(scheduler.level(), 2);
+    scheduler.draw_frame(effect, frame, info);
+    EXPECT_EQ(scheduler.level(), 1);
+    for (int i = 0; i < params.frames_to_refine; i++) {
+        scheduler.draw_frame(effect, frame, info);
+    }
+    EXPECT_EQ(scheduler.level(), 0);
+    EXPECT_EQ(scheduler.governor().stats().refined, 2u);
+}
+
+TEST(FrameScheduler, ClampsToTheDeepestLevel) {
+    LodGovernor governor(BUDGET_US);
+    governor.set_levels(3);
+    for (int i = 0; i < 20; i++) {
+        governor.update(BUDGET_US * 10);
+    }
+    EXPECT_EQ(governor.level(), 2);
+
+    governor.set_levels(1);     // e.g. the effect changed to one without levels
+    EXPECT_EQ(governor.level(), 0);
+    governor.update(BUDGET_US * 10);
+    EXPECT_EQ(governor.level(), 0);
+}
+
+TEST(FrameScheduler, FactoryEffectsWithoutLevelsAreUntouched) {
+    EffectFactory factory;
+    factory.set_effect(EffectFactory::LASER);
+    EXPECT_EQ(factory.lod_levels(), 1);
+    factory.set_lod(3);
+    EXPECT_EQ(factory.lod_levels(), 1);
+}
+
+TEST(FrameScheduler, VmEffectDecimatesAndInterpolates) {
+    // red = index * 8: linear, so interpolation at any level reproduces it exactly
+    VmAssembler<128> a;
+    a.pixel_const(4, 8);
+    a.pixel(VmOp::MUL, 5, 0, 4);
+    a.pixel_const(6, 0);
+    a.pixel(VmOp::RGB, 5, 6, 6);
+
+    VmEffect vm;
+    ASSERT_EQ(vm.load(a.build()), VmEffect::LoadResult::Ok);
+    ASSERT_EQ(vm.lod_levels(), VmEffect::LOD_LEVELS);
+    DrawInfo<uint16_t, 4> info {1000, mags};
+
+    for (uint8_t level = 0; level < VmEffect::LOD_LEVELS; level++) {
+        Frame frame(30);
+        vm.set_lod(level);
+        vm.draw_frame(frame, info);
+        for (unsigned int i = 0; i < frame.num_leds; i++) {
+            EXPECT_EQ(frame.data[i].r, i * 8) << "level " << int(level) << " pixel " << i;
+        }
+    }
+}
+
+TEST(FrameScheduler, SpectrumCoarsensUnderLoad) {
+    etl::array<uint16_t, 129> spectrum_mags {};
+    for (size_t i = 0; i < spectrum_mags.size(); i++) {
+        spectrum_mags[i] = static_cast<uint16_t>((i * 509) % 4000);
+    }
+    DrawInfo<uint16_t, 129> info {16'667, spectrum_mags};
+    EffectFactory factory;
+    factory.set_effect(EffectFactory::SPECTRUM);
+    ASSERT_EQ(factory.lod_levels(), SpectrumEffect::LOD_LEVELS);
+
+    // full detail, for comparison
+    SpectrumEffect full;
+    Frame reference(300);
+    full.draw_frame(reference, info);
+
+    FrameScheduler scheduler(5'000, slow_clock);    // 2x over budget every frame
+    Frame frame(300);
+    for (int i = 0; i < 10; i++) {
+        scheduler.draw_frame(factory, frame, info);
+    }
+    EXPECT_EQ(scheduler.level(), SpectrumEffect::LOD_LEVELS - 1);
+    EXPECT_EQ(scheduler.governor().stats().coarsened, SpectrumEffect::LOD_LEVELS - 1u);
+
+    // every 8th pixel is blended as at full detail, the ones between lie between them
+    constexpr unsigned int stride = 1u << (SpectrumEffect::LOD_LEVELS - 1);
+    for (unsigned int i = 0; i < frame.num_leds; i++) {
+        if (i % stride == 0) {
+            ASSERT_EQ(frame.data[i].as_RGB(), reference.data[i].as_RGB()) << i;
+        } else {
+            unsigned int before = i - i % stride;
+            unsigned int after = std::min(before + stride, frame.num_leds - 1);
+            uint8_t lo = std::min(frame.data[before].r, frame.data[after].r);
+            uint8_t hi = std::max(frame.data[before].r, frame.data[after].r);
+            ASSERT_GE(frame.data[i].r, lo) << i;
+            ASSERT_LE(frame.data[i].r, hi) << i;
+        }
+    }
+}
+
+// the heat moves the same at every level: only the colouring between every 2^level-th LED differs
+TEST(FrameScheduler, FireLevelsColourTheSameHeat) {
+    DrawInfo<uint16_t, 4> info {16'667, mags};
+    FireEffect full;
+    Frame reference(200);
+    for (int i = 0; i < 60; i++) {
+        full.draw_frame(reference, info);
+    }
+    for (uint8_t level = 1; level < FireEffect::LOD_LEVELS; level++) {
+        FireEffect fire;
+        fire.set_lod(level);
+        Frame frame(200);
+        for (int i = 0; i < 60; i++) {
+            fire.draw_frame(frame, info);
+        }
+        for (unsigned int i = 0; i < frame.num_leds; i += 1u << level) {
+            ASSERT_EQ(frame.data[i].as_RGB(), reference.data[i].as_RGB()) << "level " << int(level) << " LED " << i;
+        }
+    }
+}
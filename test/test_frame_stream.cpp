@@ -0,0 +1,161 @@
+#include "../src/serial/frame_stream.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <thread>
+
+namespace {
+
+constexpr int NUM_LEDS = 300;
+etl::array<uint8_t, frame_stream::packet_bytes(MAX_LEDS)> packet;
+
+size_t encode_frame(uint8_t seed, int num_leds = NUM_LEDS) {
+    static RGBValue pixels[MAX_LEDS];
+    for (int i = 0; i < num_leds; i++) {
+        pixels[i] = RGBValue{static_cast<uint8_t>(seed + i), static_cast<uint8_t>(i), seed};
+    }
+    return frame_stream::encode(etl::span<const RGBValue>(pixels, num_leds), packet);
+}
+
+bool frame_is(const Frame& frame, uint8_t seed, int num_leds = NUM_LEDS) {
+    for (int i = 0; i < num_leds; i++) {
+        const RGBValue& p = frame.data[i];
+        if (p.r != static_cast<uint8_t>(seed + i) || p.g != static_cast<uint8_t>(i) || p.b != seed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+
+TEST(FrameStream, Crc32) {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    EXPECT_EQ(Crc32().update(check, sizeof(check)).value(), 0xCBF43926u);
+}
+
+TEST(FrameStream, ReceivesInAnyChunks) {
+    static FrameSwapChain chain(NUM_LEDS);
+    FrameStreamReceiver rx(chain);
+
+    for (size_t chunk : {size_t(1), size_t(7), size_t(64), frame_stream::packet_bytes(NUM_LEDS)}) {
+        uint8_t seed = static_cast<uint8_t>(chunk);
+        size_t len = encode_frame(seed);
+        for (size_t i = 0; i < len; i += chunk) {
+            rx.feed(etl::span<const uint8_t>(packet.data() + i, std::min(chunk, len - i)));
+        }
+        EXPECT_TRUE(rx.is_idle());
+        EXPECT_TRUE(frame_is(chain.front(), seed)) << "chunk " << chunk;
+    }
+    EXPECT_EQ(rx.stats().frames, 4u);
+    EXPECT_EQ(rx.stats().crc_errors, 0u);
+}
+
+TEST(FrameStream, DmaStyleReceive) {
+    static FrameSwapChain chain(NUM_LEDS);
+    FrameStreamReceiver rx(chain);
+    size_t len = encode_frame(9);
+
+    // fill exactly what rx_buffer asks for, as the DMA channel does; pixels land in the back frame
+    size_t pos = 0;
+    bool pixels_in_frame = false;
+    while (pos < len) {
+        etl::span<uint8_t> dest = rx.rx_buffer();
+        pixels_in_frame |= dest.data() == reinterpret_cast<uint8_t*>(chain.back().data.data());
+        std::memcpy(dest.data(), packet.data() + pos, dest.size());
+        rx.received(dest.size());
+        pos += dest.size();
+    }
+    EXPECT_TRUE(pixels_in_frame);
+    EXPECT_EQ(rx.stats().frames, 1u);
+    EXPECT_TRUE(frame_is(chain.front(), 9));
+}
+
+TEST(FrameStream, DropsCorruptAndResyncs) {
+    static FrameSwapChain chain(NUM_LEDS);
+    FrameStreamReceiver rx(chain);
+
+    size_t len = encode_frame(1);
+    rx.feed(etl::span<const uint8_t>(packet.data(), len));
+    ASSERT_EQ(chain.presented(), 1u);
+
+    // corrupt pixel: dropped, front unchanged
+    len = encode_frame(2);
+    packet[100] ^= 0x10;
+    rx.feed(etl::span<const uint8_t>(packet.data(), len));
+    EXPECT_EQ(rx.stats().crc_errors, 1u);
+    EXPECT_EQ(chain.presented(), 1u);
+    EXPECT_TRUE(frame_is(chain.front(), 1));
+
+    // garbage (including a false sync) then a good frame
+    const uint8_t garbage[] = {0x00, 0xA5, 0x00, 0xA5, 0xA5, 0x5A, 0x7F, 0x00, 0x00, 0x13};
+    rx.feed(garbage);
+    EXPECT_EQ(rx.stats().bad_headers, 1u);
+    len = encode_frame(3);
+    rx.feed(etl::span<const uint8_t>(packet.data(), len));
+    EXPECT_EQ(chain.presented(), 2u);
+    EXPECT_TRUE(frame_is(chain.front(), 3));
+
+    // more pixels than the receiver has
+    len = encode_frame(4, NUM_LEDS + 1);
+    rx.feed(etl::span<const uint8_t>(packet.data(), len));
+    EXPECT_EQ(rx.stats().bad_headers, 2u);
+    EXPECT_EQ(chain.presented(), 2u);
+}
+
+TEST(FrameStream, PtyPair) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    ASSERT_GE(master, 0);
+    ASSERT_EQ(grantpt(master), 0);
+    ASSERT_EQ(unlockpt(master), 0);
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    ASSERT_GE(slave, 0);
+    termios tio;
+    ASSERT_EQ(tcgetattr(slave, &tio), 0);
+    cfmakeraw(&tio);
+    ASSERT_EQ(tcsetattr(slave, TCSANOW, &tio), 0);
+
+    static FrameSwapChain chain(MAX_LEDS);
+    FrameStreamReceiver rx(chain);
+    constexpr int frames = 20;
+
+    // host PC: write frames to the master side
+    std::thread sender([master]() {
+        static etl::array<uint8_t, frame_stream::packet_bytes(MAX_LEDS)> out;
+        static RGBValue pixels[MAX_LEDS];
+        for (int f = 0; f < frames; f++) {
+            for (int i = 0; i < MAX_LEDS; i++) {
+                pixels[i] = RGBValue{static_cast<uint8_t>(f + i), static_cast<uint8_t>(i), static_cast<uint8_t>(f)};
+            }
+            size_t len = frame_stream::encode(etl::span<const RGBValue>(pixels, MAX_LEDS), out);
+            for (size_t pos = 0; pos < len;) {
+                ssize_t n = write(master, out.data() + pos, len - pos);
+                if (n <= 0) {
+                    return;
+                }
+                pos += static_cast<size_t>(n);
+            }
+        }
+    });
+
+    // controller: read from the slave side
+    uint8_t buffer[4096];
+    while (rx.stats().frames < frames) {
+        ssize_t n = read(slave, buffer, sizeof(buffer));
+        ASSERT_GT(n, 0);
+        rx.feed(etl::span<const uint8_t>(buffer, static_cast<size_t>(n)));
+    }
+    sender.join();
+
+    EXPECT_EQ(rx.stats().crc_errors, 0u);
+    EXPECT_EQ(rx.stats().skipped_bytes, 0u);
+    EXPECT_TRUE(frame_is(chain.front(), frames - 1, MAX_LEDS));
+
+    close(slave);
+    close(master);
+}
@@ -0,0 +1,166 @@
+#include "../host/host_pipeline.h"
+#include "../host/led_sink.h"
+#include "../src/wavegen.h"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace fixed_literals;
+using Config = LightDancerConfig;
+using Gen = WaveGen<Config::audio_rate_hz>;
+
+std::string temp_path(const char* name) {
+    return std::string("/tmp/lightdancer_test_") + std::to_string(getpid()) + "_" + name;
+}
+
+// a strip's record: strip, count, words
+std::vector<uint32_t> record(uint32_t strip, const std::vector<uint32_t>& words) {
+    std::vector<uint32_t> r = {strip, static_cast<uint32_t>(words.size())};
+    r.insert(r.end(), words.begin(), words.end());
+    return r;
+}
+
+TEST(HostPipeline, OneHopAnalysedPerHopOfAudio) {
+    Gen gen;
+    gen.add_tone(440, 0.5_q15);
+    HostPipeline<Gen> pipeline(gen, 3, 100, EffectFactory::SPECTRUM);
+    // 10 s at 60 fps: the hops due, give or take the one in progress
+    for (int f = 0; f < 600; f++) {
+        pipeline.step(16'667);
+    }
+    const uint64_t hops = 600ull * 16'667 * Config::audio_rate_hz / 1'000'000 / Config::fft_hop;
+    EXPECT_EQ(pipeline.stats().ffts, hops);
+    EXPECT_EQ(pipeline.stats().frames, 600u);
+    EXPECT_EQ(pipeline.stats().short_reads, 0u);
+    ASSERT_EQ(pipeline.strips(), 3u);
+    EXPECT_EQ(pipeline.words(2).size(), LedProtocol::frame_words(100));
+
+    uint16_t loudest = 0;
+    for (uint16_t m : pipeline.magnitudes()) {
+        loudest = m > loudest ? m : loudest;
+    }
+    EXPECT_GT(loudest, 0);
+}
+
+// a recording that runs out is padded with silence
+TEST(HostPipeline, ShortReadsAreSilence) {
+    std::vector<int16_t> samples(Config::fft_hop * 2, 1000);
+    SpanAudioSource source(etl::span<const int16_t>(samples.data(), samples.size()), Config::audio_rate_hz);
+    HostPipeline<SpanAudioSource> pipeline(source, 1, 10, EffectFactory::LASER);
+    for (int f = 0; f < 60; f++) {
+        pipeline.step(16'667);
+    }
+    EXPECT_GT(pipeline.stats().short_reads, 0u);
+    EXPECT_EQ(pipeline.stats().ffts, pipeline.stats().short_reads + 2);
+}
+
+// the SIMD FFT draws the same frames as the scalar one the Pico runs
+TEST(HostPipeline, SimdKernelBitExact) {
+    Gen scalar_gen;
+    Gen simd_gen;
+    for (Gen* gen : {&scalar_gen, &simd_gen}) {
+        gen->add_tone(110, 0.3_q15);
+        gen->set_clicks(128, 0.6_q15);
+        gen->set_noise(NoiseColor::Pink, 0.05_q15);
+    }
+    HostPipeline<Gen, FftKernel::Scalar> scalar(scalar_gen, 2, 300, EffectFactory::SPECTRUM);
+    HostPipeline<Gen, FftKernel::Simd> simd(simd_gen, 2, 300, EffectFactory::SPECTRUM);
+    scalar.set_effect(1, EffectFactory::WATERFALL);
+    simd.set_effect(1, EffectFactory::WATERFALL);
+    for (int f = 0; f < 300; f++) {
+        scalar.step(16'667);
+        simd.step(16'667);
+        ASSERT_TRUE(scalar.magnitudes() == simd.magnitudes()) << f;
+        for (size_t s = 0; s < 2; s++) {
+            ASSERT_EQ(std::memcmp(scalar.words(s).data(), simd.words(s).data(), scalar.words(s).size_bytes()), 0)
+                << f << " " << s;
+        }
+    }
+}
+
+TEST(LedSink, FileRecords) {
+    const std::string path = temp_path("sink.bin");
+    const std::vector<uint32_t> a = {1, 2, 3};
+    const std::vector<uint32_t> b = {0xFFFFFF00, 0x12345600};
+    {
+        LedSink sink;
+        ASSERT_TRUE(sink.open(("file:" + path).c_str()));
+        EXPECT_EQ(sink.kind(), LedSink::Kind::File);
+        EXPECT_TRUE(sink.send(0, etl::span<const uint32_t>(a.data(), a.size()), {}));
+        EXPECT_TRUE(sink.send(1, etl::span<const uint32_t>(b.data(), b.size()), {}));
+        EXPECT_EQ(sink.stats().records, 2u);
+        EXPECT_EQ(sink.stats().bytes, (2 + 3 + 2 + 2) * sizeof(uint32_t));
+    }
+
+    std::vector<uint32_t> expected = record(0, a);
+    std::vector<uint32_t> second = record(1, b);
+    expected.insert(expected.end(), second.begin(), second.end());
+    std::vector<uint32_t> actual(expected.size() + 1);
+    FILE* f = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(f, nullptr);
+    actual.resize(std::fread(actual.data(), sizeof(uint32_t), actual.size(), f));
+    std::fclose(f);
+    std::remove(path.c_str());
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(LedSink, UnixSocketRecords) {
+    const std::string path = temp_path("sink.sock");
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(listener, 0);
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+    ASSERT_EQ(bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(listen(listener, 1), 0);
+
+    LedSink sink;
+    ASSERT_TRUE(sink.open(("unix:" + path).c_str()));
+    int reader = accept(listener, nullptr, nullptr);
+    ASSERT_GE(reader, 0);
+    const std::vector<uint32_t> words = {0xAABBCC00, 0x11223300};
+    EXPECT_TRUE(sink.send(3, etl::span<const uint32_t>(words.data(), words.size()), {}));
+
+    std::vector<uint32_t> expected = record(3, words);
+    std::vector<uint32_t> actual(expected.size());
+    size_t got = 0;
+    while (got < actual.size() * sizeof(uint32_t)) {
+        ssize_t n = read(reader, reinterpret_cast<uint8_t*>(actual.data()) + got, actual.size() * sizeof(uint32_t) - got);
+        ASSERT_GT(n, 0);
+        got += static_cast<size_t>(n);
+    }
+    EXPECT_EQ(actual, expected);
+
+    // the reader going away is an error, not a SIGPIPE
+    close(reader);
+    bool failed = false;
+    for (int i = 0; i < 100 && !failed; i++) {
+        failed = !sink.send(3, etl::span<const uint32_t>(words.data(), words.size()), {});
+    }
+    EXPECT_TRUE(failed);
+    EXPECT_GT(sink.stats().errors, 0u);
+
+    close(listener);
+    std::remove(path.c_str());
+}
+
+TEST(LedSink, BadSpecs) {
+    LedSink sink;
+    EXPECT_FALSE(sink.open("udp:1.2.3.4"));
+    EXPECT_FALSE(sink.open("unix:/nonexistent/lightdancer.sock"));
+    EXPECT_FALSE(sink.open("serial:/dev/null@12345"));     // not a standard rate
+    EXPECT_EQ(sink.kind(), LedSink::Kind::None);
+    const uint32_t word = 0;
+    EXPECT_FALSE(sink.send(0, etl::span<const uint32_t>(&word, 1), {}));
+}
+
+} // namespace
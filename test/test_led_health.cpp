@@ -0,0 +1,125 @@
+#include "../src/leds/led_health.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+constexpr unsigned int SM = 2;
+constexpr uint32_t RESET_US = 50;
+constexpr uint32_t DRAIN_US = 270;          // 9 words of 24 bits at 800 kHz
+constexpr uint32_t FRAME_US = 3000;         // 100 LEDs
+
+/**
+ * @brief Host stand-in for a PIO block: FDEBUG and a clock, with stalls that can be injected.
+ *
+ * While the state machine is stalled (between frames) TXSTALL is set again as soon as it's
+ * cleared, like the hardware.
+ */
+struct MockPio {
+    uint64_t now = 0;
+    uint32_t fdebug = pio_fdebug::txstall(SM);
+    bool stalled = true;
+
+    uint32_t read_fdebug() {
+        if (stalled) {
+            inject_stall();
+        }
+        return fdebug;
+    }
+
+    void clear_fdebug(uint32_t mask) {
+        fdebug &= ~mask;
+    }
+
+    uint64_t now_us() {
+        return now;
+    }
+
+    void inject_stall() {
+        fdebug |= pio_fdebug::txstall(SM);
+    }
+
+    void inject_overflow() {
+        fdebug |= pio_fdebug::txover(SM);
+    }
+};
+
+/**
+ * @brief What `WS2811Pio` does for a frame, with the line idle for `gap_us` after it drains.
+ */
+void send_frame(MockPio& pio, LedHealthMonitor<MockPio>& health, uint32_t gap_us, bool stall = false,
+                bool overflow = false, bool waited = false) {
+    pio.stalled = false;
+    health.on_send(waited);
+    pio.now += FRAME_US / 2;
+    if (stall) {
+        pio.inject_stall();     // e.g. DMA starved for longer than the FIFO lasts
+    }
+    if (overflow) {
+        pio.inject_overflow();
+    }
+    pio.now += FRAME_US / 2 - DRAIN_US;
+    health.on_data_queued();
+    pio.now += DRAIN_US;
+    pio.stalled = true;         // end of frame: the line idles low and latches
+    pio.inject_stall();
+    pio.now += gap_us;
+}
+
+} // namespace
+
+
+TEST(LedHealth, CleanFramesAndLatchTimes) {
+    MockPio pio;
+    LedHealthMonitor<MockPio> health(pio, RESET_US, DRAIN_US);
+    health.set_state_machine(SM);
+
+    for (int i = 0; i < 10; i++) {
+        send_frame(pio, health, 100 + i);
+    }
+    const LedHealthStats& stats = health.stats();
+    EXPECT_EQ(stats.frames, 10u);
+    EXPECT_EQ(stats.underruns, 0u);     // the stall between frames doesn't count
+    EXPECT_EQ(stats.overflows, 0u);
+    EXPECT_EQ(stats.short_latches, 0u);
+    EXPECT_EQ(stats.min_latch_us, 100u);
+    EXPECT_EQ(stats.max_latch_us, 108u);
+    EXPECT_EQ(stats.last_latch_us, 108u);
+}
+
+TEST(LedHealth, InjectedStallIsAnUnderrun) {
+    MockPio pio;
+    LedHealthMonitor<MockPio> health(pio, RESET_US, DRAIN_US);
+    health.set_state_machine(SM);
+
+    send_frame(pio, health, 100);
+    send_frame(pio, health, 100, true);
+    send_frame(pio, health, 100);
+    send_frame(pio, health, 100, false, true);
+    EXPECT_EQ(health.stats().underruns, 1u);
+    EXPECT_EQ(health.stats().overflows, 1u);
+
+    // flags of another state machine are ignored
+    pio.stalled = false;
+    health.on_send(false);
+    pio.fdebug |= pio_fdebug::txstall(SM + 1) | pio_fdebug::txover(SM + 1);
+    health.on_data_queued();
+    EXPECT_EQ(health.stats().underruns, 1u);
+    EXPECT_EQ(health.stats().overflows, 1u);
+}
+
+TEST(LedHealth, LateSendsAndShortLatches) {
+    MockPio pio;
+    LedHealthMonitor<MockPio> health(pio, RESET_US, DRAIN_US);
+    health.set_state_machine(SM);
+
+    send_frame(pio, health, 0, false, false, true);     // back to back: no time to latch
+    send_frame(pio, health, RESET_US - 1, false, false, true);
+    send_frame(pio, health, RESET_US);
+    EXPECT_EQ(health.stats().late_sends, 2u);
+    EXPECT_EQ(health.stats().short_latches, 2u);
+    EXPECT_EQ(health.stats().min_latch_us, 0u);
+
+    health.reset_stats();
+    EXPECT_EQ(health.stats().frames, 0u);
+    EXPECT_EQ(health.stats().late_sends, 0u);
+}
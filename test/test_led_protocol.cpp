@@ -0,0 +1,121 @@
+#include "../src/leds/led_protocol.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+namespace {
+
+constexpr RGBValue ORANGE {0xFF, 0x80, 0x10};
+
+template <typename Protocol, size_t N>
+size_t encode(const etl::array<RGBValue, N>& pixels, etl::array<uint32_t, 64>& words) {
+    return encode_frame<Protocol>(etl::span<const RGBValue>(pixels.data(), N), words);
+}
+
+} // namespace
+
+
+TEST(LedProtocol, SingleWirePacking) {
+    EXPECT_EQ(WS2811Protocol::pack(ORANGE), 0xFF801000u);
+    EXPECT_EQ(WS2812BProtocol::pack(ORANGE), 0x80FF1000u);    // GRB
+
+    // white takes the common part, GRBW
+    EXPECT_EQ(SK6812RgbwProtocol::pack(ORANGE), 0x70EF0010u);
+    EXPECT_EQ(SK6812RgbwProtocol::pack(WHITE), 0x000000FFu);
+    EXPECT_EQ(SK6812RgbwProtocol::pack(BLUE), 0x0000FF00u);
+
+    etl::array<RGBValue, 3> pixels {RED, LIME, BLUE};
+    etl::array<uint32_t, 64> words;
+    ASSERT_EQ(encode<WS2812BProtocol>(pixels, words), 3u);
+    EXPECT_EQ(words[0], 0x00FF0000u);
+    EXPECT_EQ(words[1], 0xFF000000u);
+    EXPECT_EQ(words[2], 0x0000FF00u);
+}
+
+TEST(LedProtocol, ClockedFrame) {
+    EXPECT_EQ(APA102Protocol::pack(ORANGE), 0xFF1080FFu);     // brightness, BGR
+
+    etl::array<RGBValue, 65> pixels;
+    pixels.fill(ORANGE);
+    etl::array<uint32_t, 64> too_small;
+    EXPECT_EQ(encode<APA102Protocol>(pixels, too_small), 0u);
+
+    etl::array<RGBValue, 2> two {RED, BLUE};
+    etl::array<uint32_t, 64> words;
+    words.fill(0xAAAAAAAA);
+    ASSERT_EQ(encode<APA102Protocol>(two, words), 4u);      // start, 2 pixels, 1 end word
+    EXPECT_EQ(words[0], 0u);
+    EXPECT_EQ(words[1], 0xFF0000FFu);
+    EXPECT_EQ(words[2], 0xFFFF0000u);
+    EXPECT_EQ(words[3], 0u);
+    EXPECT_EQ(words[4], 0xAAAAAAAAu);
+
+    ASSERT_EQ(encode<SK9822Protocol>(two, words), 5u);      // plus a reset frame
+    EXPECT_EQ(words[4], 0u);
+
+    // half a clock per LED to push the data through: 2 end words for 65..128 LEDs
+    EXPECT_EQ(APA102Protocol::frame_words(64), 1u + 64 + 1);
+    EXPECT_EQ(APA102Protocol::frame_words(65), 1u + 65 + 2);
+}
+
+TEST(LedProtocol, WireTime) {
+    EXPECT_EQ(WS2811Protocol::wire_time_us(3800), 114'000u + 50);
+    EXPECT_EQ(SK6812RgbwProtocol::wire_time_us(100), 4000u + 80);
+    // 3800 pixels + start + 60 end words at 10 MHz
+    EXPECT_EQ(APA102Protocol::wire_time_us(3800), (3861u * 32) / 10);
+    EXPECT_GT(WS2811Protocol::wire_time_us(3800), 9 * APA102Protocol::wire_time_us(3800));
+}
+
+TEST(LedProtocol, PioDelayPatch) {
+    // out x, 1 side 1 [0] in ws2811.pio's encoding (optional side-set, 3 delay bits)
+    constexpr uint16_t out_x_side1 = 0x7821;
+    EXPECT_EQ(led_protocol::with_delay(out_x_side1, 2), 0x7A21);
+    EXPECT_EQ(led_protocol::with_delay(0x7A21, 0), out_x_side1);
+    EXPECT_EQ(led_protocol::with_delay(0x0000, 7), 0x0700);
+
+    EXPECT_EQ(WS2811Protocol::timing.cycles_per_bit(), 5);
+    EXPECT_EQ(WS2812BProtocol::timing.cycles_per_bit(), 10);
+    EXPECT_EQ(SK6812RgbwProtocol::timing.cycles_per_bit(), 10);
+}
+
+TEST(LedProtocol, PanelMap) {
+    // 3 rows of 2 and one pixel left over, each pixel's red is its index
+    etl::array<RGBValue, 7> pixels;
+    for (uint8_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = RGBValue{i, 0, 0};
+    }
+    etl::span<const RGBValue> frame(pixels.data(), pixels.size());
+    etl::array<uint32_t, 64> words;
+    auto red = [&words](size_t i) {
+        return words[i] >> 24;
+    };
+
+    // a strip, and a panel that isn't scrolled, are sent as they are
+    for (PanelMap map : {PanelMap{}, PanelMap{2, false, 0}, PanelMap{2, false, 3}, PanelMap{8, true, 1}}) {
+        ASSERT_EQ(encode_frame<WS2811Protocol>(frame, words, map), 7u);
+        for (size_t i = 0; i < 7; i++) {
+            EXPECT_EQ(red(i), i);
+        }
+    }
+
+    // scrolled by a row: frame rows 1, 2, 0 top to bottom
+    ASSERT_EQ(encode_frame<WS2811Protocol>(frame, words, PanelMap{2, false, 1}), 7u);
+    etl::array<uint32_t, 7> scrolled {2, 3, 4, 5, 0, 1, 6};
+    for (size_t i = 0; i < 7; i++) {
+        EXPECT_EQ(red(i), scrolled[i]) << i;
+    }
+
+    // serpentine: the middle row runs backwards
+    ASSERT_EQ(encode_frame<WS2811Protocol>(frame, words, PanelMap{2, true, 4}), 7u);
+    etl::array<uint32_t, 7> snake {2, 3, 5, 4, 0, 1, 6};
+    for (size_t i = 0; i < 7; i++) {
+        EXPECT_EQ(red(i), snake[i]) << i;
+    }
+
+    // start and end frames are kept
+    ASSERT_EQ(encode_frame<APA102Protocol>(frame, words, PanelMap{2, false, 1}), 9u);
+    EXPECT_EQ(words[0], 0u);
+    EXPECT_EQ(words[1] & 0xFF, 2u);         // red is the low byte
+    EXPECT_EQ(words[8], 0u);
+    etl::array<uint32_t, 6> too_small;
+    EXPECT_EQ(encode_frame<WS2811Protocol>(frame, too_small, PanelMap{2, false, 1}), 0u);
+}
@@ -0,0 +1,264 @@
+#include "../src/params.h"
+#include "../src/serial/param_command.h"
+#include "../src/effects/effects_lib.h"
+#include "../src/effects/effect_factory.h"
+#include "../src/frame_scheduler.h"
+#include "../src/power_policy.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <vector>
+
+namespace {
+
+using Status = ParamStore::Status;
+using param_command::Type;
+
+etl::span<const uint8_t> bytes_of(const void* p, size_t n) {
+    return etl::span<const uint8_t>(static_cast<const uint8_t*>(p), n);
+}
+
+/**
+ * @brief Sends requests to a parser a byte at a time and decodes the replies.
+ */
+class Link {
+
+    public:
+
+    ParamCommandParser parser;
+    std::vector<std::vector<uint8_t>> replies;
+
+    explicit Link(ParamStore& store) : parser(store) {
+    }
+
+    void send(etl::span<const uint8_t> bytes) {
+        for (uint8_t b : bytes) {
+            etl::span<const uint8_t> reply = parser.feed(b);
+            if (!reply.empty()) {
+                replies.emplace_back(reply.begin(), reply.end());
+            }
+        }
+    }
+
+    size_t request(Type type, uint8_t block, uint16_t offset, etl::span<const uint8_t> data = {}, uint8_t length = 0) {
+        uint8_t packet[param_command::MAX_REQUEST_BYTES];
+        size_t len = param_command::encode_request(type, block, offset, data, length, etl::span<uint8_t>(packet, sizeof(packet)));
+        send(etl::span<const uint8_t>(packet, len));
+        return len;
+    }
+
+    param_command::Reply last() {
+        param_command::Reply reply {};
+        EXPECT_TRUE(param_command::decode_reply(etl::span<const uint8_t>(replies.back().data(), replies.back().size()), reply));
+        return reply;
+    }
+};
+
+} // namespace
+
+
+TEST(Params, CommitThenApply) {
+    ParamBlock<LaserEffect::Params> laser;
+    ParamStore store;
+    ASSERT_TRUE(store.add(1, laser));
+    EXPECT_FALSE(store.add(1, laser));      // id taken
+    EXPECT_EQ(store.size(1), sizeof(LaserEffect::Params));
+    EXPECT_EQ(store.size(2), 0);
+
+    EXPECT_FALSE(store.apply());            // nothing committed
+
+    LaserEffect::Params p;
+    p.step_us = 20'000;
+    EXPECT_EQ(store.write(1, 0, bytes_of(&p, sizeof(p))), Status::Ok);
+    EXPECT_EQ(laser.get().step_us, 50'000u);    // shadow only
+    EXPECT_FALSE(store.apply());
+    EXPECT_EQ(laser.get().step_us, 50'000u);
+
+    EXPECT_EQ(store.commit(1), Status::Ok);
+    EXPECT_EQ(store.write(1, 0, bytes_of(&p, sizeof(p))), Status::Busy);
+    EXPECT_TRUE(store.apply());
+    EXPECT_EQ(laser.get().step_us, 20'000u);
+    EXPECT_FALSE(store.apply());
+    EXPECT_EQ(store.write(1, 0, bytes_of(&p, sizeof(p))), Status::Ok);
+}
+
+TEST(Params, BadWrites) {
+    ParamBlock<LodParams> lod;
+    ParamStore store;
+    store.add(7, lod);
+    uint8_t data[8] = {};
+    EXPECT_EQ(store.write(8, 0, bytes_of(data, 1)), Status::UnknownBlock);
+    EXPECT_EQ(store.commit(8), Status::UnknownBlock);
+    EXPECT_EQ(store.write(7, sizeof(LodParams) - 1, bytes_of(data, 2)), Status::BadRange);
+    EXPECT_EQ(store.write(7, sizeof(LodParams) - 1, bytes_of(data, 1)), Status::Ok);
+    EXPECT_EQ(store.read(7, 0, etl::span<uint8_t>(data, sizeof(LodParams) + 1)), Status::BadRange);
+}
+
+TEST(Params, EffectsAndStagesTakeNewValues) {
+    EffectFactory factory;
+    factory.set_effect(EffectFactory::BLINK);
+    EXPECT_FALSE(factory.set_params<LaserEffect>(LaserEffect::Params{}));     // not the current effect
+    EXPECT_TRUE(factory.set_params<BlinkEffect>(BlinkEffect::Params{0, BLUE}));
+
+    BlinkEffect blink;
+    blink.set_params(BlinkEffect::Params{0, BLUE});
+    EXPECT_EQ(blink.params().frames_per_toggle, 1);        // kept to at least 1
+
+    PowerPolicyParams power;
+    power.idle_fft_divider = 0;
+    PowerPolicy<LightDancerConfig> policy;
+    policy.set_params(power);
+    EXPECT_EQ(policy.params().idle_fft_divider, 1);
+
+    FrameScheduler scheduler(16'667, [] { return uint64_t(0); });
+    LodParams lod;
+    lod.frames_to_refine = 5;
+    scheduler.set_params(lod);
+    EXPECT_EQ(scheduler.governor().params().frames_to_refine, 5);
+}
+
+// whatever bytes arrive over the UART, the engine gets values it can run with
+TEST(Params, OutOfRangeValuesAreClamped) {
+    LodParams lod;
+    lod.overruns_to_coarsen = 0;
+    lod.frames_to_refine = 0;
+    lod.headroom_shift = 200;
+    LodGovernor governor(16'000);
+    governor.set_levels(2);
+    governor.set_params(lod);
+    EXPECT_EQ(governor.params().overruns_to_coarsen, 1);
+    EXPECT_EQ(governor.params().frames_to_refine, 1);
+    EXPECT_EQ(governor.params().headroom_shift, 31);
+    EXPECT_EQ(governor.update(20'000), 1);      // one overrun coarsens
+    EXPECT_EQ(governor.update(0), 0);           // no shift past the budget's bits: 0 still fits
+    EXPECT_EQ(LodGovernor(16'000, lod).params().headroom_shift, 31);
+
+    LaserEffect laser;
+    laser.set_params(LaserEffect::Params{UINT32_MAX, RED});
+    EXPECT_EQ(laser.params().step_us, LaserEffect::MAX_STEP_US);
+    EXPECT_GT(laser.period_frames(MAX_LEDS, 16'667), 0u);
+
+    TwinkleEffect twinkle;
+    TwinkleEffect::Params twinkle_params;
+    twinkle_params.fade = 200;
+    twinkle.set_params(twinkle_params);
+    EXPECT_EQ(twinkle.params().fade, 15);
+
+    FireEffect fire;
+    FireEffect::Params fire_params;
+    fire_params.cooling = 5;
+    fire.set_params(fire_params);
+    EXPECT_EQ(fire.params().cooling, 7);
+    fire_params.cooling = 200;
+    fire.set_params(fire_params);
+    EXPECT_EQ(fire.params().cooling, 63);
+
+    WaterfallEffect waterfall;
+    waterfall.set_params(WaterfallEffect::Params{0});
+    EXPECT_EQ(waterfall.width(), 1);
+}
+
+TEST(ParamCommand, WriteCommitRead) {
+    ParamBlock<BlinkEffect::Params> blink;
+    ParamStore store;
+    store.add(2, blink);
+    Link link(store);
+
+    link.request(Type::Info, 2, 0);
+    ASSERT_EQ(link.replies.size(), 1u);
+    param_command::Reply reply = link.last();
+    EXPECT_EQ(reply.type, Type::Info);
+    EXPECT_EQ(reply.status, Status::Ok);
+    ASSERT_EQ(reply.data.size(), 2u);
+    EXPECT_EQ(reply.data[0] | (reply.data[1] << 8), static_cast<int>(sizeof(BlinkEffect::Params)));
+
+    const uint16_t frames_per_toggle = 9;
+    link.request(Type::Write, 2, offsetof(BlinkEffect::Params, frames_per_toggle), bytes_of(&frames_per_toggle, 2));
+    EXPECT_EQ(link.last().status, Status::Ok);
+    link.request(Type::Commit, 2, 0);
+    EXPECT_EQ(link.last().status, Status::Ok);
+    EXPECT_EQ(blink.get().frames_per_toggle, 1);
+    EXPECT_TRUE(store.apply());
+    EXPECT_EQ(blink.get().frames_per_toggle, 9);
+
+    link.request(Type::Read, 2, 0, {}, sizeof(BlinkEffect::Params));
+    reply = link.last();
+    EXPECT_EQ(reply.type, Type::Read);
+    ASSERT_EQ(reply.data.size(), sizeof(BlinkEffect::Params));
+    BlinkEffect::Params read;
+    std::memcpy(&read, reply.data.data(), sizeof(read));
+    EXPECT_EQ(read.frames_per_toggle, 9);
+
+    link.request(Type::Info, 3, 0);
+    EXPECT_EQ(link.last().status, Status::UnknownBlock);
+    link.request(Type::Read, 2, 1, {}, sizeof(BlinkEffect::Params));
+    EXPECT_EQ(link.last().status, Status::BadRange);
+    EXPECT_TRUE(link.last().data.empty());
+    EXPECT_EQ(link.parser.stats().commands, 6u);
+}
+
+TEST(ParamCommand, DropsCorruptAndResyncs) {
+    ParamBlock<FireEffect::Params> fire;
+    ParamStore store;
+    store.add(7, fire);
+    Link link(store);
+
+    const uint8_t cooling = 9;
+    uint8_t packet[param_command::MAX_REQUEST_BYTES];
+    size_t len = param_command::encode_request(Type::Write, 7, 0, bytes_of(&cooling, 1), 0,
+                                               etl::span<uint8_t>(packet, sizeof(packet)));
+    ASSERT_GT(len, 0u);
+
+    // garbage, including a stray sync byte, then a corrupt request
+    const uint8_t garbage[] = {0x00, 0xA5, 0x13, 0x5A};
+    link.send(bytes_of(garbage, sizeof(garbage)));
+    packet[7] ^= 1;
+    link.send(etl::span<const uint8_t>(packet, len));
+    EXPECT_TRUE(link.replies.empty());
+    EXPECT_EQ(link.parser.stats().crc_errors, 1u);
+
+    // a bad header: unknown type
+    const uint8_t unknown[] = {0xA5, 0x5A, 0x7F, 7, 0, 0, 0};
+    link.send(bytes_of(unknown, sizeof(unknown)));
+    EXPECT_EQ(link.parser.stats().bad_headers, 1u);
+
+    packet[7] ^= 1;
+    link.send(etl::span<const uint8_t>(packet, len));
+    ASSERT_EQ(link.replies.size(), 1u);
+    EXPECT_EQ(link.last().status, Status::Ok);
+    EXPECT_GT(link.parser.stats().skipped_bytes, 0u);
+
+    // a request too long to encode
+    uint8_t big[param_command::MAX_DATA + 1] = {};
+    EXPECT_EQ(param_command::encode_request(Type::Write, 7, 0, bytes_of(big, sizeof(big)), 0,
+                                            etl::span<uint8_t>(packet, sizeof(packet))), 0u);
+}
+
+TEST(ParamCommand, DrivesTheEngine) {
+    ParamBlock<LaserEffect::Params> laser_params;
+    ParamStore store;
+    store.add(EffectFactory::LASER, laser_params);
+    Link link(store);
+    EffectFactory factory;
+    factory.set_effect(EffectFactory::LASER);
+
+    Frame frame(100);
+    etl::array<uint16_t, 129> mags {};
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    factory.draw_frame(frame, info);
+
+    LaserEffect::Params p;
+    p.colour = BLUE;
+    link.request(Type::Write, EffectFactory::LASER, 0, bytes_of(&p, sizeof(p)));
+    link.request(Type::Commit, EffectFactory::LASER, 0);
+    // the render loop, at the frame boundary
+    if (store.apply()) {
+        factory.set_params<LaserEffect>(laser_params.get());
+    }
+    factory.draw_frame(frame, info);
+    bool blue = false;
+    for (unsigned int i = 0; i < frame.num_leds; i++) {
+        blue |= frame.data[i].as_RGB() == RGBValue(BLUE).as_RGB();
+    }
+    EXPECT_TRUE(blue);
+}
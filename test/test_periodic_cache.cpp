@@ -0,0 +1,182 @@
+#include "../src/effects/periodic_cache.h"
+#include "../src/effects/effects_lib.h"
+#include "../src/effects/effect_factory.h"
+#include "../src/leds/refresh_gate.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+namespace {
+
+constexpr uint32_t FRAME_US = 20'000;
+etl::array<uint16_t, 1> mags {0};
+
+bool frames_equal(const Frame& a, const Frame& b) {
+    for (unsigned int i = 0; i < a.num_leds; i++) {
+        if (a.data[i].as_RGB() != const_cast<Frame&>(b).data[i].as_RGB()) {
+            return false;
+        }
+    }
+    return a.num_leds == b.num_leds;
+}
+
+} // namespace
+
+
+TEST(PeriodicCache, LaserPeriod) {
+    LaserEffect laser;
+    EXPECT_EQ(laser.period_frames(300, 50'000), 10u);
+    EXPECT_EQ(laser.period_frames(300, FRAME_US), 25u);
+    EXPECT_EQ(laser.period_frames(5, FRAME_US), 1u);
+    BlinkEffect blink;
+    EXPECT_EQ(blink.period_frames(300, FRAME_US), 2u);
+    BeatBlinkEffect beat;
+    EXPECT_EQ(beat.period_frames(300, FRAME_US), 0u);
+}
+
+TEST(PeriodicCache, ReplaysIdenticalFrames) {
+    static PeriodicCache<16 * 1024> cache(FRAME_US);
+    LaserEffect cached_laser;
+    LaserEffect live_laser;
+    DrawInfo<uint16_t, 1> info {FRAME_US, mags};
+    Frame cached(300);
+    Frame live(300);
+
+    for (int i = 0; i < 100; i++) {    // 4 periods
+        cache.draw_frame(cached_laser, cached, info);
+        live_laser.draw_frame(live, info);
+        ASSERT_TRUE(frames_equal(cached, live)) << "frame " << i;
+    }
+    EXPECT_TRUE(cache.is_cached());
+    EXPECT_GT(cache.used_bytes(), 0u);
+    EXPECT_EQ(cache.frames_rendered(), 25u);    // one period
+    EXPECT_EQ(cache.frames_replayed(), 100u);
+}
+
+// replayed frames are only sent where they changed, and not at all between cached frames
+TEST(PeriodicCache, ReplayThroughRefreshGate) {
+    static PeriodicCache<16 * 1024> cache(FRAME_US);
+    LaserEffect laser;
+    DrawInfo<uint16_t, 1> info {FRAME_US / 2, mags};   // drawn twice per cached frame
+    Frame frame(300);
+    Frame last(300);
+    RefreshGate gate(1'000'000);
+
+    EXPECT_EQ(gate.update(cache.draw_frame(laser, frame, info), 300, 0).encode.kind, FrameChange::Kind::Full);
+    for (int i = 1; i < 200; i++) {    // 4 periods
+        for (unsigned int p = 0; p < 300; p++) {
+            last.data[p] = frame.data[p];
+        }
+        Refresh refresh = gate.update(cache.draw_frame(laser, frame, info), 300, i * FRAME_US / 2);
+        if (i % 2 == 0) {
+            ASSERT_EQ(refresh.encode.kind, FrameChange::Kind::Range) << "frame " << i;
+            if (i % 50 != 48) {     // not when the laser goes back from the end to the start
+                EXPECT_LE(refresh.encode.end - refresh.encode.begin, 60) << "frame " << i;
+            }
+            EXPECT_TRUE(refresh.send);
+        } else {
+            EXPECT_EQ(refresh.encode.kind, FrameChange::Kind::Unchanged) << "frame " << i;
+            EXPECT_FALSE(refresh.send);
+        }
+        // nothing changed outside what's encoded again
+        for (unsigned int p = 0; p < 300; p++) {
+            bool encoded = refresh.encode.kind == FrameChange::Kind::Range && p >= refresh.encode.begin && p < refresh.encode.end;
+            if (!encoded) {
+                ASSERT_EQ(frame.data[p].as_RGB(), last.data[p].as_RGB()) << "frame " << i << " pixel " << p;
+            }
+        }
+    }
+    EXPECT_EQ(gate.stats().unchanged, 100u);
+    EXPECT_GT(gate.stats().encode_skipped_percent(), 80u);
+}
+
+// the laser's length follows the strip, so the cached period still matches a strip resized live
+TEST(PeriodicCache, LaserPeriodAfterResize) {
+    static PeriodicCache<16 * 1024> cache(FRAME_US);
+    LaserEffect laser;
+    DrawInfo<uint16_t, 1> info {FRAME_US, mags};
+    LaserEffect live;
+    Frame long_strip(300);
+    laser.draw_frame(long_strip, info);
+    live.draw_frame(long_strip, info);
+
+    Frame frame(100);
+    Frame live_frame(100);
+    ASSERT_EQ(laser.period_frames(100, FRAME_US), 25u);
+    for (int i = 0; i < 60; i++) {
+        cache.draw_frame(laser, frame, info);
+        live.draw_frame(live_frame, info);
+        ASSERT_TRUE(frames_equal(frame, live_frame)) << "frame " << i;
+    }
+    EXPECT_TRUE(cache.is_cached());
+}
+
+TEST(PeriodicCache, FallsBackToLive) {
+    DrawInfo<uint16_t, 1> info {FRAME_US, mags};
+    Frame frame(300);
+
+    static PeriodicCache<16 * 1024> cache(FRAME_US);
+    BeatBlinkEffect beat;     // not periodic
+    cache.draw_frame(beat, frame, info);
+    EXPECT_FALSE(cache.is_cached());
+
+    static PeriodicCache<256> tiny(FRAME_US);
+    LaserEffect laser;          // doesn't fit
+    tiny.draw_frame(laser, frame, info);
+    tiny.draw_frame(laser, frame, info);
+    EXPECT_FALSE(tiny.is_cached());
+    EXPECT_EQ(tiny.frames_replayed(), 0u);
+}
+
+TEST(PeriodicCache, RebuildsWhenEffectChanges) {
+    static PeriodicCache<16 * 1024> cache(FRAME_US);
+    EffectFactory factory;
+    DrawInfo<uint16_t, 1> info {FRAME_US, mags};
+    Frame frame(300);
+
+    cache.draw_frame(factory, frame, info);
+    EXPECT_TRUE(cache.is_cached());
+    EXPECT_EQ(cache.frames_rendered(), 25u);
+
+    factory.set_effect(EffectFactory::BLINK);
+    cache.draw_frame(factory, frame, info);
+    EXPECT_TRUE(cache.is_cached());
+    EXPECT_EQ(cache.frames_rendered(), 27u);
+    uint32_t first = frame.data[0].as_RGB();
+    cache.draw_frame(factory, frame, info);
+    EXPECT_NE(frame.data[0].as_RGB(), first);     // still blinking
+
+    cache.invalidate();
+    cache.draw_frame(factory, frame, info);
+    EXPECT_EQ(cache.frames_rendered(), 29u);
+}
+
+TEST(PeriodicCache, RebuildsWhenParamsChange) {
+    static PeriodicCache<32 * 1024> cache(FRAME_US);
+    EffectFactory factory;
+    DrawInfo<uint16_t, 1> info {FRAME_US, mags};
+    Frame frame(300);
+
+    cache.draw_frame(factory, frame, info);
+    EXPECT_EQ(cache.frames_rendered(), 25u);
+    cache.draw_frame(factory, frame, info);
+    EXPECT_EQ(cache.frames_rendered(), 25u);      // replayed
+
+    // half the speed: twice the period, rendered again rather than the stale one replayed
+    LaserEffect::Params params;
+    params.step_us = 100'000;
+    uint32_t generation = factory.generation();
+    ASSERT_TRUE(factory.set_params<LaserEffect>(params));
+    EXPECT_NE(factory.generation(), generation);
+    cache.draw_frame(factory, frame, info);
+    EXPECT_TRUE(cache.is_cached());
+    EXPECT_EQ(cache.frames_rendered(), 25u + 50u);
+
+    // not the current effect: nothing changes
+    generation = factory.generation();
+    EXPECT_FALSE(factory.set_params<BlinkEffect>(BlinkEffect::Params{}));
+    EXPECT_EQ(factory.generation(), generation);
+
+    // and the refresh gate sends the whole frame
+    ASSERT_TRUE(factory.set_params<LaserEffect>(LaserEffect::Params{}));
+    EXPECT_EQ(factory.draw_frame(frame, info).kind, FrameChange::Kind::Full);
+}
@@ -0,0 +1,229 @@
+#include "../src/effects/pixel_state.h"
+#include "../src/effects/effects_lib.h"
+#include "../src/effects/effect_factory.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+namespace {
+
+etl::array<uint16_t, 129> mags {};
+
+template <unsigned int Bits>
+void check_word_kernels() {
+    using State = PackedState<Bits, 64>;
+    uint32_t rng = 12345;
+    for (int n = 0; n < 10'000; n++) {
+        uint32_t x = xorshift32(rng) & State::fields;
+        uint32_t y = xorshift32(rng) & State::fields;
+        uint32_t sub = State::sub_sat_word(x, y);
+        uint32_t add = State::add_sat_word(x, y);
+        for (unsigned int f = 0; f < State::per_word; f++) {
+            int a = (x >> (f * Bits)) & State::max_value;
+            int b = (y >> (f * Bits)) & State::max_value;
+            int max = State::max_value;
+            ASSERT_EQ(static_cast<int>((sub >> (f * Bits)) & State::max_value), a > b ? a - b : 0) << x << " " << y;
+            ASSERT_EQ(static_cast<int>((add >> (f * Bits)) & State::max_value), a + b < max ? a + b : max) << x << " " << y;
+        }
+        // bits outside the fields stay clear
+        ASSERT_EQ(sub & ~State::fields, 0u);
+        ASSERT_EQ(add & ~State::fields, 0u);
+    }
+}
+
+// runs the same bulk updates on packed and byte state and expects the same fields
+template <unsigned int Bits>
+void check_against_bytes() {
+    PackedState<Bits, 100> packed;
+    ByteState<Bits, 100> bytes;
+    uint32_t rng = 99;
+    for (size_t i = 0; i < 100; i++) {
+        uint8_t v = static_cast<uint8_t>(xorshift32(rng));
+        packed.set(i, v);
+        bytes.set(i, v);
+    }
+    packed.sub_sat(100, 2);
+    bytes.sub_sat(100, 2);
+    packed.add_sat(100, 3);
+    bytes.add_sat(100, 3);
+    packed.add_sat(100, 1);
+    bytes.add_sat(100, 1);
+    for (size_t i = 0; i < 100; i++) {
+        ASSERT_EQ(packed.get(i), bytes.get(i)) << i;
+    }
+    int visited = 0;
+    packed.for_each(100, [&](size_t i, uint8_t v) {
+        EXPECT_EQ(v, bytes.get(i));
+        visited++;
+    });
+    EXPECT_EQ(visited, 100);
+}
+
+} // namespace
+
+
+TEST(PixelState, Sizes) {
+    static_assert(PackedState<2, 3800>::bytes == 952, "16 per word");
+    static_assert(PackedState<4, 3800>::bytes == 1900, "8 per word");
+    static_assert(PackedState<6, 3800>::bytes == 3040, "5 per word");
+    static_assert(ByteState<4, 3800>::bytes == 3800, "byte each");
+    static_assert(PackedState<6, 5>::msbs == 0b100000'100000'100000'100000'100000u, "top bits");
+}
+
+TEST(PixelState, WordKernels) {
+    check_word_kernels<2>();
+    check_word_kernels<4>();
+    check_word_kernels<6>();
+}
+
+TEST(PixelState, GetSetFill) {
+    PackedState<6, 12> state;
+    state.set(4, 63);
+    state.set(5, 64 + 7);       // kept to 6 bits
+    EXPECT_EQ(state.get(3), 0);
+    EXPECT_EQ(state.get(4), 63);
+    EXPECT_EQ(state.get(5), 7);
+    state.set(4, 1);
+    EXPECT_EQ(state.get(4), 1);
+    EXPECT_EQ(state.get(5), 7);
+    state.fill(9);
+    for (size_t i = 0; i < 12; i++) {
+        EXPECT_EQ(state.get(i), 9);
+    }
+}
+
+TEST(PixelState, PackUnpack) {
+    PackedState<6, 40> state;
+    ByteState<6, 40> bytes;
+    uint8_t in[23];
+    for (uint8_t i = 0; i < 23; i++) {
+        in[i] = static_cast<uint8_t>(i * 2 + 1);
+    }
+    state.pack(7, 23, in);      // starts and ends mid-word
+    bytes.pack(7, 23, in);
+    uint8_t out[23] = {};
+    state.unpack(7, 23, out);
+    for (size_t i = 0; i < 23; i++) {
+        EXPECT_EQ(out[i], in[i]);
+        EXPECT_EQ(state.get(7 + i), bytes.get(7 + i));
+    }
+    EXPECT_EQ(state.get(6), 0);
+    EXPECT_EQ(state.get(30), 0);
+}
+
+TEST(PixelState, SameAsBytes) {
+    check_against_bytes<2>();
+    check_against_bytes<4>();
+    check_against_bytes<6>();
+}
+
+TEST(PixelState, SubSatRandom) {
+    PackedState<4, 64> state;
+    state.fill(10);
+    uint32_t rng = 7;
+    state.sub_sat_random(64, [&rng]() { return xorshift32(rng); }, 3);
+    bool some_cooled = false;
+    for (size_t i = 0; i < 64; i++) {
+        EXPECT_GE(state.get(i), 7);
+        EXPECT_LE(state.get(i), 10);
+        some_cooled |= state.get(i) < 10;
+    }
+    EXPECT_TRUE(some_cooled);
+    for (int n = 0; n < 10; n++) {
+        state.sub_sat_random(64, [&rng]() { return xorshift32(rng); }, 3);
+    }
+    for (size_t i = 0; i < 64; i++) {
+        EXPECT_LE(state.get(i), 10);
+    }
+}
+
+// the kernels stop at the word holding the last of the `n` fields asked for
+TEST(PixelState, KernelsOnlyTouchFirstFields) {
+    PackedState<6, 100> packed;
+    ByteState<6, 100> bytes;
+    packed.fill(20);
+    bytes.fill(20);
+    packed.sub_sat(12, 5);     // 5 fields a word: words 0 to 2, fields 0 to 14
+    bytes.sub_sat(12, 5);
+    packed.add_sat(3, 50);     // word 0 only
+    bytes.add_sat(3, 50);
+    uint32_t rng = 5;
+    packed.sub_sat_random(0, [&rng]() { return xorshift32(rng); }, 7);
+    EXPECT_EQ(rng, 5u);        // no words, no random numbers
+    for (size_t i = 0; i < 100; i++) {
+        uint8_t expected = i < 5 ? 63 : (i < 15 ? 15 : 20);
+        EXPECT_EQ(packed.get(i), expected) << i;
+        EXPECT_EQ(bytes.get(i), i < 3 ? 63 : (i < 12 ? 15 : 20)) << i;
+    }
+    static_assert(PackedState<6, 100>::words_for(12) == 3, "3 words");
+    static_assert(PackedState<6, 100>::words_for(1000) == PackedState<6, 100>::words, "all words");
+}
+
+TEST(PixelState, Twinkle) {
+    TwinkleEffect twinkle;
+    Frame frame(1000);
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    for (int n = 0; n < 30; n++) {
+        twinkle.draw_frame(frame, info);
+    }
+    // a few LEDs lit, each warm white, fading over 15 frames
+    int lit = 0;
+    for (const RGBValue& p : frame.data) {
+        if (p.r > 0) {
+            lit++;
+            EXPECT_GE(p.r, p.g);
+            EXPECT_GE(p.g, p.b);
+        }
+    }
+    EXPECT_GT(lit, 15);
+    EXPECT_LT(lit, 100);
+}
+
+TEST(PixelState, TwinklePackedAsBytes) {
+    TwinkleEffect packed;
+    BasicTwinkleEffect<ByteState<4, MAX_LEDS>> bytes;
+    Frame a(500);
+    Frame b(500);
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    for (int n = 0; n < 20; n++) {
+        packed.draw_frame(a, info);
+        bytes.draw_frame(b, info);
+    }
+    for (unsigned int i = 0; i < 500; i++) {
+        ASSERT_EQ(a.data[i].as_RGB(), b.data[i].as_RGB()) << i;
+    }
+}
+
+TEST(PixelState, Fire) {
+    FireEffect fire;
+    Frame frame(128);
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    for (int n = 0; n < 100; n++) {
+        fire.draw_frame(frame, info);
+    }
+    // hot at the base of each flame, dark at the top
+    auto heat = [&frame](unsigned int from, unsigned int to) {
+        uint32_t sum = 0;
+        for (unsigned int i = from; i < to; i++) {
+            sum += frame.data[i].r;
+        }
+        return sum;
+    };
+    EXPECT_GT(heat(0, 8), heat(56, 64));
+    EXPECT_GT(heat(64, 72), heat(120, 128));
+    EXPECT_GT(heat(0, 8), 0u);
+}
+
+TEST(PixelState, ViaFactory) {
+    EffectFactory factory;
+    Frame frame(64);
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    factory.set_effect(EffectFactory::TWINKLE);
+    for (int n = 0; n < 5; n++) {
+        factory.draw_frame(frame, info);
+    }
+    factory.set_effect(EffectFactory::FIRE);
+    for (int n = 0; n < 50; n++) {
+        factory.draw_frame(frame, info);
+    }
+    EXPECT_GT(frame.data[0].r + frame.data[1].r + frame.data[2].r, 0);
+}
@@ -0,0 +1,165 @@
+#include "../src/power_policy.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+using Config = LightDancerConfig;
+using Policy = PowerPolicy<Config>;
+constexpr size_t BLOCK = Config::fft_hop;
+constexpr uint32_t RATE = Config::audio_rate_hz;
+
+/**
+ * @brief A stand-in for a recorded set: hiss, then music, a long gap, and music again.
+ *
+ * Music is a kick every 0.5s plus a chord, over the same hiss.
+ */
+struct Recording {
+    std::vector<int16_t> samples;
+    uint32_t lcg = 12345;
+
+    int16_t hiss() {
+        lcg = lcg * 1664525 + 1013904223;
+        return static_cast<int16_t>(static_cast<int32_t>(lcg >> 16) % 41 - 20);   // ~-64 dBFS
+    }
+
+    void silence(double seconds) {
+        for (size_t i = 0; i < static_cast<size_t>(seconds * RATE); i++) {
+            samples.push_back(hiss());
+        }
+    }
+
+    void music(double seconds, double gain = 1.0) {
+        for (size_t i = 0; i < static_cast<size_t>(seconds * RATE); i++) {
+            double t = static_cast<double>(i) / RATE;
+            double beat = std::fmod(t, 0.5);
+            double kick = std::exp(-beat * 20) * std::sin(2 * M_PI * 60 * t);
+            double chord = 0.3 * (std::sin(2 * M_PI * 220 * t) + std::sin(2 * M_PI * 277 * t));
+            samples.push_back(static_cast<int16_t>(gain * 8000 * (kick + chord) + hiss()));
+        }
+    }
+
+    size_t blocks() const {
+        return samples.size() / BLOCK;
+    }
+
+    etl::span<const int16_t> block(size_t i) const {
+        return etl::span<const int16_t>(samples.data() + i * BLOCK, BLOCK);
+    }
+};
+
+size_t blocks_for(double seconds) {
+    return static_cast<size_t>(seconds * RATE) / BLOCK;
+}
+
+} // namespace
+
+
+TEST(PowerPolicy, EnvelopeAndFloor) {
+    EnvelopeFollower<> env;
+    EXPECT_EQ(env.update(1000), 500);       // attack: half way in one block
+    EXPECT_GT(env.update(1000), 700);
+    for (int i = 0; i < 20; i++) {
+        env.update(1000);
+    }
+    EXPECT_EQ(env.value(), 1000);
+    uint16_t before = env.value();
+    EXPECT_LT(env.update(0), before);       // release: slow
+    EXPECT_GT(env.value(), 900);
+
+    NoiseFloor<> floor(1000);
+    EXPECT_EQ(floor.update(20), 20);        // straight down
+    for (int i = 0; i < 100; i++) {
+        floor.update(5000);
+    }
+    EXPECT_LT(floor.value(), 200);          // slowly up
+}
+
+TEST(PowerPolicy, RecordedSet) {
+    Recording rec;
+    rec.silence(2);
+    rec.music(5);
+    rec.silence(20);
+    rec.music(3, 0.25);     // quieter intro
+    rec.silence(1);
+
+    Policy policy;
+    const size_t music1_start = blocks_for(2);
+    const size_t gap_start = blocks_for(7);
+    const size_t music2_start = blocks_for(27);
+    size_t first_idle = 0;
+    size_t wake_block = 0;
+
+    for (size_t b = 0; b < rec.blocks(); b++) {
+        Policy::State before = policy.state();
+        policy.on_audio_block(rec.block(b));
+        if (b >= music1_start + 2 && b < gap_start) {
+            ASSERT_EQ(policy.state(), Policy::State::Active) << "block " << b;
+        }
+        if (first_idle == 0 && policy.state() == Policy::State::Idle && b > gap_start) {
+            first_idle = b;
+        }
+        if (before == Policy::State::Idle && policy.state() == Policy::State::Active) {
+            wake_block = b;
+        }
+    }
+
+    // idle ~10s after the music stops (the envelope's release adds a little)
+    PowerPolicyParams params = Policy::default_params();
+    EXPECT_GE(first_idle, gap_start + params.hold_blocks);
+    EXPECT_LT(first_idle, gap_start + params.hold_blocks + blocks_for(0.5));
+
+    // back to full rate on the first block of music
+    EXPECT_EQ(wake_block, music2_start);
+    EXPECT_EQ(policy.stats().wakeups, 1u);     // the 2s of hiss at the start is shorter than the hold
+}
+
+// the hold is 10s of whatever the configuration's audio blocks are
+TEST(PowerPolicy, HoldFollowsBlockLength) {
+    using SlowConfig = PipelineConfig<3800, 1, 256, 256, WindowType::Hann, 16, 22'050>;
+    EXPECT_EQ(Policy::default_params().hold_blocks, 10'000'000 / Policy::block_us());
+    EXPECT_EQ(PowerPolicyParams{}.hold_blocks, Policy::default_params().hold_blocks);
+    EXPECT_EQ(PowerPolicy<SlowConfig>::block_us(), 11'609u);
+    EXPECT_EQ(PowerPolicy<SlowConfig>::default_params().hold_blocks, 861u);
+    EXPECT_EQ(PowerPolicy<SlowConfig>().params().hold_blocks, 861u);
+}
+
+TEST(PowerPolicy, IdleSettingsAndFftThrottle) {
+    PowerPolicyParams params;
+    params.hold_blocks = 10;
+    Policy policy(params);
+    Recording rec;
+    rec.music(0.1);
+    rec.silence(2);
+
+    size_t ffts_idle = 0;
+    size_t blocks_idle = 0;
+    for (size_t b = 0; b < rec.blocks(); b++) {
+        bool fft = policy.on_audio_block(rec.block(b));
+        if (policy.state() == Policy::State::Idle) {
+            blocks_idle++;
+            ffts_idle += fft ? 1 : 0;
+        } else {
+            EXPECT_TRUE(fft);
+        }
+    }
+    ASSERT_GT(blocks_idle, 100u);
+    EXPECT_NEAR(static_cast<double>(ffts_idle), static_cast<double>(blocks_idle) / params.idle_fft_divider, 1.0);
+
+    PowerSettings idle = policy.settings();
+    EXPECT_EQ(idle.fft_divider, params.idle_fft_divider);
+    EXPECT_EQ(idle.frame_period_us, params.idle_frame_period_us);
+    EXPECT_TRUE(idle.gate_leds);
+
+    etl::array<int16_t, BLOCK> loud;
+    for (size_t i = 0; i < BLOCK; i++) {
+        loud[i] = static_cast<int16_t>(i & 1 ? 6000 : -6000);
+    }
+    EXPECT_TRUE(policy.on_audio_block(loud));
+    EXPECT_EQ(policy.state(), Policy::State::Active);
+    EXPECT_FALSE(policy.settings().gate_leds);
+    EXPECT_EQ(policy.settings().fft_divider, 1);
+}
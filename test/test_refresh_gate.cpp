@@ -0,0 +1,234 @@
+#include "../src/leds/refresh_gate.h"
+#include "../src/leds/led_protocol.h"
+#include "../src/effects/effects_lib.h"
+#include "../src/effects/effect_factory.h"
+#include "../src/effects/periodic_cache.h"
+#include "../src/effects/zones.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <vector>
+
+namespace {
+
+using Mags = etl::array<uint16_t, 129>;
+
+uint64_t no_clock() {
+    return 0;
+}
+
+/**
+ * @brief Draws frames with an effect and checks every frame against a golden copy: the frame
+ * encoded whole. The words packed only as the `RefreshGate` says must be the same, and so must
+ * the words last sent (what the strip shows).
+ */
+class GoldenRun {
+
+    public:
+
+    Frame frame;
+    RefreshGate gate {100'000};
+    std::vector<uint32_t> golden;
+    std::vector<uint32_t> words;
+    std::vector<uint32_t> strip;
+    uint64_t now_us = 0;
+
+    explicit GoldenRun(unsigned int num_leds)
+        : frame(num_leds), golden(WS2811Protocol::frame_words(num_leds)), words(golden.size()), strip(golden.size()) {
+        std::fill(frame.data.begin(), frame.data.end(), BLACK);
+    }
+
+    /**
+     * @param draw draws the next frame into `frame` and returns its `FrameChange`
+     */
+    template <typename Draw>
+    void step(Draw&& draw, const PanelMap& map = PanelMap{}) {
+        FrameChange change = draw(frame);
+        now_us += 16'667;
+        Refresh refresh = gate.update(change, frame.num_leds, now_us, map);
+
+        etl::span<const RGBValue> pixels = frame.data.first(frame.num_leds);
+        encode_frame<WS2811Protocol>(pixels, etl::span<uint32_t>(golden.data(), golden.size()), map);
+        etl::span<uint32_t> out(words.data(), words.size());
+        if (refresh.encode.kind == FrameChange::Kind::Full) {
+            encode_frame<WS2811Protocol>(pixels, out, map);
+        } else if (refresh.encode.kind == FrameChange::Kind::Range) {
+            encode_pixels<WS2811Protocol>(pixels, out, refresh.encode.begin, refresh.encode.end, map);
+        }
+        if (refresh.send) {
+            strip = words;
+        }
+        ASSERT_EQ(words, golden) << "frame " << gate.stats().frames;
+        ASSERT_EQ(strip, golden) << "frame " << gate.stats().frames;
+    }
+};
+
+} // namespace
+
+
+TEST(RefreshGate, SkipsUnchangedFrames) {
+    RefreshGate gate(1'000'000);
+    Refresh r = gate.update(FrameChange::none(), 100, 0);
+    EXPECT_EQ(r.encode.kind, FrameChange::Kind::Full);     // first frame
+    EXPECT_TRUE(r.send);
+
+    r = gate.update(FrameChange::none(), 100, 16'667);
+    EXPECT_TRUE(r.encode.unchanged());
+    EXPECT_FALSE(r.send);
+
+    r = gate.update(FrameChange::range(10, 20), 100, 33'333);
+    EXPECT_EQ(r.encode.kind, FrameChange::Kind::Range);
+    EXPECT_EQ(r.encode.begin, 10);
+    EXPECT_EQ(r.encode.end, 20);
+    EXPECT_TRUE(r.send);
+
+    // keep-alive a second after the last send
+    r = gate.update(FrameChange::none(), 100, 1'033'332);
+    EXPECT_FALSE(r.send);
+    r = gate.update(FrameChange::none(), 100, 1'033'333);
+    EXPECT_TRUE(r.send);
+    EXPECT_TRUE(r.encode.unchanged());
+    EXPECT_EQ(gate.stats().keep_alives, 1u);
+
+    // a range past the end is clipped
+    r = gate.update(FrameChange::range(90, 200), 100, 1'050'000);
+    EXPECT_EQ(r.encode.end, 100);
+
+    const RefreshStats& stats = gate.stats();
+    EXPECT_EQ(stats.frames, 6u);
+    EXPECT_EQ(stats.unchanged, 3u);
+    EXPECT_EQ(stats.sends, 4u);
+    EXPECT_EQ(stats.pixels_encoded, 120u);
+    EXPECT_EQ(stats.encode_skipped_percent(), 80u);
+    EXPECT_EQ(stats.send_skipped_percent(), 34u);
+}
+
+TEST(RefreshGate, WholeFrameWhenTheOutputChanges) {
+    RefreshGate gate;
+    gate.update(FrameChange::full(), 100, 0);
+    EXPECT_EQ(gate.update(FrameChange::none(), 120, 1).encode.kind, FrameChange::Kind::Full);
+    EXPECT_EQ(gate.update(FrameChange::none(), 120, 2, PanelMap{10, false, 1}).encode.kind, FrameChange::Kind::Full);
+    // a range on a rotated panel isn't contiguous on the wire
+    EXPECT_EQ(gate.update(FrameChange::range(0, 10), 120, 3, PanelMap{10, false, 1}).encode.kind, FrameChange::Kind::Full);
+    EXPECT_TRUE(gate.update(FrameChange::none(), 120, 4, PanelMap{10, false, 1}).encode.unchanged());
+    gate.invalidate();
+    EXPECT_EQ(gate.update(FrameChange::none(), 120, 5, PanelMap{10, false, 1}).encode.kind, FrameChange::Kind::Full);
+}
+
+TEST(RefreshGate, MergeAndWithin) {
+    FrameChange a = FrameChange::range(10, 20).merge(FrameChange::range(30, 35));
+    EXPECT_EQ(a.begin, 10);
+    EXPECT_EQ(a.end, 35);
+    EXPECT_TRUE(FrameChange::none().merge(FrameChange::none()).unchanged());
+    EXPECT_EQ(FrameChange::none().merge(FrameChange::full()).kind, FrameChange::Kind::Full);
+    EXPECT_TRUE(FrameChange::range(5, 5).unchanged());
+
+    FrameChange z = FrameChange::full().within(100, 50);
+    EXPECT_EQ(z.kind, FrameChange::Kind::Range);
+    EXPECT_EQ(z.begin, 100);
+    EXPECT_EQ(z.end, 150);
+    EXPECT_EQ(FrameChange::range(1, 2).within(100, 50).begin, 101);
+}
+
+TEST(RefreshGate, GoldenLaser) {
+    GoldenRun run(300);
+    LaserEffect laser;
+    Mags mags {};
+    for (int n = 0; n < 200; n++) {
+        run.step([&](FrameView& frame) {
+            DrawInfo<uint16_t, 129> info {static_cast<uint32_t>(n % 3 == 0 ? 0 : 16'667), mags};
+            return laser.draw_frame(frame, info);
+        });
+    }
+    // the laser is a tenth of the strip and moves a few LEDs a frame
+    EXPECT_GT(run.gate.stats().encode_skipped_percent(), 70u);
+}
+
+TEST(RefreshGate, GoldenBlink) {
+    GoldenRun run(100);
+    BlinkEffect blink(4);
+    Mags mags {};
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    for (int n = 0; n < 40; n++) {
+        run.step([&](FrameView& frame) {
+            return blink.draw_frame(frame, info);
+        });
+    }
+    EXPECT_EQ(run.gate.stats().unchanged, 30u);
+    EXPECT_EQ(run.gate.stats().send_skipped_percent(), 75u);
+}
+
+TEST(RefreshGate, GoldenSpectrumInSilence) {
+    GoldenRun run(200);
+    SpectrumEffect spectrum;
+    Mags music {};
+    for (size_t i = 0; i < music.size(); i++) {
+        music[i] = static_cast<uint16_t>((i * 509) & 0xFFF);
+    }
+    Mags silence {};
+    for (int n = 0; n < 90; n++) {
+        Mags& mags = (n / 30) % 2 == 0 ? music : silence;
+        run.step([&](FrameView& frame) {
+            DrawInfo<uint16_t, 129> info {16'667, mags};
+            return spectrum.draw_frame(frame, info);
+        });
+    }
+    // the first silent frame goes black, the rest are skipped
+    EXPECT_EQ(run.gate.stats().unchanged, 29u);
+}
+
+TEST(RefreshGate, GoldenWaterfallPanel) {
+    GoldenRun run(16 * 8);
+    WaterfallEffect waterfall(16);
+    Mags mags {};
+    for (int n = 0; n < 20; n++) {
+        mags[1 + n % 100] = static_cast<uint16_t>(1000 + n);
+        run.step([&](FrameView& frame) {
+            DrawInfo<uint16_t, 129> info {16'667, mags};
+            return waterfall.draw_frame(frame, info);
+        }, PanelMap{16, true, waterfall.row_offset()});
+    }
+}
+
+TEST(RefreshGate, GoldenTwinkleFireAndFactory) {
+    GoldenRun run(500);
+    EffectFactory factory;
+    Mags mags {};
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    const size_t effects[] = {EffectFactory::TWINKLE, EffectFactory::BEATBLINK, EffectFactory::FIRE,
+                              EffectFactory::LASER, EffectFactory::BLINK, EffectFactory::SPECTRUM};
+    for (size_t effect : effects) {
+        factory.set_effect(effect);
+        for (int n = 0; n < 30; n++) {
+            run.step([&](FrameView& frame) {
+                return factory.draw_frame(frame, info);
+            });
+        }
+    }
+}
+
+TEST(RefreshGate, GoldenZonesAndCache) {
+    GoldenRun run(400);
+    ZoneSet zones(no_clock,
+                  Zone<LaserEffect, 0, 100>{},
+                  Zone<BlinkEffect, 150, 50>{5},
+                  Zone<SpectrumEffect, 300, 100>{});
+    Mags mags {};
+    for (int n = 0; n < 100; n++) {
+        run.step([&](FrameView& frame) {
+            DrawInfo<uint16_t, 129> info {16'667, mags};
+            return zones.draw_frame(frame, info);
+        });
+    }
+    EXPECT_GT(run.gate.stats().partial, 50u);
+
+    GoldenRun cached(300);
+    static PeriodicCache<16 * 1024> cache(16'667);
+    LaserEffect laser;
+    for (int n = 0; n < 100; n++) {
+        cached.step([&](FrameView& frame) {
+            DrawInfo<uint16_t, 129> info {16'667, mags};
+            return cache.draw_frame(laser, static_cast<Frame&>(frame), info);
+        });
+    }
+}
@@ -0,0 +1,131 @@
+#include "../src/effects/effects_lib.h"
+#include "../src/effects/effect_factory.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <cmath>
+
+namespace {
+
+constexpr unsigned int BINS = 129;
+using Mags = etl::array<uint16_t, BINS>;
+
+void draw(SpectrumEffect& effect, Frame& frame, Mags& mags) {
+    DrawInfo<uint16_t, BINS> info {16'667, mags};
+    effect.draw_frame(frame, info);
+}
+
+unsigned int brightest(const Frame& frame) {
+    unsigned int best = 0;
+    for (unsigned int i = 0; i < frame.num_leds; i++) {
+        const RGBValue& p = frame.data[i];
+        const RGBValue& b = frame.data[best];
+        if (p.r + p.g + p.b > b.r + b.g + b.b) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+
+TEST(SpectrumEffect, Log2Fixed) {
+    EXPECT_EQ(log2_fixed(1).raw(), 0);
+    EXPECT_EQ(log2_fixed(2), Q16_16::from_int(1));
+    EXPECT_EQ(log2_fixed(1024), Q16_16::from_int(10));
+    EXPECT_EQ(log2_fixed(0x80000000u), Q16_16::from_int(31));
+    for (uint32_t x : {3u, 10u, 127u, 1000u, 123'456u, 0xFFFFFFFFu}) {
+        EXPECT_NEAR(log2_fixed(x).to_double(), std::log2(x), 2.0 / 65536) << x;
+    }
+}
+
+TEST(SpectrumEffect, MapCoversTheStrip) {
+    for (SpectrumEffect::Scale scale : {SpectrumEffect::Scale::Linear, SpectrumEffect::Scale::Log}) {
+        for (int leds : {2, 60, 129, 1000, MAX_LEDS}) {
+            SpectrumEffect effect(scale);
+            Frame frame(leds);
+            Mags mags {};
+            draw(effect, frame, mags);
+            EXPECT_EQ(effect.segment_start(1), 0);
+            EXPECT_EQ(effect.segment_start(BINS - 1), frame.num_leds - 1);
+            for (unsigned int b = 2; b < BINS; b++) {
+                ASSERT_LE(effect.segment_start(b - 1), effect.segment_start(b)) << leds << " " << b;
+            }
+        }
+    }
+
+    // linear: equal widths; log: each octave gets the same width, so bin 2 to 4 is as wide as 64 to 128
+    Frame frame(1271);       // 10 pixels per bin
+    Mags mags {};
+    SpectrumEffect linear(SpectrumEffect::Scale::Linear);
+    draw(linear, frame, mags);
+    EXPECT_EQ(linear.segment_start(2), 10);
+    EXPECT_EQ(linear.segment_start(65), 640);
+    SpectrumEffect log;
+    draw(log, frame, mags);
+    EXPECT_EQ(log.segment_start(2), 182);        // 1270 / 7 octaves, rounded up
+    EXPECT_NEAR(log.segment_start(4) - log.segment_start(2), 1270 - log.segment_start(64), 1);
+}
+
+TEST(SpectrumEffect, PeaksLandOnTheirBins) {
+    Frame frame(1271);       // 10 pixels per bin
+    SpectrumEffect effect(SpectrumEffect::Scale::Linear);
+    for (unsigned int bin : {1u, 20u, 65u, 128u}) {
+        Mags mags {};
+        mags[bin] = 1000;
+        draw(effect, frame, mags);
+        EXPECT_EQ(brightest(frame), (bin - 1) * 10) << bin;
+    }
+
+    // a peak is blended smoothly into its neighbours: 10 pixels each side, brightness falling off
+    Mags mags {};
+    mags[65] = 1000;
+    draw(effect, frame, mags);
+    EXPECT_EQ(frame.data[640].as_RGB(), 0xFFFFFF00u);
+    EXPECT_EQ(frame.data[630].as_RGB(), 0u);
+    EXPECT_EQ(frame.data[650].as_RGB(), 0u);
+    for (unsigned int i = 631; i < 640; i++) {
+        const RGBValue& a = frame.data[i];
+        const RGBValue& b = frame.data[i + 1];
+        EXPECT_LE(a.r + a.g + a.b, b.r + b.g + b.b) << i;
+    }
+}
+
+TEST(SpectrumEffect, RebuildsForNewSizesAndScales) {
+    SpectrumEffect effect(SpectrumEffect::Scale::Linear);
+    Mags mags {};
+    mags[128] = 1;
+    Frame small(100);
+    draw(effect, small, mags);
+    EXPECT_EQ(effect.segment_start(BINS - 1), 99);
+    Frame big(1271);
+    draw(effect, big, mags);
+    EXPECT_EQ(effect.segment_start(BINS - 1), 1270);
+    EXPECT_EQ(effect.segment_start(65), 640);
+
+    effect.set_scale(SpectrumEffect::Scale::Log);
+    draw(effect, big, mags);
+    EXPECT_GT(effect.segment_start(65), 1270 * 6 / 7);   // upper half of the bins, last octave
+    EXPECT_EQ(brightest(big), 1270u);
+
+    // the strip follows the loudest recent bin; quiet frames fade from it
+    mags[128] = 50'000;
+    draw(effect, big, mags);
+    EXPECT_EQ(big.data[1270].as_RGB(), 0xFFFFFF00u);
+    mags[128] = 25'000;
+    draw(effect, big, mags);
+    EXPECT_LT(big.data[1270].b, 255);
+}
+
+TEST(SpectrumEffect, ViaFactory) {
+    EffectFactory factory;
+    factory.set_effect(EffectFactory::SPECTRUM);
+    Frame frame(300);
+    Mags mags {};
+    mags[10] = 500;
+    DrawInfo<uint16_t, BINS> info {16'667, mags};
+    factory.draw_frame(frame, info);
+    EXPECT_EQ(factory.period_frames(300, 16'667), 0u);      // audio driven
+    EXPECT_NE(frame.data[brightest(frame)].as_RGB(), 0u);
+}
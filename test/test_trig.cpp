@@ -0,0 +1,92 @@
+#include "../src/trig.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+namespace {
+
+double angle_error(uint16_t angle, double y, double x) {
+    double expected = std::atan2(y, x) * 65536 / (2 * M_PI);
+    double d = std::fmod(angle - expected + 2 * 65536, 65536);
+    return d > 32768 ? d - 65536 : d;
+}
+
+// usable at compile time, e.g. to build other tables
+struct Ramp {
+    int16_t v[8];
+};
+
+constexpr Ramp make_ramp() {
+    Ramp r {};
+    for (uint32_t i = 0; i < 8; i++) {
+        r.v[i] = trig::sin16(i * 0x1000);
+    }
+    return r;
+}
+
+constexpr Ramp ramp = make_ramp();
+static_assert(ramp.v[4] == 32767, "sin(π/2) at compile time");
+static_assert(trig::atan2(1, 0) == 0x4000, "atan2 at compile time");
+
+} // namespace
+
+
+TEST(Trig, Sin16) {
+    EXPECT_EQ(trig::sin16(0), 0);
+    EXPECT_EQ(trig::sin16(0x4000), 32767);
+    EXPECT_EQ(trig::sin16(0x8000), 0);
+    EXPECT_EQ(trig::sin16(0xC000), -32767);
+    EXPECT_NEAR(trig::sin16(0x2000), 23170, 1);     // sin(π/4)
+    EXPECT_EQ(trig::sin16(0x12000), trig::sin16(0x2000));   // only 16 bits of angle
+    EXPECT_EQ(trig::cos16(0), 32767);
+    EXPECT_EQ(trig::cos16(0x8000), -32767);
+
+    double max_error = 0;
+    for (uint32_t a = 0; a < 0x10000; a++) {
+        double expected = 32767 * std::sin(2 * M_PI * a / 65536);
+        max_error = std::max(max_error, std::fabs(trig::sin16(a) - expected));
+        ASSERT_EQ(trig::sin16(a), -trig::sin16(0x10000 - a));   // odd
+    }
+    EXPECT_LT(max_error, 1.1);
+}
+
+TEST(Trig, Sin8) {
+    EXPECT_EQ(trig::sin8(0), 128);
+    EXPECT_EQ(trig::sin8(64), 255);
+    EXPECT_EQ(trig::sin8(128), 128);
+    EXPECT_EQ(trig::sin8(192), 1);
+    for (uint32_t a = 0; a < 256; a++) {
+        EXPECT_NEAR(trig::sin8(static_cast<uint8_t>(a)), 128 + 127 * std::sin(2 * M_PI * a / 256), 1.0);
+    }
+}
+
+TEST(Trig, Atan2) {
+    EXPECT_EQ(trig::atan2(0, 0), 0);
+    EXPECT_EQ(trig::atan2(0, 5), 0);
+    EXPECT_EQ(trig::atan2(5, 0), 0x4000);
+    EXPECT_EQ(trig::atan2(0, -5), 0x8000);
+    EXPECT_EQ(trig::atan2(-5, 0), 0xC000);
+    EXPECT_EQ(trig::atan2(7, 7), 0x2000);
+
+    double max_error = 0;
+    for (int32_t y = -1000; y <= 1000; y += 7) {
+        for (int32_t x = -1000; x <= 1000; x += 11) {
+            if (x != 0 || y != 0) {
+                max_error = std::max(max_error, std::fabs(angle_error(trig::atan2(y, x), y, x)));
+            }
+        }
+    }
+    // large values are scaled into 16 bits first
+    for (int32_t y : {INT32_MIN, -2'000'000'000, 123'456'789, INT32_MAX}) {
+        for (int32_t x : {INT32_MIN, -77'777, 1, 2'000'000'000}) {
+            max_error = std::max(max_error, std::fabs(angle_error(trig::atan2(y, x), y, x)));
+        }
+    }
+    EXPECT_LT(max_error, 2.0);
+
+    // the round trip with sin/cos
+    for (uint32_t a = 0; a < 0x10000; a += 97) {
+        double d = angle_error(trig::atan2(trig::sin16(a), trig::cos16(a)), std::sin(2 * M_PI * a / 65536),
+                               std::cos(2 * M_PI * a / 65536));
+        ASSERT_LT(std::fabs(d), 3.0) << a;
+    }
+}
@@ -0,0 +1,118 @@
+#include "../src/effects/effects_lib.h"
+#include "../src/effects/effect_factory.h"
+#include "../src/leds/led_protocol.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <vector>
+
+namespace {
+
+constexpr unsigned int BINS = 129;
+using Mags = etl::array<uint16_t, BINS>;
+
+void draw(WaterfallEffect& effect, Frame& frame, Mags& mags) {
+    DrawInfo<uint16_t, BINS> info {16'667, mags};
+    effect.draw_frame(frame, info);
+}
+
+// the panel as the LEDs show it: red of each pixel, top row first
+std::vector<uint32_t> shown(const Frame& frame, uint16_t width, uint16_t row_offset) {
+    std::vector<uint32_t> words(frame.num_leds);
+    encode_frame<WS2811Protocol>(frame.data.first(frame.num_leds), etl::span<uint32_t>(words.data(), words.size()),
+                                 PanelMap{width, false, row_offset});
+    for (uint32_t& w : words) {
+        w >>= 24;
+    }
+    return words;
+}
+
+} // namespace
+
+
+TEST(WaterfallEffect, NewRowsAtTheTop) {
+    WaterfallEffect effect(4);
+    Frame frame(4 * 5);
+    Mags mags {};
+    // frame n is loud in column n % 4 (bins 1-32, 33-64, ...)
+    for (unsigned int n = 0; n < 7; n++) {
+        mags.fill(0);
+        mags[1 + (n % 4) * 32] = 1000;
+        draw(effect, frame, mags);
+    }
+
+    std::vector<uint32_t> panel = shown(frame, 4, effect.row_offset());
+    for (unsigned int y = 0; y < 5; y++) {
+        unsigned int n = 6 - y;     // row y is from frame 6 - y
+        for (unsigned int x = 0; x < 4; x++) {
+            EXPECT_EQ(panel[y * 4 + x], x == n % 4 ? 255u : 0u) << y << " " << x;
+        }
+    }
+}
+
+TEST(WaterfallEffect, OneRowPerFrame) {
+    WaterfallEffect effect(16);
+    Frame frame(16 * 64);
+    Mags mags {};
+    mags[10] = 500;
+    draw(effect, frame, mags);
+
+    // nothing but the new row changes
+    std::vector<RGBValue> before(frame.data.begin(), frame.data.end());
+    mags[100] = 700;
+    draw(effect, frame, mags);
+    unsigned int head = effect.row_offset();
+    for (unsigned int i = 0; i < frame.num_leds; i++) {
+        if (i / 16 != head) {
+            ASSERT_EQ(frame.data[i].as_RGB(), before[i].as_RGB()) << i;
+        }
+    }
+    EXPECT_NE(frame.data[head * 16 + 12].as_RGB(), 0u);     // bin 100 of 1-128 is column 12
+
+    // the head walks up the ring and wraps
+    for (unsigned int n = 0; n < 64; n++) {
+        unsigned int expected = head == 0 ? 63 : head - 1;
+        draw(effect, frame, mags);
+        ASSERT_EQ(effect.row_offset(), expected);
+        head = expected;
+    }
+}
+
+TEST(WaterfallEffect, Resize) {
+    WaterfallEffect effect(10);
+    Mags mags {};
+    mags[5] = 100;
+    Frame frame(95);        // 9 rows, 5 pixels left over
+    frame.data[94] = WHITE;
+    for (int n = 0; n < 3; n++) {
+        draw(effect, frame, mags);
+    }
+    EXPECT_EQ(effect.row_offset(), 6);
+    EXPECT_EQ(frame.data[94].as_RGB(), 0u);         // cleared on the first frame, then not drawn
+
+    effect.set_width(5);
+    draw(effect, frame, mags);
+    EXPECT_EQ(effect.row_offset(), 18);             // 19 rows, started again
+    unsigned int lit = 0;
+    for (unsigned int i = 0; i < frame.num_leds; i++) {
+        lit += frame.data[i].as_RGB() != 0;
+    }
+    EXPECT_EQ(lit, 1u);
+
+    Frame tiny(4);
+    draw(effect, tiny, mags);                       // narrower than a row: nothing to draw
+}
+
+TEST(WaterfallEffect, ViaFactory) {
+    EffectFactory factory;
+    EXPECT_EQ(factory.row_offset(), 0);
+    factory.set_effect(EffectFactory::WATERFALL);
+    Frame frame(16 * 10);
+    Mags mags {};
+    mags[1] = 300;
+    DrawInfo<uint16_t, BINS> info {16'667, mags};
+    factory.draw_frame(frame, info);
+    EXPECT_EQ(factory.row_offset(), 9);
+    EXPECT_EQ(frame.data[9 * 16].as_RGB(), 0xFFFFFF00u);
+    EXPECT_EQ(factory.period_frames(160, 16'667), 0u);      // audio driven
+}
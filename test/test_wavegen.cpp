@@ -0,0 +1,235 @@
+#include "../src/wavegen.h"
+#include "../src/fixedpoint_fft.h"
+#include "../src/power_policy.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace fixed_literals;
+
+namespace {
+
+constexpr uint32_t RATE = 8000;
+
+static_assert(is_audio_source<WaveGen<RATE>>::value, "WaveGen is an audio source");
+
+template <typename Source>
+std::vector<int16_t> read_all(Source& source, size_t n, size_t block) {
+    std::vector<int16_t> out(n);
+    for (size_t i = 0; i < n; i += block) {
+        size_t len = std::min(block, n - i);
+        EXPECT_EQ(source.read(etl::span<int16_t>(out.data() + i, len)), len);
+    }
+    return out;
+}
+
+// each bin's magnitude summed over `blocks` FFTs
+etl::array<uint32_t, 129> spectrum(WaveGen<RATE>& gen, int blocks) {
+    FixedPointFFT<256, int16_t, uint32_t> fft;
+    etl::array<int16_t, 256> samples;
+    etl::array<uint32_t, 129> mags;
+    etl::array<uint32_t, 129> sum {};
+    for (int b = 0; b < blocks; b++) {
+        gen.read(samples);
+        fft.magnitudes(samples, mags);
+        for (size_t i = 0; i < mags.size(); i++) {
+            sum[i] += mags[i];
+        }
+    }
+    return sum;
+}
+
+size_t peak_bin(const etl::array<uint32_t, 129>& mags) {
+    return static_cast<size_t>(std::max_element(mags.begin() + 1, mags.end()) - mags.begin());
+}
+
+} // namespace
+
+
+TEST(WaveGen, Tones) {
+    WaveGen<RATE> gen;
+    ASSERT_TRUE(gen.add_tone(697, 0.5_q15));
+    std::vector<int16_t> wave = read_all(gen, 512, 512);
+    for (size_t i = 0; i < wave.size(); i++) {
+        // phase truncated to 16 bits: up to 2π/65536 (~1.5 LSB at half scale) plus the table's
+        ASSERT_NEAR(wave[i], 16383 * std::sin(2 * M_PI * 697 * i / RATE), 3.0) << i;
+    }
+
+    ASSERT_TRUE(gen.add_tone(1000, 0.25_q15));
+    ASSERT_TRUE(gen.add_tone(2000, 0.25_q15));
+    ASSERT_TRUE(gen.add_tone(3000, 0.25_q15));
+    EXPECT_FALSE(gen.add_tone(3500, 0.25_q15));     // MaxTones
+    gen.clear_tones();
+    gen.add_tone(1000, 0.5_q15);
+    EXPECT_EQ(peak_bin(spectrum(gen, 4)), 32u);     // 1000 Hz / (8000 Hz / 256)
+}
+
+TEST(WaveGen, ContinuousAcrossBlocks) {
+    auto make = []() {
+        WaveGen<RATE> gen(7);
+        gen.add_tone(440, 0.25_q15);
+        gen.set_chirp(100, 3000, 1000, 0.25_q15);
+        gen.set_clicks(150, 0.25_q15);
+        gen.set_noise(NoiseColor::Pink, 0.1_q15);
+        gen.set_envelope(Envelope{100, 500, 100, 300});
+        return gen;
+    };
+    WaveGen<RATE> whole = make();
+    WaveGen<RATE> blocks = make();
+    EXPECT_EQ(read_all(whole, 10'000, 10'000), read_all(blocks, 10'000, 7));
+    EXPECT_EQ(blocks.position(), 10'000u);
+
+    // another seed, other noise
+    WaveGen<RATE> other(8);
+    other.set_noise(NoiseColor::Pink, 0.1_q15);
+    WaveGen<RATE> same(7);
+    same.set_noise(NoiseColor::Pink, 0.1_q15);
+    EXPECT_NE(read_all(other, 100, 100), read_all(same, 100, 100));
+}
+
+TEST(WaveGen, Chirp) {
+    WaveGen<RATE> gen;
+    gen.set_chirp(200, 2000, RATE, 0.5_q15);        // one second up, then again
+    // zero crossings per 0.1s follow the frequency
+    std::vector<int16_t> wave = read_all(gen, 2 * RATE, 128);
+    auto crossings = [&wave](size_t from) {
+        int n = 0;
+        for (size_t i = from + 1; i < from + RATE / 10; i++) {
+            n += (wave[i - 1] < 0) != (wave[i] < 0);
+        }
+        return n;
+    };
+    EXPECT_NEAR(crossings(0), 2 * 290 / 10, 2);         // ~290 Hz average over the first 0.1s
+    EXPECT_NEAR(crossings(RATE * 9 / 10), 2 * 1910 / 10, 2);
+    EXPECT_NEAR(crossings(RATE), crossings(0), 1);      // repeats
+}
+
+TEST(WaveGen, ClickTrack) {
+    WaveGen<RATE> gen;
+    gen.set_clicks(120, 0.5_q15, 100, 50);          // a click every 0.5s lasting 50ms
+    std::vector<int16_t> wave = read_all(gen, 10 * RATE, 100);
+    EXPECT_EQ(gen.beats(), 20u);
+    for (size_t beat = 0; beat < 20; beat++) {
+        size_t start = beat * RATE / 2;
+        int32_t loud = 0;
+        int32_t quiet = 0;
+        for (size_t i = start; i < start + RATE / 50; i++) {
+            loud = std::max<int32_t>(loud, std::abs(wave[i]));
+        }
+        for (size_t i = start + RATE / 20 + 1; i < start + RATE / 2; i++) {
+            quiet = std::max<int32_t>(quiet, std::abs(wave[i]));
+        }
+        EXPECT_GT(loud, 10'000) << beat;
+        EXPECT_EQ(quiet, 0) << beat;
+    }
+
+    // the tempo is exact over a long run: 128 BPM for an hour
+    WaveGen<RATE> hour;
+    hour.set_clicks(128, 0.5_q15);
+    etl::array<int16_t, 4000> block;
+    for (int i = 0; i < 3600 * 2; i++) {
+        hour.read(block);
+    }
+    EXPECT_EQ(hour.beats(), 128u * 60);
+}
+
+TEST(WaveGen, Noise) {
+    WaveGen<RATE> white(3);
+    white.set_noise(NoiseColor::White, 0.5_q15);
+    WaveGen<RATE> pink(3);
+    pink.set_noise(NoiseColor::Pink, 0.5_q15);
+
+    auto rms = [](const std::vector<int16_t>& v) {
+        double sum = 0;
+        for (int16_t s : v) {
+            sum += static_cast<double>(s) * s;
+        }
+        return std::sqrt(sum / v.size());
+    };
+    double white_rms = rms(read_all(white, 100'000, 256));
+    double pink_rms = rms(read_all(pink, 100'000, 256));
+    EXPECT_NEAR(white_rms, 0.5 * 32768 / std::sqrt(3.0), 200);
+    EXPECT_NEAR(pink_rms, white_rms, white_rms * 0.25);
+
+    // white is flat, pink falls with frequency: compare an octave near the bottom with the top one
+    auto slope = [](const etl::array<uint32_t, 129>& mags) {
+        uint64_t low = 0;
+        uint64_t high = 0;
+        for (size_t i = 4; i < 8; i++) low += mags[i];
+        for (size_t i = 64; i < 128; i += 16) high += mags[i];
+        return static_cast<double>(low) / high;
+    };
+    EXPECT_NEAR(slope(spectrum(white, 200)), 1.0, 0.2);
+    EXPECT_GT(slope(spectrum(pink, 200)), 3.0);     // 4 octaves at -3 dB each: ~4x
+}
+
+// at full amplitude pink noise clips like a louder copy of itself, and never wraps to the other sign
+TEST(WaveGen, FullAmplitudePink) {
+    WaveGen<RATE> full(5);
+    full.set_noise(NoiseColor::Pink, Q15::from_raw(32767));
+    WaveGen<RATE> quiet(5);     // same noise
+    quiet.set_noise(NoiseColor::Pink, Q15::from_raw(4096));
+    std::vector<int16_t> loud = read_all(full, 100'000, 256);
+    std::vector<int16_t> ref = read_all(quiet, 100'000, 256);
+    int clipped = 0;
+    for (size_t i = 0; i < loud.size(); i++) {
+        if (ref[i] > 16 || ref[i] < -16) {
+            ASSERT_EQ(loud[i] > 0, ref[i] > 0) << i;
+            ASSERT_GE(std::abs(loud[i]), std::min(std::abs(ref[i]) * 7, 32767)) << i;
+        }
+        clipped += loud[i] == 32767 || loud[i] == -32768 ? 1 : 0;
+    }
+    EXPECT_GT(clipped, 0);
+}
+
+TEST(WaveGen, Envelope) {
+    WaveGen<RATE> gen;
+    gen.add_tone(1000, 0.5_q15);
+    gen.set_envelope(Envelope{100, 200, 100, 600});
+    std::vector<int16_t> wave = read_all(gen, 2000, 64);
+    auto peak = [&wave](size_t from, size_t to) {
+        int32_t p = 0;
+        for (size_t i = from; i < to; i++) {
+            p = std::max<int32_t>(p, std::abs(wave[i]));
+        }
+        return p;
+    };
+    EXPECT_LT(peak(0, 10), 16383 / 10);
+    EXPECT_NEAR(peak(100, 300), 16383, 2);
+    EXPECT_EQ(peak(400, 1000), 0);
+    EXPECT_NEAR(peak(1100, 1300), 16383, 2);        // and again
+}
+
+TEST(WaveGen, PowerPolicySoak) {
+    // music for 20s with 40s gaps, over hiss, through the power policy for 10 minutes
+    using Config = LightDancerConfig;
+    PowerPolicy<Config> policy;
+    WaveGen<Config::audio_rate_hz> music(11);
+    music.add_tone(220, 0.25_q15);
+    music.add_tone(277, 0.25_q15);
+    music.set_clicks(124, 0.5_q15);
+    music.set_envelope(Envelope{Config::audio_rate_hz, 19 * Config::audio_rate_hz, 1, 40 * Config::audio_rate_hz});
+    WaveGen<Config::audio_rate_hz> hiss(12);
+    hiss.set_noise(NoiseColor::White, Q15::from_raw(20));
+
+    etl::array<int16_t, Config::fft_hop> block;
+    etl::array<int16_t, Config::fft_hop> noise;
+    uint32_t idle_changes = 0;
+    bool was_idle = false;
+    for (uint64_t samples = 0; samples < 600ull * Config::audio_rate_hz; samples += block.size()) {
+        music.read(block);
+        hiss.read(noise);
+        for (size_t i = 0; i < block.size(); i++) {
+            block[i] = static_cast<int16_t>(block[i] + noise[i]);
+        }
+        policy.on_audio_block(block);
+        bool idle = policy.state() == PowerPolicy<Config>::State::Idle;
+        idle_changes += idle != was_idle;
+        was_idle = idle;
+    }
+    EXPECT_EQ(policy.stats().wakeups, 9u);      // every set but the first, which starts active
+    EXPECT_EQ(idle_changes, 19u);               // into idle 10 times, out of it 9
+}
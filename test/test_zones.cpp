@@ -0,0 +1,144 @@
+#include "../src/effects/zones.h"
+#include "../src/effects/effects_lib.h"
+#include "../src/frame_scheduler.h"
+#include <gtest/gtest.h>
+#include "etl/array.h"
+
+#include <thread>
+
+namespace {
+
+uint64_t fake_now = 0;
+
+uint64_t fake_clock() {
+    return fake_now;
+}
+
+etl::array<uint16_t, 129> mags {};
+
+/**
+ * @brief Fills its view with one colour and takes `cost_us` on the fake clock; remembers the
+ * size of the view it was given.
+ */
+class FillEffect : public EffectBase<FillEffect> {
+
+    public:
+
+    RGBValue colour;
+    uint32_t cost_us;
+    unsigned int seen_leds = 0;
+    uint8_t lod = 0;
+
+    FillEffect(RGBValue c, uint32_t cost) : colour(c), cost_us(cost) {
+    }
+
+    template <typename FreqT, unsigned int FreqN>
+    void draw_frame(FrameView& frame, [[maybe_unused]] DrawInfo<FreqT, FreqN>& info) {
+        std::fill(frame.data.begin(), frame.data.end(), colour);
+        seen_leds = frame.num_leds;
+        fake_now += cost_us;
+    }
+
+    uint8_t lod_levels() const {
+        return 3;
+    }
+
+    void set_lod(uint8_t level) {
+        lod = level;
+    }
+};
+
+} // namespace
+
+
+// zones are drawn into one frame the driver maps as a whole, so no zone can rotate its own rows
+TEST(Zones, RowOffsetEffectsAreRejected) {
+    static_assert(zones_detail::uses_row_offset<WaterfallEffect>::value, "waterfall scrolls by rows");
+    static_assert(!zones_detail::uses_row_offset<LaserEffect>::value, "EffectBase's is always 0");
+    static_assert(!zones_detail::uses_row_offset<FireEffect>::value, "EffectBase's is always 0");
+    static_assert(!zones_detail::uses_row_offset<FillEffect>::value, "no row_offset at all");
+    static_assert(std::is_constructible<Zone<FireEffect, 0, 16>>::value, "a zone");
+}
+
+TEST(Zones, EachZoneDrawsItsPart) {
+    ZoneSet zones(fake_clock,
+                  Zone<FillEffect, 0, 10>{RED, 100},
+                  Zone<FillEffect, 20, 5>{BLUE, 50},
+                  Zone<LaserEffect, 30, 50>{});
+    static_assert(decltype(zones)::size == 3, "three zones");
+    Frame frame(60);
+    std::fill(frame.data.begin(), frame.data.end(), WHITE);
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    zones.draw_frame(frame, info);
+
+    for (unsigned int i = 0; i < 30; i++) {
+        uint32_t expected = i < 10 ? RED.as_RGB() : (i >= 20 && i < 25 ? BLUE.as_RGB() : WHITE.as_RGB());
+        EXPECT_EQ(frame.data[i].as_RGB(), expected) << i;
+    }
+    // the laser's zone is cut short by the end of the frame, and it sees a 30 LED strip
+    EXPECT_EQ(frame.data[30].as_RGB(), 0xFF000000u);
+    EXPECT_EQ(frame.data[33].as_RGB(), 0xFF000000u);
+    EXPECT_EQ(frame.data[34].as_RGB(), 0u);
+    EXPECT_EQ(zones.effect<1>().seen_leds, 5u);
+
+    // per zone timing
+    EXPECT_EQ(zones.stats(0).last_us, 100u);
+    EXPECT_EQ(zones.stats(1).last_us, 50u);
+    zones.effect<0>().cost_us = 300;
+    zones.draw_frame(frame, info);
+    EXPECT_EQ(zones.stats(0).frames, 2u);
+    EXPECT_EQ(zones.stats(0).max_us, 300u);
+    EXPECT_EQ(zones.stats(0).total_us, 400u);
+    zones.reset_stats();
+    EXPECT_EQ(zones.stats(0).frames, 0u);
+
+    // zones past the end of a short frame are skipped
+    Frame small(15);
+    zones.draw_frame(small, info);
+    EXPECT_EQ(zones.stats(0).frames, 1u);
+    EXPECT_EQ(zones.stats(1).frames, 0u);
+}
+
+TEST(Zones, PerCore) {
+    ZoneSet zones(fake_clock,
+                  Zone<FillEffect, 0, 100, 0>{RED, 1},
+                  Zone<FillEffect, 100, 100, 1>{BLUE, 1});
+    Frame frame(200);
+    std::fill(frame.data.begin(), frame.data.end(), BLACK);
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+
+    zones.draw_frame(frame, info, 1);
+    EXPECT_EQ(frame.data[0].as_RGB(), 0u);
+    EXPECT_EQ(frame.data[100].as_RGB(), 0x0000FF00u);
+    EXPECT_EQ(zones.stats(0).frames, 0u);
+
+    // both "cores" draw the same frame at once: the zones don't share pixels
+    ZoneSet threaded(fake_clock,
+                     Zone<LaserEffect, 0, 1000, 0>{},
+                     Zone<SpectrumEffect, 1000, 1000, 1>{});
+    Frame big(2000);
+    for (int n = 0; n < 50; n++) {
+        std::thread core1([&]() {
+            threaded.draw_frame(big, info, 1);
+        });
+        threaded.draw_frame(big, info, 0);
+        core1.join();
+    }
+    EXPECT_EQ(threaded.stats(0).frames, 50u);
+    EXPECT_EQ(threaded.stats(1).frames, 50u);
+}
+
+TEST(Zones, LevelOfDetail) {
+    ZoneSet zones(fake_clock,
+                  Zone<FillEffect, 0, 8>{RED, 40'000},
+                  Zone<LaserEffect, 8, 8>{});
+    EXPECT_EQ(zones.lod_levels(), 3);
+    FrameScheduler scheduler(16'667, fake_clock);
+    Frame frame(16);
+    DrawInfo<uint16_t, 129> info {16'667, mags};
+    for (int i = 0; i < 10; i++) {
+        scheduler.draw_frame(zones, frame, info);
+    }
+    EXPECT_EQ(scheduler.level(), 2);
+    EXPECT_EQ(zones.effect<0>().lod, 2);
+}
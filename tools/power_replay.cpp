@@ -0,0 +1,76 @@
+/**
+ * @file power_replay.cpp
+ * @brief Replay a recording through `PowerPolicy` (power_policy.h) to tune its thresholds.
+ *
+ * Usage: power_replay <recording.wav> [hold_seconds]
+ *
+ * The recording must be 16-bit PCM; only the first channel is used and it is treated as if it
+ * were at `LightDancerConfig::audio_rate_hz`. Prints each state change with its time, envelope and
+ * noise floor, then the share of time idle and of FFTs skipped.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../host/wav_file.h"
+#include "../src/power_policy.h"
+
+namespace {
+
+using Config = LightDancerConfig;
+using Policy = PowerPolicy<Config>;
+
+const char* state_name(Policy::State state) {
+    switch (state) {
+        case Policy::State::Active: return "active";
+        case Policy::State::Hangover: return "hangover";
+        case Policy::State::Idle: return "idle";
+    }
+    return "?";
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: power_replay <recording.wav> [hold_seconds]\n");
+        return 1;
+    }
+    std::vector<int16_t> samples;
+    uint32_t rate = 0;
+    if (!wav_file::read(argv[1], samples, rate)) {
+        std::fprintf(stderr, "%s: not a 16-bit PCM WAV file\n", argv[1]);
+        return 1;
+    }
+    if (rate != Config::audio_rate_hz) {
+        std::fprintf(stderr, "warning: %u Hz recording, pipeline runs at %u Hz\n", static_cast<unsigned>(rate),
+                     static_cast<unsigned>(Config::audio_rate_hz));
+    }
+
+    PowerPolicyParams params = Policy::default_params();
+    if (argc > 2) {
+        params.hold_blocks = static_cast<uint32_t>(std::atof(argv[2]) * 1'000'000 / Policy::block_us());
+    }
+    Policy policy(params);
+
+    std::printf("time_s,state,envelope,noise_floor\n");
+    Policy::State state = policy.state();
+    const size_t blocks = samples.size() / Config::fft_hop;
+    for (size_t b = 0; b < blocks; b++) {
+        policy.on_audio_block(etl::span<const int16_t>(samples.data() + b * Config::fft_hop, Config::fft_hop));
+        if (policy.state() != state) {
+            state = policy.state();
+            std::printf("%.3f,%s,%u,%u\n", b * Policy::block_us() / 1e6, state_name(state),
+                        static_cast<unsigned>(policy.envelope()), static_cast<unsigned>(policy.noise_floor()));
+        }
+    }
+
+    const Policy::Stats& stats = policy.stats();
+    if (stats.blocks > 0) {
+        std::fprintf(stderr, "%.1fs: idle %.1f%%, FFTs skipped %.1f%%, %u wake-ups\n",
+                     stats.blocks * Policy::block_us() / 1e6, 100.0 * stats.idle_blocks / stats.blocks,
+                     100.0 * (stats.blocks - stats.ffts) / stats.blocks, static_cast<unsigned>(stats.wakeups));
+    }
+    return 0;
+}
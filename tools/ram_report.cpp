@@ -0,0 +1,70 @@
+/**
+ * @file ram_report.cpp
+ * @brief Print the RAM budget breakdown of `LightDancerConfig` (see config.h and ram_budget.h).
+ *
+ * Built and run on the host by CMake after the Pico application is built, so the breakdown is
+ * visible before flashing. Sizes are computed with the host compiler so members whose size
+ * depends on pointer width (e.g. `Frame::data`) may differ by a few bytes from the target; the
+ * `static_assert`s in the target build are authoritative.
+ */
+#include <cstdio>
+#include "../src/config.h"
+#include "../src/ram_budget.h"
+#include "../src/frame_history.h"
+
+namespace {
+
+const char* region_name(RamRegion region) {
+    switch (region) {
+        case RamRegion::Static: return "static";
+        case RamRegion::Core0Stack: return "core0 stack";
+        case RamRegion::Core1Stack: return "core1 stack";
+    }
+    return "?";
+}
+
+template <typename Budget>
+void print_region(RamRegion region) {
+    size_t used = Budget::total(region);
+    size_t capacity = Budget::capacity(region);
+    std::printf("  %-12s %7zu / %7zu bytes (%3zu%%)\n", region_name(region), used, capacity,
+                (used * 100) / capacity);
+}
+
+template <typename Format>
+void print_history_slot() {
+    std::printf("  %-12s %7zu bytes\n", Format::name, FrameHistory<Format, 1>::slot_bytes);
+}
+
+} // namespace
+
+
+int main() {
+    using Config = LightDancerConfig;
+    using Budget = RamBudget<Config>;
+
+    std::printf("LightDancer RAM budget\n");
+    std::printf("  %u LEDs in %u lane(s), FFT N=%u hop=%u, %u bands, %u Hz audio\n",
+                Config::max_leds, Config::lanes, Config::fft_n, Config::fft_hop, Config::bands,
+                static_cast<unsigned>(Config::audio_rate_hz));
+    std::printf("  %u FFT/s, %s LEDs, fastest refresh %u us per frame\n",
+                static_cast<unsigned>(Config::fft_rate_hz), LedProtocol::name,
+                static_cast<unsigned>(LedProtocol::wire_time_us(Config::leds_per_lane)));
+
+    std::printf("\n  %-18s %-12s %7s\n", "item", "region", "bytes");
+    for (const auto& item : Budget::items) {
+        std::printf("  %-18s %-12s %7zu\n", item.name, region_name(item.region), item.bytes);
+    }
+
+    std::printf("\n");
+    print_region<Budget>(RamRegion::Static);
+    print_region<Budget>(RamRegion::Core0Stack);
+    print_region<Budget>(RamRegion::Core1Stack);
+
+    // not part of the budget until an effect keeps history, but what each slot would cost
+    std::printf("\n  frame history (frame_history.h), per slot of %u LEDs\n", Config::max_leds);
+    print_history_slot<history_format::Rgb888>();
+    print_history_slot<history_format::Yuv422>();
+    print_history_slot<history_format::Rgb332>();
+    return 0;
+}
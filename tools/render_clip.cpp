@@ -0,0 +1,130 @@
+/**
+ * @file render_clip.cpp
+ * @brief Render an effect from effects_lib.h into a clip (see clips/clip.h) and report its
+ * compression ratio and decode speed.
+ *
+ * Usage: render_clip <effect> <num_leds> <frames> <frame_period_us> [output.clip]
+ * where <effect> is one of laser, blink, beatblink, vm, spectrum, waterfall, twinkle, fire (every
+ * `EffectFactory::EffectType`). Effects are rendered with silent audio, so the audio-reactive ones
+ * (beatblink, spectrum, waterfall) and the empty vm give mostly black clips.
+ *
+ * The clip can be linked into the firmware (e.g. with `xxd -i`) and played with `ClipPlayer`.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "etl/array.h"
+
+#include "../bench/bench.h"
+#include "../src/draw.h"
+#include "../src/effects/effect_factory.h"
+#include "../src/clips/clip.h"
+
+namespace {
+
+struct EffectName {
+    const char* name;
+    EffectFactory::EffectType type;
+};
+
+constexpr EffectName effect_names[] = {
+    {"laser", EffectFactory::LASER},
+    {"blink", EffectFactory::BLINK},
+    {"beatblink", EffectFactory::BEATBLINK},
+    {"vm", EffectFactory::VM},
+    {"spectrum", EffectFactory::SPECTRUM},
+    {"waterfall", EffectFactory::WATERFALL},
+    {"twinkle", EffectFactory::TWINKLE},
+    {"fire", EffectFactory::FIRE},
+};
+
+int usage() {
+    std::fprintf(stderr, "usage: render_clip <effect> <num_leds> <frames> <frame_period_us> [output.clip]\n");
+    std::fprintf(stderr, "effects:");
+    for (const EffectName& e : effect_names) {
+        std::fprintf(stderr, " %s", e.name);
+    }
+    std::fprintf(stderr, "\n");
+    return 1;
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        return usage();
+    }
+
+    const EffectName* effect = nullptr;
+    for (const EffectName& e : effect_names) {
+        if (std::strcmp(argv[1], e.name) == 0) {
+            effect = &e;
+        }
+    }
+    int num_leds = std::atoi(argv[2]);
+    uint32_t frames = static_cast<uint32_t>(std::atol(argv[3]));
+    uint32_t period_us = static_cast<uint32_t>(std::atol(argv[4]));
+    if (effect == nullptr || num_leds <= 0 || frames == 0 || period_us == 0) {
+        return usage();
+    }
+
+    // render
+    Frame frame(num_leds);
+    EffectFactory factory;
+    factory.set_effect(effect->type);
+    etl::array<uint16_t, 129> mags {};
+    DrawInfo<uint16_t, 129> info {period_us, mags};
+
+    size_t raw_size = static_cast<size_t>(frames) * frame.num_leds * 3;
+    std::vector<uint8_t> buffer(raw_size + raw_size / 64 + 16 + 4 * frames + 12 * frames + 1024);
+    ClipWriter writer;
+    if (!writer.begin(etl::span<uint8_t>(buffer.data(), buffer.size()), frame.num_leds, period_us, frames)) {
+        std::fprintf(stderr, "cannot create clip\n");
+        return 1;
+    }
+    for (uint32_t f = 0; f < frames; f++) {
+        factory.draw_frame(frame, info);
+        if (!writer.add_frame(frame.data)) {
+            std::fprintf(stderr, "clip buffer full at frame %u\n", static_cast<unsigned>(f));
+            return 1;
+        }
+    }
+    etl::span<const uint8_t> clip = writer.finish();
+
+    if (argc > 5) {
+        FILE* out = std::fopen(argv[5], "wb");
+        if (out == nullptr || std::fwrite(clip.data(), 1, clip.size(), out) != clip.size()) {
+            std::fprintf(stderr, "cannot write %s\n", argv[5]);
+            return 1;
+        }
+        std::fclose(out);
+    }
+
+    // decode every frame into a wire buffer in 64 word chunks, as when streaming to the PIO
+    ClipPlayer player;
+    if (player.open(clip) != ClipPlayer::OpenResult::Ok) {
+        std::fprintf(stderr, "clip failed to open\n");
+        return 1;
+    }
+    etl::array<uint32_t, 64> chunk;
+    uint32_t frame_index = 0;
+    double ns_per_frame = bench::time_ns([&]() {
+        player.begin_frame(frame_index);
+        frame_index = (frame_index + 1) % player.frame_count();
+        while (player.remaining() > 0) {
+            player.decode(etl::span<uint32_t>(chunk.data(), chunk.size()));
+            bench::do_not_optimize(chunk[0]);
+        }
+    }, bench::iterations_for(frame.num_leds));
+
+    std::printf("# %s: %u frames x %u LEDs, raw %zu bytes, clip %zu bytes, ratio %.1f:1\n",
+                effect->name, static_cast<unsigned>(frames), frame.num_leds, raw_size, clip.size(),
+                static_cast<double>(raw_size) / clip.size());
+    bench::print_header();
+    bench::print_row("clip_decode", effect->name, "wire_chunk64", frame.num_leds,
+                     bench::iterations_for(frame.num_leds), ns_per_frame);
+    return 0;
+}